@@ -2,6 +2,7 @@
 
 #include <yarp/os/LockGuard.h>
 #include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
 #include <yarp/os/Property.h>
 #include <yarp/os/ResourceFinder.h>
 #include <yarp/os/Time.h>
@@ -11,7 +12,11 @@
 
 #include <iDynTree/yarp/YARPConversions.h>
 #include <iDynTree/Core/Utils.h>
+#include <iDynTree/Core/EigenHelpers.h>
 
+#include <Eigen/LU>
+
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -21,12 +26,29 @@ namespace dev
 {
 
 const double floatingBaseEstimator_sensorTimeoutInSeconds = 2.0;
+const size_t floatingBaseEstimator_nrOfChannelsOfAYARPIMUSensor = 12;
+const size_t floatingBaseEstimator_stateSize = 28;
+const size_t floatingBaseEstimator_nrOfChannelsOfYARPFTSensor = 6;
 
 floatingBaseEstimator::floatingBaseEstimator(): RateThread(10),
                                                 portPrefix("/floatingBaseEstimator"),
                                                 correctlyConfigured(false),
                                                 sensorReadCorrectly(false),
-                                                estimationWentWell(false)
+                                                estimationWentWell(false),
+                                                fixedFrameIndex(iDynTree::FRAME_INVALID_INDEX),
+                                                imuFrameIndex(iDynTree::FRAME_INVALID_INDEX),
+                                                imuInterface(0),
+                                                imuTimed(0),
+                                                estimationTime(0.0),
+                                                imuReadCorrectly(false),
+                                                useJointVelocity(true),
+                                                useJointAcceleration(true),
+                                                imuAngularVelocityWeight(0.5),
+                                                timeAlignment(false),
+                                                timeAlignmentBufferSize(10),
+                                                contactSwitchingEnabled(false),
+                                                normalForceThreshold(0.0),
+                                                normalForceHysteresis(0.0)
 {
 }
 
@@ -62,6 +84,37 @@ bool floatingBaseEstimator::openPorts()
         return false;
     }
 
+    ok = statePort.open(portPrefix+"/state:o");
+    if( !ok )
+    {
+        yError() << "floatingBaseEstimator: Impossible to open port " << portPrefix+"/state:o";
+        return false;
+    }
+
+    // Open and connect the ports reading the wrenches used for contact switching
+    for(size_t i=0; i < contactFrames.size(); i++)
+    {
+        if( contactFrames[i].wrench_source.empty() || contactFrames[i].wrench_source[0] != '/' )
+        {
+            continue;
+        }
+
+        std::string portName = portPrefix+"/"+contactFrames[i].frame+"/wrench:i";
+        contactFrames[i].wrench_port = new yarp::os::BufferedPort<yarp::sig::Vector>;
+        ok = contactFrames[i].wrench_port->open(portName);
+        if( !ok )
+        {
+            yError() << "floatingBaseEstimator: Impossible to open port " << portName;
+            return false;
+        }
+
+        if( !yarp::os::Network::connect(contactFrames[i].wrench_source,portName) )
+        {
+            yWarning() << "floatingBaseEstimator: Impossible to connect " << contactFrames[i].wrench_source << " to " << portName
+                       << ", the port should be connected before the contact of " << contactFrames[i].frame << " can be detected";
+        }
+    }
+
     return true;
 }
 
@@ -70,6 +123,17 @@ bool floatingBaseEstimator::closePorts()
     rpcPort.close();
     iCubGuiPort.close();
     WBIPort.close();
+    statePort.close();
+
+    for(size_t i=0; i < contactFrames.size(); i++)
+    {
+        if( contactFrames[i].wrench_port )
+        {
+            contactFrames[i].wrench_port->close();
+            delete contactFrames[i].wrench_port;
+            contactFrames[i].wrench_port = 0;
+        }
+    }
 
     return true;
 }
@@ -130,6 +194,13 @@ bool floatingBaseEstimator::openRemapperControlBoard(os::Searchable& config)
     ok = ok && remappedControlBoard.view(remappedControlBoardInterfaces.encs);
     ok = ok && remappedControlBoard.view(remappedControlBoardInterfaces.multwrap);
 
+    // The timestamps of the encoders are needed only to align the sensors in time
+    remappedControlBoardInterfaces.encsTimed = 0;
+    if( timeAlignment )
+    {
+        ok = ok && remappedControlBoard.view(remappedControlBoardInterfaces.encsTimed);
+    }
+
     if( !ok )
     {
         yError() << "floatingBaseEstimator : open impossible to use the necessary interfaces in remappedControlBoard";
@@ -175,6 +246,35 @@ bool floatingBaseEstimator::openEstimator(os::Searchable& config)
         return false;
     }
 
+    ok = this->kinDynComp.loadRobotModel(estimator.model());
+    ok = ok && this->kinDynComp.setFrameVelocityRepresentation(iDynTree::MIXED_REPRESENTATION);
+    if( !ok )
+    {
+        yError() << "floatingBaseEstimator : error in opening KinDynComputations class";
+        return false;
+    }
+
+    if( !imuFrameName.empty() )
+    {
+        imuFrameIndex = kinDynComp.getRobotModel().getFrameIndex(imuFrameName);
+        if( imuFrameIndex == iDynTree::FRAME_INVALID_INDEX )
+        {
+            yError() << "floatingBaseEstimator : imuFrameName " << imuFrameName << " not found in the model";
+            return false;
+        }
+    }
+
+    for(size_t i=0; i < contactFrames.size(); i++)
+    {
+        iDynTree::FrameIndex frameIndex = kinDynComp.getRobotModel().getFrameIndex(contactFrames[i].frame);
+        if( frameIndex == iDynTree::FRAME_INVALID_INDEX )
+        {
+            yError() << "floatingBaseEstimator : contact frame " << contactFrames[i].frame << " not found in the model";
+            return false;
+        }
+        contactFrames[i].link_index = kinDynComp.getRobotModel().getFrameLink(frameIndex);
+    }
+
     this->resizeBuffers();
     return true;
 }
@@ -183,7 +283,35 @@ bool floatingBaseEstimator::openEstimator(os::Searchable& config)
 void floatingBaseEstimator::resizeBuffers()
 {
     this->jointPos.resize(estimator.model());
-    this->jointVelSetToZero.resize(estimator.model());
+    this->jointVel.resize(estimator.model());
+    this->jointVel.zero();
+    this->jointAcc.resize(estimator.model());
+    this->jointAcc.zero();
+
+    size_t nrOfDOFs = estimator.model().getNrOfDOFs();
+    this->fixedFrameJacobian.resize(6,6+nrOfDOFs);
+    this->imuFrameJacobian.resize(6,6+nrOfDOFs);
+
+    this->baseVel.zero();
+    this->baseAcc.zero();
+    this->gravity.zero();
+    this->gravity(2) = -9.81;
+
+    this->imuMeasurement.resize(floatingBaseEstimator_nrOfChannelsOfAYARPIMUSensor,0.0);
+    this->imuAngularVel.zero();
+
+    this->ftMeasurement.resize(floatingBaseEstimator_nrOfChannelsOfYARPFTSensor,0.0);
+
+    if( timeAlignment )
+    {
+        this->jointTimestamps.resize(nrOfDOFs,0.0);
+        this->lastJointTimestamps.resize(nrOfDOFs,0.0);
+        this->lastJointTimestampChanges.resize(nrOfDOFs,0.0);
+        this->jointBuffers.assign(nrOfDOFs,iCub::ctrl::realTime::TimestampedBuffer(3,timeAlignmentBufferSize));
+        this->imuBuffer.assign(1,iCub::ctrl::realTime::TimestampedBuffer(3,timeAlignmentBufferSize));
+        this->jointSample.resize(3,0.0);
+        this->imuSample.resize(3,0.0);
+    }
 
     this->homMatrixBuffer.resize(4,4);
 }
@@ -215,6 +343,125 @@ bool floatingBaseEstimator::loadSettingsFromConfig(os::Searchable& config)
         initialWorldFrame = initialFixedFrame;
     }
 
+    if( prop.check("useJointVelocity") )
+    {
+        useJointVelocity = prop.find("useJointVelocity").asBool();
+    }
+
+    if( prop.check("useJointAcceleration") )
+    {
+        useJointAcceleration = prop.find("useJointAcceleration").asBool();
+    }
+
+    if( prop.check("imuFrameName") &&
+        prop.find("imuFrameName").isString() )
+    {
+        imuFrameName = prop.find("imuFrameName").asString();
+    }
+
+    if( prop.check("imuAngularVelocityWeight") )
+    {
+        imuAngularVelocityWeight = prop.find("imuAngularVelocityWeight").asDouble();
+        if( imuAngularVelocityWeight < 0.0 || imuAngularVelocityWeight > 1.0 )
+        {
+            yError() << "floatingBaseEstimator : imuAngularVelocityWeight should be in [0,1], while it is " << imuAngularVelocityWeight;
+            return false;
+        }
+    }
+
+    if( prop.check("timeAlignment") )
+    {
+        timeAlignment = prop.find("timeAlignment").asBool();
+    }
+
+    if( prop.check("timeAlignmentBufferSize") )
+    {
+        int bufferSize = prop.find("timeAlignmentBufferSize").asInt();
+        if( bufferSize < 2 )
+        {
+            yError() << "floatingBaseEstimator : timeAlignmentBufferSize should be at least 2, while it is " << bufferSize;
+            return false;
+        }
+        timeAlignmentBufferSize = bufferSize;
+    }
+
+    return loadContactSwitchingSettingsFromConfig(config);
+}
+
+bool floatingBaseEstimator::loadContactSwitchingSettingsFromConfig(os::Searchable& config)
+{
+    contactFrames.resize(0);
+
+    yarp::os::Bottle & contactSwitchingBot = config.findGroup("CONTACT_SWITCHING");
+    if( contactSwitchingBot.isNull() )
+    {
+        // The CONTACT_SWITCHING group is optional
+        contactSwitchingEnabled = false;
+        return true;
+    }
+
+    if( contactSwitchingBot.check("enableContactSwitching") )
+    {
+        contactSwitchingEnabled = contactSwitchingBot.find("enableContactSwitching").asBool();
+    }
+
+    if( !contactSwitchingEnabled )
+    {
+        return true;
+    }
+
+    if( !contactSwitchingBot.check("normalForceThreshold") )
+    {
+        yError() << "floatingBaseEstimator : CONTACT_SWITCHING group found, but normalForceThreshold double parameter missing";
+        return false;
+    }
+    normalForceThreshold = contactSwitchingBot.find("normalForceThreshold").asDouble();
+
+    normalForceHysteresis = 0.0;
+    if( contactSwitchingBot.check("normalForceHysteresis") )
+    {
+        normalForceHysteresis = contactSwitchingBot.find("normalForceHysteresis").asDouble();
+        if( normalForceHysteresis < 0.0 )
+        {
+            yError() << "floatingBaseEstimator : normalForceHysteresis should be non negative, while it is " << normalForceHysteresis;
+            return false;
+        }
+    }
+
+    yarp::os::Bottle * contactFramesBot = contactSwitchingBot.find("contactFrames").asList();
+    if( contactFramesBot == 0 || contactFramesBot->size() == 0 )
+    {
+        yError() << "floatingBaseEstimator : CONTACT_SWITCHING group found, but contactFrames list parameter missing";
+        return false;
+    }
+
+    for(int i=0; i < contactFramesBot->size(); i++)
+    {
+        yarp::os::Bottle * contactFrameBot = contactFramesBot->get(i).asList();
+        if( contactFrameBot == 0 || contactFrameBot->size() != 5 )
+        {
+            yError() << "floatingBaseEstimator : malformed element " << contactFramesBot->get(i).toString()
+                     << " of contactFrames, expecting (frameName wrenchSource nx ny nz)";
+            return false;
+        }
+
+        contactSwitchingFrameInformation contactFrame;
+        contactFrame.frame = contactFrameBot->get(0).asString();
+        contactFrame.wrench_source = contactFrameBot->get(1).asString();
+        contactFrame.link_index = iDynTree::LINK_INVALID_INDEX;
+        for(int j=0; j < 3; j++)
+        {
+            contactFrame.normal_direction(j) = contactFrameBot->get(2+j).asDouble();
+        }
+        contactFrame.ft_sensor = 0;
+        contactFrame.wrench_port = 0;
+        contactFrame.normal_force = 0.0;
+        contactFrame.has_wrench_sample = false;
+        contactFrame.in_contact = false;
+
+        contactFrames.push_back(contactFrame);
+    }
+
     return true;
 }
 
@@ -271,6 +518,83 @@ bool floatingBaseEstimator::attachAllControlBoard(const PolyDriverList& p)
     return true;
 }
 
+bool floatingBaseEstimator::attachAllIMUs(const PolyDriverList& p)
+{
+    std::vector<IGenericSensor*> imuList;
+    std::vector<IPreciselyTimed*> imuTimedList;
+
+    for(size_t devIdx = 0; devIdx < (size_t)p.size(); devIdx++)
+    {
+        IGenericSensor * pGenericSensor = 0;
+        if( p[devIdx]->poly->view(pGenericSensor) )
+        {
+            // The timestamps are optional
+            IPreciselyTimed * pTimed = 0;
+            p[devIdx]->poly->view(pTimed);
+
+            imuList.push_back(pGenericSensor);
+            imuTimedList.push_back(pTimed);
+        }
+    }
+
+    if( imuList.size() != 1 )
+    {
+        yError() << "floatingBaseEstimator was expecting only one IMU, but it did find " << imuList.size() << " in the attached devices";
+        return false;
+    }
+
+    this->imuInterface = imuList[0];
+    this->imuTimed = imuTimedList[0];
+
+    // Make sure that the IMU actually works before starting the thread
+    bool verbose = false;
+    double tic = yarp::os::Time::now();
+    bool readSuccessfull = false;
+    while( (yarp::os::Time::now() - tic < floatingBaseEstimator_sensorTimeoutInSeconds) && !readSuccessfull )
+    {
+        readSuccessfull = readIMUSensors(verbose);
+    }
+
+    if( !readSuccessfull )
+    {
+        yError() << "floatingBaseEstimator was unable to correctly read from the IMU for " << floatingBaseEstimator_sensorTimeoutInSeconds << " seconds, exiting.";
+    }
+
+    return readSuccessfull;
+}
+
+bool floatingBaseEstimator::attachAllFTs(const PolyDriverList& p)
+{
+    for(size_t i=0; i < contactFrames.size(); i++)
+    {
+        if( contactFrames[i].wrench_port )
+        {
+            continue;
+        }
+
+        // The wrench source is the name of an F/T sensor in the attach list
+        for(size_t devIdx = 0; devIdx < (size_t)p.size(); devIdx++)
+        {
+            IAnalogSensor * pAnalogSens = 0;
+            if( p[devIdx]->key == contactFrames[i].wrench_source &&
+                p[devIdx]->poly->view(pAnalogSens) &&
+                pAnalogSens->getChannels() == (int)floatingBaseEstimator_nrOfChannelsOfYARPFTSensor )
+            {
+                contactFrames[i].ft_sensor = pAnalogSens;
+            }
+        }
+
+        if( !contactFrames[i].ft_sensor )
+        {
+            yError() << "floatingBaseEstimator was expecting an F/T sensor named " << contactFrames[i].wrench_source
+                     << " for the contact frame " << contactFrames[i].frame << " but it did not find one in the attached devices";
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool floatingBaseEstimator::attachAll(const PolyDriverList& p)
 {
     yarp::os::LockGuard guard(this->deviceMutex);
@@ -278,6 +602,16 @@ bool floatingBaseEstimator::attachAll(const PolyDriverList& p)
     bool ok = true;
     ok = ok && this->attachAllControlBoard(p);
 
+    if( !imuFrameName.empty() )
+    {
+        ok = ok && this->attachAllIMUs(p);
+    }
+
+    if( contactSwitchingEnabled )
+    {
+        ok = ok && this->attachAllFTs(p);
+    }
+
     if( ok )
     {
         this->start();
@@ -304,12 +638,161 @@ void floatingBaseEstimator_convertVectorFromDegreesToRadians(iDynTree::VectorDyn
 void floatingBaseEstimator::readSensors()
 {
     // Read encoders
-    sensorReadCorrectly = remappedControlBoardInterfaces.encs->getEncoders(jointPos.data());
+    if( timeAlignment )
+    {
+        sensorReadCorrectly = remappedControlBoardInterfaces.encsTimed->getEncodersTimed(jointPos.data(),jointTimestamps.data());
+    }
+    else
+    {
+        sensorReadCorrectly = remappedControlBoardInterfaces.encs->getEncoders(jointPos.data());
+    }
 
     // Convert from degrees (used on wire by YARP) to radians (used by iDynTree)
     floatingBaseEstimator_convertVectorFromDegreesToRadians(jointPos);
 
-    jointVelSetToZero.zero();
+    bool ok;
+
+    if( useJointVelocity )
+    {
+        ok = remappedControlBoardInterfaces.encs->getEncoderSpeeds(jointVel.data());
+        sensorReadCorrectly = sensorReadCorrectly && ok;
+        floatingBaseEstimator_convertVectorFromDegreesToRadians(jointVel);
+    }
+
+    if( useJointAcceleration )
+    {
+        ok = remappedControlBoardInterfaces.encs->getEncoderAccelerations(jointAcc.data());
+        sensorReadCorrectly = sensorReadCorrectly && ok;
+        floatingBaseEstimator_convertVectorFromDegreesToRadians(jointAcc);
+    }
+
+    // A failure of the IMU is not fatal, the angular velocity is then estimated from the kinematics only
+    if( imuInterface )
+    {
+        imuReadCorrectly = readIMUSensors();
+    }
+
+    if( timeAlignment && sensorReadCorrectly )
+    {
+        alignSensorsInTime();
+        stateStamp.update(estimationTime);
+    }
+    else
+    {
+        stateStamp.update();
+    }
+}
+
+double floatingBaseEstimator_getJointTimestamp(const double timestamp, double & lastTimestamp, double & lastTimestampChange,
+                                               const double receptionTime, const double frozenTimeout)
+{
+    // A repeated timestamp is the same measurement read again, and the buffer drops it.
+    // Only a timestamp that is not valid, or that did not change for longer than
+    // frozenTimeout (i.e. a board that does not update it), is replaced by the time of reading
+    if( timestamp != lastTimestamp )
+    {
+        lastTimestamp = timestamp;
+        lastTimestampChange = receptionTime;
+    }
+    if( timestamp <= 0.0 || receptionTime-lastTimestampChange > frozenTimeout )
+    {
+        return receptionTime;
+    }
+    return timestamp;
+}
+
+double floatingBaseEstimator_getTimestamp(IPreciselyTimed * timedInterface, const double receptionTime)
+{
+    // If the device does not provide a timestamp, the time of reading is used
+    if( timedInterface )
+    {
+        yarp::os::Stamp stamp = timedInterface->getLastInputStamp();
+        if( stamp.isValid() && stamp.getTime() > 0.0 )
+        {
+            return stamp.getTime();
+        }
+    }
+
+    return receptionTime;
+}
+
+void floatingBaseEstimator::alignSensorsInTime()
+{
+    double receptionTime = yarp::os::Time::now();
+    // A joint timestamp is considered frozen if it does not change for the whole buffered interval
+    double frozenTimeout = timeAlignmentBufferSize*getRate()/1000.0;
+
+    for(size_t dof=0; dof < jointBuffers.size(); dof++)
+    {
+        jointSample[0] = jointPos(dof);
+        jointSample[1] = jointVel(dof);
+        jointSample[2] = jointAcc(dof);
+        jointBuffers[dof].push(floatingBaseEstimator_getJointTimestamp(jointTimestamps[dof],lastJointTimestamps[dof],lastJointTimestampChanges[dof],
+                                                                       receptionTime,frozenTimeout),
+                               jointSample,receptionTime);
+    }
+
+    bool useIMU = (imuInterface && imuReadCorrectly);
+    if( useIMU )
+    {
+        for(size_t i=0; i < 3; i++)
+        {
+            imuSample[i] = imuAngularVel(i);
+        }
+        imuBuffer[0].push(floatingBaseEstimator_getTimestamp(imuTimed,receptionTime),imuSample,receptionTime);
+    }
+
+    // The estimation time is the most recent time for which all the sensors have a measurement,
+    // so that the measurements are only interpolated, never extrapolated (empty buffers are skipped)
+    estimationTime = receptionTime;
+    for(size_t dof=0; dof < jointBuffers.size(); dof++)
+    {
+        if( jointBuffers[dof].getNrOfSamples() > 0 )
+        {
+            estimationTime = std::min(estimationTime,jointBuffers[dof].getNewestTimestamp());
+        }
+    }
+    if( useIMU && imuBuffer[0].getNrOfSamples() > 0 )
+    {
+        estimationTime = std::min(estimationTime,imuBuffer[0].getNewestTimestamp());
+    }
+
+    // Replace the measurements with the interpolated ones
+    for(size_t dof=0; dof < jointBuffers.size(); dof++)
+    {
+        jointBuffers[dof].interpolate(estimationTime,jointSample);
+        jointPos(dof) = jointSample[0];
+        jointVel(dof) = jointSample[1];
+        jointAcc(dof) = jointSample[2];
+    }
+
+    if( useIMU && imuBuffer[0].interpolate(estimationTime,imuSample) )
+    {
+        for(size_t i=0; i < 3; i++)
+        {
+            imuAngularVel(i) = imuSample[i];
+        }
+    }
+}
+
+bool floatingBaseEstimator::readIMUSensors(bool verbose)
+{
+    bool ok = imuInterface->read(imuMeasurement);
+
+    if( !ok && verbose )
+    {
+        yWarning() << "floatingBaseEstimator warning : imu sensor was not readed correctly";
+    }
+
+    if( ok )
+    {
+        // Check format of IMU in YARP http://wiki.icub.org/wiki/Inertial_Sensor
+        imuAngularVel(0) = floatingBaseEstimator_deg2rad(imuMeasurement[6]);
+        imuAngularVel(1) = floatingBaseEstimator_deg2rad(imuMeasurement[7]);
+        imuAngularVel(2) = floatingBaseEstimator_deg2rad(imuMeasurement[8]);
+    }
+
+    return ok;
 }
 
 void floatingBaseEstimator::updateKinematics()
@@ -317,6 +800,159 @@ void floatingBaseEstimator::updateKinematics()
     estimationWentWell = estimator.updateKinematics(jointPos);
 }
 
+void floatingBaseEstimator::updateFixedFrameIndex()
+{
+    fixedFrameIndex = kinDynComp.getRobotModel().getFrameIndex(estimator.getCurrentFixedLink());
+}
+
+void floatingBaseEstimator::readContactWrenches()
+{
+    for(size_t i=0; i < contactFrames.size(); i++)
+    {
+        contactSwitchingFrameInformation & contactFrame = contactFrames[i];
+
+        // If no new measurement is available, the previous normal force is kept
+        const yarp::sig::Vector * wrench = 0;
+        if( contactFrame.ft_sensor )
+        {
+            if( contactFrame.ft_sensor->read(ftMeasurement) == IAnalogSensor::AS_OK )
+            {
+                wrench = &ftMeasurement;
+            }
+        }
+        else if( contactFrame.wrench_port )
+        {
+            wrench = contactFrame.wrench_port->read(false);
+        }
+
+        if( wrench && wrench->size() >= 3 )
+        {
+            contactFrame.normal_force = (*wrench)[0]*contactFrame.normal_direction(0)
+                                      + (*wrench)[1]*contactFrame.normal_direction(1)
+                                      + (*wrench)[2]*contactFrame.normal_direction(2);
+            contactFrame.has_wrench_sample = true;
+        }
+
+        if( !contactFrame.has_wrench_sample )
+        {
+            continue;
+        }
+
+        if( contactFrame.in_contact )
+        {
+            contactFrame.in_contact = (contactFrame.normal_force >= normalForceThreshold - normalForceHysteresis);
+        }
+        else
+        {
+            contactFrame.in_contact = (contactFrame.normal_force > normalForceThreshold);
+        }
+    }
+}
+
+void floatingBaseEstimator::switchFixedFrameFromContacts()
+{
+    int fixedContactFrame = -1;
+    int bestContactFrame = -1;
+    iDynTree::LinkIndex fixedLinkIndex = kinDynComp.getRobotModel().getLinkIndex(estimator.getCurrentFixedLink());
+    for(size_t i=0; i < contactFrames.size(); i++)
+    {
+        if( contactFrames[i].link_index == fixedLinkIndex )
+        {
+            fixedContactFrame = i;
+        }
+
+        if( contactFrames[i].in_contact &&
+            (bestContactFrame < 0 || contactFrames[i].normal_force > contactFrames[bestContactFrame].normal_force) )
+        {
+            bestContactFrame = i;
+        }
+    }
+
+    // The fixed frame is moved only if it is one of the contact frames and it lost its contact,
+    // a fixed frame whose wrench source did not produce any sample yet is not considered as lost
+    if( fixedContactFrame < 0 ||
+        !contactFrames[fixedContactFrame].has_wrench_sample ||
+        contactFrames[fixedContactFrame].in_contact ||
+        bestContactFrame < 0 )
+    {
+        return;
+    }
+
+    if( this->estimator.changeFixedFrame(contactFrames[bestContactFrame].frame) )
+    {
+        this->updateFixedFrameIndex();
+        yInfo() << "floatingBaseEstimator : " << contactFrames[fixedContactFrame].frame << " lost contact, switching fixed frame to "
+                << contactFrames[bestContactFrame].frame;
+    }
+    else
+    {
+        yError() << "floatingBaseEstimator : impossible to switch fixed frame to " << contactFrames[bestContactFrame].frame;
+    }
+}
+
+bool floatingBaseEstimator::computeBaseVelocityAndAcceleration()
+{
+    typedef Eigen::Matrix<double,6,6> Matrix6d;
+    typedef Eigen::Matrix<double,6,1> Vector6d;
+
+    const size_t nrOfDOFs = jointPos.size();
+
+    world_H_base = estimator.getWorldLinkTransform(estimator.model().getDefaultBaseLink());
+
+    // The Jacobian does not depend on the base velocity, that is still unknown
+    baseTwist.zero();
+    bool ok = kinDynComp.setRobotState(world_H_base,jointPos,baseTwist,jointVel,gravity);
+    ok = ok && kinDynComp.getFrameFreeFloatingJacobian(fixedFrameIndex,fixedFrameJacobian);
+    if( !ok )
+    {
+        return false;
+    }
+
+    // The fixed frame is still: J_base*v_base + J_joints*dq = 0
+    // In mixed representation J_base is always invertible
+    Matrix6d jacobianBase = toEigen(fixedFrameJacobian).leftCols<6>();
+    Eigen::PartialPivLU<Matrix6d> jacobianBaseLU(jacobianBase);
+
+    Vector6d jointsContribution;
+    jointsContribution.noalias() = toEigen(fixedFrameJacobian).rightCols(nrOfDOFs)*toEigen(jointVel);
+    toEigen(baseVel) = -jacobianBaseLU.solve(jointsContribution);
+
+    // Optionally replace part of the kinematic angular velocity with the one of the gyroscope,
+    // removing the contribution of the joints between the base and the IMU frame
+    if( imuInterface && imuReadCorrectly )
+    {
+        ok = kinDynComp.getFrameFreeFloatingJacobian(imuFrameIndex,imuFrameJacobian);
+        if( ok )
+        {
+            Eigen::Vector3d imuAngularVelInWorld =
+                toEigen(kinDynComp.getWorldTransform(imuFrameIndex).getRotation())*toEigen(imuAngularVel);
+            Eigen::Vector3d baseAngularVelFromIMU = imuAngularVelInWorld;
+            baseAngularVelFromIMU.noalias() -= toEigen(imuFrameJacobian).bottomRightCorner(3,nrOfDOFs)*toEigen(jointVel);
+            toEigen(baseVel).tail<3>() = (1.0-imuAngularVelocityWeight)*toEigen(baseVel).tail<3>()
+                                         + imuAngularVelocityWeight*baseAngularVelFromIMU;
+        }
+    }
+
+    for(unsigned int i=0; i < 6; i++)
+    {
+        baseTwist(i) = baseVel(i);
+    }
+
+    // Differentiating the constraint: J_base*a_base + J_joints*ddq + dJ*nu = 0,
+    // where the bias dJ*nu depends on the base twist just estimated
+    ok = kinDynComp.setRobotState(world_H_base,jointPos,baseTwist,jointVel,gravity);
+    if( !ok )
+    {
+        return false;
+    }
+
+    jointsContribution = toEigen(kinDynComp.getFrameBiasAcc(fixedFrameIndex));
+    jointsContribution.noalias() += toEigen(fixedFrameJacobian).rightCols(nrOfDOFs)*toEigen(jointAcc);
+    toEigen(baseAcc) = -jacobianBaseLU.solve(jointsContribution);
+
+    return true;
+}
+
 void floatingBaseEstimator::publishEstimatedQuantities()
 {
     if( !estimationWentWell )
@@ -327,6 +963,7 @@ void floatingBaseEstimator::publishEstimatedQuantities()
     {
         publishFloatingBasePosInWBIFormat();
         publishFloatingBasePosIniCubGuiFormat();
+        publishFloatingBaseState();
     }
 }
 
@@ -380,6 +1017,32 @@ void floatingBaseEstimator::publishFloatingBasePosInWBIFormat()
 
 
 
+void floatingBaseEstimator::publishFloatingBaseState()
+{
+    yarp::sig::Vector & state = this->statePort.prepare();
+    state.resize(floatingBaseEstimator_stateSize);
+
+    for(unsigned int row=0; row < 3; row++)
+    {
+        for(unsigned int col=0; col < 3; col++)
+        {
+            state[4*row+col] = world_H_base.getRotation()(row,col);
+        }
+        state[4*row+3] = world_H_base.getPosition()(row);
+    }
+    state[12] = state[13] = state[14] = 0.0;
+    state[15] = 1.0;
+
+    for(unsigned int i=0; i < 6; i++)
+    {
+        state[16+i] = baseVel(i);
+        state[22+i] = baseAcc(i);
+    }
+
+    this->statePort.setEnvelope(stateStamp);
+    this->statePort.write();
+}
+
 template <class T> void fbe_broadcastData(T& _values, yarp::os::BufferedPort<T>& _port)
 {
     if (_port.getOutputCount()>0 )
@@ -404,6 +1067,7 @@ void floatingBaseEstimator::run()
             // first run, configure the estimator
             this->updateKinematics();
             correctlyConfigured = this->estimator.init(initialFixedFrame,initialWorldFrame);
+            this->updateFixedFrameIndex();
         }
 
         if( correctlyConfigured )
@@ -411,6 +1075,17 @@ void floatingBaseEstimator::run()
             // Update kinematics
             this->updateKinematics();
 
+            // Switch the fixed frame if its contact was lost, so that the estimates of this cycle
+            // are already computed with the new fixed frame
+            if( contactSwitchingEnabled && estimationWentWell )
+            {
+                this->readContactWrenches();
+                this->switchFixedFrameFromContacts();
+            }
+
+            // Estimate the base twist and acceleration
+            estimationWentWell = estimationWentWell && this->computeBaseVelocityAndAcceleration();
+
             // Publish estimated quantities
             this->publishEstimatedQuantities();
         }
@@ -456,7 +1131,9 @@ bool floatingBaseEstimator::resetSimpleLeggedOdometry(const std::string& initial
                                                       const std::string& initial_fixed_frame)
 {
     yarp::os::LockGuard guard(this->deviceMutex);
-    return this->estimator.init(initial_fixed_frame,initial_world_frame);
+    bool ok = this->estimator.init(initial_fixed_frame,initial_world_frame);
+    this->updateFixedFrameIndex();
+    return ok;
 }
 
 iDynTree::Transform thrift2iDynTree(const codyco::HomTransform& thriftTrans)
@@ -492,14 +1169,18 @@ bool floatingBaseEstimator::resetSimpleLeggedOdometryToArbitraryFrame(const std:
 {
     iDynTree::Transform initial_reference_frame_H_world = thrift2iDynTree(initial_reference_frame_H_world_thrift);
     yarp::os::LockGuard guard(this->deviceMutex);
-    return this->estimator.init(initial_fixed_frame,initial_reference_frame,initial_reference_frame_H_world);
+    bool ok = this->estimator.init(initial_fixed_frame,initial_reference_frame,initial_reference_frame_H_world);
+    this->updateFixedFrameIndex();
+    return ok;
 }
 
 
 bool floatingBaseEstimator::changeFixedLinkSimpleLeggedOdometry(const std::string& new_fixed_frame)
 {
     yarp::os::LockGuard guard(this->deviceMutex);
-    return this->estimator.changeFixedFrame(new_fixed_frame);
+    bool ok = this->estimator.changeFixedFrame(new_fixed_frame);
+    this->updateFixedFrameIndex();
+    return ok;
 }
 
 std::string floatingBaseEstimator::getCurrentSettingsString()
@@ -508,6 +1189,46 @@ std::string floatingBaseEstimator::getCurrentSettingsString()
     std::stringstream ss;
     ss << "Current settings for floatingBaseEstimator\n";
     ss << "Used estimator: simpleLeggedOdometry\n";
+    ss << "Joint velocities used: " << (this->useJointVelocity ? "yes" : "no") << "\n";
+    ss << "Joint accelerations used: " << (this->useJointAcceleration ? "yes" : "no") << "\n";
+    if( this->contactSwitchingEnabled )
+    {
+        ss << "Contact switching: normal force threshold " << this->normalForceThreshold
+           << " N, hysteresis " << this->normalForceHysteresis << " N\n";
+        for(size_t i=0; i < this->contactFrames.size(); i++)
+        {
+            ss << "  " << this->contactFrames[i].frame << " (" << this->contactFrames[i].wrench_source << "): ";
+            if( !this->contactFrames[i].has_wrench_sample )
+            {
+                ss << "no wrench received yet\n";
+                continue;
+            }
+            ss << "normal force " << this->contactFrames[i].normal_force << " N, "
+               << (this->contactFrames[i].in_contact ? "in contact" : "not in contact") << "\n";
+        }
+    }
+    if( this->timeAlignment )
+    {
+        // Latency is the difference between the time of reading and the timestamp of each sensor
+        double maxJointLatency = 0.0;
+        double meanJointLatency = 0.0;
+        for(size_t dof=0; dof < this->jointBuffers.size(); dof++)
+        {
+            maxJointLatency = std::max(maxJointLatency,this->jointBuffers[dof].getMaxLatency());
+            meanJointLatency += this->jointBuffers[dof].getMeanLatency()/this->jointBuffers.size();
+        }
+        ss << "Time alignment enabled, estimation time delay: " << yarp::os::Time::now() - this->estimationTime << " s\n";
+        ss << "Encoders latency: mean " << meanJointLatency << " s, max " << maxJointLatency << " s\n";
+        if( this->imuInterface )
+        {
+            ss << "IMU latency: last " << this->imuBuffer[0].getLastLatency() << " s, mean " << this->imuBuffer[0].getMeanLatency()
+               << " s, max " << this->imuBuffer[0].getMaxLatency() << " s" << (this->imuTimed ? "" : " (no timestamps)") << "\n";
+        }
+    }
+    if( this->imuInterface )
+    {
+        ss << "IMU frame: " << this->imuFrameName << " (angular velocity weight " << this->imuAngularVelocityWeight << ")\n";
+    }
     ss << "Current fixedLink: " << this->estimator.getCurrentFixedLink() << "\n";
     ss << "Current world_H_fixedLink: " << this->estimator.getWorldLinkTransform(this->estimator.model().getLinkIndex(this->estimator.getCurrentFixedLink())).toString() << "\n";
     return ss.str();
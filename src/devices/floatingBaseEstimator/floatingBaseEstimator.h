@@ -6,15 +6,23 @@
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/dev/ControlBoardInterfaces.h>
 #include <yarp/dev/Wrapper.h>
+#include <yarp/dev/GenericSensorInterfaces.h>
+#include <yarp/dev/IAnalogSensor.h>
+#include <yarp/dev/PreciselyTimed.h>
+#include <yarp/os/BufferedPort.h>
 #include <yarp/os/RateThread.h>
+#include <yarp/os/Stamp.h>
 #include <yarp/sig/Matrix.h>
 #include <yarp/sig/Vector.h>
 
 // iDynTree includes
 #include <iDynTree/Estimation/SimpleLeggedOdometry.h>
+#include <iDynTree/KinDynComputations.h>
 
 #include <codyco/floatingBaseEstimatorRPC.h>
 
+#include "ctrlLibRT/timestampedBuffer.h"
+
 
 #include <vector>
 
@@ -22,6 +30,23 @@
 namespace yarp {
 namespace dev {
 
+/**
+ * Structure of information relative to a frame that can be
+ * automatically selected as the fixed frame of the odometry.
+ */
+struct contactSwitchingFrameInformation
+{
+    std::string frame;
+    std::string wrench_source;
+    iDynTree::LinkIndex link_index;
+    iDynTree::Vector3 normal_direction;
+    yarp::dev::IAnalogSensor * ft_sensor;
+    yarp::os::BufferedPort<yarp::sig::Vector> * wrench_port;
+    double normal_force;
+    bool has_wrench_sample;
+    bool in_contact;
+};
+
 /**
  * \section floatingBaseEstimator
  * A device that takes a list of axes and estimates the .
@@ -33,6 +58,37 @@ namespace dev {
  * | modelFile      |      -         | path to file      |   -   | model.urdf    | No       | Path to the URDF file used for the kinematic and dynamic model.   |       |
  * | initialFixedFrame  | string | - | - | Yes | Name of a frame attached to the link that is assumed to be fixed at start | - |
  * | initialWorldFrame | string | - | Equal to initialFixedFrame | No | Name of the frame of the model that is supposed to be coincident with the world/inertial frame at start | - |
+ * | useJointVelocity | bool | - | true | No | Read the joint velocities from the encoders to estimate the base twist, otherwise the base is assumed still | - |
+ * | useJointAcceleration | bool | - | true | No | Read the joint accelerations from the encoders to estimate the base acceleration, otherwise they are assumed to be zero | - |
+ * | imuFrameName | string | - | - | No | Name of the frame of the model where the IMU attached to the device is placed. If missing, no IMU is attached | - |
+ * | imuAngularVelocityWeight | double | - | 0.5 | No | Weight in [0,1] of the IMU gyroscope in the estimated angular velocity of the base, the kinematics having the complementary weight | Used only if imuFrameName is given |
+ * | timeAlignment | bool | - | false | No | If true, the encoders and IMU measurements are buffered with their timestamps and linearly interpolated at a common estimation time, the most recent time for which all of them have a measurement | The state:o port is stamped with the estimation time, and the sensor latencies are reported by getCurrentSettingsString |
+ * | timeAlignmentBufferSize | int | - | 10 | No | Number of measurements buffered for each sensor when timeAlignment is true | - |
+ * | CONTACT_SWITCHING | - | group | - | - | No | Group configuring the automatic switching of the fixed frame from the measured contact forces | |
+ * |                | enableContactSwitching | bool | - | false | No | Enable the automatic switching of the fixed frame | |
+ * |                | normalForceThreshold | double | N | - | Yes | A frame comes in contact when its normal force exceeds this threshold | |
+ * |                | normalForceHysteresis | double | N | 0.0 | No | A frame in contact loses it when its normal force is below normalForceThreshold-normalForceHysteresis | |
+ * |                | contactFrames | list of bottles | - | - | Yes | Each element is (frameName wrenchSource nx ny nz): the candidate fixed frame, the attached F/T sensor device or the port (starting with /) streaming its wrench, and the direction of the normal force in the frame of the measured wrench | |
+ *
+ * Besides the pose published on the floatingbasestate:o and base:o ports, the device publishes on the
+ * state:o port a vector with a fixed layout of 28 elements, timestamped in its envelope:
+ * | Elements | Content |
+ * |:--------:|:-------:|
+ * | 0-15  | world_H_base homogeneous transform, row-major |
+ * | 16-21 | Base twist (linear, angular) in mixed representation, i.e. the velocity of the base origin and the angular velocity, both in the world frame |
+ * | 22-27 | Base acceleration (linear, angular), the time derivative of the twist |
+ *
+ * The twist and the acceleration are computed from the joint velocities and accelerations,
+ * assuming that the current fixed frame of the odometry has zero velocity and acceleration.
+ *
+ * \subsection ContactSwitching
+ * If contact switching is enabled, at each cycle the normal force of each contact frame is read from its wrench source.
+ * When the link of the current fixed frame is one of the contact frames and it is not in contact anymore, the
+ * fixed frame is moved to the contact frame in contact with the largest normal force, in the same cycle in which
+ * the contact is lost. The wrench sources can be F/T sensors attached to the device (identified by their name in
+ * the attach list) or the external wrench ports of wholeBodyDynamics, that are connected to the input ports
+ * <portPrefix>/<frameName>/wrench:i. If the current fixed frame is not among the contact frames, as after
+ * a reset on an arbitrary frame, it is changed only through RPC.
  *
  * The axes contained in the axesNames parameter are then mapped to the wrapped controlboard in the attachAll method, using controlBoardRemapper class.
  * Furthermore are also used to match the yarp axes to the joint names found in the passed URDF file.
@@ -92,6 +148,7 @@ private:
     struct
     {
         yarp::dev::IEncoders        * encs;
+        yarp::dev::IEncodersTimed   * encsTimed;
         yarp::dev::IMultipleWrapper * multwrap;
     } remappedControlBoardInterfaces;
 
@@ -127,6 +184,19 @@ private:
      */
     bool attachAllControlBoard(const PolyDriverList& p);
 
+    /**
+     * Attach the IMU, if imuFrameName was given.
+     * A device is identified as an IMU if it
+     * implements the IGenericSensor interface.
+     */
+    bool attachAllIMUs(const PolyDriverList& p);
+
+    /**
+     * Attach the F/T sensors used as wrench sources for contact switching.
+     * An F/T sensor is identified by its name in the attach list.
+     */
+    bool attachAllFTs(const PolyDriverList& p);
+
     /**
      * Run-related methods.
      */
@@ -136,23 +206,62 @@ private:
      * the internal buffers, false otherwise.
      */
     void readSensors();
+    bool readIMUSensors(bool verbose=true);
+
+    /**
+     * Buffer the measurements just read and replace them with the ones
+     * interpolated at the common estimation time.
+     */
+    void alignSensorsInTime();
     void updateKinematics();
 
+    /**
+     * Compute the base twist and acceleration from the joint velocities and
+     * accelerations, imposing the fixed frame of the odometry to be still.
+     * Return false if the kinematics could not be computed.
+     */
+    bool computeBaseVelocityAndAcceleration();
+
+    /**
+     * Update the index of the current fixed frame of the odometry in kinDynComp,
+     * to be called each time the fixed frame of the estimator changes.
+     */
+    void updateFixedFrameIndex();
+
+    /**
+     * Read the normal force of the contact frames and update their contact state with hysteresis.
+     * The contact state of a frame stays undecided until its wrench source produced at least one sample.
+     */
+    void readContactWrenches();
+
+    /**
+     * Move the fixed frame of the odometry to a contact frame in contact,
+     * if the current fixed frame lost its contact.
+     */
+    void switchFixedFrameFromContacts();
+
     // Publish related methods
     void publishEstimatedQuantities();
     void publishFloatingBasePosInWBIFormat();
     void publishFloatingBasePosIniCubGuiFormat();
+    void publishFloatingBaseState();
 
     /**
      * Load settings from config.
      */
     bool loadSettingsFromConfig(yarp::os::Searchable& config);
+    bool loadContactSwitchingSettingsFromConfig(yarp::os::Searchable& config);
 
     /**
      * Class actually doing computations.
      */
     iDynTree::SimpleLeggedOdometry estimator;
 
+    /**
+     * Class computing the Jacobians of the model, loaded with the model of the estimator.
+     */
+    iDynTree::KinDynComputations kinDynComp;
+
     /**
      * Buffers related methods
      */
@@ -166,8 +275,50 @@ private:
     /// < Joint position read from controlboard
     iDynTree::JointPosDoubleArray  jointPos;
 
-    /// < Joint velocities (for now set to zero)
-    iDynTree::JointDOFsDoubleArray jointVelSetToZero;
+    /// < Joint velocities read from controlboard (zero if useJointVelocity is false)
+    iDynTree::JointDOFsDoubleArray jointVel;
+
+    /// < Joint accelerations read from controlboard (zero if useJointAcceleration is false)
+    iDynTree::JointDOFsDoubleArray jointAcc;
+
+    /// < Index in kinDynComp of the current fixed frame of the odometry
+    iDynTree::FrameIndex fixedFrameIndex;
+
+    /// < Index in kinDynComp of the frame of the IMU
+    iDynTree::FrameIndex imuFrameIndex;
+
+    /// < Free floating Jacobians of the fixed frame and of the IMU frame
+    iDynTree::MatrixDynSize fixedFrameJacobian;
+    iDynTree::MatrixDynSize imuFrameJacobian;
+
+    /// < Estimated base pose, twist and acceleration (mixed representation)
+    iDynTree::Transform world_H_base;
+    iDynTree::Twist     baseTwist;
+    iDynTree::Vector6   baseVel;
+    iDynTree::Vector6   baseAcc;
+
+    /// < Gravity in the world frame, passed to kinDynComp
+    iDynTree::Vector3 gravity;
+
+    /// < IMU measurement, in the YARP inertial sensor format
+    yarp::dev::IGenericSensor * imuInterface;
+    yarp::dev::IPreciselyTimed * imuTimed;
+    yarp::sig::Vector imuMeasurement;
+    iDynTree::Vector3 imuAngularVel;
+    bool imuReadCorrectly;
+
+    /// < Buffer for the F/T sensors measurement
+    yarp::sig::Vector ftMeasurement;
+
+    /// < Time alignment buffers: position, velocity and acceleration of each joint, and IMU angular velocity
+    double estimationTime;
+    std::vector<double> jointTimestamps;
+    std::vector<double> lastJointTimestamps;
+    std::vector<double> lastJointTimestampChanges;
+    std::vector<iCub::ctrl::realTime::TimestampedBuffer> jointBuffers;
+    std::vector<iCub::ctrl::realTime::TimestampedBuffer> imuBuffer;
+    yarp::sig::Vector jointSample;
+    yarp::sig::Vector imuSample;
 
     /**
      * RPC Calibration related attributes
@@ -184,12 +335,28 @@ private:
      */
     yarp::os::BufferedPort<yarp::sig::Vector> iCubGuiPort;
 
+    /**
+     * Port for publishing the pose, twist and acceleration of the base
+     */
+    yarp::os::BufferedPort<yarp::sig::Vector> statePort;
+    yarp::os::Stamp stateStamp;
+
     // Buffers
     yarp::sig::Matrix homMatrixBuffer;
 
     // Settings
     std::string initialWorldFrame;
     std::string initialFixedFrame;
+    bool useJointVelocity;
+    bool useJointAcceleration;
+    std::string imuFrameName;
+    double imuAngularVelocityWeight;
+    bool timeAlignment;
+    size_t timeAlignmentBufferSize;
+    bool contactSwitchingEnabled;
+    double normalForceThreshold;
+    double normalForceHysteresis;
+    std::vector<contactSwitchingFrameInformation> contactFrames;
 
     // RPC methods
     virtual bool resetSimpleLeggedOdometry(const std::string& initial_world_frame, const std::string& initial_fixed_frame);
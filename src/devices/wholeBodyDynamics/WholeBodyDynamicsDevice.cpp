@@ -13,8 +13,10 @@
 #include <iDynTree/yarp/YARPConversions.h>
 #include <iDynTree/Core/Utils.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <sstream>
 
 namespace yarp
 {
@@ -44,6 +46,13 @@ WholeBodyDynamicsDevice::WholeBodyDynamicsDevice(): RateThread(10),
     calibrationBuffers.nrOfSamplesToUseForCalibration = 0;
     calibrationBuffers.nrOfSamplesUsedUntilNowForCalibration = 0;
 
+    // Time alignment quantities
+    remappedControlBoardInterfaces.encsTimed = 0;
+    imuInterface = 0;
+    imuTimed = 0;
+    timeAlignment.enabled = false;
+    timeAlignment.bufferSize = 10;
+    timeAlignment.estimationTime = 0.0;
 }
 
 WholeBodyDynamicsDevice::~WholeBodyDynamicsDevice()
@@ -196,6 +205,12 @@ bool WholeBodyDynamicsDevice::openRemapperControlBoard(os::Searchable& config)
     ok = ok && remappedControlBoard.view(remappedControlBoardInterfaces.ctrlmode);
     ok = ok && remappedControlBoard.view(remappedControlBoardInterfaces.intmode);
 
+    // The timestamps of the encoders are needed only to align the sensors in time
+    if( timeAlignment.enabled )
+    {
+        ok = ok && remappedControlBoard.view(remappedControlBoardInterfaces.encsTimed);
+    }
+
     if( !ok )
     {
         yError() << "wholeBodyDynamics : open impossible to use the necessary interfaces in remappedControlBoard";
@@ -523,6 +538,21 @@ void WholeBodyDynamicsDevice::resizeBuffers()
     this->estimatedJointTorquesYARP.resize(this->estimatedJointTorques.size(),0.0);
     this->estimateExternalContactWrenches.resize(estimator.model());
 
+    // Resize time alignment buffers
+    if( timeAlignment.enabled )
+    {
+        size_t nrOfDOFs = estimator.model().getNrOfDOFs();
+        size_t nrOfFTs = estimator.sensors().getNrOfSensors(iDynTree::SIX_AXIS_FORCE_TORQUE);
+        timeAlignment.jointTimestamps.resize(nrOfDOFs,0.0);
+        timeAlignment.lastJointTimestamps.resize(nrOfDOFs,0.0);
+        timeAlignment.lastJointTimestampChanges.resize(nrOfDOFs,0.0);
+        timeAlignment.joints.assign(nrOfDOFs,iCub::ctrl::realTime::TimestampedBuffer(3,timeAlignment.bufferSize));
+        timeAlignment.fts.assign(nrOfFTs,iCub::ctrl::realTime::TimestampedBuffer(wholeBodyDynamics_nrOfChannelsOfYARPFTSensor,timeAlignment.bufferSize));
+        timeAlignment.imu.assign(1,iCub::ctrl::realTime::TimestampedBuffer(6,timeAlignment.bufferSize));
+        timeAlignment.jointSample.resize(3,0.0);
+        timeAlignment.imuSample.resize(6,0.0);
+    }
+
     // Resize F/T stuff
     size_t nrOfFTSensors = estimator.sensors().getNrOfSensors(iDynTree::SIX_AXIS_FORCE_TORQUE);
     calibrationBuffers.calibratingFTsensor.resize(nrOfFTSensors,false);
@@ -662,6 +692,22 @@ bool WholeBodyDynamicsDevice::loadSettingsFromConfig(os::Searchable& config)
         settings.useJointAcceleration = prop.find(useJointAccelerationOptionName.c_str()).asBool();
     }
 
+    if( prop.check("timeAlignment") )
+    {
+        timeAlignment.enabled = prop.find("timeAlignment").asBool();
+    }
+
+    if( prop.check("timeAlignmentBufferSize") )
+    {
+        int bufferSize = prop.find("timeAlignmentBufferSize").asInt();
+        if( bufferSize < 2 )
+        {
+            yError() << "wholeBodyDynamics: timeAlignmentBufferSize should be at least 2, while it is " << bufferSize;
+            return false;
+        }
+        timeAlignment.bufferSize = bufferSize;
+    }
+
     return true;
 }
 
@@ -948,6 +994,7 @@ bool WholeBodyDynamicsDevice::attachAllVirtualAnalogSensor(const PolyDriverList&
 bool WholeBodyDynamicsDevice::attachAllFTs(const PolyDriverList& p)
 {
     std::vector<IAnalogSensor *> ftList;
+    std::vector<IPreciselyTimed *> ftTimedList;
     std::vector<std::string>     ftDeviceNames;
     for(size_t devIdx = 0; devIdx < (size_t)p.size(); devIdx++)
     {
@@ -957,7 +1004,12 @@ bool WholeBodyDynamicsDevice::attachAllFTs(const PolyDriverList& p)
         {
             if( pAnalogSens->getChannels() == (int)wholeBodyDynamics_nrOfChannelsOfYARPFTSensor )
             {
+                // The timestamps are optional
+                IPreciselyTimed * pTimed = 0;
+                p[devIdx]->poly->view(pTimed);
+
                 ftList.push_back(pAnalogSens);
+                ftTimedList.push_back(pTimed);
                 ftDeviceNames.push_back(p[devIdx]->key);
             }
         }
@@ -974,6 +1026,7 @@ bool WholeBodyDynamicsDevice::attachAllFTs(const PolyDriverList& p)
     // For now we assume that the name of the F/T sensor device match the sensor name in the URDF
     // In the future we could use a new fancy sensor interface
     ftSensors.resize(ftList.size());
+    ftSensorsTimed.resize(ftList.size());
     for(size_t IDTsensIdx=0; IDTsensIdx < ftSensors.size(); IDTsensIdx++)
     {
         std::string sensorName = estimator.sensors().getSensor(iDynTree::SIX_AXIS_FORCE_TORQUE,IDTsensIdx)->getName();
@@ -995,6 +1048,7 @@ bool WholeBodyDynamicsDevice::attachAllFTs(const PolyDriverList& p)
         }
 
         ftSensors[IDTsensIdx] = ftList[deviceThatHasTheSameNameOfTheSensor];
+        ftSensorsTimed[IDTsensIdx] = ftTimedList[deviceThatHasTheSameNameOfTheSensor];
     }
 
     // We try to read for a brief moment the sensors for two reasons:
@@ -1021,13 +1075,19 @@ bool WholeBodyDynamicsDevice::attachAllFTs(const PolyDriverList& p)
 bool WholeBodyDynamicsDevice::attachAllIMUs(const PolyDriverList& p)
 {
     std::vector<IGenericSensor*> imuList;
+    std::vector<IPreciselyTimed*> imuTimedList;
 
     for(size_t devIdx = 0; devIdx < (size_t)p.size(); devIdx++)
     {
         IGenericSensor * pGenericSensor = 0;
         if( p[devIdx]->poly->view(pGenericSensor) )
         {
+            // The timestamps are optional
+            IPreciselyTimed * pTimed = 0;
+            p[devIdx]->poly->view(pTimed);
+
             imuList.push_back(pGenericSensor);
+            imuTimedList.push_back(pTimed);
         }
     }
 
@@ -1042,6 +1102,7 @@ bool WholeBodyDynamicsDevice::attachAllIMUs(const PolyDriverList& p)
     if( imuList.size() == 1 )
     {
         this->imuInterface = imuList[0];
+        this->imuTimed = imuTimedList[0];
     }
 
     // We try to read for a brief moment the sensors for two reasons:
@@ -1100,6 +1161,39 @@ void convertVectorFromDegreesToRadians(iDynTree::VectorDynSize & vector)
     return;
 }
 
+double wholeBodyDynamics_getJointTimestamp(const double timestamp, double & lastTimestamp, double & lastTimestampChange,
+                                           const double receptionTime, const double frozenTimeout)
+{
+    // A repeated timestamp is the same measurement read again, and the buffer drops it.
+    // Only a timestamp that is not valid, or that did not change for longer than
+    // frozenTimeout (i.e. a board that does not update it), is replaced by the time of reading
+    if( timestamp != lastTimestamp )
+    {
+        lastTimestamp = timestamp;
+        lastTimestampChange = receptionTime;
+    }
+    if( timestamp <= 0.0 || receptionTime-lastTimestampChange > frozenTimeout )
+    {
+        return receptionTime;
+    }
+    return timestamp;
+}
+
+double wholeBodyDynamics_getTimestamp(IPreciselyTimed * timedInterface, const double receptionTime)
+{
+    // If the device does not provide a timestamp, the time of reading is used
+    if( timedInterface )
+    {
+        yarp::os::Stamp stamp = timedInterface->getLastInputStamp();
+        if( stamp.isValid() && stamp.getTime() > 0.0 )
+        {
+            return stamp.getTime();
+        }
+    }
+
+    return receptionTime;
+}
+
 bool WholeBodyDynamicsDevice::readFTSensors(bool verbose)
 {
     bool FTSensorsReadCorrectly = true;
@@ -1140,6 +1234,12 @@ bool WholeBodyDynamicsDevice::readFTSensors(bool verbose)
             iDynTree::toiDynTree(ftMeasurement,bufWrench);
 
             rawSensorsMeasurements.setMeasurement(iDynTree::SIX_AXIS_FORCE_TORQUE,ft,bufWrench);
+
+            if( timeAlignment.enabled )
+            {
+                double receptionTime = yarp::os::Time::now();
+                timeAlignment.fts[ft].push(wholeBodyDynamics_getTimestamp(ftSensorsTimed[ft],receptionTime),ftMeasurement,receptionTime);
+            }
         }
     }
 
@@ -1169,6 +1269,17 @@ bool WholeBodyDynamicsDevice::readIMUSensors(bool verbose)
         rawIMUMeasurements.linProperAcc(0) = imuMeasurement[3];
         rawIMUMeasurements.linProperAcc(1) = imuMeasurement[4];
         rawIMUMeasurements.linProperAcc(2) = imuMeasurement[5];
+
+        if( timeAlignment.enabled )
+        {
+            double receptionTime = yarp::os::Time::now();
+            for(size_t i=0; i < 3; i++)
+            {
+                timeAlignment.imuSample[i]   = rawIMUMeasurements.linProperAcc(i);
+                timeAlignment.imuSample[3+i] = rawIMUMeasurements.angularVel(i);
+            }
+            timeAlignment.imu[0].push(wholeBodyDynamics_getTimestamp(imuTimed,receptionTime),timeAlignment.imuSample,receptionTime);
+        }
     }
 
     return ok;
@@ -1178,7 +1289,14 @@ bool WholeBodyDynamicsDevice::readIMUSensors(bool verbose)
 void WholeBodyDynamicsDevice::readSensors()
 {
     // Read encoders
-    sensorReadCorrectly = remappedControlBoardInterfaces.encs->getEncoders(jointPos.data());
+    if( timeAlignment.enabled )
+    {
+        sensorReadCorrectly = remappedControlBoardInterfaces.encsTimed->getEncodersTimed(jointPos.data(),timeAlignment.jointTimestamps.data());
+    }
+    else
+    {
+        sensorReadCorrectly = remappedControlBoardInterfaces.encs->getEncoders(jointPos.data());
+    }
 
     // Convert from degrees (used on wire by YARP) to radians (used by iDynTree)
     convertVectorFromDegreesToRadians(jointPos);
@@ -1238,7 +1356,80 @@ void WholeBodyDynamicsDevice::readSensors()
         sensorReadCorrectly = ok && sensorReadCorrectly;
     }
 
+    if( timeAlignment.enabled && sensorReadCorrectly )
+    {
+        alignSensorsInTime();
+    }
+}
+
+void WholeBodyDynamicsDevice::alignSensorsInTime()
+{
+    double receptionTime = yarp::os::Time::now();
 
+    // Buffer the joint measurements, each one with the timestamp of its board
+    // (considered frozen if it does not change for the whole buffered interval)
+    double frozenTimeout = timeAlignment.bufferSize*getRate()/1000.0;
+    for(size_t dof=0; dof < timeAlignment.joints.size(); dof++)
+    {
+        timeAlignment.jointSample[0] = jointPos(dof);
+        timeAlignment.jointSample[1] = jointVel(dof);
+        timeAlignment.jointSample[2] = jointAcc(dof);
+        timeAlignment.joints[dof].push(wholeBodyDynamics_getJointTimestamp(timeAlignment.jointTimestamps[dof],timeAlignment.lastJointTimestamps[dof],
+                                                                           timeAlignment.lastJointTimestampChanges[dof],receptionTime,frozenTimeout),
+                                       timeAlignment.jointSample,receptionTime);
+    }
+
+    // The estimation time is the most recent time for which all the sensors have a measurement,
+    // so that the measurements are only interpolated, never extrapolated (empty buffers are skipped)
+    bool useIMU = (settings.kinematicSource == IMU);
+    double estimationTime = receptionTime;
+    for(size_t dof=0; dof < timeAlignment.joints.size(); dof++)
+    {
+        if( timeAlignment.joints[dof].getNrOfSamples() > 0 )
+        {
+            estimationTime = std::min(estimationTime,timeAlignment.joints[dof].getNewestTimestamp());
+        }
+    }
+    for(size_t ft=0; ft < timeAlignment.fts.size(); ft++)
+    {
+        if( timeAlignment.fts[ft].getNrOfSamples() > 0 )
+        {
+            estimationTime = std::min(estimationTime,timeAlignment.fts[ft].getNewestTimestamp());
+        }
+    }
+    if( useIMU && timeAlignment.imu[0].getNrOfSamples() > 0 )
+    {
+        estimationTime = std::min(estimationTime,timeAlignment.imu[0].getNewestTimestamp());
+    }
+    timeAlignment.estimationTime = estimationTime;
+
+    // Replace the measurements with the interpolated ones
+    for(size_t dof=0; dof < timeAlignment.joints.size(); dof++)
+    {
+        timeAlignment.joints[dof].interpolate(estimationTime,timeAlignment.jointSample);
+        jointPos(dof) = timeAlignment.jointSample[0];
+        jointVel(dof) = timeAlignment.jointSample[1];
+        jointAcc(dof) = timeAlignment.jointSample[2];
+    }
+
+    for(size_t ft=0; ft < timeAlignment.fts.size(); ft++)
+    {
+        if( timeAlignment.fts[ft].interpolate(estimationTime,ftMeasurement) )
+        {
+            iDynTree::Wrench bufWrench;
+            iDynTree::toiDynTree(ftMeasurement,bufWrench);
+            rawSensorsMeasurements.setMeasurement(iDynTree::SIX_AXIS_FORCE_TORQUE,ft,bufWrench);
+        }
+    }
+
+    if( useIMU && timeAlignment.imu[0].interpolate(estimationTime,timeAlignment.imuSample) )
+    {
+        for(size_t i=0; i < 3; i++)
+        {
+            rawIMUMeasurements.linProperAcc(i) = timeAlignment.imuSample[i];
+            rawIMUMeasurements.angularVel(i)   = timeAlignment.imuSample[3+i];
+        }
+    }
 }
 
 void WholeBodyDynamicsDevice::filterSensorsAndRemoveSensorOffsets()
@@ -2132,7 +2323,37 @@ std::string WholeBodyDynamicsDevice::getCurrentSettingsString()
 {
    yarp::os::LockGuard guard(this->deviceMutex);
 
-   return settings.toString();
+   if( !timeAlignment.enabled )
+   {
+       return settings.toString();
+   }
+
+   // Report the latency of the sensors, the difference between the time of reading and the timestamp
+   std::stringstream ss;
+   ss << settings.toString() << "\n";
+   ss << "Time alignment enabled, estimation time delay: " << yarp::os::Time::now() - timeAlignment.estimationTime << " s\n";
+   ss << "Sensor latencies in s (last mean max):\n";
+   double maxJointLatency = 0.0;
+   double meanJointLatency = 0.0;
+   for(size_t dof=0; dof < timeAlignment.joints.size(); dof++)
+   {
+       maxJointLatency = std::max(maxJointLatency,timeAlignment.joints[dof].getMaxLatency());
+       meanJointLatency += timeAlignment.joints[dof].getMeanLatency()/timeAlignment.joints.size();
+   }
+   ss << "  encoders: " << meanJointLatency << " " << maxJointLatency << " (mean and max over all the joints)\n";
+   for(size_t ft=0; ft < timeAlignment.fts.size(); ft++)
+   {
+       ss << "  " << estimator.sensors().getSensor(iDynTree::SIX_AXIS_FORCE_TORQUE,ft)->getName() << ": "
+          << timeAlignment.fts[ft].getLastLatency() << " " << timeAlignment.fts[ft].getMeanLatency() << " "
+          << timeAlignment.fts[ft].getMaxLatency() << (ftSensorsTimed.size() > ft && ftSensorsTimed[ft] ? "" : " (no timestamps)") << "\n";
+   }
+   if( imuInterface )
+   {
+       ss << "  imu: " << timeAlignment.imu[0].getLastLatency() << " " << timeAlignment.imu[0].getMeanLatency() << " "
+          << timeAlignment.imu[0].getMaxLatency() << (imuTimed ? "" : " (no timestamps)") << "\n";
+   }
+
+   return ss.str();
 }
 
 bool WholeBodyDynamicsDevice::resetSimpleLeggedOdometry(const std::string& /*initial_world_frame*/, const std::string& /*initial_fixed_link*/)
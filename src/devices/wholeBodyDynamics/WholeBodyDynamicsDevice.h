@@ -14,6 +14,7 @@
 #include <yarp/dev/IVirtualAnalogSensor.h>
 #include <yarp/dev/IAnalogSensor.h>
 #include <yarp/dev/GenericSensorInterfaces.h>
+#include <yarp/dev/PreciselyTimed.h>
 
 // iCub includes
 #include <iCub/skinDynLib/skinContactList.h>
@@ -25,6 +26,7 @@
 
 // Filters
 #include "ctrlLibRT/filters.h"
+#include "ctrlLibRT/timestampedBuffer.h"
 
 #include <wholeBodyDynamicsSettings.h>
 #include <wholeBodyDynamics_IDLServer.h>
@@ -131,6 +133,8 @@ class wholeBodyDynamicsDeviceFilters
  * | defaultContactFrames |      -   | vector of strings |  -    |    -          | Yes      | If not data is read from the skin, specify the location of the default contacts | For each submodel induced by the FT sensor, the first not used frame that belongs to that submodel is selected from the list. An error is raised if not suitable frame is found for a submodel. |
  * | useJointVelocity     |        - | bool              |  -    |      true     |  No      | Select if the measured joint velocities (read from the getEncoderSpeeds method) are used for estimation, or if they should be forced to 0.0 . | The default value of true is deprecated, and in the future the parameter will be required. |
  * | useJointAcceleration |        - | bool              |  -    |      true     |  No      | Select if the measured joint accelerations (read from the getEncoderAccelerations method) are used for estimation, or if they should be forced to 0.0 . | The default value of true is deprecated, and in the future the parameter will be required. |
+ * | timeAlignment        |        - | bool              |  -    |      false    |  No      | If true, the measurements of encoders, F/T sensors and IMU are buffered with their timestamps and linearly interpolated at a common estimation time, the most recent time for which all the sensors have a measurement. | The timestamps of F/T sensors and IMU are read from the IPreciselyTimed interface of their devices, if available, otherwise the time of reading is used, as for the joint timestamps that are not positive or do not change for the whole buffered interval. The latency of each sensor is reported by getCurrentSettingsString. |
+ * | timeAlignmentBufferSize |     - | int               |  -    |      10       |  No      | Number of measurements buffered for each sensor when timeAlignment is true. | It bounds the delay of the estimation time with respect to the newest measurements. |
  * | IDYNTREE_SKINDYNLIB_LINKS |  -  | group             | -     | -             | Yes      |  Group describing the mapping between link names and skinDynLib identifiers. | |
  * |                |   linkName_1   | string (name of a link in the model) | - | - | Yes   | Bottle of three elements describing how the link with linkName is described in skinDynLib: the first element is the name of the frame in which the contact info is expressed in skinDynLib (tipically DH frames), the second a integer describing the skinDynLib BodyPart , and the third a integer describing the skinDynLib LinkIndex  | |
  * |                |   ...   | string (name of a link in the model) | - | -     | Yes      | Bottle of three elements describing how the link with linkName is described in skinDynLib: the first element is the name of the frame in which the contact info is expressed in skinDynLib (tipically DH frames), the second a integer describing the skinDynLib BodyPart , and the third a integer describing the skinDynLib LinkIndex  | |
@@ -324,6 +328,7 @@ private:
     struct
     {
         yarp::dev::IEncoders        * encs;
+        yarp::dev::IEncodersTimed   * encsTimed;
         yarp::dev::IMultipleWrapper * multwrap;
         yarp::dev::IImpedanceControl * impctrl;
         yarp::dev::IControlMode2    * ctrlmode;
@@ -341,9 +346,15 @@ private:
     /** F/T sensors interfaces */
     std::vector<yarp::dev::IAnalogSensor * > ftSensors;
 
+    /** F/T sensors timestamps interfaces (0 if the device does not provide timestamps) */
+    std::vector<yarp::dev::IPreciselyTimed * > ftSensorsTimed;
+
     /** IMU interface */
     yarp::dev::IGenericSensor * imuInterface;
 
+    /** IMU timestamps interface (0 if the device does not provide timestamps) */
+    yarp::dev::IPreciselyTimed * imuTimed;
+
     /**
      * Setting for the whole body external wrenches and joint torques estimation.
      * Contained in a Thrift-generated structure to enable easy editing through
@@ -443,6 +454,12 @@ private:
      */
     bool readIMUSensors(bool verbose=true);
     void readSensors();
+
+    /**
+     * Buffer the measurements just read and replace them with the ones
+     * interpolated at the common estimation time.
+     */
+    void alignSensorsInTime();
     void filterSensorsAndRemoveSensorOffsets();
     void updateKinematics();
     void readContactPoints();
@@ -525,6 +542,24 @@ private:
         size_t nrOfSamplesToUseForCalibration;
     } calibrationBuffers;
 
+    /**
+     * Time alignment data structures
+     */
+    struct
+    {
+        bool enabled;
+        size_t bufferSize;
+        double estimationTime;
+        std::vector<double> jointTimestamps;
+        std::vector<double> lastJointTimestamps;
+        std::vector<double> lastJointTimestampChanges;
+        std::vector<iCub::ctrl::realTime::TimestampedBuffer> joints; ///< position, velocity and acceleration of each joint
+        std::vector<iCub::ctrl::realTime::TimestampedBuffer> fts;
+        std::vector<iCub::ctrl::realTime::TimestampedBuffer> imu;    ///< linear proper acceleration and angular velocity, empty if no IMU is used
+        yarp::sig::Vector jointSample;
+        yarp::sig::Vector imuSample;
+    } timeAlignment;
+
     /**
      * Vector of classes used to process the raw FT measurements,
      * removing offset and using a secondary calibration matrix.
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2016 CoDyCo
+ * Author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+/**
+ * \defgroup MinJerkCtrl MinJerkCtrl
+ *
+ * @ingroup ctrlLibRT
+ *
+ * Minimum jerk trajectory generation, modified to avoid non-realtime behaviour.
+ *
+ * \author Francesco Romano
+ *
+ */
+
+#ifndef RT_MINJERKCTRL_H
+#define RT_MINJERKCTRL_H
+
+#include <Eigen/Dense>
+
+
+namespace iCub
+{
+
+namespace ctrl
+{
+
+namespace realTime
+{
+
+/**
+* \ingroup MinJerkCtrl
+*
+* Generator of approximately minimum jerk trajectories.
+*
+* It implements the same third order system used by iCub::ctrl::minJerkTrajGen
+* \f[
+* G(s) = \frac{a}{s^3 + c s^2 + b s + a}, \quad
+* a = \frac{150.766}{T^3}, b = \frac{84.925}{T^2}, c = \frac{15.924}{T}
+* \f]
+* discretised with the Tustin method, but it stores its state in Eigen
+* objects and it does not allocate memory after construction.
+*
+* Position, velocity and acceleration are computed in a single call.
+* Every component of the set point is an independent trajectory, so
+* many trajectories sharing the same duration can be stacked in
+* a single generator and evaluated at once.
+*
+* @tparam Dimension number of trajectories generated (Eigen::Dynamic to specify it at construction time)
+*/
+template <int Dimension = Eigen::Dynamic>
+class minJerkTrajGen
+{
+public:
+    typedef Eigen::Matrix<double, Dimension, 1> VectorType;
+    typedef Eigen::Matrix<double, Dimension, 3> StateType; ///< columns are position, velocity and acceleration
+    typedef typename StateType::ConstColXpr ConstVectorBlock;
+
+    /**
+    * Constructor.
+    * @param sampleTime sample time (s).
+    * @param trajTime trajectory duration T (s).
+    * @param dimension number of trajectories. Ignored if Dimension is fixed.
+    */
+    minJerkTrajGen(const double sampleTime, const double trajTime,
+                   const int dimension = (Dimension == Eigen::Dynamic ? 1 : Dimension))
+    : T(trajTime)
+    , Ts(sampleTime)
+    , state(Dimension == Eigen::Dynamic ? dimension : Dimension, 3)
+    , output(Dimension == Eigen::Dynamic ? dimension : Dimension, 3)
+    , nextState(Dimension == Eigen::Dynamic ? dimension : Dimension, 3)
+    {
+        state.setZero();
+        output.setZero();
+        computeCoeffs();
+    }
+
+    /**
+    * Returns the number of trajectories generated.
+    * @return the number of trajectories.
+    */
+    int size() const { return static_cast<int>(state.rows()); }
+
+    /**
+    * Initializes the trajectories to a steady state.
+    * @param y0 initial position (velocity and acceleration are zero).
+    */
+    template <typename Derived>
+    void init(const Eigen::MatrixBase<Derived> &y0)
+    {
+        //the discrete state corresponding to the steady state [y0 0 0] is [y0 0 0] too
+        state.setZero();
+        state.col(0)=y0;
+        output.setZero();
+        output.col(0)=y0;
+    }
+
+    /**
+    * Computes the next values of the trajectories.
+    * @param yd the desired set point.
+    */
+    template <typename Derived>
+    void computeNextValues(const Eigen::MatrixBase<Derived> &yd)
+    {
+        //y(k) = Cd x(k) + Dd u(k), x(k+1) = Ad x(k) + Bd u(k)
+        //lazy products never allocate temporaries
+        output.noalias()=state.lazyProduct(Cd.transpose());
+        output.noalias()+=yd.lazyProduct(Dd.transpose());
+        nextState.noalias()=state.lazyProduct(Ad.transpose());
+        nextState.noalias()+=yd.lazyProduct(Bd.transpose());
+        state=nextState;
+    }
+
+    /**
+    * Computes the next values of the trajectories and returns them.
+    * @param yd the desired set point.
+    * @param pos position of the trajectories.
+    * @param vel velocity of the trajectories.
+    * @param acc acceleration of the trajectories.
+    */
+    template <typename Derived, typename Position, typename Velocity, typename Acceleration>
+    void computeNextValues(const Eigen::MatrixBase<Derived> &yd,
+                           const Eigen::MatrixBase<Position> &pos,
+                           const Eigen::MatrixBase<Velocity> &vel,
+                           const Eigen::MatrixBase<Acceleration> &acc)
+    {
+        computeNextValues(yd);
+        const_cast<Eigen::MatrixBase<Position>&>(pos)=output.col(0);
+        const_cast<Eigen::MatrixBase<Velocity>&>(vel)=output.col(1);
+        const_cast<Eigen::MatrixBase<Acceleration>&>(acc)=output.col(2);
+    }
+
+    /**
+    * Returns the current position.
+    * @return the position of the trajectories.
+    */
+    ConstVectorBlock getPos() const { return output.col(0); }
+
+    /**
+    * Returns the current velocity.
+    * @return the velocity of the trajectories.
+    */
+    ConstVectorBlock getVel() const { return output.col(1); }
+
+    /**
+    * Returns the current acceleration.
+    * @return the acceleration of the trajectories.
+    */
+    ConstVectorBlock getAcc() const { return output.col(2); }
+
+    /**
+    * Returns position, velocity and acceleration (one column each).
+    * @return the trajectories outputs.
+    */
+    const StateType& getValues() const { return output; }
+
+    /**
+    * Changes the trajectory duration.
+    * @param trajTime the new duration (s).
+    * @return true/false on success/fail.
+    * @note the internal state is preserved.
+    */
+    bool setT(const double trajTime)
+    {
+        if (trajTime<=0.0)
+            return false;
+        T=trajTime;
+        computeCoeffs();
+        return true;
+    }
+
+    /**
+    * Changes the sample time.
+    * @param sampleTime the new sample time (s).
+    * @return true/false on success/fail.
+    * @note the internal state is preserved.
+    */
+    bool setTs(const double sampleTime)
+    {
+        if (sampleTime<=0.0)
+            return false;
+        Ts=sampleTime;
+        computeCoeffs();
+        return true;
+    }
+
+    /**
+    * Returns the trajectory duration.
+    * @return the duration (s).
+    */
+    double getT() const { return T; }
+
+    /**
+    * Returns the sample time.
+    * @return the sample time (s).
+    */
+    double getTs() const { return Ts; }
+
+protected:
+    double T;
+    double Ts;
+
+    Eigen::Matrix3d Ad;
+    Eigen::Vector3d Bd;
+    Eigen::Matrix3d Cd;
+    Eigen::Vector3d Dd;
+
+    StateType state;
+    StateType output;
+    StateType nextState;
+
+    void computeCoeffs()
+    {
+        const double a=150.765868956161/(T*T*T);
+        const double b=84.9253149327275/(T*T);
+        const double c=15.9236684951833/T;
+
+        //continuous system, state is [pos vel acc]
+        Eigen::Matrix3d A;
+        A<<0.0, 1.0, 0.0,
+           0.0, 0.0, 1.0,
+            -a,  -b,  -c;
+        Eigen::Vector3d B(0.0,0.0,a);
+
+        //Tustin discretisation
+        const Eigen::Matrix3d M=(Eigen::Matrix3d::Identity()-0.5*Ts*A).inverse();
+        Ad=M*(Eigen::Matrix3d::Identity()+0.5*Ts*A);
+        Bd=Ts*M*B;
+        Cd=M;
+        Dd=0.5*Ts*M*B;
+    }
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+}
+
+}
+
+}
+
+#endif
+
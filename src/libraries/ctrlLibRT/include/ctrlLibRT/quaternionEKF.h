@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+/**
+ * \defgroup QuaternionEKF QuaternionEKF
+ *
+ * @ingroup ctrlLibRT
+ *
+ * Attitude estimation from a gyroscope and an accelerometer,
+ * modified to avoid non-realtime behaviour.
+ *
+ * \author Jorhabib Eljaik
+ *
+ */
+
+#ifndef RT_QUATERNIONEKF_H
+#define RT_QUATERNIONEKF_H
+
+#include <cmath>
+#include <Eigen/Dense>
+
+
+namespace iCub
+{
+
+namespace ctrl
+{
+
+namespace realTime
+{
+
+/**
+* \ingroup QuaternionEKF
+*
+* Extended Kalman filter estimating the orientation of an IMU.
+*
+* The state is the unit quaternion q = [q0 q1 q2 q3] (real part first) of the
+* rotation R(q) that maps the gravity in the inertial frame to the proper
+* acceleration measured by the accelerometer:
+* \f[
+* a = R(q) \begin{bmatrix} 0 & 0 & g \end{bmatrix}^T + v_a
+* \f]
+* The gyroscope measurement \f$ \omega \f$ is the input of the prediction:
+* \f[
+* q_{k+1} = \left(I_4 + \frac{T_s}{2} \Omega(\omega_k)\right) q_k, \quad
+* Q_k = \left(\frac{T_s}{2}\right)^2 \Xi(q_k) \Sigma_\omega \Xi(q_k)^T
+* \f]
+* and the covariance is corrected with the Joseph form, that keeps it
+* symmetric and positive definite.
+*
+* The filter can also fuse N IMUs rigidly attached to the same body, whose
+* measurements are expressed in the frame of the estimate. All the sensors
+* share the measurement model, so the stacked update with noise covariance
+* diag(sigmaAcc/w_1 I_3, ..., sigmaAcc/w_N I_3) is equivalent to a single
+* update with the weighted mean of the accelerations and variance
+* sigmaAcc/sum(w_i): the cost of a fused step is linear in N. The same
+* holds for the angular velocities in the prediction.
+*
+* All the quantities have a fixed size, so the filter does not allocate
+* memory and it can be run at the native rate of the sensors.
+*/
+class QuaternionEKF
+{
+public:
+    typedef Eigen::Matrix<double, 4, 1> StateType;
+    typedef Eigen::Matrix<double, 4, 4> CovarianceType;
+    typedef Eigen::Matrix<double, 4, 3> XiType;
+    typedef Eigen::Matrix<double, 3, 4> JacobianType;
+
+    /**
+    * Constructor.
+    * @param sampleTime sample time (s).
+    */
+    QuaternionEKF(const double sampleTime = 0.01)
+    : Ts(sampleTime)
+    , sigmaGyro(0.0)
+    , sigmaAcc(1.0)
+    , gravity(9.81)
+    {
+        init(StateType(1.0, 0.0, 0.0, 0.0), 1.0);
+    }
+
+    /**
+    * Resets the estimate.
+    * @param q0 initial quaternion (it is normalized).
+    * @param priorCovariance variance of each component of the initial quaternion.
+    */
+    template <typename Derived>
+    void init(const Eigen::MatrixBase<Derived> &q0, const double priorCovariance)
+    {
+        state=q0;
+        state.normalize();
+        covariance=priorCovariance*CovarianceType::Identity();
+    }
+
+    /**
+    * Changes the sample time.
+    * @param sampleTime the new sample time (s).
+    * @return true/false on success/fail.
+    */
+    bool setTs(const double sampleTime)
+    {
+        if (sampleTime<=0.0)
+            return false;
+        Ts=sampleTime;
+        return true;
+    }
+
+    /**
+    * Sets the variance of the gyroscope noise on each axis ((rad/s)^2).
+    */
+    void setGyroscopeNoise(const double variance) { sigmaGyro=variance; }
+
+    /**
+    * Sets the variance of the accelerometer noise on each axis ((m/s^2)^2).
+    */
+    void setAccelerometerNoise(const double variance) { sigmaAcc=variance; }
+
+    /**
+    * Sets the norm of the gravity used by the measurement model (m/s^2).
+    */
+    void setGravity(const double g) { gravity=g; }
+
+    /**
+    * Prediction step.
+    * @param angVel angular velocity measured by the gyroscope (rad/s).
+    */
+    template <typename Derived>
+    void predict(const Eigen::MatrixBase<Derived> &angVel)
+    {
+        propagate(angVel,sigmaGyro);
+    }
+
+    /**
+    * Prediction step with N gyroscopes.
+    * @param angVels 3xN matrix of the angular velocities (rad/s),
+    *                expressed in the frame of the estimate.
+    * @param weights N weights, the noise variance of the i-th
+    *                sensor is sigmaGyro/weights(i).
+    * @return false if all the weights are zero (the state is not changed).
+    */
+    template <typename Gyros, typename Weights>
+    bool predict(const Eigen::MatrixBase<Gyros> &angVels, const Eigen::MatrixBase<Weights> &weights)
+    {
+        double w=weights.sum();
+        if (w<=0.0)
+            return false;
+
+        Eigen::Vector3d angVel;
+        angVel.noalias()=angVels*weights;
+        angVel/=w;
+        propagate(angVel,sigmaGyro/w);
+        return true;
+    }
+
+    /**
+    * Correction step.
+    * @param linAcc proper acceleration measured by the accelerometer (m/s^2).
+    */
+    template <typename Derived>
+    void update(const Eigen::MatrixBase<Derived> &linAcc)
+    {
+        correct(linAcc,sigmaAcc);
+    }
+
+    /**
+    * Correction step with N accelerometers.
+    * @param linAccs 3xN matrix of the proper accelerations (m/s^2),
+    *                expressed in the frame of the estimate.
+    * @param weights N weights, the noise variance of the i-th
+    *                sensor is sigmaAcc/weights(i).
+    * @return false if all the weights are zero (the state is not changed).
+    */
+    template <typename Accs, typename Weights>
+    bool update(const Eigen::MatrixBase<Accs> &linAccs, const Eigen::MatrixBase<Weights> &weights)
+    {
+        double w=weights.sum();
+        if (w<=0.0)
+            return false;
+
+        Eigen::Vector3d linAcc;
+        linAcc.noalias()=linAccs*weights;
+        linAcc/=w;
+        correct(linAcc,sigmaAcc/w);
+        return true;
+    }
+
+    /**
+    * Prediction and correction steps with a new IMU sample.
+    * @param angVel angular velocity measured by the gyroscope (rad/s).
+    * @param linAcc proper acceleration measured by the accelerometer (m/s^2).
+    */
+    template <typename Gyro, typename Acc>
+    void step(const Eigen::MatrixBase<Gyro> &angVel, const Eigen::MatrixBase<Acc> &linAcc)
+    {
+        predict(angVel);
+        update(linAcc);
+    }
+
+    /**
+    * Prediction and correction steps with a new sample of N IMUs.
+    * @param angVels 3xN matrix of the angular velocities (rad/s).
+    * @param linAccs 3xN matrix of the proper accelerations (m/s^2).
+    * @param weights N weights of the sensors.
+    * @return false if all the weights are zero (the state is not changed).
+    */
+    template <typename Gyros, typename Accs, typename Weights>
+    bool step(const Eigen::MatrixBase<Gyros> &angVels, const Eigen::MatrixBase<Accs> &linAccs,
+              const Eigen::MatrixBase<Weights> &weights)
+    {
+        return predict(angVels,weights) && update(linAccs,weights);
+    }
+
+    /**
+    * Returns the estimated quaternion.
+    */
+    const StateType& getState() const { return state; }
+
+    /**
+    * Returns the covariance of the estimated quaternion.
+    */
+    const CovarianceType& getCovariance() const { return covariance; }
+
+    /**
+    * Returns the sample time.
+    * @return the sample time (s).
+    */
+    double getTs() const { return Ts; }
+
+    /**
+    * Expected accelerometer measurement and its analytic jacobian.
+    * @param q quaternion.
+    * @param h expected measurement R(q)*[0 0 g]'.
+    * @param dhdq derivative of h with respect to q.
+    */
+    void measurementModel(const StateType &q, Eigen::Vector3d &h, JacobianType &dhdq) const
+    {
+        const double q0=q(0), q1=q(1), q2=q(2), q3=q(3);
+        //third column of R(q), scaled by the gravity
+        h<<2.0*gravity*(q1*q3+q0*q2),
+           2.0*gravity*(q2*q3-q0*q1),
+           gravity*(2.0*(q0*q0+q3*q3)-1.0);
+        dhdq<< q2,  q3,  q0,  q1,
+              -q1, -q0,  q3,  q2,
+               2.0*q0, 0.0, 0.0, 2.0*q3;
+        dhdq*=2.0*gravity;
+    }
+
+    /**
+    * Euler angles of R(q) = Rx(angles(0))*Ry(angles(1))*Rz(angles(2)),
+    * with angles(1) in [-pi/2, pi/2].
+    * @param q quaternion.
+    * @param angles Euler angles in xyz order (rad).
+    */
+    static void eulerAnglesXYZ(const StateType &q, Eigen::Vector3d &angles)
+    {
+        const double q0=q(0), q1=q(1), q2=q(2), q3=q(3);
+        const double r02=2.0*(q1*q3+q0*q2);
+        angles(0)=atan2(-2.0*(q2*q3-q0*q1),1.0-2.0*(q1*q1+q2*q2));
+        angles(1)=asin(r02>1.0 ? 1.0 : (r02<-1.0 ? -1.0 : r02));
+        angles(2)=atan2(-2.0*(q1*q2-q0*q3),1.0-2.0*(q2*q2+q3*q3));
+    }
+
+    /**
+    * Xi operator: q_dot = 0.5*Xi(q)*omega.
+    * Xi(q) = [ -q_v' ; q0*I_3 + S(q_v) ]
+    */
+    static void XiOperator(const StateType &q, XiType &Xi)
+    {
+        Xi<<-q(1), -q(2), -q(3),
+             q(0), -q(3),  q(2),
+             q(3),  q(0), -q(1),
+            -q(2),  q(1),  q(0);
+    }
+
+    /**
+    * Omega operator: q_dot = 0.5*Omega(omega)*q.
+    */
+    template <typename Derived>
+    static void OmegaOperator(const Eigen::MatrixBase<Derived> &omg, CovarianceType &Omega)
+    {
+        Omega<< 0.0,    -omg(0), -omg(1), -omg(2),
+                omg(0),  0.0,     omg(2), -omg(1),
+                omg(1), -omg(2),  0.0,     omg(0),
+                omg(2),  omg(1), -omg(0),  0.0;
+    }
+
+protected:
+    template <typename Derived>
+    void propagate(const Eigen::MatrixBase<Derived> &angVel, const double gyroVariance)
+    {
+        //process noise, function of the previous estimate
+        XiOperator(state,Xi);
+        Q.noalias()=(0.25*Ts*Ts*gyroVariance)*(Xi*Xi.transpose());
+
+        OmegaOperator(angVel,A);
+        A*=0.5*Ts;
+        A+=CovarianceType::Identity();
+
+        StateType predicted;
+        predicted.noalias()=A*state;
+        state=predicted;
+        state.normalize();
+
+        CovarianceType AP;
+        AP.noalias()=A*covariance;
+        covariance.noalias()=AP*A.transpose();
+        covariance+=Q;
+    }
+
+    template <typename Derived>
+    void correct(const Eigen::MatrixBase<Derived> &linAcc, const double accVariance)
+    {
+        Eigen::Vector3d expected;
+        measurementModel(state,expected,H);
+
+        Eigen::Matrix<double, 4, 3> PHt;
+        PHt.noalias()=covariance*H.transpose();
+        Eigen::Matrix3d S;
+        S.noalias()=H*PHt;
+        S+=accVariance*Eigen::Matrix3d::Identity();
+        K.noalias()=PHt*S.inverse();
+
+        state.noalias()+=K*(linAcc-expected);
+        state.normalize();
+
+        //Joseph form: P = (I-KH) P (I-KH)' + K R K'
+        CovarianceType IKH=CovarianceType::Identity();
+        IKH.noalias()-=K*H;
+        CovarianceType IKHP;
+        IKHP.noalias()=IKH*covariance;
+        covariance.noalias()=IKHP*IKH.transpose();
+        covariance.noalias()+=accVariance*(K*K.transpose());
+    }
+
+    double Ts;
+    double sigmaGyro;
+    double sigmaAcc;
+    double gravity;
+
+    StateType state;
+    CovarianceType covariance;
+
+    //buffers of the steps
+    CovarianceType A;
+    CovarianceType Q;
+    XiType Xi;
+    JacobianType H;
+    Eigen::Matrix<double, 4, 3> K;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Silvio Traversaro
+ * email:  silvio.traversaro@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+/**
+ * \defgroup TimestampedBuffer TimestampedBuffer
+ *
+ * @ingroup ctrlLibRT
+ *
+ * Buffering of timestamped sensor samples, to resample
+ * sensors read at different times to a common time
+ * without non-realtime behaviour.
+ *
+ * \author Silvio Traversaro
+ *
+ */
+
+#ifndef RT_TIMESTAMPEDBUFFER_H
+#define RT_TIMESTAMPEDBUFFER_H
+
+#include <Eigen/Dense>
+
+#include <yarp/sig/Vector.h>
+
+
+namespace iCub
+{
+
+namespace ctrl
+{
+
+namespace realTime
+{
+
+/**
+* \ingroup TimestampedBuffer
+*
+* Ring buffer of the last samples of a sensor with their timestamps,
+* that can be linearly interpolated at any time. Memory is only
+* allocated in the constructor.
+*
+* The buffer also keeps the statistics of the latency of the sensor,
+* i.e. the difference between the time at which each sample was
+* received and its timestamp.
+*/
+class TimestampedBuffer
+{
+protected:
+    Eigen::MatrixXd samples;    ///< Matrix of the buffered samples: each column is a sample
+    Eigen::VectorXd timestamps; ///< Timestamps of the buffered samples
+    int newest;                 ///< Column of the newest sample
+    int nrOfSamples;            ///< Number of buffered samples
+
+    double lastLatency;
+    double maxLatency;
+    double latencySum;
+    unsigned long nrOfLatencies;
+
+public:
+    /**
+    * Creates a buffer.
+    * @param sampleSize number of elements of each sample.
+    * @param capacity maximum number of buffered samples.
+    */
+    TimestampedBuffer(const size_t sampleSize, const size_t capacity);
+
+    /**
+    * Remove all the buffered samples and reset the latency statistics.
+    */
+    void reset();
+
+    /**
+    * Add a sample to the buffer, replacing the oldest one if the buffer is full.
+    * A sample not newer than the newest buffered one is not added, as it is
+    * the same measurement read again, but it still counts in the latency statistics.
+    * @param timestamp time at which the sample was measured (s).
+    * @param sample the sample, of sampleSize elements.
+    * @param receptionTime time at which the sample was read (s).
+    * @return true if the sample was added, false otherwise.
+    */
+    bool push(const double timestamp, const yarp::sig::Vector &sample, const double receptionTime);
+
+    /**
+    * Linearly interpolate the buffered samples at a given time.
+    * Outside the buffered interval the oldest or the newest sample is returned.
+    * @param time time of the interpolated sample (s).
+    * @param sample the interpolated sample (output), resized to sampleSize if necessary.
+    * @return false if the buffer is empty, true otherwise.
+    */
+    bool interpolate(const double time, yarp::sig::Vector &sample) const;
+
+    /**
+    * Return the timestamp of the newest sample, or 0.0 if the buffer is empty.
+    */
+    double getNewestTimestamp() const;
+
+    /**
+    * Return the number of buffered samples.
+    */
+    size_t getNrOfSamples() const { return nrOfSamples; }
+
+    /**
+    * Return the latency of the last read sample (s).
+    */
+    double getLastLatency() const { return lastLatency; }
+
+    /**
+    * Return the mean latency since the last reset of the statistics (s).
+    */
+    double getMeanLatency() const;
+
+    /**
+    * Return the maximum latency since the last reset of the statistics (s).
+    */
+    double getMaxLatency() const { return maxLatency; }
+
+    /**
+    * Reset the latency statistics, keeping the buffered samples.
+    */
+    void resetLatencyStatistics();
+};
+
+}
+
+}
+
+}
+
+#endif
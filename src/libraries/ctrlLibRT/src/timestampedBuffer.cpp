@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Silvio Traversaro
+ * email:  silvio.traversaro@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#include "ctrlLibRT/timestampedBuffer.h"
+
+using namespace yarp::sig;
+using namespace iCub::ctrl::realTime;
+
+/***************************************************************************/
+TimestampedBuffer::TimestampedBuffer(const size_t sampleSize, const size_t capacity)
+{
+    samples.resize(sampleSize,capacity > 0 ? capacity : 1);
+    timestamps.resize(samples.cols());
+    reset();
+}
+
+/***************************************************************************/
+void TimestampedBuffer::reset()
+{
+    samples.setZero();
+    timestamps.setZero();
+    newest = samples.cols()-1;
+    nrOfSamples = 0;
+    resetLatencyStatistics();
+}
+
+/***************************************************************************/
+bool TimestampedBuffer::push(const double timestamp, const Vector &sample, const double receptionTime)
+{
+    lastLatency = receptionTime-timestamp;
+    if ((nrOfLatencies == 0) || (lastLatency > maxLatency))
+        maxLatency = lastLatency;
+    latencySum += lastLatency;
+    nrOfLatencies++;
+
+    if ((nrOfSamples > 0) && (timestamp <= timestamps(newest)))
+        return false;
+
+    newest = (newest+1)%samples.cols();
+    for (int i=0; i<samples.rows(); i++)
+        samples(i,newest) = sample[i];
+    timestamps(newest) = timestamp;
+
+    if (nrOfSamples < samples.cols())
+        nrOfSamples++;
+
+    return true;
+}
+
+/***************************************************************************/
+bool TimestampedBuffer::interpolate(const double time, Vector &sample) const
+{
+    if (nrOfSamples == 0)
+        return false;
+
+    if ((int)sample.size() != samples.rows())
+        sample.resize(samples.rows());
+
+    // Walk back from the newest sample to the first one not newer than time
+    int after = newest;
+    int before = newest;
+    for (int s=0; s<nrOfSamples; s++)
+    {
+        before = (newest-s+samples.cols())%samples.cols();
+        if (timestamps(before) <= time)
+            break;
+        after = before;
+    }
+
+    double alpha = 0.0;
+    if ((before != after) && (timestamps(before) <= time))
+        alpha = (time-timestamps(before))/(timestamps(after)-timestamps(before));
+    else
+        before = after;
+
+    for (int i=0; i<samples.rows(); i++)
+        sample[i] = (1.0-alpha)*samples(i,before)+alpha*samples(i,after);
+
+    return true;
+}
+
+/***************************************************************************/
+double TimestampedBuffer::getNewestTimestamp() const
+{
+    return (nrOfSamples > 0) ? timestamps(newest) : 0.0;
+}
+
+/***************************************************************************/
+double TimestampedBuffer::getMeanLatency() const
+{
+    return (nrOfLatencies > 0) ? latencySum/nrOfLatencies : 0.0;
+}
+
+/***************************************************************************/
+void TimestampedBuffer::resetLatencyStatistics()
+{
+    lastLatency = 0.0;
+    maxLatency = 0.0;
+    latencySum = 0.0;
+    nrOfLatencies = 0;
+}
@@ -23,9 +23,11 @@
 #include <iostream>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <stdlib.h>
 #include <yarp/os/LogStream.h>
 #include <bfl/wrappers/matrix/matrix_wrapper.h>
+#include "dataDumperTable.h"
 
 using boost::iostreams::mapped_file_source;
 using boost::iostreams::stream;
@@ -52,6 +54,11 @@ public:
     bool parseFileistream();
     bool countLines();
     bool parseLine(currentData &currData);
+    /**
+     * Parses the whole mapped file in one pass into a columnar table
+     * (see dataDumperTableParser::parseTable).
+     */
+    bool parseTable(dataDumperTable &table);
     bool closeFile();
     
 };
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+#ifndef __DATADUMPERTABLE_H__
+#define __DATADUMPERTABLE_H__
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * Whole dataDumper log stored by columns: the timestamps and, for each
+ * logged value, a contiguous vector with one element for each line.
+ */
+struct dataDumperTable {
+    std::vector<double>                 time;
+    std::vector< std::vector<double> >  columns;
+
+    size_t rows() const { return time.size(); }
+    void clear() { time.clear(); columns.clear(); }
+};
+
+/**
+ * Parser of a whole dataDumper log into a dataDumperTable, that does not
+ * depend on BFL (see dataDumperParser for the line by line parsing).
+ */
+class dataDumperTableParser{
+    boost::iostreams::mapped_file_source m_mmap;
+    std::string                          m_srcFile;
+public:
+    dataDumperTableParser(std::string srcFile);
+    /**
+     * Maps the whole file in memory. Throws if the file cannot be opened.
+     */
+    void parseFile();
+    /**
+     * Parses the mapped file into a columnar table (see the static version).
+     */
+    bool parseTable(dataDumperTable &table);
+    /**
+     * Parses the whole log between first and last in one pass into a columnar table.
+     * Each line is "<counter> <timestamp> <value_0> ... <value_n-1>" and all
+     * the lines must have the same number of values. Numbers are converted
+     * in place from the mapped memory, without copying or tokenizing lines.
+     * srcFile is only used in the error messages.
+     */
+    static bool parseTable(const char* first, const char* last, const std::string &srcFile, dataDumperTable &table);
+    /**
+     * Converts the number starting at p and ending before end or at a blank.
+     * On success p is moved after the number.
+     */
+    static bool parseNumber(const char* &p, const char* end, double &value);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+#ifndef __OFFLINEREPLAY_H__
+#define __OFFLINEREPLAY_H__
+
+#include <string>
+#include "dataDumperTable.h"
+
+namespace filter{
+
+/**
+ * Parameters of the offline replay of a dataDumper log through the quaternion EKF.
+ */
+struct offlineReplayParams {
+    offlineReplayParams();
+
+    // Sample time (s), used when the timestamps of two consecutive lines are not increasing
+    double       sampleTime;
+    // Variances of the gyroscope and accelerometer noises and of the prior
+    double       sigmaGyro;
+    double       sigmaAcc;
+    double       priorCovariance;
+    // Norm of the gravity used by the measurement model
+    double       gravity;
+    // First of the three columns (among the logged values) of the accelerometer and of the gyroscope
+    unsigned int accColumn;
+    unsigned int gyroColumn;
+    // Factors converting the logged values to m/s^2 and rad/s
+    double       accScale;
+    double       gyroScale;
+};
+
+/**
+ * Comparison of the estimates with a reference orientation logged in the same
+ * dataDumper file (e.g. the Euler angles of the XSens, in degrees).
+ */
+struct offlineReplayScoring {
+    offlineReplayScoring();
+
+    // First of the three columns (among the logged values) of the reference roll, pitch and yaw (deg)
+    unsigned int referenceColumn;
+    // Time (s) from the beginning of the log during which the filter is converging and is not scored
+    double       settleTime;
+    // Whether the yaw, which the accelerometer does not observe, is scored
+    bool         useYaw;
+};
+
+/**
+ * Runs the quaternion EKF over a whole dataDumper log as fast as possible.
+ * The estimates are stored in a table with the timestamps of the log and
+ * the columns q0 q1 q2 q3 roll pitch yaw, with the Euler angles (deg, xyz)
+ * of the conjugate quaternion as published by quaternionEKFThread.
+ */
+class offlineReplay {
+    offlineReplayParams m_params;
+public:
+    offlineReplay(const offlineReplayParams &params);
+
+    bool run(const dataDumperTable &data, dataDumperTable &estimates) const;
+    /**
+     * Runs the filter over the log without storing the estimates and computes
+     * the RMS error (deg) of the Euler angles with respect to the reference.
+     * The replay only reads data, so several replays can share it concurrently.
+     */
+    bool score(const dataDumperTable &data, const offlineReplayScoring &scoring, double &rmsError) const;
+
+    /**
+     * Writes a table as CSV: a header line, then one line per row with the timestamp first.
+     */
+    static bool writeCSV(const dataDumperTable &table, const std::string &fileName);
+    /**
+     * Writes a table in binary: the number of rows and of columns (uint32),
+     * then the rows (time first) as native endian doubles.
+     */
+    static bool writeBinary(const dataDumperTable &table, const std::string &fileName);
+};
+
+}
+
+#endif
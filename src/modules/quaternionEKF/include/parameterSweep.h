@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+#ifndef __PARAMETERSWEEP_H__
+#define __PARAMETERSWEEP_H__
+
+#include <string>
+#include <vector>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Thread.h>
+#include "offlineReplay.h"
+
+namespace filter{
+
+struct sweepResult {
+    offlineReplayParams params;
+    double              rmsError;
+    bool                valid;
+};
+
+/**
+ * Scores many configurations of the quaternion EKF over the same log.
+ * Each worker thread takes the next configuration not yet scored and runs
+ * its own filter over the shared (read-only) table, so the configurations
+ * are spread over all the workers whatever their cost.
+ */
+class parameterSweep {
+    class worker: public yarp::os::Thread {
+        parameterSweep &m_sweep;
+    public:
+        worker(parameterSweep &sweep);
+        void run();
+    };
+
+    const dataDumperTable      &m_data;
+    offlineReplayScoring        m_scoring;
+    std::vector<sweepResult>    m_results;
+    size_t                      m_next;
+    yarp::os::Mutex             m_mutex;
+
+    bool nextConfiguration(size_t &index);
+public:
+    parameterSweep(const dataDumperTable &data, const offlineReplayScoring &scoring);
+
+    void addConfiguration(const offlineReplayParams &params);
+    /**
+     * Scores all the configurations with nrOfThreads workers and ranks them
+     * by increasing error. Configurations that could not be scored or whose
+     * filter diverged are ranked last.
+     */
+    bool run(unsigned int nrOfThreads);
+    const std::vector<sweepResult>& getResults() const;
+
+    /**
+     * Writes the ranked table as CSV, one line per configuration.
+     */
+    bool writeRanking(const std::string &fileName) const;
+};
+
+}
+
+#endif
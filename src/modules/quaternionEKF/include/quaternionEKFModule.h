@@ -28,6 +28,7 @@
 #include "quaternionEKFThread.h"
 #define FILTER_GROUP_PARAMS_NAME "EKFPARAMS"
 #define DIRECT_GROUP_PARAMS_NAME "DIRECTFILTERPARAMS"
+#define OFFLINE_GROUP_PARAMS_NAME "OFFLINE"
 #define CONVERSION_FACTOR_ACC 5.9855e-04
 
 namespace filter{
@@ -62,6 +63,12 @@ class quaternionEKFModule: public yarp::os::RFModule
     dataDumperParser                           *m_parser;
     currentData                                 m_currentData;
     
+    /**
+     * Parses the whole dataDumper log, runs the EKF over it and writes the estimates
+     * to a CSV or binary file, with the parameters of the OFFLINE group.
+     */
+    bool   runOffline(yarp::os::ResourceFinder &rf);
+    
 public:
     quaternionEKFModule();
     
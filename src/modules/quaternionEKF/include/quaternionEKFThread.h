@@ -18,12 +18,6 @@
 #ifndef __QUATERNIONEKFTHREAD_H__
 #define __QUATERNIONEKFTHREAD_H__
 
-#include <bfl/filter/extendedkalmanfilter.h>
-#include <bfl/model/linearanalyticsystemmodel_gaussianuncertainty.h>
-#include <bfl/model/linearanalyticmeasurementmodel_gaussianuncertainty.h>
-#include <bfl/pdf/analyticconditionalgaussian.h>
-#include <bfl/pdf/linearanalyticconditionalgaussian.h>
-
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Property.h>
 #include <yarp/os/Bottle.h>
@@ -33,11 +27,11 @@
 
 #include <iomanip> //setw
 #include <algorithm> //std::find
-#include "nonLinearAnalyticConditionalGaussian.h"
-#include "nonLinearMeasurementGaussianPdf.h"
+#include <vector>
 #include "dataDumperParser.h"
 #include "directFilterComputation.h"
 #include <iCub/ctrl/filters.h>
+#include <ctrlLibRT/quaternionEKF.h>
 #include <yarp/math/Math.h>
 
 //TODO The path to the original data file must be retrieved by the ResourceFinder.
@@ -47,6 +41,8 @@
 //TODO In case you wanna add a different group in the configuration file
 #define FILTER_GROUP_PARAMS_NAME "EKFPARAMS"
 #define GRAVITY_ACC 9.81
+// Norm of the gravity used by the accelerometer model of the filter
+#define GRAVITY_NOMINAL 10.0
 #define PI 3.141592654
 // Accelerometer conversionf actor in m/s^2
 #define CONVERSION_FACTOR_ACC 5.9855e-04
@@ -59,6 +55,35 @@
 
 
 namespace filter{
+/**
+ * One of the IMUs fused by the filter, with its own measurement buffers.
+ */
+struct imuSensor
+{
+    // Source (index in the SENSOR_SOURCES ports) of the sensor, -1 for the legacy skin or XSens ports
+    int                                          source;
+    // MTB board of the sensor, -1 for a generic IMU
+    int                                          mtbBoard;
+    // Weight of the sensor: its noise variance is the nominal one divided by the weight
+    double                                       weight;
+    // Rotation from the sensor frame to the frame of the estimate
+    Eigen::Matrix3d                              rotation;
+    yarp::sig::Vector                            linAcc;
+    yarp::sig::Vector                            angVel;
+};
+
+/**
+ * A port from which the measurements of one or more sensors are read.
+ */
+struct imuSource
+{
+    std::string                                  portName;
+    yarp::os::BufferedPort<yarp::sig::Vector>   *reader;
+    // Last reading of the port, used until a new one arrives
+    yarp::sig::Vector                            lastReading;
+    bool                                         received;
+};
+
 class quaternionEKFThread: public yarp::os::RateThread
 {
     // Ports for sensor readings
@@ -89,12 +114,6 @@ class quaternionEKFThread: public yarp::os::RateThread
     dataDumperParser                            *m_parser;
     // currentData struct defined in dataDumperParser.h
     currentData                                  m_currentData;
-    BFL::nonLinearAnalyticConditionalGaussian    m_sysPdf;
-    BFL::AnalyticSystemModelGaussianUncertainty *m_sys_model;
-    BFL::Gaussian                               *m_measurement_uncertainty;
-    BFL::nonLinearMeasurementGaussianPdf        *m_measPdf;
-    BFL::AnalyticMeasurementModelGaussianUncertainty* m_meas_model;
-    MatrixWrapper::ColumnVector                  m_posterior_state;
     // filter parameters read from configuration file
     // TODO These should be put in some structure
     int                                          m_state_size;
@@ -109,12 +128,21 @@ class quaternionEKFThread: public yarp::os::RateThread
     bool                                         m_smoother;
     bool                                         m_external_imu;
     // Priors
-    BFL::Gaussian                               *m_prior;
     double                                       m_prior_cov;
     double                                       m_prior_mu;
-    MatrixWrapper::ColumnVector                  m_prior_mu_vec;
     // Filter
-    BFL::ExtendedKalmanFilter                   *m_filter;
+    iCub::ctrl::realTime::QuaternionEKF          m_filter;
+    // Sensors fused by the filter and their measurements in the frame of the estimate, allocated once
+    std::vector<imuSensor>                       m_sensors;
+    // Ports of the SENSOR_SOURCES, one for each distinct port
+    std::vector<imuSource>                       m_sources;
+    Eigen::Matrix<double, 3, Eigen::Dynamic>     m_sensorsLinAcc;
+    Eigen::Matrix<double, 3, Eigen::Dynamic>     m_sensorsAngVel;
+    Eigen::VectorXd                              m_sensorsWeight;
+    // Estimates buffers, allocated once
+    yarp::sig::Vector                            m_realOrientation;
+    yarp::sig::Vector                            m_estimateQuaternion;
+    yarp::sig::Vector                            m_estimateEuler;
     // Others
     double                                       m_waitingTime;
     yarp::sig::Vector                           *imu_measurement;
@@ -125,8 +153,10 @@ class quaternionEKFThread: public yarp::os::RateThread
     MatrixWrapper::Quaternion                   *m_quat_lsole_sensor;
     double                                       m_lowPass_cutoffFreq;
     bool                                         m_using2acc;
-    // Low Pass Filter
-    iCub::ctrl::FirstOrderLowPassFilter         *lowPassFilter;
+    // Low Pass Filter and weight of each accelerometer of the direct computation
+    std::vector<iCub::ctrl::FirstOrderLowPassFilter*> m_lowPassFilters;
+    std::vector<double>                          m_directWeights;
+    yarp::sig::Vector                            m_directAcc;
 
 public:
   quaternionEKFThread ( int                             period,
@@ -149,19 +179,34 @@ public:
   bool threadInit();
   void run();
   void threadRelease();
-  // TODO Temporarily will put this method here but it should be in QuaternionWrapper
-  void XiOperator(MatrixWrapper::ColumnVector quat, MatrixWrapper::Matrix* Xi);
-  // TODO Temporarily putting this method here. Should be put in MatrixWrapper somewhere
-  void SOperator(MatrixWrapper::ColumnVector omg, MatrixWrapper::Matrix* S);
    
-  /** \brief Filters and extracts a specific MTB data from an MTB port.
+  /** \brief Filters and extracts a specific MTB data from a reading of an MTB port.
    * 
    *    MTB port example: /icub/rigth_leg/inertialMTB
+   *  \param[in]  mtbMeas Reading of the MTB port.
    *  \param[in]  sensorType ID number of the MTB "position" in iCub's body.
    *  \param[out] linAccOutput Extracted/Parsed accelerometer measurement from MTB port reading.
    *  \param[out] gyroMeasOutput Extracted/Parsed gyroscope measurement from MTB port reading.
+   *  \return true if both the accelerometer and the gyroscope of the board were found in the reading.
+   */
+  bool extractMTBDatafromPort(const yarp::sig::Vector &mtbMeas, int sensorType, yarp::sig::Vector &linAccOutput, yarp::sig::Vector &gyroMeasOutput);
+
+  /** \brief Extracts the measurements from a reading of a generic IMU port (XSens layout).
+   *
+   *    IMU port example: /icub/inertial
+   *  \param[in]  imuMeas Reading of the IMU port: euler angles (deg), linear acceleration (m/s^2) and angular velocity (deg/s).
+   *  \param[out] linAccOutput Linear acceleration in m/s^2.
+   *  \param[out] gyroMeasOutput Angular velocity in rad/s.
+   *  \return true if the reading has all the measurements.
    */
-  bool extractMTBDatafromPort(int sensorType, yarp::sig::Vector &linAccOutput, yarp::sig::Vector &gyroMeasOutput);
+  bool extractIMUDatafromPort(const yarp::sig::Vector &imuMeas, yarp::sig::Vector &linAccOutput, yarp::sig::Vector &gyroMeasOutput);
+
+  /** \brief Reads the fused sensors configuration (SENSOR_SOURCES or MTB_BOARDS, SENSOR_WEIGHTS and SENSOR_ROTATIONS)
+   *         from the filter parameters and allocates the measurement buffers and the readers of the sources.
+   */
+  bool configureSensors();
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   };
 }
 
@@ -33,6 +33,7 @@ dataDumperParser::dataDumperParser(std::string srcFile): m_srcFile(srcFile)
 //     // Pointer to last byte of data in the mapping
 //     m_pLast = m_pFirst + m_mmap.size();
 //     
+    m_mmap = NULL;
     m_pLast = 0;
     m_pFirst = 0;
     m_pCurrent = 0;
@@ -154,6 +155,16 @@ bool dataDumperParser::parseLine(currentData &currData)
     }
 }
 
+bool dataDumperParser::parseTable(dataDumperTable &table)
+{
+    if (!m_pFirst) {
+        table.clear();
+        yError("[dataDumperParser::parseTable] The file has not been mapped, call parseFile() first");
+        return false;
+    }
+    return dataDumperTableParser::parseTable(m_pFirst, m_pLast, m_srcFile, table);
+}
+
 bool dataDumperParser::countLines()
 {
     bool ans = false;
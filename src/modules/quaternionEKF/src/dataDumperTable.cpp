@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "dataDumperTable.h"
+
+#include <cmath>
+#include <cstring>
+#include <yarp/os/LogStream.h>
+
+dataDumperTableParser::dataDumperTableParser(std::string srcFile): m_srcFile(srcFile)
+{
+}
+
+void dataDumperTableParser::parseFile()
+{
+    m_mmap.open(m_srcFile);
+}
+
+bool dataDumperTableParser::parseTable(dataDumperTable &table)
+{
+    if (!m_mmap.is_open()) {
+        table.clear();
+        yError("[dataDumperTableParser::parseTable] The file has not been mapped, call parseFile() first");
+        return false;
+    }
+    return parseTable(m_mmap.data(), m_mmap.data() + m_mmap.size(), m_srcFile, table);
+}
+
+bool dataDumperTableParser::parseNumber(const char* &p, const char* end, double &value)
+{
+    // Exactly representable powers of ten
+    static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                         1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                         1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* q = p;
+    bool negative = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+        negative = (*q == '-');
+        q++;
+    }
+
+    // At most 19 significant digits are accumulated in an integer mantissa
+    unsigned long long mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    while (q < end && *q >= '0' && *q <= '9') {
+        if (significantDigits < 19) {
+            mantissa = 10*mantissa + (*q - '0');
+            if (mantissa) significantDigits++;
+        } else {
+            exponent++;
+        }
+        anyDigit = true;
+        q++;
+    }
+    if (q < end && *q == '.') {
+        q++;
+        while (q < end && *q >= '0' && *q <= '9') {
+            if (significantDigits < 19) {
+                mantissa = 10*mantissa + (*q - '0');
+                if (mantissa) significantDigits++;
+                exponent--;
+            }
+            anyDigit = true;
+            q++;
+        }
+    }
+    if (!anyDigit) {
+        return false;
+    }
+    if (q < end && (*q == 'e' || *q == 'E')) {
+        q++;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = (*q == '-');
+            q++;
+        }
+        if (q == end || *q < '0' || *q > '9') {
+            return false;
+        }
+        int explicitExponent = 0;
+        while (q < end && *q >= '0' && *q <= '9') {
+            if (explicitExponent < 10000)
+                explicitExponent = 10*explicitExponent + (*q - '0');
+            q++;
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    // The number must be followed by a blank or by the end of the line
+    if (q < end && *q != ' ' && *q != '\t' && *q != '\r') {
+        return false;
+    }
+
+    value = (double) mantissa;
+    if (exponent < 0) {
+        value /= (exponent >= -22) ? powersOfTen[-exponent] : pow(10.0, -exponent);
+    } else if (exponent > 0) {
+        value *= (exponent <= 22) ? powersOfTen[exponent] : pow(10.0, exponent);
+    }
+    if (negative) {
+        value = -value;
+    }
+    p = q;
+    return true;
+}
+
+bool dataDumperTableParser::parseTable(const char* first, const char* last, const std::string &srcFile, dataDumperTable &table)
+{
+    table.clear();
+
+    // Preallocate the columns with the number of lines
+    size_t nrOfLines = 0;
+    for (const char* pLine = first; pLine && pLine != last; ) {
+        if ((pLine = static_cast<const char*>(memchr(pLine, '\n', last - pLine))))
+            nrOfLines++, pLine++;
+    }
+    nrOfLines++;
+    table.time.reserve(nrOfLines);
+
+    size_t nrOfValues = 0;
+    size_t lineNumber = 0;
+    const char* pLine = first;
+    while (pLine < last) {
+        const char* eol = static_cast<const char*>(memchr(pLine, '\n', last - pLine));
+        if (!eol) {
+            eol = last;
+        }
+        lineNumber++;
+
+        const char* p = pLine;
+        size_t col = 0;
+        while (true) {
+            while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) {
+                p++;
+            }
+            if (p == eol) {
+                break;
+            }
+            double value;
+            if (!parseNumber(p, eol, value)) {
+                yError("[dataDumperTableParser::parseTable] Invalid number at line %lu, column %lu of %s",
+                       (unsigned long) lineNumber, (unsigned long) col, srcFile.c_str());
+                return false;
+            }
+            if (col == 1) {
+                table.time.push_back(value);
+            } else if (col > 1) {
+                // The first line defines the number of values
+                if (table.rows() == 1 && col - 2 == table.columns.size()) {
+                    table.columns.push_back(std::vector<double>());
+                    table.columns.back().reserve(nrOfLines);
+                }
+                if (col - 2 >= table.columns.size()) {
+                    yError("[dataDumperTableParser::parseTable] Line %lu of %s has more values than the first line",
+                           (unsigned long) lineNumber, srcFile.c_str());
+                    return false;
+                }
+                table.columns[col - 2].push_back(value);
+            }
+            col++;
+        }
+
+        // Empty lines are skipped
+        if (col > 0) {
+            if (table.rows() == 1) {
+                nrOfValues = table.columns.size();
+            }
+            if (col < 2 || col - 2 != nrOfValues) {
+                yError("[dataDumperTableParser::parseTable] Line %lu of %s has %lu values instead of %lu",
+                       (unsigned long) lineNumber, srcFile.c_str(), (unsigned long) (col < 2 ? 0 : col - 2), (unsigned long) nrOfValues);
+                return false;
+            }
+        }
+        pLine = eol + 1;
+    }
+
+    yInfo(" [dataDumperTableParser::parseTable] Parsed %lu lines with %lu values from %s",
+          (unsigned long) table.rows(), (unsigned long) nrOfValues, srcFile.c_str());
+    return true;
+}
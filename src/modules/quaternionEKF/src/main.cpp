@@ -31,7 +31,8 @@ int main(int argc, char* argv[])
                                   to put the accelerometer at 0 degrees or 90 degrees. Once this \n\
                                   orientation is achieved, the user needs to hit ENTER for data to be collected\n");
         printf("--autoconnect     :[true] or false\n");
-        printf("--mode            :[online] or offline\n");
+        printf("--mode            :[online] or offline. When offline, the whole dataDumper log given in the\n\
+                                  OFFLINE group is filtered at once and the estimates are written to file.\n");
         printf("--usingXSens      :[false] When true, the module will an XSens IMU attached to the \n\
                                   computer (USB) for testing the algorithm.\n");
         printf("--usingEKF        :[true] When true, the module will use a quaternion-based Extended \n\
@@ -58,7 +59,8 @@ int main(int argc, char* argv[])
     
     yarp::os::Network yarpNetwork;
     
-    if (!yarpNetwork.checkNetwork())
+    // The offline batch estimation only reads and writes files
+    if (rf.check("mode") && rf.find("mode").asString() != "offline" && !yarpNetwork.checkNetwork())
     {
         yError("YARP Network is not available. The module will shut down now...");
         return -1;
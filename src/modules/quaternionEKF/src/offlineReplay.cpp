@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "offlineReplay.h"
+
+#include <cstdio>
+#include <cmath>
+#include <yarp/os/LogStream.h>
+#include <ctrlLibRT/quaternionEKF.h>
+
+#define OFFLINE_REPLAY_ESTIMATES 7
+#define PI 3.141592654
+
+using namespace filter;
+
+namespace
+{
+    typedef iCub::ctrl::realTime::QuaternionEKF QuaternionEKF;
+
+    bool checkColumns(const offlineReplayParams &params, const dataDumperTable &data)
+    {
+        if (params.accColumn + 3 > data.columns.size() || params.gyroColumn + 3 > data.columns.size()) {
+            yError("[offlineReplay] The log has %lu values per line, the accelerometer and gyroscope columns are out of range",
+                   (unsigned long) data.columns.size());
+            return false;
+        }
+        return true;
+    }
+
+    void initFilter(const offlineReplayParams &params, QuaternionEKF &ekf)
+    {
+        ekf.setTs(params.sampleTime);
+        ekf.setGyroscopeNoise(params.sigmaGyro);
+        ekf.setAccelerometerNoise(params.sigmaAcc);
+        ekf.setGravity(params.gravity);
+        ekf.init(Eigen::Vector4d(1.0, 0.0, 0.0, 0.0), params.priorCovariance);
+    }
+
+    // Filters the k-th line of the log and returns the Euler angles (deg) published by quaternionEKFThread
+    void filterLine(const offlineReplayParams &params, const dataDumperTable &data, const size_t k,
+                    QuaternionEKF &ekf, Eigen::Vector3d &eulerAnglesDeg)
+    {
+        Eigen::Vector3d linAcc, angVel;
+        double dt = (k > 0) ? data.time[k] - data.time[k-1] : 0.0;
+        ekf.setTs(dt > 0.0 ? dt : params.sampleTime);
+        for (unsigned int i=0; i<3; i++) {
+            linAcc(i) = params.accScale*data.columns[params.accColumn + i][k];
+            angVel(i) = params.gyroScale*data.columns[params.gyroColumn + i][k];
+        }
+        ekf.step(angVel, linAcc);
+
+        const QuaternionEKF::StateType& q = ekf.getState();
+        QuaternionEKF::StateType conjugateQuat;
+        conjugateQuat << q(0), -q(1), -q(2), -q(3);
+        QuaternionEKF::eulerAnglesXYZ(conjugateQuat, eulerAnglesDeg);
+        eulerAnglesDeg *= 180/PI;
+    }
+
+    // Difference of two angles (deg) wrapped in [-180, 180)
+    double angleDifference(const double a, const double b)
+    {
+        double diff = fmod(a - b + 180.0, 360.0);
+        if (diff < 0.0)
+            diff += 360.0;
+        return diff - 180.0;
+    }
+}
+
+offlineReplayScoring::offlineReplayScoring()
+    : referenceColumn( 0 ),
+      settleTime( 1.0 ),
+      useYaw( false )
+{
+}
+
+offlineReplayParams::offlineReplayParams()
+    : sampleTime( 0.01 ),
+      sigmaGyro( 0.001 ),
+      sigmaAcc( 0.002 ),
+      priorCovariance( 1.0 ),
+      gravity( 10.0 ),
+      accColumn( 3 ),
+      gyroColumn( 6 ),
+      accScale( 1.0 ),
+      gyroScale( PI/180 )
+{
+}
+
+offlineReplay::offlineReplay ( const offlineReplayParams& params ) : m_params( params )
+{
+}
+
+bool offlineReplay::run ( const dataDumperTable& data, dataDumperTable& estimates ) const
+{
+    if (!checkColumns(m_params, data))
+        return false;
+
+    QuaternionEKF ekf(m_params.sampleTime);
+    initFilter(m_params, ekf);
+
+    size_t rows = data.rows();
+    estimates.time = data.time;
+    estimates.columns.assign(OFFLINE_REPLAY_ESTIMATES, std::vector<double>(rows));
+
+    Eigen::Vector3d eulerAngles;
+    for (size_t k=0; k<rows; k++) {
+        filterLine(m_params, data, k, ekf, eulerAngles);
+        for (unsigned int i=0; i<4; i++)
+            estimates.columns[i][k] = ekf.getState()(i);
+        for (unsigned int i=0; i<3; i++)
+            estimates.columns[4+i][k] = eulerAngles(i);
+    }
+    return true;
+}
+
+bool offlineReplay::score ( const dataDumperTable& data, const offlineReplayScoring& scoring, double& rmsError ) const
+{
+    if (!checkColumns(m_params, data))
+        return false;
+    if (scoring.referenceColumn + 3 > data.columns.size()) {
+        yError("[offlineReplay::score] The log has %lu values per line, the reference columns are out of range",
+               (unsigned long) data.columns.size());
+        return false;
+    }
+
+    QuaternionEKF ekf(m_params.sampleTime);
+    initFilter(m_params, ekf);
+
+    unsigned int scoredAngles = scoring.useYaw ? 3 : 2;
+    double squaredError = 0.0;
+    size_t scoredLines = 0;
+    Eigen::Vector3d eulerAngles;
+    for (size_t k=0; k<data.rows(); k++) {
+        filterLine(m_params, data, k, ekf, eulerAngles);
+        if (data.time[k] - data.time[0] < scoring.settleTime)
+            continue;
+        for (unsigned int i=0; i<scoredAngles; i++) {
+            double error = angleDifference(eulerAngles(i), data.columns[scoring.referenceColumn + i][k]);
+            squaredError += error*error;
+        }
+        scoredLines++;
+    }
+    if (scoredLines == 0) {
+        yError("[offlineReplay::score] The log is shorter than the settle time");
+        return false;
+    }
+    rmsError = sqrt(squaredError/(scoredLines*scoredAngles));
+    return true;
+}
+
+bool offlineReplay::writeCSV ( const dataDumperTable& table, const std::string& fileName )
+{
+    FILE* file = fopen(fileName.c_str(), "w");
+    if (!file) {
+        yError("[offlineReplay::writeCSV] Could not open %s", fileName.c_str());
+        return false;
+    }
+    if (table.columns.size() == OFFLINE_REPLAY_ESTIMATES) {
+        fprintf(file, "time,q0,q1,q2,q3,roll,pitch,yaw\n");
+    } else {
+        fprintf(file, "time");
+        for (size_t c=0; c<table.columns.size(); c++)
+            fprintf(file, ",value%lu", (unsigned long) c);
+        fprintf(file, "\n");
+    }
+    for (size_t k=0; k<table.rows(); k++) {
+        fprintf(file, "%.6f", table.time[k]);
+        for (size_t c=0; c<table.columns.size(); c++)
+            fprintf(file, ",%.9g", table.columns[c][k]);
+        fprintf(file, "\n");
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+bool offlineReplay::writeBinary ( const dataDumperTable& table, const std::string& fileName )
+{
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if (!file) {
+        yError("[offlineReplay::writeBinary] Could not open %s", fileName.c_str());
+        return false;
+    }
+    unsigned int header[2] = {(unsigned int) table.rows(), (unsigned int) table.columns.size()};
+    fwrite(header, sizeof(unsigned int), 2, file);
+    std::vector<double> row(1 + table.columns.size());
+    for (size_t k=0; k<table.rows(); k++) {
+        row[0] = table.time[k];
+        for (size_t c=0; c<table.columns.size(); c++)
+            row[1+c] = table.columns[c][k];
+        fwrite(&row[0], sizeof(double), row.size(), file);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
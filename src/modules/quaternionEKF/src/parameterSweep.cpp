@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "parameterSweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <yarp/os/LogStream.h>
+
+using namespace filter;
+
+namespace
+{
+    bool betterResult(const sweepResult &a, const sweepResult &b)
+    {
+        if (a.valid != b.valid)
+            return a.valid;
+        return a.valid && a.rmsError < b.rmsError;
+    }
+}
+
+parameterSweep::worker::worker ( parameterSweep& sweep ) : m_sweep( sweep )
+{
+}
+
+void parameterSweep::worker::run()
+{
+    size_t index;
+    while (m_sweep.nextConfiguration(index)) {
+        sweepResult &result = m_sweep.m_results[index];
+        offlineReplay replay(result.params);
+        result.valid = replay.score(m_sweep.m_data, m_sweep.m_scoring, result.rmsError);
+        // A diverging filter gives a NaN error
+        if (result.rmsError != result.rmsError)
+            result.valid = false;
+    }
+}
+
+parameterSweep::parameterSweep ( const dataDumperTable& data, const offlineReplayScoring& scoring )
+    : m_data( data ),
+      m_scoring( scoring ),
+      m_next( 0 )
+{
+}
+
+void parameterSweep::addConfiguration ( const offlineReplayParams& params )
+{
+    sweepResult result;
+    result.params = params;
+    result.rmsError = 0.0;
+    result.valid = false;
+    m_results.push_back(result);
+}
+
+bool parameterSweep::nextConfiguration ( size_t& index )
+{
+    m_mutex.lock();
+    bool available = m_next < m_results.size();
+    if (available)
+        index = m_next++;
+    m_mutex.unlock();
+    return available;
+}
+
+bool parameterSweep::run ( unsigned int nrOfThreads )
+{
+    if (nrOfThreads == 0)
+        nrOfThreads = 1;
+    if (nrOfThreads > m_results.size())
+        nrOfThreads = m_results.size();
+    m_next = 0;
+
+    std::vector<worker*> workers;
+    bool started = true;
+    for (unsigned int t=0; t<nrOfThreads; t++) {
+        workers.push_back(new worker(*this));
+        if (!workers.back()->start()) {
+            yError("[parameterSweep::run] Could not start worker thread %u", t);
+            started = false;
+            break;
+        }
+    }
+    // The workers terminate when no configuration is left, stop() joins them
+    for (unsigned int t=0; t<workers.size(); t++) {
+        workers[t]->stop();
+        delete workers[t];
+    }
+    if (!started)
+        return false;
+
+    std::stable_sort(m_results.begin(), m_results.end(), betterResult);
+    return true;
+}
+
+const std::vector<sweepResult>& parameterSweep::getResults() const
+{
+    return m_results;
+}
+
+bool parameterSweep::writeRanking ( const std::string& fileName ) const
+{
+    FILE* file = fopen(fileName.c_str(), "w");
+    if (!file) {
+        yError("[parameterSweep::writeRanking] Could not open %s", fileName.c_str());
+        return false;
+    }
+    fprintf(file, "rank,SIGMA_GYRO_NOISE,SIGMA_MEASUREMENT_NOISE,PRIOR_COV_STATE,rmsError\n");
+    for (size_t r=0; r<m_results.size(); r++) {
+        const sweepResult &result = m_results[r];
+        fprintf(file, "%lu,%g,%g,%g,", (unsigned long) (r+1), result.params.sigmaGyro,
+                result.params.sigmaAcc, result.params.priorCovariance);
+        if (result.valid)
+            fprintf(file, "%.6g\n", result.rmsError);
+        else
+            fprintf(file, "nan\n");
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
@@ -17,13 +17,18 @@
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Port.h>
 
+#include <yarp/os/Time.h>
+
 #include "quaternionEKFThread.h"
 #include "quaternionEKFModule.h"
+#include "offlineReplay.h"
 
 using namespace filter;
 quaternionEKFModule::quaternionEKFModule()
 {
     period = 0.01;
+    quatEKFThread = NULL;
+    m_parser = NULL;
 }
 
 bool quaternionEKFModule::configure ( yarp::os::ResourceFinder& rf )
@@ -204,14 +209,10 @@ bool quaternionEKFModule::configure ( yarp::os::ResourceFinder& rf )
             if(!tmpOffline.compare(mode)) {
                 yInfo(" [quaternionEKFModule::configure] Offline batch estimation will be performed");
                 
-                // **** Initialization
-                // Create dataDumper parser
-                m_parser = new dataDumperParser(DATAFILE);
-                m_parser->parseFile();
-                m_parser->countLines();
-                
-                // Change period of the module thread
-                
+                if (!runOffline(rf)) {
+                    yError("[quaternionEKFModule::configure] Offline estimation failed.");
+                    return false;
+                }
             } else {
                 yError("[quaternionEKFModule::configure] An invalid option was passed to 'mode'. Available options are 'offline' or 'online'.");
                 return false;
@@ -223,17 +224,76 @@ bool quaternionEKFModule::configure ( yarp::os::ResourceFinder& rf )
   return true;
 }
 
+bool quaternionEKFModule::runOffline ( yarp::os::ResourceFinder& rf )
+{
+    // The whole log is parsed in a columnar table and replayed through the filter at once
+    yarp::os::Property filterParams;
+    if (rf.check(FILTER_GROUP_PARAMS_NAME)) {
+        filterParams.fromString(rf.findGroup(FILTER_GROUP_PARAMS_NAME).tail().toString());
+    }
+    yarp::os::Property offlineParams;
+    if (rf.check(OFFLINE_GROUP_PARAMS_NAME)) {
+        offlineParams.fromString(rf.findGroup(OFFLINE_GROUP_PARAMS_NAME).tail().toString());
+    }
+
+    offlineReplayParams params;
+    params.sampleTime      = period;
+    params.gravity         = gravityVec;
+    params.sigmaGyro       = filterParams.check("SIGMA_GYRO_NOISE", yarp::os::Value(params.sigmaGyro)).asDouble();
+    params.sigmaAcc        = filterParams.check("SIGMA_MEASUREMENT_NOISE", yarp::os::Value(params.sigmaAcc)).asDouble();
+    params.priorCovariance = filterParams.check("PRIOR_COV_STATE", yarp::os::Value(params.priorCovariance)).asDouble();
+    params.accColumn       = offlineParams.check("accColumn", yarp::os::Value((int) params.accColumn)).asInt();
+    params.gyroColumn      = offlineParams.check("gyroColumn", yarp::os::Value((int) params.gyroColumn)).asInt();
+    params.accScale        = offlineParams.check("accScale", yarp::os::Value(params.accScale)).asDouble();
+    params.gyroScale       = offlineParams.check("gyroScale", yarp::os::Value(params.gyroScale)).asDouble();
+
+    std::string dataFile     = offlineParams.check("dataFile", yarp::os::Value(DATAFILE)).asString();
+    std::string outputFile   = offlineParams.check("outputFile", yarp::os::Value("quaternionEKF_estimates.csv")).asString();
+    std::string outputFormat = offlineParams.check("outputFormat", yarp::os::Value("csv")).asString();
+    if (outputFormat != "csv" && outputFormat != "binary") {
+        yError("[quaternionEKFModule::runOffline] Invalid outputFormat %s. Available options are 'csv' or 'binary'.", outputFormat.c_str());
+        return false;
+    }
+
+    double startTime = yarp::os::Time::now();
+    m_parser = new dataDumperParser(dataFile);
+    try {
+        m_parser->parseFile();
+    } catch (std::exception &e) {
+        yError("[quaternionEKFModule::runOffline] Could not open %s: %s", dataFile.c_str(), e.what());
+        return false;
+    }
+    dataDumperTable data;
+    if (!m_parser->parseTable(data)) {
+        return false;
+    }
+    double parseTime = yarp::os::Time::now();
+
+    dataDumperTable estimates;
+    offlineReplay replay(params);
+    if (!replay.run(data, estimates)) {
+        return false;
+    }
+    double filterTime = yarp::os::Time::now();
+
+    bool written = (outputFormat == "csv") ? offlineReplay::writeCSV(estimates, outputFile)
+                                           : offlineReplay::writeBinary(estimates, outputFile);
+    if (!written) {
+        yError("[quaternionEKFModule::runOffline] Could not write the estimates to %s", outputFile.c_str());
+        return false;
+    }
+    yInfo(" [quaternionEKFModule::runOffline] %lu samples: parsed in %f s, filtered in %f s, estimates written to %s in %f s",
+          (unsigned long) estimates.rows(), parseTime - startTime, filterTime - parseTime,
+          outputFile.c_str(), yarp::os::Time::now() - filterTime);
+    return true;
+}
+
 bool quaternionEKFModule::updateModule()
 {
     std::string tmp = "offline";
-//     std::cout << "Module period" << this->getPeriod() << std::endl;
     if (!tmp.compare(mode)) {
-        if(!m_parser->parseLine(m_currentData)) {
-            yInfo("[ quaternionEKFThread::run] File was fully processed or it could not be opened. Quitting thread.");
-            return false;
-        } else {
-        // TODO Perform the offline estimates
-        }
+        // The batch estimation was completed in configure()
+        return false;
     } else {
         if (calib) {
             using namespace std;
@@ -303,6 +363,10 @@ bool quaternionEKFModule::close()
             gyroMeasPort2.interrupt();
         }
     }
+    if (m_parser) {
+        delete m_parser;
+        m_parser = NULL;
+    }
     return true;
 }
 
@@ -19,6 +19,8 @@
 
 #include <iCub/ctrl/filters.h>
 
+#include <sstream>
+
 using namespace std;
 using namespace yarp::os;
 using namespace yarp::sig;
@@ -60,10 +62,13 @@ quaternionEKFThread::quaternionEKFThread ( int period,
       m_filterParams( filterParams ),
       m_gyroMeasPort ( gyroMeasPort ),
       m_gyroMeasPort2 ( gyroMeasPort2 ),
-      m_sysPdf( STATEDIM ),
-      m_prior_mu_vec( STATEDIM ),
+      m_filter( period/1000.0 ),
+      m_realOrientation( 3, 0.0 ),
+      m_estimateQuaternion( STATEDIM, 0.0 ),
+      m_estimateEuler( 3, 0.0 ),
       m_waitingTime( 0.0 ),
-      m_using2acc( false )
+      m_using2acc( false ),
+      m_directAcc( 3, 0.0 )
 {
     //TODO Initialize m_gyroMeasPort according to gyroMeasPort
     // NOTE This is assuming that the accelerometer readings are coming from the MTB boards' accelerometers as done in iCubGenova01
@@ -75,7 +80,7 @@ quaternionEKFThread::quaternionEKFThread ( int period,
 void quaternionEKFThread::run()
 {
     // Get Input and measurement from XSens or iCubGenova01's sensors
-    if ( m_usingxsens && !m_usingSkin) {
+    if ( m_usingxsens && !m_usingSkin && m_sources.empty()) {
         bool reading = true;
         imu_measurement = m_gyroMeasPort->read(reading);
         if (m_using2acc) {
@@ -83,166 +88,141 @@ void quaternionEKFThread::run()
         }
     }
     
-    if (m_verbose && (!m_usingSkin || m_usingxsens)) {
+    if (m_verbose && (!m_usingSkin || m_usingxsens) && m_sources.empty()) {
         cout << "Full imu_measurement vec: " << endl;
         cout << imu_measurement->toString().c_str() << endl;
     }
     
-    yarp::sig::Vector imu_linAcc(3);
-    yarp::sig::Vector imu_angVel(3);
-    yarp::sig::Vector realOrientation(3);
-    
-    // Get input(gyro) and measurement(acc) from MTB port
-    if (m_usingSkin && m_usingEKF && !m_usingxsens) {
-        if( !extractMTBDatafromPort(MTB_RIGHT_FOOT_ACC_PLUS_GYRO_2_ID, imu_linAcc, imu_angVel) ) {
-            yError("[quaternionEKFThread::run] Sensor data could not be parsed from MTB port");
-        } else {
-            if (m_verbose)
-                yInfo("[quaternionEKFThread::run] Parsed sensor data: \n Acc [m/s^2]: \t%s \n Ang Vel [deg/s]: \t%s \n",  imu_linAcc.toString().c_str(), imu_angVel.toString().c_str());
-        }
-    }
+    yarp::sig::Vector& realOrientation = m_realOrientation;
 
     if (m_usingEKF) {
-        // XSens orientation
-        if (m_usingxsens & !m_usingSkin)
-            realOrientation = imu_measurement->subVector(0,2);
-        // Extract linear acceleration in m/s^2
-        if (m_usingxsens && !m_usingSkin) {
-            imu_linAcc = imu_measurement->subVector(3,5);
-            // NOTE The raw angular speed read from the IMU is in deg/s. In this module we will transform
-            // it to rad/s
-            imu_angVel = PI/180*imu_measurement->subVector(6,8);
+        // A sensor whose data is not available in this cycle is not fused
+        m_sensorsWeight.setZero();
+
+        // Get input(gyro) and measurement(acc) of each sensor from the last reading of its source
+        if (!m_sources.empty()) {
+            for (unsigned int p=0; p<m_sources.size(); p++) {
+                yarp::sig::Vector* reading = m_sources[p].reader->read(false);
+                if (reading) {
+                    m_sources[p].lastReading = *reading;
+                    m_sources[p].received = true;
+                }
+            }
+            for (unsigned int s=0; s<m_sensors.size(); s++) {
+                imuSensor& sensor = m_sensors[s];
+                const imuSource& source = m_sources[sensor.source];
+                if (!source.received)
+                    continue;
+                bool parsed = (sensor.mtbBoard >= 0) ? extractMTBDatafromPort(source.lastReading, sensor.mtbBoard, sensor.linAcc, sensor.angVel)
+                                                     : extractIMUDatafromPort(source.lastReading, sensor.linAcc, sensor.angVel);
+                if (!parsed) {
+                    yError("[quaternionEKFThread::run] Data of sensor %d could not be parsed from %s", s, source.portName.c_str());
+                } else {
+                    m_sensorsWeight(s) = sensor.weight;
+                }
+            }
         }
-        // Copy ang velocity data from a yarp vector into a ColumnVector
-        MatrixWrapper::ColumnVector input(imu_angVel.data(),m_input_size);
-        if (m_verbose)
-            cout << "VEL INPUT IS: " << endl << input << endl;
-        // Copy accelerometer data from a yarp vector into a ColumnVector
-        MatrixWrapper::ColumnVector measurement(imu_linAcc.data(),m_measurement_size);
-        if (m_verbose)
-            cout << "ACC INPUT IS: " << endl << measurement << endl;
-
-        // Noise gaussian
-        // System Noise Mean
-        // TODO [NOT SURE] This mean changes!!!
-        MatrixWrapper::ColumnVector sys_noise_mu(m_state_size);
-        sys_noise_mu = 0.0;
-
-        /**************** System Noise Covariance ********************************************************************************/
-        MatrixWrapper::Matrix Xi(m_state_size, m_input_size);
-        XiOperator(m_posterior_state, &Xi);
-        MatrixWrapper::SymmetricMatrix sys_noise_cov(m_state_size);
-        sys_noise_cov = 0.0;
-        // NOTE m_sigma_gyro must be small, ||ek|| = 10e-3 rad/sec
-        MatrixWrapper::Matrix Sigma_gyro(m_input_size,m_input_size);
-        Sigma_gyro = 0.0;
-        Sigma_gyro(1,1) = Sigma_gyro(2,2) = Sigma_gyro(3,3) = m_sigma_gyro;
-        MatrixWrapper::Matrix tmp = Xi*Sigma_gyro*Xi.transpose();
-        // NOTE on 30-07-2015 I commented the following lines because making this matrix symmetric this way does not make much sense from a theoretical point of view. I'd rather add a term such as alpha*I_4x4
-//         MatrixWrapper::SymmetricMatrix tmpSym(m_state_size);
-//         tmp.convertToSymmetricMatrix(tmpSym);
-        sys_noise_cov = (MatrixWrapper::SymmetricMatrix) tmp*pow(m_period/(1000.0*2.0),2);
-        // NOTE Next line is setting system noise covariance matrix to a constant diagonal matrix
-//         sys_noise_cov = 0.0; sys_noise_cov(1,1) = sys_noise_cov (2,2) = sys_noise_cov(3,3) = sys_noise_cov(4,4) = 0.000001;
-        /****************END System Noise Covariance *********************************************************************************/
 
-        if (m_verbose)
-            cout << "System covariance matrix will be: " << endl << sys_noise_cov << endl;
+        // Get input(gyro) and measurement(acc) of each sensor from MTB port
+        if (m_usingSkin && !m_usingxsens && m_sources.empty()) {
+            bool portRead = m_imuSkinPortIn.read(m_MTBmeas);
+            if (!portRead) {
+                yError("[quaternionEKFThread::run] There was an error trying to read from the MTB port");
+            } else if (m_verbose) {
+                yInfo("[quaternionEKFThread::run] Raw meas: %s", m_MTBmeas.toString().c_str());
+            }
+            for (unsigned int s=0; s<m_sensors.size() && portRead; s++) {
+                imuSensor& sensor = m_sensors[s];
+                if( !extractMTBDatafromPort(m_MTBmeas, sensor.mtbBoard, sensor.linAcc, sensor.angVel) ) {
+                    yError("[quaternionEKFThread::run] Data of MTB board %d could not be parsed from MTB port", sensor.mtbBoard);
+                } else {
+                    m_sensorsWeight(s) = sensor.weight;
+                    if (m_verbose)
+                        yInfo("[quaternionEKFThread::run] Parsed sensor data of board %d: \n Acc [m/s^2]: \t%s \n Ang Vel [rad/s]: \t%s \n", sensor.mtbBoard, sensor.linAcc.toString().c_str(), sensor.angVel.toString().c_str());
+                }
+            }
+        }
 
-        m_sysPdf.AdditiveNoiseMuSet(sys_noise_mu);
-        m_sysPdf.AdditiveNoiseSigmaSet(sys_noise_cov);
+        if (m_usingxsens && !m_usingSkin && m_sources.empty()) {
+            imuSensor& sensor = m_sensors[0];
+            for (unsigned int i=0; i<3; i++) {
+                // XSens orientation
+                realOrientation(i) = (*imu_measurement)(i);
+                // Extract linear acceleration in m/s^2
+                sensor.linAcc(i) = (*imu_measurement)(3+i);
+                // NOTE The raw angular speed read from the IMU is in deg/s. In this module we will transform
+                // it to rad/s
+                sensor.angVel(i) = PI/180*(*imu_measurement)(6+i);
+            }
+            m_sensorsWeight(0) = sensor.weight;
+        }
+
+        // Express all the measurements in the frame of the estimate
+        for (unsigned int s=0; s<m_sensors.size(); s++) {
+            m_sensorsAngVel.col(s).noalias() = m_sensors[s].rotation*Eigen::Map<const Eigen::Vector3d>(m_sensors[s].angVel.data());
+            m_sensorsLinAcc.col(s).noalias() = m_sensors[s].rotation*Eigen::Map<const Eigen::Vector3d>(m_sensors[s].linAcc.data());
+        }
+        if (m_verbose) {
+            cout << "VEL INPUT IS: " << endl << m_sensorsAngVel << endl;
+            cout << "ACC INPUT IS: " << endl << m_sensorsLinAcc << endl;
+            cout << "SENSOR WEIGHTS ARE: " << m_sensorsWeight.transpose() << endl;
+        }
+
+        // Prediction with the gyroscopes (the system noise covariance depends on the last estimate)
+        // and correction with the accelerometers, fused in a single step
+        if (!m_filter.step(m_sensorsAngVel, m_sensorsLinAcc, m_sensorsWeight)) {
+            yError("[quaternionEKFThread::run] No sensor data is available, the estimate was not updated");
+        }
 
         double elapsedTime = yarp::os::Time::now() - m_waitingTime;
 
-    //     double intpart = 0.0;
-
-    //     // NOTE Let's include the measurement roughly every ten seconds
-    //     if (modf(elapsedTime/10, &intpart) < 0.001) {
-    //         if(!m_filter->Update(m_sys_model, input, m_meas_model, measurement))
-    //             yError(" [quaternionEKFThread::run] Update step of the Kalman Filter could not be performed\n");
-    //     } else {
-    //             if(!m_filter->Update(m_sys_model, input))
-    //                 yError(" [quaternionEKFThread::run] Update step of the Kalman Filter could not be performed\n");
-    //     }
-        
-        // NOTE THE NEXT TWO LINES ARE THE ONES I ACTUALLY NEED TO USE!!! DON'T FORGET TO UNCOMMENT AFTER DEBUGGING
-        if(!m_filter->Update(m_sys_model, input, m_meas_model, measurement))
-//             yError(" [quaternionEKFThread::run] Update step of the Kalman Filter could not be performed\n");
-        // NOTE Testing just the model equations
-//         if(!m_filter->Update(m_sys_model, input, m_meas_model, measurement))
-//             yError(" [quaternionEKFThread::run] Update step of the Kalman Filter could not be performed\n");
-
-        // Get the posterior of the updated filter. Result of all the system model and meaurement information
-        BFL::Pdf<BFL::ColumnVector> * posterior = m_filter->PostGet();
         // Posterior Expectation
-        m_posterior_state = posterior->ExpectedValueGet();
-        MatrixWrapper::Quaternion expectedValueQuat(m_posterior_state);
-        // Posterior Covariance
-        MatrixWrapper::SymmetricMatrix covariance(m_state_size);
-        covariance = posterior->CovarianceGet();
+        const iCub::ctrl::realTime::QuaternionEKF::StateType& posterior_state = m_filter.getState();
         if (m_verbose) {
-            cout << "Posterior Mean: " << expectedValueQuat << endl;
-            cout << "Posterior Covariance: " << posterior->CovarianceGet() << endl;
+            cout << "Posterior Mean: " << posterior_state.transpose() << endl;
+            cout << "Posterior Covariance: " << endl << m_filter.getCovariance() << endl;
         }
-        MatrixWrapper::ColumnVector eulerAngles(3);
-        MatrixWrapper::Quaternion tmpQuat;
         // NOTE When comparing results with the XSens sensor, this parameters should be set to TRUE
         // as the orientation estimated by the XSens IMU is in the Earth reference frame, thus the conjugate
         // of our estimate should be written to the port.
-//         if (m_inWorldRefFrame) {
-//             expectedValueQuat.conjugate(tmpQuat);
-//         } else { 
-//             tmpQuat = expectedValueQuat;
-//         }
-        expectedValueQuat.conjugate(tmpQuat);
-        tmpQuat.getEulerAngles(string("xyz"), eulerAngles);
+        iCub::ctrl::realTime::QuaternionEKF::StateType conjugateQuat(posterior_state(0), -posterior_state(1), -posterior_state(2), -posterior_state(3));
+        Eigen::Vector3d eulerAngles;
+        iCub::ctrl::realTime::QuaternionEKF::eulerAnglesXYZ(conjugateQuat, eulerAngles);
         if (m_verbose)
-            cout << "Posterior Mean in Euler Angles: " << (180/PI)*eulerAngles  << endl;
+            cout << "Posterior Mean in Euler Angles: " << (180/PI)*eulerAngles.transpose() << endl;
         // Publish results to port
-        yarp::sig::Vector tmpVec(m_state_size);
-        for (unsigned int i=1; i<m_posterior_state.size()+1; i++) {
-            tmpVec(i-1) = m_posterior_state(i);
+        for (unsigned int i=0; i<STATEDIM; i++) {
+            m_estimateQuaternion(i) = posterior_state(i);
         }
         // Publish Euler Angles estimation to port
-        yarp::sig::Vector tmpEuler(3);
-        for (unsigned int i=1; i<eulerAngles.rows()+1; i++)
-            tmpEuler(i-1) = eulerAngles(i)*(180/PI);
+        for (unsigned int i=0; i<3; i++)
+            m_estimateEuler(i) = eulerAngles(i)*(180/PI);
         // Writing to port the full estimated orientation in Euler angles (xyz order)
         yarp::sig::Vector& tmpPortEuler = m_publisherFilteredOrientationEulerPort->prepare();
-        tmpPortEuler = tmpEuler;
+        tmpPortEuler = m_estimateEuler;
         m_publisherFilteredOrientationEulerPort->write();
         // Writing to port the full estimated quaternion
         yarp::sig::Vector& tmpPortRef = m_publisherFilteredOrientationPort->prepare();
-        tmpPortRef = tmpVec;
+        tmpPortRef = m_estimateQuaternion;
         m_publisherFilteredOrientationPort->write();
 
         if (m_usingSkin && m_debugGyro) {
             yarp::sig::Vector &tmpGyroMeas = m_publisherGyroDebug->prepare();
-            if (imu_angVel.data() != NULL) {
-                tmpGyroMeas = imu_angVel;
-                m_publisherGyroDebug->write();
-            } else {
-                yError("[quaternionEKFThread::run] ang velocity reading was empty");
-            }
+            tmpGyroMeas = m_sensors[0].angVel;
+            m_publisherGyroDebug->write();
         }
 
         if (m_usingSkin && m_debugAcc) {
             yarp::sig::Vector &tmpAccMeas = m_publisherAccDebug->prepare();
-            if (imu_linAcc.data() != NULL) {
-                tmpAccMeas = imu_linAcc;
-                m_publisherAccDebug->write();
-            } else {
-                yError("[quaternionEKFThread::run] Accelerometer reading was empty");
-            }
+            tmpAccMeas = m_sensors[0].linAcc;
+            m_publisherAccDebug->write();
         }
 
         //  Publish XSens orientation just for debugging
         if (m_usingxsens) {
             yarp::sig::Vector& tmpXSensEuler = m_publisherXSensEuler->prepare();
-            if (realOrientation.data()!=NULL) {
-                tmpXSensEuler = realOrientation;
-                m_publisherXSensEuler->write();
-            }
+            tmpXSensEuler = realOrientation;
+            m_publisherXSensEuler->write();
         }
 
         if (m_verbose) {
@@ -254,31 +234,29 @@ void quaternionEKFThread::run()
     // Direct filter computation with one or two accelerometers as specified by m_using2acc (iCubGenova01 specific)
     // Accelerometer only!!
     if (!m_usingEKF && !m_usingxsens) {
-        yarp::sig::Vector output(12), output2(12);
-        output.zero(); output2.zero();
-        if(m_using2acc) {
-            // Filtering accelerometers
-            (*imu_measurement) = lowPassFilter->filt((*imu_measurement));
-            (*imu_measurement2) = lowPassFilter->filt((*imu_measurement2));
-            // Read and filter the two accelerometers
-            m_directComputation->computeOrientation(imu_measurement, output);
-            m_directComputation->computeOrientation(imu_measurement2, output2);
-            // NOTE Storing only the mean of the roll!! 
-            output(0) = (output(0) + output2(0))/2;
-            // Streaming orientation
-            yarp::sig::Vector& tmpPortEuler = m_publisherFilteredOrientationEulerPort->prepare();
-            tmpPortEuler = output;
-            m_publisherFilteredOrientationEulerPort->write();
-        } else {
-            (*imu_measurement) = lowPassFilter->filt((*imu_measurement));
-            m_directComputation->computeOrientation(imu_measurement, output);
-            // Low pass filtering
-//             output = lowPassFilter->filt(output);
-    //         cout << "Roll, Pitch, Yaw " << output(0) << " " << output(1) << " " << output(2) << endl;
-            yarp::sig::Vector& tmpPortEuler = m_publisherFilteredOrientationEulerPort->prepare();
-            tmpPortEuler = output;
-            m_publisherFilteredOrientationEulerPort->write();
+        yarp::sig::Vector output(12);
+        output.zero();
+        // Each accelerometer has its own low pass filter, the filtered measurements
+        // are averaged with the configured weights before computing the orientation
+        yarp::sig::Vector* directMeasurements[2] = {imu_measurement, imu_measurement2};
+        double totalWeight = 0.0;
+        m_directAcc.zero();
+        for (unsigned int s=0; s<m_lowPassFilters.size(); s++) {
+            const yarp::sig::Vector& filtered = m_lowPassFilters[s]->filt(*directMeasurements[s]);
+            for (unsigned int i=0; i<3; i++)
+                m_directAcc(i) += m_directWeights[s]*filtered(i);
+            totalWeight += m_directWeights[s];
+        }
+        // No accelerometer contributes to the average: the orientation can not be computed
+        if (totalWeight <= 0.0) {
+            return;
         }
+        m_directAcc /= totalWeight;
+        m_directComputation->computeOrientation(&m_directAcc, output);
+        // Streaming orientation
+        yarp::sig::Vector& tmpPortEuler = m_publisherFilteredOrientationEulerPort->prepare();
+        tmpPortEuler = output;
+        m_publisherFilteredOrientationEulerPort->write();
     }
 }
 
@@ -318,7 +296,21 @@ bool quaternionEKFThread::threadInit()
         m_directComputation = new directFilterComputation(*m_quat_lsole_sensor);
         double periodInSeconds = getRate()*1e-3;
         yarp::sig::Vector dofZeros(3,0.0);
-        lowPassFilter = new iCub::ctrl::FirstOrderLowPassFilter(m_lowPass_cutoffFreq, periodInSeconds, dofZeros);
+        unsigned int nrOfAccelerometers = m_using2acc ? 2 : 1;
+        yarp::os::Bottle* weights = m_filterParams.find("weights").asList();
+        if (weights && weights->size() != (int)nrOfAccelerometers) {
+            yError("[quaternionEKFThread::threadInit] weights should have one element for each accelerometer");
+            return false;
+        }
+        for (unsigned int s=0; s<nrOfAccelerometers; s++) {
+            double weight = weights ? weights->get(s).asDouble() : 1.0;
+            if (!(weight > 0.0)) {
+                yError("[quaternionEKFThread::threadInit] The weights of the accelerometers should be positive");
+                return false;
+            }
+            m_directWeights.push_back(weight);
+            m_lowPassFilters.push_back(new iCub::ctrl::FirstOrderLowPassFilter(m_lowPass_cutoffFreq, periodInSeconds, dofZeros));
+        }
     }
 
     // IMU Measurement vector
@@ -360,62 +352,43 @@ bool quaternionEKFThread::threadInit()
     }
 
     if(m_usingEKF) {
-        // System Noise Mean
-        MatrixWrapper::ColumnVector sys_noise_mu(m_state_size);
-        sys_noise_mu(1) = sys_noise_mu(2) = sys_noise_mu(3) = sys_noise_mu(4) = 0.0;
-
-        // System Noise Covariance
-        MatrixWrapper::SymmetricMatrix sys_noise_cov(m_state_size);
-        sys_noise_cov = 0.0;
-        sys_noise_cov(1,1) = sys_noise_cov(2,2) = sys_noise_cov(3,3) = sys_noise_cov(4,4) = m_sigma_system_noise;
-
-        // Setting System noise uncertainty
-        m_sysPdf.AdditiveNoiseMuSet(sys_noise_mu);
-        m_sysPdf.AdditiveNoiseSigmaSet(sys_noise_cov);
-        m_sysPdf.setPeriod(m_period);
-        // Creating the model
-        m_sys_model = new BFL::AnalyticSystemModelGaussianUncertainty(&m_sysPdf);
-
-        // Creating measurement model for linear measurement model
-        // Measurement noise distribution
-        // Measurement noise mean
-        MatrixWrapper::ColumnVector meas_noise_mu(m_measurement_size);
-        meas_noise_mu = 0.0;                // Set all to zero
-        meas_noise_mu(3) = 0.0;
-        // Measurement noise covariance
-        MatrixWrapper::SymmetricMatrix meas_noise_cov(m_measurement_size);
-        meas_noise_cov = 0.0;
-        meas_noise_cov(1,1) = meas_noise_cov(2,2) = meas_noise_cov(3,3) = m_sigma_measurement_noise;
-        // Measurement noise uncertainty
-        m_measurement_uncertainty = new BFL::Gaussian(meas_noise_mu, meas_noise_cov);
-        // Probability density function (PDF) for the measurement
-        m_measPdf = new BFL::nonLinearMeasurementGaussianPdf(*m_measurement_uncertainty);
-        //  Measurement model from the measurement PDF
-        m_meas_model = new BFL::AnalyticMeasurementModelGaussianUncertainty(m_measPdf);
+        // The filter has a fixed size: state quaternion, gyroscope input and accelerometer measurement
+        if (m_state_size != STATEDIM || m_input_size != 3 || m_measurement_size != 3) {
+            yError("[quaternionEKFThread::threadInit] STATE_SIZE, INPUT_SIZE and MEASUREMENT_SIZE should be 4, 3 and 3");
+            return false;
+        }
+        m_filter.setTs(m_period/1000.0);
+        m_filter.setGyroscopeNoise(m_sigma_gyro);
+        m_filter.setAccelerometerNoise(m_sigma_measurement_noise);
+        m_filter.setGravity(GRAVITY_NOMINAL);
+        if (!configureSensors()) {
+            return false;
+        }
         // Setting prior. This is equivalent to a zero rotation
-        MatrixWrapper::ColumnVector prior_mu(m_state_size);
-        prior_mu = 0.0;
-        prior_mu(1) = 1.0;
-        m_prior_mu_vec = prior_mu;
-        m_posterior_state = prior_mu;
-        MatrixWrapper::SymmetricMatrix prior_cov(4);
-        prior_cov = 0.0;
-        prior_cov(1,1) = prior_cov(2,2) = prior_cov(3,3) = prior_cov(4,4) = m_prior_cov;
+        m_filter.init(Eigen::Vector4d(1.0, 0.0, 0.0, 0.0), m_prior_cov);
         cout << "Priors will be: " << endl;
-        cout << "State prior: " << endl << prior_mu << endl;
-        cout << "Covariance prior: " << endl << prior_cov << endl;
-        m_prior = new BFL::Gaussian(prior_mu, prior_cov);
-
-        // Construction of the filter
-        m_filter = new BFL::ExtendedKalmanFilter(m_prior);
+        cout << "State prior: " << endl << m_filter.getState() << endl;
+        cout << "Covariance prior: " << endl << m_filter.getCovariance() << endl;
     }
 
     // Sensor ports
     // This port was opened by the module.
     std::string gyroMeasPortName = string("/" + m_moduleName + "/imu:i");
 
+    // NOTE If using the SENSOR_SOURCES, each distinct port has its own reader
+    if ( m_usingEKF && !m_sources.empty() ) {
+        for (unsigned int p=0; p<m_sources.size(); p++) {
+            std::ostringstream readerName;
+            readerName << "/" << m_moduleName << "/source" << p << ":i";
+            m_sources[p].reader = new yarp::os::BufferedPort<yarp::sig::Vector>;
+            m_sources[p].reader->open(readerName.str().c_str());
+            if (!yarp::os::Network::connect(m_sources[p].portName, m_sources[p].reader->getName())) {
+                yError("[quaternionEKFThread::threadInit] Could not connect %s to the module", m_sources[p].portName.c_str());
+                return false;
+            }
+        }
     // NOTE If using acccelerometer and gyro in the foot
-    if ( m_usingSkin && m_usingEKF && !m_usingxsens && !m_using2acc) {
+    } else if ( m_usingSkin && m_usingEKF && !m_usingxsens && !m_using2acc) {
         std::string srcTmp = string("/" + m_robotName + "/right_leg/inertialMTB");
         if ( !m_sensorPort.compare(srcTmp) && m_usingSkin) {
             // NOTE Here I need to create a port that reads a bottle because the dimensions of this port can't be known a priori, since its size will depend on the amount of sensors that have been specified in the skin configuration file.
@@ -460,79 +433,152 @@ bool quaternionEKFThread::threadInit()
     return true;
 }
 
-void quaternionEKFThread::XiOperator ( MatrixWrapper::ColumnVector quat, MatrixWrapper::Matrix* Xi )
+bool quaternionEKFThread::extractMTBDatafromPort ( const Vector& mtbMeas, int boardNum, Vector& linAccOutput, Vector& gyroMeasOutput )
 {
-//     In  Matlab language this would be:
-//     Xi = [       -qk(2:4,:)'           ;
-//           qk(1)*eye(3) + S(qk(2:4,:)) ];
-    // NOTE When testing Eigen I changed the following line from 1.0 to 0.0. Couldn't understand why I would have put 1.0 for instance
-    (*Xi) = 0.0;
-    MatrixWrapper::ColumnVector omg(3);
-    omg(1) = quat(2);    omg(2) = quat(3);    omg(3) = quat(4);
-    (*Xi)(1,1) = -quat(2);    (*Xi)(1,2) = -quat(3);    (*Xi)(1,3) = -quat(4);
-    MatrixWrapper::Matrix eye(3,3);
-    eye.toIdentity();
-    MatrixWrapper::Matrix S(3,3);
-    SOperator(omg, &S);
-    MatrixWrapper::Matrix tmpAdd = eye*quat(1) + S;
-    Xi->setSubMatrix(tmpAdd,2,4,1,3);
+    int indexSubVector = 0;
+    bool accFound = false;
+    bool gyroFound = false;
+    /******************* searching for multiple instances of the sensor  **************************/
+    const double* tmp;
+    tmp = mtbMeas.data();
+    const double *it = tmp + 2; // First two elements of the vector can be skipped
+    while (it < tmp + mtbMeas.size()) {
+        it = std::find(it, it + (mtbMeas.size() - indexSubVector), boardNum);
+        if (it < tmp + mtbMeas.size()) {
+            indexSubVector = (int)(it - tmp) + 1;
+
+            // Parse sensor data
+            int trueindexSubVector = indexSubVector - 1;
+            if ( tmp[trueindexSubVector]  == boardNum ) {
+                //  If sensor from board "boardNum" is an accelerometer
+                if ( tmp[trueindexSubVector + 1] == 1.0) {
+                    linAccOutput(0) = tmp[trueindexSubVector + 3];
+                    linAccOutput(1) = tmp[trueindexSubVector + 4];
+                    linAccOutput(2) = tmp[trueindexSubVector + 5];
+                    accFound = true;
+                } else {
+                    // If sensor from board "boardNum" is a gyroscope
+                    if ( tmp[trueindexSubVector + 1] == 2.0 ) {
+                        gyroMeasOutput(0) = tmp[trueindexSubVector + 3];
+                        gyroMeasOutput(1) = tmp[trueindexSubVector + 4];
+                        gyroMeasOutput(2) = tmp[trueindexSubVector + 5];
+                        gyroFound = true;
+                    }
+                }
+            }
+            it = it + MTB_PORT_DATA_PACKAGE_OFFSET; //Move to the next position in the vector where a package data is expected
+        }
+    }
+    /**********************************************************************************/
+    if (!accFound || !gyroFound) {
+        return false;
+    }
+    linAccOutput *= CONVERSION_FACTOR_ACC;
+    if (yarp::math::norm(linAccOutput) > 11.0) {
+        yError("WARNING!!! [quaternionEKFThread::run] Gravity's norm is too big!");
+    }
+    gyroMeasOutput *= PI/180*CONVERSION_FACTOR_GYRO;
+    if (yarp::math::norm(gyroMeasOutput) > 100.0) {
+        yError("WARNING!!! [quaternionEKFThread::run] Ang vel's norm is too big!");
+    }
+    return true;
 }
 
-void quaternionEKFThread::SOperator ( MatrixWrapper::ColumnVector omg, MatrixWrapper::Matrix* S )
+bool quaternionEKFThread::extractIMUDatafromPort ( const Vector& imuMeas, Vector& linAccOutput, Vector& gyroMeasOutput )
 {
-    (*S)(1,1) = 0.0;    (*S)(1,2) = -omg(3); (*S)(1,3) = omg(2);
-    (*S)(2,1) = omg(3); (*S)(2,2) = 0.0    ; (*S)(2,3) = -omg(1);
-    (*S)(3,1) = -omg(2);(*S)(3,2) = omg(1) ; (*S)(3,3) = 0.0;
+    if (imuMeas.size() < 9) {
+        return false;
+    }
+    for (unsigned int i=0; i<3; i++) {
+        linAccOutput(i) = imuMeas(3+i);
+        gyroMeasOutput(i) = PI/180*imuMeas(6+i);
+    }
+    return true;
 }
 
-bool quaternionEKFThread::extractMTBDatafromPort ( int boardNum, Vector& linAccOutput, Vector& gyroMeasOutput )
+bool quaternionEKFThread::configureSensors()
 {
-    int indexSubVector = 0;
-    if ( !m_imuSkinPortIn.read(m_MTBmeas) ) {
-        yError("[quaternionEKFThread::extractMTBDatafromPort] There was an error trying to read from the MTB port");
+    // Each of the SENSOR_SOURCES is a port with the id of an MTB board or imu for a generic IMU.
+    // Without them, the MTB boards are read from sensorPortName, and without a list of MTB boards
+    // a single sensor is used (the right foot MTB board or the XSens)
+    yarp::os::Bottle* sources = m_filterParams.find("SENSOR_SOURCES").asList();
+    yarp::os::Bottle* boards = m_filterParams.find("MTB_BOARDS").asList();
+    yarp::os::Bottle* weights = m_filterParams.find("SENSOR_WEIGHTS").asList();
+    yarp::os::Bottle* rotations = m_filterParams.find("SENSOR_ROTATIONS").asList();
+    unsigned int nrOfSensors = 1;
+    if (sources) {
+        nrOfSensors = sources->size();
+    } else if (m_usingSkin && !m_usingxsens && boards) {
+        nrOfSensors = boards->size();
+    }
+    if (nrOfSensors == 0) {
+        yError("[quaternionEKFThread::configureSensors] SENSOR_SOURCES and MTB_BOARDS should not be empty");
         return false;
-    } else {
-        if (m_verbose)
-            yInfo("[quaternionEKFThread::extractMTBDatafromPort] Raw meas: %s", m_MTBmeas.toString().c_str());
-        /******************* searching for multiple instances of the sensor  **************************/
-        double* tmp;
-        tmp = m_MTBmeas.data();
-        double *it = tmp + 2; // First two elements of the vector can be skipped
-        while (it < tmp + m_MTBmeas.size()) {
-            it = std::find(it, it + (m_MTBmeas.size() - indexSubVector), boardNum);
-            if (it < tmp + m_MTBmeas.size()) {
-                indexSubVector = (int)(it - tmp) + 1;
-
-                // Parse sensor data
-                int trueindexSubVector = indexSubVector - 1;
-                if ( tmp[trueindexSubVector]  == boardNum ) {
-                    //  If sensor from board "boardNum" is an accelerometer
-                    if ( tmp[trueindexSubVector + 1] == 1.0) {
-                        linAccOutput(0) = tmp[trueindexSubVector + 3];
-                        linAccOutput(1) = tmp[trueindexSubVector + 4];
-                        linAccOutput(2) = tmp[trueindexSubVector + 5];
-                    } else {
-                        // If sensor from board "boardNum" is a gyroscope
-                        if ( tmp[trueindexSubVector + 1] == 2.0 ) {
-                            gyroMeasOutput(0) = tmp[trueindexSubVector + 3];
-                            gyroMeasOutput(1) = tmp[trueindexSubVector + 4];
-                            gyroMeasOutput(2) = tmp[trueindexSubVector + 5];
-                        }
-                    }
-                }
-                it = it + MTB_PORT_DATA_PACKAGE_OFFSET; //Move to the next position in the vector where a package data is expected
+    }
+    if (weights && weights->size() != (int)nrOfSensors) {
+        yError("[quaternionEKFThread::configureSensors] SENSOR_WEIGHTS should have one element for each sensor");
+        return false;
+    }
+    if (rotations && rotations->size() != (int)nrOfSensors) {
+        yError("[quaternionEKFThread::configureSensors] SENSOR_ROTATIONS should have one quaternion for each sensor");
+        return false;
+    }
+
+    m_sensors.resize(nrOfSensors);
+    for (unsigned int s=0; s<nrOfSensors; s++) {
+        imuSensor& sensor = m_sensors[s];
+        sensor.source = -1;
+        sensor.mtbBoard = (m_usingSkin && boards) ? boards->get(s).asInt() : (int)MTB_RIGHT_FOOT_ACC_PLUS_GYRO_2_ID;
+        if (sources) {
+            yarp::os::Bottle* src = sources->get(s).asList();
+            if (!src || src->size() != 2 || !src->get(0).isString()
+                || !(src->get(1).isInt() || std::string(src->get(1).asString().c_str()) == "imu")) {
+                yError("[quaternionEKFThread::configureSensors] Each element of SENSOR_SOURCES should be (port board) or (port imu)");
+                return false;
+            }
+            std::string portName = src->get(0).asString().c_str();
+            sensor.mtbBoard = src->get(1).isInt() ? src->get(1).asInt() : -1;
+            // The sensors read from the same port share its reader
+            for (unsigned int p=0; p<m_sources.size(); p++) {
+                if (m_sources[p].portName == portName)
+                    sensor.source = p;
+            }
+            if (sensor.source < 0) {
+                imuSource source;
+                source.portName = portName;
+                source.reader = NULL;
+                source.received = false;
+                m_sources.push_back(source);
+                sensor.source = m_sources.size()-1;
             }
         }
-        /**********************************************************************************/
-        linAccOutput = CONVERSION_FACTOR_ACC*linAccOutput;
-        if (yarp::math::norm(linAccOutput) > 11.0) {
-            yError("WARNING!!! [quaternionEKFThread::run] Gravity's norm is too big!");
+        sensor.weight = weights ? weights->get(s).asDouble() : 1.0;
+        if (sensor.weight <= 0.0) {
+            yError("[quaternionEKFThread::configureSensors] The weights of the sensors should be positive");
+            return false;
         }
-        gyroMeasOutput = PI/180*CONVERSION_FACTOR_GYRO*gyroMeasOutput;
-        if (yarp::math::norm(gyroMeasOutput) > 100.0) {
-            yError("WARNING!!! [quaternionEKFThread::run] Ang vel's norm is too big!");
+        sensor.rotation.setIdentity();
+        if (rotations) {
+            // Quaternion (real part first) of the rotation from the sensor frame to the frame of the estimate
+            yarp::os::Bottle* quat = rotations->get(s).asList();
+            if (!quat || quat->size() != 4) {
+                yError("[quaternionEKFThread::configureSensors] Each element of SENSOR_ROTATIONS should be a quaternion (q0 q1 q2 q3)");
+                return false;
+            }
+            sensor.rotation = Eigen::Quaterniond(quat->get(0).asDouble(), quat->get(1).asDouble(),
+                                                 quat->get(2).asDouble(), quat->get(3).asDouble()).normalized().toRotationMatrix();
         }
+        sensor.linAcc.resize(3, 0.0);
+        sensor.angVel.resize(3, 0.0);
     }
+
+    m_sensorsLinAcc.setZero(3, nrOfSensors);
+    m_sensorsAngVel.setZero(3, nrOfSensors);
+    m_sensorsWeight.setZero(nrOfSensors);
+    cout << "[quaternionEKFThread::configureSensors] Fusing " << nrOfSensors << " sensor(s)";
+    if (!m_sources.empty())
+        cout << " from " << m_sources.size() << " port(s)";
+    cout << endl;
     return true;
 }
 
@@ -545,12 +591,13 @@ void quaternionEKFThread::threadRelease()
             m_directComputation = NULL;
             cout << "m_directComputation deleted" << endl;
         }
-        if (lowPassFilter) {
-            cout << "deleting lowPassFilter" << endl;
-            delete lowPassFilter;
-            lowPassFilter = NULL;
-            cout << "lowPassFilter deleted "<< endl;
+        for (unsigned int s=0; s<m_lowPassFilters.size(); s++) {
+            cout << "deleting lowPassFilter " << s << endl;
+            delete m_lowPassFilters[s];
+            m_lowPassFilters[s] = NULL;
+            cout << "lowPassFilter " << s << " deleted "<< endl;
         }
+        m_lowPassFilters.clear();
     }
     if (m_publisherFilteredOrientationEulerPort) {
         cout << "deleting m_publisherFilteredOrientationEulerPort" << endl;
@@ -587,42 +634,13 @@ void quaternionEKFThread::threadRelease()
         m_publisherXSensEuler = NULL;
         cout << "m_publisherXSensEuler deleted" << endl;
     }
-    if (m_usingEKF) {
-        if (m_sys_model) {
-            cout << "deleting m_sys_model" << endl;
-            delete m_sys_model;
-            m_sys_model = NULL;
-            cout << "m_sys_model deleted" << endl;
-        }
-        if (m_measurement_uncertainty) {
-            cout << "deleting m_measurement_uncertainty " << endl;
-            delete m_measurement_uncertainty;
-            m_measurement_uncertainty = NULL;
-            cout << "m_measurement_uncertainty deleted" << endl;
-        }
-        if (m_measPdf) {
-            cout << "deleting m_measPdf"  << endl;
-            delete m_measPdf;
-            m_measPdf = NULL;
-            cout << "m_measPdf deleted" << endl;
-        }
-        if (m_meas_model) {
-            cout << "deleting m_meas_model" << endl;
-            delete m_meas_model;
-            m_meas_model = NULL;
-            cout << "m_meas_model deleted" << endl;
-        }
-        if (m_prior) {
-            cout << "deleting m_prior" << endl;
-            delete m_prior;
-            m_prior = NULL;
-            cout << "m_prior deleted" << endl;
-        }
-        if (m_filter) {
-            cout << "deleting m_filter" << endl;
-            delete m_filter;
-            m_filter = NULL;
-            cout << "m_filter deleted" << endl;
+    for (unsigned int p=0; p<m_sources.size(); p++) {
+        if (m_sources[p].reader) {
+            cout << "deleting reader of " << m_sources[p].portName << endl;
+            m_sources[p].reader->interrupt();
+            m_sources[p].reader->close();
+            delete m_sources[p].reader;
+            m_sources[p].reader = NULL;
         }
     }
     if (imu_measurement && !m_usingSkin) {
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Time.h>
+#include <cstdio>
+
+#include "dataDumperTable.h"
+#include "offlineReplay.h"
+#include "parameterSweep.h"
+
+using namespace filter;
+
+// Reads a parameter given either as a single value or as a list of values
+static bool readValues(yarp::os::ResourceFinder &rf, const std::string &name, double defaultValue, std::vector<double> &values)
+{
+    values.clear();
+    if (!rf.check(name)) {
+        values.push_back(defaultValue);
+        return true;
+    }
+    yarp::os::Value &value = rf.find(name);
+    if (value.isList()) {
+        yarp::os::Bottle* list = value.asList();
+        for (int i=0; i<list->size(); i++)
+            values.push_back(list->get(i).asDouble());
+    } else {
+        values.push_back(value.asDouble());
+    }
+    if (values.empty()) {
+        yError("[quaternionEKFSweep] No value was given for %s", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    yarp::os::ResourceFinder rf;
+    rf.setVerbose(true);
+    rf.configure(argc, argv);
+
+    if (rf.check("help") || !rf.check("dataFile")) {
+        printf("\n");
+        printf("Scores a grid of quaternion EKF configurations over a dataDumper log against a logged reference orientation.\n");
+        printf("PARAMETERS\n");
+        printf("--dataFile        :dataDumper log with the accelerometer, the gyroscope and the reference Euler angles\n");
+        printf("--sigmaGyro       :[0.001] Gyroscope noise variance, a value or a list e.g. \"(0.0001 0.001 0.01)\"\n");
+        printf("--sigmaAcc        :[0.002] Accelerometer noise variance, a value or a list\n");
+        printf("--priorCov        :[1.0] Prior covariance of the state, a value or a list\n");
+        printf("--threads         :[4] Number of worker threads\n");
+        printf("--rate            :[10] Sample time (ms) used when the log timestamps are not increasing\n");
+        printf("--gravity         :[10.0] Norm of the gravity\n");
+        printf("--accColumn       :[3] First logged value of the accelerometer\n");
+        printf("--gyroColumn      :[6] First logged value of the gyroscope\n");
+        printf("--accScale        :[1.0] Conversion of the accelerometer to m/s^2\n");
+        printf("--gyroScale       :[0.017453293] Conversion of the gyroscope to rad/s\n");
+        printf("--referenceColumn :[0] First logged value of the reference roll, pitch and yaw (deg), e.g. of the XSens\n");
+        printf("--settleTime      :[1.0] Time (s) at the beginning of the log that is not scored\n");
+        printf("--useYaw          :[false] When true, the yaw error is scored too\n");
+        printf("--output          :[quaternionEKF_sweep.csv] Ranked table of the configurations\n");
+        printf("--top             :[10] Number of best configurations printed\n");
+        return rf.check("help") ? 0 : -1;
+    }
+
+    offlineReplayParams params;
+    params.sampleTime = rf.check("rate", yarp::os::Value(10.0)).asDouble()/1000.0;
+    params.gravity    = rf.check("gravity", yarp::os::Value(params.gravity)).asDouble();
+    params.accColumn  = rf.check("accColumn", yarp::os::Value((int) params.accColumn)).asInt();
+    params.gyroColumn = rf.check("gyroColumn", yarp::os::Value((int) params.gyroColumn)).asInt();
+    params.accScale   = rf.check("accScale", yarp::os::Value(params.accScale)).asDouble();
+    params.gyroScale  = rf.check("gyroScale", yarp::os::Value(params.gyroScale)).asDouble();
+
+    offlineReplayScoring scoring;
+    scoring.referenceColumn = rf.check("referenceColumn", yarp::os::Value((int) scoring.referenceColumn)).asInt();
+    scoring.settleTime      = rf.check("settleTime", yarp::os::Value(scoring.settleTime)).asDouble();
+    scoring.useYaw          = rf.check("useYaw", yarp::os::Value(scoring.useYaw)).asBool();
+
+    std::vector<double> sigmaGyro, sigmaAcc, priorCov;
+    if (!readValues(rf, "sigmaGyro", params.sigmaGyro, sigmaGyro) ||
+        !readValues(rf, "sigmaAcc", params.sigmaAcc, sigmaAcc) ||
+        !readValues(rf, "priorCov", params.priorCovariance, priorCov))
+        return -1;
+
+    int threads = rf.check("threads", yarp::os::Value(4)).asInt();
+    int top = rf.check("top", yarp::os::Value(10)).asInt();
+    std::string dataFile = rf.find("dataFile").asString();
+    std::string output = rf.check("output", yarp::os::Value("quaternionEKF_sweep.csv")).asString();
+
+    // The log is parsed once and shared by all the workers
+    double startTime = yarp::os::Time::now();
+    dataDumperTableParser parser(dataFile);
+    try {
+        parser.parseFile();
+    } catch (std::exception &e) {
+        yError("[quaternionEKFSweep] Could not open %s: %s", dataFile.c_str(), e.what());
+        return -1;
+    }
+    dataDumperTable data;
+    if (!parser.parseTable(data))
+        return -1;
+    double parseTime = yarp::os::Time::now();
+
+    parameterSweep sweep(data, scoring);
+    for (size_t g=0; g<sigmaGyro.size(); g++) {
+        for (size_t a=0; a<sigmaAcc.size(); a++) {
+            for (size_t p=0; p<priorCov.size(); p++) {
+                params.sigmaGyro = sigmaGyro[g];
+                params.sigmaAcc = sigmaAcc[a];
+                params.priorCovariance = priorCov[p];
+                sweep.addConfiguration(params);
+            }
+        }
+    }
+
+    if (!sweep.run(threads > 0 ? threads : 1))
+        return -1;
+    const std::vector<sweepResult> &results = sweep.getResults();
+    yInfo(" [quaternionEKFSweep] %lu configurations over %lu samples scored in %f s with %d threads (parsing took %f s)",
+          (unsigned long) results.size(), (unsigned long) data.rows(),
+          yarp::os::Time::now() - parseTime, threads, parseTime - startTime);
+
+    printf("%6s %18s %24s %16s %12s\n", "rank", "SIGMA_GYRO_NOISE", "SIGMA_MEASUREMENT_NOISE", "PRIOR_COV_STATE", "rmsError");
+    for (size_t r=0; r<results.size() && (int) r<top; r++) {
+        printf("%6lu %18g %24g %16g ", (unsigned long) (r+1), results[r].params.sigmaGyro,
+               results[r].params.sigmaAcc, results[r].params.priorCovariance);
+        if (results[r].valid)
+            printf("%12.6g\n", results[r].rmsError);
+        else
+            printf("%12s\n", "nan");
+    }
+
+    if (!sweep.writeRanking(output))
+        return -1;
+    yInfo(" [quaternionEKFSweep] Ranking written to %s", output.c_str());
+    return 0;
+}
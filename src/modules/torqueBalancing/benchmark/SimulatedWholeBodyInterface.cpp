@@ -0,0 +1,215 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "SimulatedWholeBodyInterface.h"
+
+#include <yarp/os/Log.h>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        SimulatedWholeBodyInterface::SimulatedWholeBodyInterface(const char* name, const yarp::os::Property& wbiProperties)
+        : yarpWbi::yarpWholeBodyInterface(name, wbiProperties)
+        , m_model((std::string(name) + "_model").c_str(), wbiProperties)
+        , m_world2BaseFrameSerialization(16)
+        , m_baseVelocity(6)
+        , m_controlMode(wbi::CTRL_MODE_POS)
+        , m_torqueReferencesCount(0)
+        {
+            //base frame coincident with the world frame
+            Eigen::Map<Eigen::Matrix4d>(m_world2BaseFrameSerialization.data()).setIdentity();
+            m_baseVelocity.setZero();
+        }
+
+        SimulatedWholeBodyInterface::~SimulatedWholeBodyInterface() {}
+
+#pragma mark - Configuration
+
+        bool SimulatedWholeBodyInterface::init()
+        {
+            //only the model is initialized: no device is opened
+            if (!m_model.init()) {
+                yError("Could not initialize the model of the simulated interface.");
+                return false;
+            }
+            int dofs = m_model.getDoFs();
+            m_jointPositions.setZero(dofs);
+            m_jointVelocities.setZero(dofs);
+            m_torques.setZero(dofs);
+            m_torqueReferencesCount = 0;
+            return true;
+        }
+
+        bool SimulatedWholeBodyInterface::close()
+        {
+            return m_model.close();
+        }
+
+        int SimulatedWholeBodyInterface::addJoints(const wbi::IDList& jointList)
+        {
+            return m_model.addJoints(jointList);
+        }
+
+        const wbi::IDList& SimulatedWholeBodyInterface::getJointList()
+        {
+            return m_model.getJointList();
+        }
+
+        const wbi::IDList& SimulatedWholeBodyInterface::getFrameList()
+        {
+            return m_model.getFrameList();
+        }
+
+        int SimulatedWholeBodyInterface::getDoFs()
+        {
+            return m_model.getDoFs();
+        }
+
+        bool SimulatedWholeBodyInterface::getJointLimits(double *qMin, double *qMax, int joint)
+        {
+            return m_model.getJointLimits(qMin, qMax, joint);
+        }
+
+#pragma mark - Model
+
+        bool SimulatedWholeBodyInterface::computeJacobian(double *q, const wbi::Frame &xBase, int linkId, double *J, double *pos)
+        {
+            return m_model.computeJacobian(q, xBase, linkId, J, pos);
+        }
+
+        bool SimulatedWholeBodyInterface::computeDJdq(double *q, const wbi::Frame &xBase, double *dq, double *dxB, int linkId, double *dJdq, double *pos)
+        {
+            return m_model.computeDJdq(q, xBase, dq, dxB, linkId, dJdq, pos);
+        }
+
+        bool SimulatedWholeBodyInterface::forwardKinematics(double *q, const wbi::Frame &xBase, int linkId, double *x, double *pos)
+        {
+            return m_model.forwardKinematics(q, xBase, linkId, x, pos);
+        }
+
+        bool SimulatedWholeBodyInterface::inverseDynamics(double *q, const wbi::Frame &xBase, double *dq, double *dxB, double *ddq, double *ddxB, double *g, double *tau)
+        {
+            return m_model.inverseDynamics(q, xBase, dq, dxB, ddq, ddxB, g, tau);
+        }
+
+        bool SimulatedWholeBodyInterface::computeMassMatrix(double *q, const wbi::Frame &xBase, double *M)
+        {
+            return m_model.computeMassMatrix(q, xBase, M);
+        }
+
+        bool SimulatedWholeBodyInterface::computeGeneralizedBiasForces(double *q, const wbi::Frame &xBase, double *dq, double *dxB, double *g, double *h)
+        {
+            return m_model.computeGeneralizedBiasForces(q, xBase, dq, dxB, g, h);
+        }
+
+        bool SimulatedWholeBodyInterface::computeCentroidalMomentum(double *q, const wbi::Frame &xBase, double *dq, double *dxB, double *h)
+        {
+            return m_model.computeCentroidalMomentum(q, xBase, dq, dxB, h);
+        }
+
+#pragma mark - State
+
+        bool SimulatedWholeBodyInterface::getEstimate(const wbi::EstimateType et, const int estimate_numeric_id, double *data, double time, bool blocking)
+        {
+            if (!data) return false;
+            switch (et) {
+                case wbi::ESTIMATE_JOINT_POS:
+                    if (estimate_numeric_id < 0 || estimate_numeric_id >= m_jointPositions.size()) return false;
+                    *data = m_jointPositions(estimate_numeric_id);
+                    return true;
+                case wbi::ESTIMATE_JOINT_VEL:
+                    if (estimate_numeric_id < 0 || estimate_numeric_id >= m_jointVelocities.size()) return false;
+                    *data = m_jointVelocities(estimate_numeric_id);
+                    return true;
+                case wbi::ESTIMATE_BASE_POS:
+                case wbi::ESTIMATE_BASE_VEL:
+                    return getEstimates(et, data, time, blocking);
+                default:
+                    return false;
+            }
+        }
+
+        bool SimulatedWholeBodyInterface::getEstimates(const wbi::EstimateType et, double *data, double /*time*/, bool /*blocking*/)
+        {
+            if (!data) return false;
+            switch (et) {
+                case wbi::ESTIMATE_JOINT_POS:
+                    Eigen::Map<Eigen::VectorXd>(data, m_jointPositions.size()) = m_jointPositions;
+                    return true;
+                case wbi::ESTIMATE_JOINT_VEL:
+                    Eigen::Map<Eigen::VectorXd>(data, m_jointVelocities.size()) = m_jointVelocities;
+                    return true;
+                case wbi::ESTIMATE_BASE_POS:
+                    Eigen::Map<Eigen::VectorXd>(data, 16) = m_world2BaseFrameSerialization;
+                    return true;
+                case wbi::ESTIMATE_BASE_VEL:
+                    Eigen::Map<Eigen::VectorXd>(data, 6) = m_baseVelocity;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+#pragma mark - Actuators
+
+        bool SimulatedWholeBodyInterface::setControlMode(wbi::ControlMode controlMode, double *ref, int joint)
+        {
+            m_controlMode = controlMode;
+            if (ref && controlMode == wbi::CTRL_MODE_TORQUE) {
+                return setControlReference(ref, joint);
+            }
+            return true;
+        }
+
+        bool SimulatedWholeBodyInterface::setControlReference(double *ref, int joint)
+        {
+            if (!ref || m_controlMode != wbi::CTRL_MODE_TORQUE) return false;
+            if (joint < 0) {
+                m_torques = Eigen::Map<const Eigen::VectorXd>(ref, m_torques.size());
+            } else if (joint < m_torques.size()) {
+                m_torques(joint) = *ref;
+            } else {
+                return false;
+            }
+            m_torqueReferencesCount++;
+            return true;
+        }
+
+#pragma mark - Simulation
+
+        void SimulatedWholeBodyInterface::setState(const Eigen::Ref<const Eigen::VectorXd>& jointPositions,
+                                                   const Eigen::Ref<const Eigen::VectorXd>& jointVelocities,
+                                                   const Eigen::Ref<const Eigen::VectorXd>& world2BaseFrameSerialization,
+                                                   const Eigen::Ref<const Eigen::VectorXd>& baseVelocity)
+        {
+            m_jointPositions = jointPositions;
+            m_jointVelocities = jointVelocities;
+            m_world2BaseFrameSerialization = world2BaseFrameSerialization;
+            m_baseVelocity = baseVelocity;
+        }
+
+        const Eigen::VectorXd& SimulatedWholeBodyInterface::lastTorques() const
+        {
+            return m_torques;
+        }
+
+        unsigned SimulatedWholeBodyInterface::torqueReferencesCount() const
+        {
+            return m_torqueReferencesCount;
+        }
+
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef SIMULATEDWHOLEBODYINTERFACE_H
+#define SIMULATEDWHOLEBODYINTERFACE_H
+
+#include <yarpWholeBodyInterface/yarpWholeBodyInterface.h>
+#include <yarpWholeBodyInterface/yarpWholeBodyModel.h>
+#include <Eigen/Core>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** @brief Whole body interface which does not connect to any robot.
+         *
+         * Model quantities are computed by a yarpWholeBodyModel (i.e. from the URDF
+         * specified in the wbi configuration), while the estimates are the ones
+         * prescribed by calling setState. Torques sent through setControlReference are
+         * stored and can be read back with lastTorques.
+         *
+         * It derives from yarpWholeBodyInterface because the controller locks the
+         * interface mutex while reading the state.
+         */
+        class SimulatedWholeBodyInterface : public yarpWbi::yarpWholeBodyInterface {
+        public:
+            /** Constructor
+             * @param name name of the interface
+             * @param wbiProperties wbi configuration (as for yarpWholeBodyInterface)
+             */
+            SimulatedWholeBodyInterface(const char* name, const yarp::os::Property& wbiProperties);
+            virtual ~SimulatedWholeBodyInterface();
+
+#pragma mark - Configuration
+            virtual bool init();
+            virtual bool close();
+            virtual int addJoints(const wbi::IDList& jointList);
+            virtual const wbi::IDList& getJointList();
+            virtual const wbi::IDList& getFrameList();
+            virtual int getDoFs();
+            virtual bool getJointLimits(double *qMin, double *qMax, int joint = -1);
+
+#pragma mark - Model
+            virtual bool computeJacobian(double *q, const wbi::Frame &xBase, int linkId, double *J, double *pos = 0);
+            virtual bool computeDJdq(double *q, const wbi::Frame &xBase, double *dq, double *dxB, int linkId, double *dJdq, double *pos = 0);
+            virtual bool forwardKinematics(double *q, const wbi::Frame &xBase, int linkId, double *x, double *pos = 0);
+            virtual bool inverseDynamics(double *q, const wbi::Frame &xBase, double *dq, double *dxB, double *ddq, double *ddxB, double *g, double *tau);
+            virtual bool computeMassMatrix(double *q, const wbi::Frame &xBase, double *M);
+            virtual bool computeGeneralizedBiasForces(double *q, const wbi::Frame &xBase, double *dq, double *dxB, double *g, double *h);
+            virtual bool computeCentroidalMomentum(double *q, const wbi::Frame &xBase, double *dq, double *dxB, double *h);
+
+#pragma mark - State
+            virtual bool getEstimate(const wbi::EstimateType et, const int estimate_numeric_id, double *data, double time = -1.0, bool blocking = true);
+            virtual bool getEstimates(const wbi::EstimateType et, double *data, double time = -1.0, bool blocking = true);
+
+#pragma mark - Actuators
+            virtual bool setControlMode(wbi::ControlMode controlMode, double *ref = 0, int joint = -1);
+            virtual bool setControlReference(double *ref, int joint = -1);
+
+#pragma mark - Simulation
+            /** Sets the state returned by the estimates
+             *
+             * @param jointPositions joints positions (DoFs)
+             * @param jointVelocities joints velocities (DoFs)
+             * @param world2BaseFrameSerialization serialization of the world to base frame (16)
+             * @param baseVelocity base velocity (6)
+             */
+            void setState(const Eigen::Ref<const Eigen::VectorXd>& jointPositions,
+                          const Eigen::Ref<const Eigen::VectorXd>& jointVelocities,
+                          const Eigen::Ref<const Eigen::VectorXd>& world2BaseFrameSerialization,
+                          const Eigen::Ref<const Eigen::VectorXd>& baseVelocity);
+
+            /** Returns the torques received with the last setControlReference
+             * @return the last torque references
+             */
+            const Eigen::VectorXd& lastTorques() const;
+
+            /** Returns the number of setControlReference calls received in torque mode
+             * @return the number of torque references received
+             */
+            unsigned torqueReferencesCount() const;
+
+        private:
+            yarpWbi::yarpWholeBodyModel m_model;
+            Eigen::VectorXd m_jointPositions;
+            Eigen::VectorXd m_jointVelocities;
+            Eigen::VectorXd m_world2BaseFrameSerialization;
+            Eigen::VectorXd m_baseVelocity;
+            Eigen::VectorXd m_torques;
+            wbi::ControlMode m_controlMode;
+            unsigned m_torqueReferencesCount;
+        };
+    }
+}
+
+#endif /* end of include guard: SIMULATEDWHOLEBODYINTERFACE_H */
@@ -0,0 +1,288 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "SimulatedWholeBodyInterface.h"
+#include "TorqueBalancingController.h"
+#include "Reference.h"
+
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Log.h>
+#include <yarpWholeBodyInterface/yarpWholeBodyModel.h>
+#include <wbi/wholeBodyInterface.h>
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace codyco::torquebalancing;
+
+/** Returns the value of the sorted vector at the given percentile
+ */
+static double percentile(const std::vector<double>& sortedValues, double percent)
+{
+    if (sortedValues.empty()) return 0;
+    size_t index = static_cast<size_t>(std::ceil(percent / 100.0 * sortedValues.size()));
+    if (index > 0) index--;
+    return sortedValues[std::min(index, sortedValues.size() - 1)];
+}
+
+/** Compares the torques of a tick with the corresponding line of the golden file
+ * @return the maximum absolute difference, or a negative value if the line is not valid
+ */
+static double compareWithGolden(const std::string& goldenLine, const Eigen::VectorXd& torques)
+{
+    std::istringstream stream(goldenLine);
+    double maximumError = 0;
+    for (int i = 0; i < torques.size(); ++i) {
+        double value;
+        if (!(stream >> value)) return -1;
+        maximumError = std::max(maximumError, std::abs(value - torques(i)));
+    }
+    return maximumError;
+}
+
+/** Closes the simulated robot, then closes and deletes the models of the computation workers
+ */
+static void releaseRobot(SimulatedWholeBodyInterface& robot, std::vector<wbi::iWholeBodyModel*>& computationModels)
+{
+    robot.close();
+    for (std::vector<wbi::iWholeBodyModel*>::iterator it = computationModels.begin();
+         it != computationModels.end(); ++it) {
+        (*it)->close();
+        delete *it;
+    }
+    computationModels.clear();
+}
+
+int main(int argc, char **argv)
+{
+    //no port is opened by the benchmark: the network is not required
+    yarp::os::Network yarp;
+
+    yarp::os::ResourceFinder resourceFinder = yarp::os::ResourceFinder::getResourceFinderSingleton();
+    resourceFinder.setDefaultConfigFile("torqueBalancing.ini");
+    resourceFinder.setDefaultContext("torqueBalancing");
+    resourceFinder.configure(argc, argv);
+
+    if (resourceFinder.check("help")) {
+        std::cout << "Runs the balancing controller on a simulated robot and reports its timing." << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "\t--wbi_config_file <file>, --wbi_joint_list <list>: as for the torqueBalancing module" << std::endl;
+        std::cout << "\t--ticks <n>: number of control steps (default 5000)" << std::endl;
+        std::cout << "\t--period <ms>: controller period (default 10)" << std::endl;
+        std::cout << "\t--amplitude <rad>, --frequency <Hz>: joints motion (default 0.05, 0.5)" << std::endl;
+        std::cout << "\t--model_workers <n>: number of model computation workers (default 0)" << std::endl;
+        std::cout << "\t--contact_forces_qp: compute the contact forces with the QP" << std::endl;
+        std::cout << "\t--record_golden <file>: writes the torques computed at each step" << std::endl;
+        std::cout << "\t--golden <file>: compares the torques with the ones previously recorded" << std::endl;
+        std::cout << "\t--tolerance <Nm>: maximum difference allowed with the golden torques (default 1e-6)" << std::endl;
+        return 0;
+    }
+
+    //Load the model configuration
+    if (!resourceFinder.check("wbi_config_file") || !resourceFinder.check("wbi_joint_list")) {
+        yError("Please specify the wbi configuration file (\"wbi_config_file\") and the joint list (\"wbi_joint_list\")");
+        return 1;
+    }
+    yarp::os::Property wbiProperties;
+    if (!wbiProperties.fromConfigFile(resourceFinder.findFile("wbi_config_file"))) {
+        yError("Not possible to load WBI properties from file.");
+        return 1;
+    }
+    wbiProperties.fromString(resourceFinder.toString(), false);
+
+    wbi::IDList jointList;
+    if (!yarpWbi::loadIdListFromConfig(resourceFinder.find("wbi_joint_list").asString(), wbiProperties, jointList)) {
+        yError("Cannot find joint list");
+        return 1;
+    }
+    int actuatedDOFs = jointList.size();
+
+    //Load the benchmark parameters
+    using yarp::os::Value;
+    int ticks = resourceFinder.check("ticks", Value(5000)).asInt();
+    int period = resourceFinder.check("period", Value(10)).asInt();
+    double dynamicsSmoothing = resourceFinder.check("dynSmooth", Value(1.0)).asDouble();
+    double amplitude = resourceFinder.check("amplitude", Value(0.05)).asDouble();
+    double frequency = resourceFinder.check("frequency", Value(0.5)).asDouble();
+    int modelWorkers = resourceFinder.check("model_workers", Value(0)).asInt();
+    double centroidalGain = resourceFinder.check("kw", Value(1.0)).asDouble();
+    double impedanceGain = resourceFinder.check("kImp", Value(1.0)).asDouble();
+    double tolerance = resourceFinder.check("tolerance", Value(1e-6)).asDouble();
+    bool contactForcesOptimization = resourceFinder.check("contact_forces_qp");
+    std::string recordGoldenFile = resourceFinder.check("record_golden", Value("")).asString();
+    std::string goldenFile = resourceFinder.check("golden", Value("")).asString();
+
+    if (ticks <= 0 || period <= 0) {
+        yError("Number of ticks and period must be positive");
+        return 1;
+    }
+
+    //the files are opened before creating the robot: nothing has to be released if they are not available
+    std::ofstream recordGolden;
+    if (!recordGoldenFile.empty()) {
+        recordGolden.open(recordGoldenFile.c_str());
+        if (!recordGolden.is_open()) {
+            yError("Could not open %s", recordGoldenFile.c_str());
+            return 1;
+        }
+        recordGolden.precision(17);
+    }
+    std::ifstream golden;
+    if (!goldenFile.empty()) {
+        golden.open(goldenFile.c_str());
+        if (!golden.is_open()) {
+            yError("Could not open %s", goldenFile.c_str());
+            return 1;
+        }
+    }
+
+    //Simulated robot and controller
+    SimulatedWholeBodyInterface robot("torqueBalancingBenchmark", wbiProperties);
+    robot.addJoints(jointList);
+    std::vector<wbi::iWholeBodyModel*> computationModels;
+    if (!robot.init()) {
+        yError("Could not initialize the simulated robot.");
+        releaseRobot(robot, computationModels);
+        return 1;
+    }
+
+    for (int i = 0; i < modelWorkers; ++i) {
+        std::ostringstream modelName;
+        modelName << "torqueBalancingBenchmark_model" << i;
+        yarpWbi::yarpWholeBodyModel *model = new yarpWbi::yarpWholeBodyModel(modelName.str().c_str(), wbiProperties);
+        computationModels.push_back(model);
+        model->addJoints(jointList);
+        if (!model->init()) {
+            yError("Could not initialize model for computation worker %d.", i);
+            releaseRobot(robot, computationModels);
+            return 1;
+        }
+    }
+
+    ControllerReferences references(actuatedDOFs);
+    TorqueBalancingController controller(period, references, robot, actuatedDOFs, dynamicsSmoothing);
+    std::vector<std::string> constraints;
+    constraints.push_back("l_sole");
+    constraints.push_back("r_sole");
+    controller.setInitialConstraintSet(constraints);
+    controller.setCheckJointLimits(false);
+    controller.setContactForcesOptimization(contactForcesOptimization, ContactForcesOptimizer::Parameters());
+    controller.setComputationModels(computationModels);
+
+    //the thread is never started: run is called synchronously
+    if (!controller.threadInit()) {
+        yError("Could not initialize the controller.");
+        controller.threadRelease();
+        releaseRobot(robot, computationModels);
+        return 1;
+    }
+    controller.setCentroidalMomentumGain(centroidalGain);
+    Eigen::VectorXd impedanceGains = Eigen::VectorXd::Constant(actuatedDOFs, impedanceGain);
+    controller.setImpedanceGains(impedanceGains);
+    references.desiredJointsConfiguration().setValue(Eigen::VectorXd::Zero(actuatedDOFs));
+    controller.setActiveState(true);
+
+    //all the memory used by the loop is allocated here
+    Eigen::VectorXd jointPositions(actuatedDOFs);
+    Eigen::VectorXd jointVelocities(actuatedDOFs);
+    Eigen::VectorXd world2BaseFrameSerialization(16);
+    Eigen::Map<Eigen::Matrix4d>(world2BaseFrameSerialization.data()).setIdentity();
+    Eigen::VectorXd baseVelocity = Eigen::VectorXd::Zero(6);
+    Eigen::VectorXd desiredCOMAcceleration = Eigen::VectorXd::Zero(3);
+    std::vector<double> latencies(ticks);
+    std::string goldenLine;
+    double maximumGoldenError = 0;
+    int firstGoldenMismatch = -1;
+
+    double omega = 2 * M_PI * frequency;
+    double benchmarkStart = yarp::os::Time::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        //prescribed (deterministic) state: every joint oscillates with a different phase
+        double time = tick * period / 1000.0;
+        for (int j = 0; j < actuatedDOFs; ++j) {
+            jointPositions(j) = amplitude * std::sin(omega * time + j);
+            jointVelocities(j) = amplitude * omega * std::cos(omega * time + j);
+        }
+        desiredCOMAcceleration(1) = 0.1 * std::sin(omega * time);
+        robot.setState(jointPositions, jointVelocities, world2BaseFrameSerialization, baseVelocity);
+        references.desiredCOMAcceleration().setValue(desiredCOMAcceleration);
+
+        double tickStart = yarp::os::Time::now();
+        controller.run();
+        latencies[tick] = yarp::os::Time::now() - tickStart;
+
+        const Eigen::VectorXd& torques = robot.lastTorques();
+        if (recordGolden.is_open()) {
+            for (int j = 0; j < torques.size(); ++j) {
+                recordGolden << (j == 0 ? "" : " ") << torques(j);
+            }
+            recordGolden << "\n";
+        }
+        if (golden.is_open()) {
+            double error = std::getline(golden, goldenLine) ? compareWithGolden(goldenLine, torques) : -1;
+            if (error < 0) {
+                yError("Golden file %s does not contain valid torques for tick %d", goldenFile.c_str(), tick);
+                golden.close();
+                firstGoldenMismatch = tick;
+            } else {
+                maximumGoldenError = std::max(maximumGoldenError, error);
+                if (error > tolerance && firstGoldenMismatch < 0) firstGoldenMismatch = tick;
+            }
+        }
+    }
+    double benchmarkDuration = yarp::os::Time::now() - benchmarkStart;
+
+    controller.setActiveState(false);
+    controller.threadRelease();
+    releaseRobot(robot, computationModels);
+
+    //Report
+    std::sort(latencies.begin(), latencies.end());
+    double latenciesSum = 0;
+    for (std::vector<double>::const_iterator it = latencies.begin(); it != latencies.end(); ++it) {
+        latenciesSum += *it;
+    }
+    std::printf("Ticks: %d (%d torque references sent)\n", ticks, robot.torqueReferencesCount());
+    std::printf("Throughput: %.1lf ticks/s (%.3lf s total)\n", ticks / benchmarkDuration, benchmarkDuration);
+    std::printf("Tick latency [us]: mean %.1lf min %.1lf p50 %.1lf p90 %.1lf p99 %.1lf p99.9 %.1lf max %.1lf\n",
+                1e6 * latenciesSum / ticks, 1e6 * latencies.front(),
+                1e6 * percentile(latencies, 50), 1e6 * percentile(latencies, 90),
+                1e6 * percentile(latencies, 99), 1e6 * percentile(latencies, 99.9),
+                1e6 * latencies.back());
+    if (contactForcesOptimization) {
+        std::printf("Note: the QP has a wall-clock time budget, torques may differ between runs\n");
+    }
+
+    if (!goldenFile.empty()) {
+        if (firstGoldenMismatch >= 0) {
+            std::printf("Golden comparison FAILED: first mismatch at tick %d (max error %lg Nm, tolerance %lg Nm)\n",
+                        firstGoldenMismatch, maximumGoldenError, tolerance);
+            return 1;
+        }
+        std::printf("Golden comparison passed (max error %lg Nm)\n", maximumGoldenError);
+    }
+    return 0;
+}
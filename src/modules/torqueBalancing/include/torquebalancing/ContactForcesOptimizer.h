@@ -0,0 +1,151 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef CONTACTFORCESOPTIMIZER_H
+#define CONTACTFORCESOPTIMIZER_H
+
+#include "config.h"
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** @brief Computes the contact wrenches as solution of a constrained least-squares problem.
+         *
+         * The problem solved is
+         * \f[
+         * \min_f \frac{1}{2} \| A f - b \|^2 + \frac{\lambda}{2} \| f \|^2
+         * \f]
+         * subject to (for every contact, in the contact frame):
+         * - unilateral normal force \f$ f_z \geq f_{z,min} \f$
+         * - linearised (pyramidal) friction cone \f$ |f_x|, |f_y| \leq \mu f_z \f$
+         * - torsional friction \f$ |\tau_z| \leq \mu_t f_z \f$
+         * - CoP inside the foot support polygon (the same limits are used for all the contacts)
+         *
+         * The problem (6 variables per contact, up to MaximumContactsCount contacts) is solved with an ADMM scheme, which
+         * is warm-started with the solution (primal and dual) of the previous call.
+         * No memory is allocated while solving.
+         * The solver stops if the maximum number of iterations or the time budget is exceeded.
+         * In that case the solution is not accepted and the caller should
+         * fall back to its own (unconstrained) solution.
+         */
+        class ContactForcesOptimizer {
+        public:
+            /** Parameters of the optimisation problem
+             */
+            struct Parameters {
+                Parameters();
+
+                double staticFrictionCoefficient; /*!< coefficient of the linearised friction cone */
+                double torsionalFrictionCoefficient; /*!< coefficient of the torsional friction */
+                double minimumNormalForce; /*!< minimum normal force for an active contact */
+                double footSizeX[2]; /*!< CoP limits (min, max) along the x axis of the contact frame */
+                double footSizeY[2]; /*!< CoP limits (min, max) along the y axis of the contact frame */
+                double regularization; /*!< weight of the regularization term on the wrenches norm */
+                double timeBudget; /*!< maximum time (in seconds) allowed for a single solve */
+                int maximumIterations; /*!< maximum number of iterations of a single solve */
+            };
+
+            ContactForcesOptimizer();
+
+            /** Sets the parameters of the optimisation problem
+             *
+             * It also resets the warm-start status
+             * @param parameters the new parameters
+             */
+            void setParameters(const Parameters& parameters);
+
+            /** Returns the current parameters of the optimisation problem
+             * @return the parameters
+             */
+            const Parameters& parameters() const;
+
+            /** Drops the stored solution, i.e. the next solve will not be warm-started
+             */
+            void reset();
+
+            /** Solves the optimisation problem
+             *
+             * The number of contacts is given by the size of centroidalForceMatrix.
+             * If it changes the warm-start status is reset.
+             * @param centroidalForceMatrix matrix mapping the contact wrenches to the centroidal momentum rate of change (A, 6 x (6 x contacts))
+             * @param desiredWrench desired total wrench to be applied by the contacts (b)
+             * @param contactsRotation rotations from the contact frames to the world frame (3 x (3 x contacts))
+             * @param[in,out] contactForces the initial guess used if no previous solution is available.
+             *               On successful exit it contains the solution (contacts wrenches)
+             * @return true if the solver converged within the iterations and time budget. False otherwise
+             */
+            bool solve(const Eigen::Ref<const Eigen::Matrix<double, 6, Eigen::Dynamic> >& centroidalForceMatrix,
+                       const Eigen::Matrix<double, 6, 1>& desiredWrench,
+                       const Eigen::Ref<const Eigen::Matrix<double, 3, Eigen::Dynamic> >& contactsRotation,
+                       Eigen::Ref<Eigen::VectorXd> contactForces);
+
+            /** Returns the number of iterations performed in the last solve
+             * @return the number of iterations
+             */
+            int lastIterationsCount() const;
+
+        private:
+            enum {
+                ContactConstraintsSize = 11, /*!< constraints for a single contact (unilateral, friction, torsional friction, CoP) */
+                MaxVariablesSize = 6 * MaximumContactsCount,
+                MaxConstraintsSize = MaximumContactsCount * ContactConstraintsSize
+            };
+
+            //sizes depend on the number of contacts, but the memory is not dynamically allocated
+            typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MaxVariablesSize, 1> VariablesVector;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MaxVariablesSize, MaxVariablesSize> VariablesMatrix;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MaxConstraintsSize, 1> ConstraintsVector;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MaxConstraintsSize, MaxVariablesSize> ConstraintsMatrix;
+
+            void resize(int contactsCount);
+            void buildContactConstraints(int contactIndex, const Eigen::Ref<const Eigen::Matrix3d>& contactRotation);
+
+            Parameters m_parameters;
+            bool m_hasWarmStart;
+            int m_lastIterationsCount;
+
+            int m_contactsCount;
+
+            Eigen::Matrix<double, 11, 6> m_localContactConstraints; /*!< constraints of a contact expressed in the contact frame */
+            ConstraintsMatrix m_constraintsMatrix;
+            ConstraintsVector m_lowerBounds;
+            ConstraintsVector m_upperBounds;
+            ConstraintsVector m_stepSizes; /*!< ADMM step size (rho) of each constraint */
+
+            VariablesMatrix m_hessian;
+            VariablesVector m_gradient;
+            VariablesMatrix m_kktMatrix;
+            Eigen::LLT<VariablesMatrix> m_kktDecomposition;
+
+            //ADMM status
+            VariablesVector m_primal;
+            ConstraintsVector m_slack;
+            ConstraintsVector m_dual;
+
+            //buffers
+            VariablesVector m_primalTilde;
+            VariablesVector m_variablesVector;
+            ConstraintsVector m_slackTilde;
+
+        public:
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        };
+    }
+}
+
+#endif /* end of include guard: CONTACTFORCESOPTIMIZER_H */
@@ -18,25 +18,52 @@
 #ifndef DYNAMICCONSTRAINT_H
 #define DYNAMICCONSTRAINT_H
 
+#include <ctrlLibRT/minJerkCtrl.h>
+#include <Eigen/Core>
+#include <string>
+
 namespace codyco {
     namespace torquebalancing {
 
-        //TODO: this class should hold the information about
-        // - link/frame name
-        // - jacobians
-
+        /** @brief Rigid contact constraint on a frame of the robot.
+         *
+         * It holds the frame the constraint refers to and its activation state.
+         * Activation and deactivation are smoothed: the continuous value goes
+         * from 0 (not active) to 1 (active) following a minimum jerk trajectory.
+         *
+         * All the state is stored by value, so that constraints can be kept
+         * in a contiguous array and accessed by index.
+         */
         class DynamicConstraint {
-        private:
-            void * m_implementation;
-
         public:
-            DynamicConstraint();
-            ~DynamicConstraint();
-            DynamicConstraint(const DynamicConstraint&);
-            DynamicConstraint& operator=(const DynamicConstraint&);
+            /** Constructor
+             * @param frameName name of the frame of the constraint
+             */
+            explicit DynamicConstraint(const std::string& frameName = "");
 
+            /** Initializes the constraint
+             * @param isConstraintActiveAtInit initial state of the constraint
+             * @param timeStep time between two calls to updateStateInterpolation (seconds)
+             * @param transitionTime duration of the activation and deactivation (seconds)
+             * @return true on success
+             */
             bool init(bool isConstraintActiveAtInit, double timeStep, double transitionTime);
 
+            /** Returns the name of the frame of the constraint
+             * @return the frame name
+             */
+            const std::string& frameName() const;
+
+            /** Returns the index of the frame in the frame list of the model
+             * @return the frame index. -1 if not set
+             */
+            int frameID() const;
+
+            /** Sets the index of the frame in the frame list of the model
+             * @param frameID the frame index
+             */
+            void setFrameID(int frameID);
+
             bool isActive() const;
             bool isActiveWithThreshold(double threshold) const;
             double continuousValue() const;
@@ -44,8 +71,28 @@ namespace codyco {
             void updateStateInterpolation();
             void activate();
             void deactivate();
-            
+
+        private:
+            std::string m_frameName;
+            int m_frameID;
+            bool m_initialized;
+            bool m_active;
+            Eigen::Matrix<double, 1, 1> m_innerValue;
+            double m_lastComputedValue;
+            iCub::ctrl::realTime::minJerkTrajGen<1> m_transitionSmoother;
         };
+
+        inline bool DynamicConstraint::isActive() const { return m_active; }
+
+        inline bool DynamicConstraint::isActiveWithThreshold(double threshold) const
+        {
+            return m_lastComputedValue >= threshold;
+        }
+
+        inline double DynamicConstraint::continuousValue() const
+        {
+            return m_initialized ? m_lastComputedValue : 0;
+        }
         
     }
 }
@@ -18,21 +18,10 @@
 #define MINIMUMJERKTRAJECTORYGENERATOR_H
 
 #include "ReferenceGenerator.h"
+#include <ctrlLibRT/minJerkCtrl.h>
 #include <Eigen/Core>
 
 
-namespace iCub {
-    namespace ctrl {
-        class minJerkTrajGen;
-    }
-}
-
-namespace yarp {
-    namespace sig {
-        class Vector;
-    }
-}
-
 namespace codyco {
     namespace torquebalancing {
         
@@ -61,16 +50,11 @@ namespace codyco {
         private:
             
             int m_size;
-            iCub::ctrl::minJerkTrajGen* m_minimumJerkGenerator;
+            iCub::ctrl::realTime::minJerkTrajGen<Eigen::Dynamic> m_minimumJerkGenerator;
+            Eigen::VectorXd m_setPoint;
             Eigen::VectorXd m_computedPosition;
             Eigen::VectorXd m_computedVelocity;
             Eigen::VectorXd m_computedAcceleration;
-            
-            double m_sampleTime;
-            double m_duration;
-            
-            yarp::sig::Vector* m_yarpReference;
-            yarp::sig::Vector* m_yarpInitialValue;
         };
     }
 }
@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef MODELCOMPUTATIONWORKERS_H
+#define MODELCOMPUTATIONWORKERS_H
+
+#include <vector>
+
+namespace wbi {
+    class iWholeBodyModel;
+}
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** @brief A computation performed on a robot model
+         */
+        class ModelComputationTask {
+        public:
+            virtual ~ModelComputationTask();
+
+            /** Performs the computation
+             * @param model the model to be used for the computation
+             * @return true if the computation succeeded
+             */
+            virtual bool compute(wbi::iWholeBodyModel& model) = 0;
+        };
+
+        /** @brief Executes model computations concurrently.
+         *
+         * Model objects are not thread-safe (they cache the last state used), so
+         * each worker owns a different model instance.
+         * The first model is used by the thread calling execute, while
+         * a thread is created for each one of the remaining models.
+         */
+        class ModelComputationWorkers {
+        public:
+            ModelComputationWorkers();
+            ~ModelComputationWorkers();
+
+            /** Starts the workers
+             *
+             * @param models models used by the workers (ownership is not transferred)
+             * @return true if all the workers started successfully
+             */
+            bool start(const std::vector<wbi::iWholeBodyModel*>& models);
+
+            /** Stops the workers.
+             */
+            void stop();
+
+            /** Returns the number of workers (including the calling thread)
+             * @return the number of workers, 0 if the workers are not started
+             */
+            int size() const;
+
+            /** Executes the tasks and waits for their completion.
+             *
+             * Task i is executed by worker (i mod size()).
+             * @param tasks the tasks to be executed
+             * @param tasksCount number of tasks
+             * @return true if all the tasks succeeded
+             */
+            bool execute(ModelComputationTask* const* tasks, int tasksCount);
+
+        private:
+            void* m_implementation;
+        };
+    }
+}
+
+#endif /* end of include guard: MODELCOMPUTATIONWORKERS_H */
@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef PSEUDOINVERSE_H
+#define PSEUDOINVERSE_H
+
+#include <Eigen/Core>
+#include <Eigen/SVD>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** Computes the pseudoinverse of a matrix by using the provided SVD decomposition object.
+         *
+         * Same semantic of codyco::math::pseudoInverse, but it also accepts fixed-size matrices
+         * (and the corresponding fixed-size JacobiSVD objects).
+         * If the SVD object and the output matrix are already allocated no memory allocation is performed.
+         * @note fixed-size decompositions only support full U and V computation.
+         *
+         * @param A the matrix to be pseudoinverted
+         * @param svdDecomposition the decomposition object (already allocated)
+         * @param[out] Apinv the pseudoinverse of A
+         * @param tolerance singular values smaller than tolerance are considered zero
+         * @param computationOptions options passed to the SVD decomposition
+         */
+        template <typename MatrixType, typename SVDMatrixType, typename PseudoInverseType>
+        void pseudoInverse(const Eigen::MatrixBase<MatrixType>& A,
+                           Eigen::JacobiSVD<SVDMatrixType>& svdDecomposition,
+                           Eigen::MatrixBase<PseudoInverseType>& Apinv,
+                           double tolerance,
+                           unsigned int computationOptions = Eigen::ComputeFullU | Eigen::ComputeFullV)
+        {
+            svdDecomposition.compute(A, computationOptions);
+            const typename Eigen::JacobiSVD<SVDMatrixType>::SingularValuesType &singularValues = svdDecomposition.singularValues();
+            Apinv.setZero();
+            //singular values are sorted in decreasing order
+            for (int i = 0; i < singularValues.size() && singularValues(i) >= tolerance; ++i) {
+                Apinv.noalias() += (1.0 / singularValues(i)) * svdDecomposition.matrixV().col(i) * svdDecomposition.matrixU().col(i).transpose();
+            }
+        }
+    }
+}
+
+#endif /* end of include guard: PSEUDOINVERSE_H */
@@ -17,6 +17,7 @@
 #ifndef REFERENCE_H
 #define REFERENCE_H
 
+#include "ReferencePreviewBuffer.h"
 #include <Eigen/Core>
 
 
@@ -38,6 +39,10 @@ namespace codyco {
          * The size is passed at construction and cannot be changed. It can be obtained by calling valueSize() function.
          * The content of this object which is not valid is not guaranteed to contain meaningful values (i.e. it can be garbage, so do not use it).
          * This class is thread-safe for setting and reading values.
+         *
+         * Values are exchanged between writers and readers through a triple buffer:
+         * writers never wait for readers (and vice versa), as only the indices of the buffers are exchanged (atomically).
+         * Writers (and readers) are serialized among themselves.
          */
         class Reference
         {
@@ -50,11 +55,19 @@ namespace codyco {
             bool setUpReaderPort(std::string portName);
             bool tearDownReaderPort();
             
-            /** Return the current value.
-             * Before using the value is some computation check if it is valid or not.
-             * @return the current value
+            /** Copies the most recent value.
+             *
+             * This function never waits for the writers.
+             * @param[out] value the current value. Must have size valueSize()
+             * @param[out] generation if not NULL it is filled with the generation of the value
+             * @return true if the value is valid. False otherwise
+             */
+            bool read(Eigen::Ref<Eigen::VectorXd> value, unsigned long *generation = 0) const;
+
+            /** Returns true if a value has been published since the last read
+             * @return true if a new value is available
              */
-            const Eigen::VectorXd& value() const;
+            bool hasNewValue() const;
             
             /** Sets the value for the current reference.
              * The state of the reference automatically switch to active.
@@ -74,14 +87,23 @@ namespace codyco {
              * @return if the reference is valid or not.
              */
             bool isValid();
+
+            /** returns the generation of the current value, i.e. the number of values (or validity changes)
+             * published so far.
+             * @return the generation of the current value
+             */
+            unsigned long generation() const;
             
-            /** returns the size of the currently hold value, i.e. the size of the vector returned by value().
+            /** returns the size of the currently hold value, i.e. the size of the vector filled by read().
              *
              * @return the size of the value
              */
             int valueSize() const;
             
         private:
+            void publish();
+
+            //last value written (writers side)
             Eigen::VectorXd m_value;
             bool m_valid;
             const int m_valueSize;
@@ -89,6 +111,18 @@ namespace codyco {
             void * m_implementation;
         };
 
+        /** @brief Copy of the references used by the controller, taken at the same instant
+         */
+        struct ControllerReferencesSnapshot {
+            explicit ControllerReferencesSnapshot(int actuatedDOFs);
+
+            Eigen::VectorXd desiredCOMAcceleration; /*!< 3 */
+            bool desiredCOMAccelerationValid;
+            Eigen::VectorXd desiredJointsConfiguration; /*!< actuatedDOFs */
+            bool desiredJointsConfigurationValid;
+            unsigned long generation; /*!< sum of the generations of the references in the snapshot */
+        };
+
         //To be removed from this file
         class ControllerReferences
         {
@@ -113,6 +147,25 @@ namespace codyco {
              * @return desired joints configuration (actuated joints)
              */
             Reference& desiredJointsConfiguration();
+
+            /** @brief copies the references used by the controller.
+             *
+             * The references are read without waiting for the reference generators.
+             * If a reference is updated while the snapshot is taken the snapshot
+             * is taken again (a limited number of times), so that all the values
+             * are the most recent ones at the same instant.
+             * @param[out] snapshot the snapshot to be filled
+             * @return true if the snapshot is consistent. False if the references kept changing while being read
+             */
+            bool snapshot(ControllerReferencesSnapshot& snapshot);
+
+            /** @brief returns the buffer of the future references.
+             *
+             * COM samples have the same layout of desiredCOM(),
+             * joints samples the one of desiredJointsPosition()
+             * @return the preview buffer
+             */
+            ReferencePreviewBuffer& preview();
             
         private:
             Reference m_desiredCOM;
@@ -120,6 +173,8 @@ namespace codyco {
 
             Reference m_desiredCOMAcceleration;
             Reference m_desiredJointsConfiguration;
+
+            ReferencePreviewBuffer m_preview;
         };
         
     }
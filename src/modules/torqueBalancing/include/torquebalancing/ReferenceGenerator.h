@@ -76,6 +76,15 @@ namespace codyco {
             virtual void threadRelease();
             virtual void run();
 
+            /** Computes the reference for the specified time instant.
+             *
+             * This is the body of the thread loop. It can be called directly
+             * (without starting the thread) to step the generator synchronously
+             * from another thread, e.g. the controller.
+             * @param time the current time (in seconds)
+             */
+            void step(double time);
+
 #pragma mark - Getter and setter
 
             ReferenceGeneratorInputReader& inputReader();
@@ -30,11 +30,14 @@ namespace wbi {
 
 namespace codyco {
     namespace torquebalancing {
+        class RobotStateSnapshot;
 
         /** Implementation of ReferenceGeneratorInputReader to read the position of a generic endeffector
          * of the robot.
          *
          * It handles a 7-dimension vector representing the homogenous transformation of the endeffector position w.r.t. the world frame. The rotational component is expressed as angle-axis.
+         * If a robot state snapshot publishing the endeffector is provided and it is recent enough, the endeffector
+         * position and velocity are taken from the snapshot. Otherwise they are computed from the robot state.
          *
          * @note this class is not thread safe: avoid cuncurrent calls to its methods.
          */
@@ -44,6 +47,10 @@ namespace codyco {
             int m_numberOfJoints;
             int m_endEffectorLinkID;
 
+            const RobotStateSnapshot* m_robotStateSnapshot;
+            int m_snapshotIndex; /*!< index of the endeffector in the snapshot (-1 if not published) */
+            double m_maximumSnapshotAge;
+
             Eigen::VectorXd m_jointsPosition;
             Eigen::VectorXd m_jointsVelocity;
             Eigen::VectorXd m_basePositionSerialization;
@@ -61,6 +68,16 @@ namespace codyco {
         public:
             EndEffectorPositionReader(wbi::wholeBodyInterface& robot, std::string endEffectorLinkName, int numberOfJoints);
             EndEffectorPositionReader(wbi::wholeBodyInterface& robot, int linkID, int numberOfJoints);
+
+            /** Constructor
+             * @param robot reference to the robot interface
+             * @param linkID link ID of the endeffector
+             * @param numberOfJoints number of actuated joints
+             * @param robotStateSnapshot snapshot of the robot state published by the controller
+             * @param maximumSnapshotAge maximum age (in seconds) of the snapshot to be considered valid
+             */
+            EndEffectorPositionReader(wbi::wholeBodyInterface& robot, int linkID, int numberOfJoints,
+                                      const RobotStateSnapshot& robotStateSnapshot, double maximumSnapshotAge);
             virtual ~EndEffectorPositionReader();
             virtual const Eigen::VectorXd& getSignal(long context = 0);
             virtual const Eigen::VectorXd& getSignalDerivative(long context = 0);
@@ -83,6 +100,15 @@ namespace codyco {
         public:
             COMReader(wbi::wholeBodyInterface& robot, int numberOfJoints);
 
+            /** Constructor
+             * @param robot reference to the robot interface
+             * @param numberOfJoints number of actuated joints
+             * @param robotStateSnapshot snapshot of the robot state published by the controller
+             * @param maximumSnapshotAge maximum age (in seconds) of the snapshot to be considered valid
+             */
+            COMReader(wbi::wholeBodyInterface& robot, int numberOfJoints,
+                      const RobotStateSnapshot& robotStateSnapshot, double maximumSnapshotAge);
+
             virtual ~COMReader();
             virtual const Eigen::VectorXd& getSignal(long context = 0);
             virtual const Eigen::VectorXd& getSignalDerivative(long context = 0);
@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef REFERENCEPREVIEWBUFFER_H
+#define REFERENCEPREVIEWBUFFER_H
+
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+namespace yarp {
+    namespace os {
+        class Bottle;
+    }
+}
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** @brief Time-indexed buffer of future references.
+         *
+         * The buffer holds samples of the COM reference (position, velocity, acceleration),
+         * of the joints reference and of the state of the constraints, each sample
+         * associated to the time instant (in seconds, same clock as yarp::os::Time::now())
+         * at which it should be applied.
+         * Samples are received in chunks, i.e. a trajectory (or part of it) in a single message:
+         * \verbatim
+         [relative] (t_0 (com x y z [vx vy vz ax ay az]) (q q_1 ... q_n) (constraints link_1 ... link_k)) (t_1 ...) ...
+         \endverbatim
+         * Every part of a sample is optional. The constraints list contains the active constraints.
+         * If the keyword relative is present the times are relative to the reception of the message.
+         * The samples of a chunk replace the samples already in the buffer from the time of the first sample of the chunk.
+         *
+         * The controller reads the buffer with sampleAtTime, which interpolates (linearly) the samples
+         * and discards the ones that are in the past.
+         *
+         * Memory is allocated only by configure. This class is thread-safe.
+         */
+        class ReferencePreviewBuffer {
+        public:
+            /** Parts of a sample
+             */
+            enum Channel {
+                ChannelCOM = 1, /*!< COM position, velocity and acceleration */
+                ChannelJoints = 2, /*!< joints configuration */
+                ChannelConstraints = 4 /*!< state of the constraints */
+            };
+
+            /** Constructor
+             * @param comSize size of the COM reference (position, velocity and acceleration)
+             * @param jointsSize size of the joints reference
+             */
+            ReferencePreviewBuffer(int comSize, int jointsSize);
+            ~ReferencePreviewBuffer();
+
+            /** Allocates the buffer.
+             *
+             * Samples already in the buffer are discarded.
+             * @param capacity maximum number of samples
+             * @param constraintNames names of the constraints whose state can be specified in the samples
+             * @return true on success
+             */
+            bool configure(int capacity, const std::vector<std::string>& constraintNames);
+
+            bool setUpReaderPort(std::string portName);
+            bool tearDownReaderPort();
+
+            /** Returns the maximum number of samples
+             * @return the capacity of the buffer
+             */
+            int capacity() const;
+
+            /** Returns the number of samples currently stored
+             * @return the number of samples
+             */
+            int size() const;
+
+            /** Returns the names of the constraints, i.e. the meaning of the constraints vector
+             * @return the names of the constraints
+             */
+            const std::vector<std::string>& constraintNames() const;
+
+            /** Discards all the samples
+             */
+            void clear();
+
+            /** Adds a chunk of samples.
+             *
+             * The chunk is either accepted as a whole or discarded.
+             * @param chunk the samples (see the class documentation for the format)
+             * @param receptionTime time used as origin for relative chunks
+             * @return true if the samples have been added
+             */
+            bool addSamples(const yarp::os::Bottle& chunk, double receptionTime);
+
+            /** Returns the references at the specified time.
+             *
+             * Samples older than the specified time are discarded (the last one is
+             * discarded once it has been returned).
+             * The constraints state is returned only if it changed since the previous call.
+             * @param time the current time (in seconds)
+             * @param[out] com the COM reference
+             * @param[out] joints the joints reference
+             * @param[out] constraints state of the constraints (1 active, 0 not active) in the order given by constraintNames
+             * @return the channels (Channel flags) which have been filled. Zero if no sample is available for time
+             */
+            unsigned sampleAtTime(double time,
+                                  Eigen::Ref<Eigen::VectorXd> com,
+                                  Eigen::Ref<Eigen::VectorXd> joints,
+                                  Eigen::Ref<Eigen::VectorXd> constraints);
+
+        private:
+            void* m_implementation;
+        };
+    }
+}
+
+#endif /* end of include guard: REFERENCEPREVIEWBUFFER_H */
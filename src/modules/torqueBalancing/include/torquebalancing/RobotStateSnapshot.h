@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef ROBOTSTATESNAPSHOT_H
+#define ROBOTSTATESNAPSHOT_H
+
+#include "Reference.h"
+#include <Eigen/Core>
+#include <vector>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** @brief Kinematic quantities of the robot computed at each control step.
+         *
+         * The balancing controller publishes the pose and the velocity of a set of end effectors
+         * (specified at construction) at each step, so that the other threads (e.g. the reference
+         * generator readers) do not have to read the robot state and compute them again.
+         * The center of mass is identified by wbi::wholeBodyInterface::COM_LINK_ID: only the linear part
+         * of its velocity is published (the angular part is zero).
+         *
+         * Publishing and reading never wait for each other (see Reference).
+         * @note only one publisher thread and one reader thread for each end effector are supported.
+         */
+        class RobotStateSnapshot {
+        public:
+            /** Constructor
+             *
+             * @param endEffectorLinkIDs link IDs of the end effectors whose state is published
+             */
+            explicit RobotStateSnapshot(const std::vector<int>& endEffectorLinkIDs);
+
+            /** Returns the link IDs of the end effectors whose state is published
+             * @return the link IDs, in the order of the columns of the published matrices
+             */
+            const std::vector<int>& endEffectorLinkIDs() const;
+
+            /** Returns the index of an end effector in the snapshot
+             * @param linkID link ID of the end effector
+             * @return the index of the end effector, -1 if its state is not published
+             */
+            int endEffectorIndex(int linkID) const;
+
+            /** Publishes a new snapshot
+             *
+             * @param endEffectorsPose pose (position and angle-axis) of the end effectors in the world frame (7 x end effectors)
+             * @param endEffectorsVelocity velocity of the end effectors in the world frame (6 x end effectors)
+             * @param timestamp time (in seconds) at which the robot state has been read
+             */
+            void publish(const Eigen::Ref<const Eigen::MatrixXd>& endEffectorsPose,
+                         const Eigen::Ref<const Eigen::MatrixXd>& endEffectorsVelocity,
+                         double timestamp);
+
+            /** Reads the state of an end effector from the last published snapshot if it is recent enough
+             *
+             * The outputs are not modified if the snapshot is not available.
+             * @param endEffectorIndex index of the end effector (see endEffectorIndex)
+             * @param[out] pose pose of the end effector (7)
+             * @param[out] velocity velocity of the end effector (6)
+             * @param maximumAge maximum age (in seconds) of the snapshot
+             * @return true if a snapshot younger than maximumAge is available. False otherwise
+             */
+            bool read(int endEffectorIndex,
+                      Eigen::Ref<Eigen::VectorXd> pose,
+                      Eigen::Ref<Eigen::VectorXd> velocity,
+                      double maximumAge) const;
+
+        private:
+            std::vector<int> m_endEffectorLinkIDs;
+            Reference m_snapshot; /*!< poses (7 x end effectors), velocities (6 x end effectors), timestamp */
+            Eigen::VectorXd m_writeBuffer;
+            mutable std::vector<Eigen::VectorXd> m_readBuffers; /*!< one for each end effector */
+        };
+    }
+}
+
+#endif /* end of include guard: ROBOTSTATESNAPSHOT_H */
@@ -18,6 +18,10 @@
 #define TORQUEBALANCINGCONTROLLER_H
 
 #include "config.h"
+#include "Reference.h"
+#include "ContactForcesOptimizer.h"
+#include "ModelComputationWorkers.h"
+#include "DynamicConstraint.h"
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Mutex.h>
 #include <wbi/wbiUtil.h>
@@ -26,20 +30,25 @@
 #include <Eigen/Core>
 #include <Eigen/SVD>
 #include <Eigen/LU>
+#include <Eigen/Cholesky>
 
-#include <map>
+#include <string>
+#include <vector>
 
 #include <yarp/os/BufferedPort.h>
 #include <yarp/sig/Vector.h>
 
 namespace wbi {
     class wholeBodyInterface;
+    class iWholeBodyModel;
     class Frame;
 }
 
 namespace codyco {
     namespace torquebalancing {
-        class DynamicContraint;
+        class TorqueBalancingSolver;
+        class RobotStateSnapshot;
+        class ReferenceGenerator;
 
         //Move this somewhere else (and make this more generic)
         class TorqueBalancingController;
@@ -50,8 +59,6 @@ namespace codyco {
             virtual void controllerDidStop(TorqueBalancingController& controller);
         };
 
-        class ControllerReferences;
-        
         /** @brief Represents the actual controller
          *
          */
@@ -125,6 +132,22 @@ namespace codyco {
              */
             const Eigen::VectorXd& torqueSaturationLimit();
 
+            /** Enables or disables the optimisation of the contact forces
+             *
+             * If enabled the contact forces are computed by solving a QP which
+             * enforces friction cones, unilateral normal forces and CoP limits.
+             * If the QP does not converge within its time budget the analytic
+             * (pseudoinverse-based) solution is used.
+             * @param enabled true to enable the optimisation
+             * @param parameters parameters of the optimisation problem
+             */
+            void setContactForcesOptimization(bool enabled, const ContactForcesOptimizer::Parameters& parameters);
+
+            /** Returns true if the contact forces are computed by the QP optimisation
+             * @return true if the contact forces optimisation is enabled
+             */
+            bool usesContactForcesOptimization();
+
             /** Sets the current delegate. NULL to unset it
              * 
              * @param delegate the new delegate or NULL to unset it
@@ -133,12 +156,64 @@ namespace codyco {
 
             /** Initialize the rigid constraints 
              *
+             * Any frame of the robot model can be constrained (e.g. feet and hands).
+             * All the constraints are active at start.
+             * The order of the frames is the order of the contact wrenches (see desiredFeetForces).
              * @note this function must be called before the initialization of the thread
              * to take effect
-             * @param constraintsLinkName the list of 
+             * @param constraintsLinkName the list of frames to be constrained (at most MaximumContactsCount)
+             * @return true if the constraints have been set
              */
             bool setInitialConstraintSet(const std::vector<std::string> &constraintsLinkName);
 
+            /** Sets the models used to compute the kinematic and dynamic quantities of the robot
+             *
+             * If models are specified the robot state is read (under the interface mutex)
+             * and the model quantities are then computed concurrently, each worker using its own model.
+             * If no models are specified (default) all the quantities are computed sequentially
+             * with the robot interface while holding the interface mutex.
+             * @note this function must be called before the initialization of the thread
+             * to take effect
+             * @param models the models to be used. Ownership is not transferred
+             * @return true if the models have been set
+             */
+            bool setComputationModels(const std::vector<wbi::iWholeBodyModel*>& models);
+
+            /** Sets the object used to publish the robot state computed at each control step
+             *
+             * @note this function must be called before the initialization of the thread
+             * to take effect
+             * @param snapshot the object to be filled. NULL to disable publishing
+             */
+            void setRobotStateSnapshot(RobotStateSnapshot* snapshot);
+
+            /** Sets the reference generators to be stepped inside the control loop
+             *
+             * At each control step, after the robot state has been updated (and published),
+             * the generators are stepped in the specified order with the same timestamp,
+             * and then the references are read by the controller.
+             * The generators threads should not be started in this case.
+             * @param generators the generators to be stepped. Ownership is not transferred. Empty to disable
+             */
+            void setInlineReferenceGenerators(const std::vector<ReferenceGenerator*>& generators);
+
+            /** Enables the references preview
+             *
+             * At each control step the samples of the preview buffer (see ControllerReferences#preview)
+             * at the current time plus the look-ahead time are given directly to the COM and joints
+             * reference generators, and the constraints are activated or deactivated as specified by the samples.
+             * As this happens at each control step, while the preview buffer has samples for a channel
+             * they take priority over the references received from the streaming ports.
+             * The look-ahead can be used to compensate the delay of the references tracking.
+             * @note this function must be called before the initialization of the thread
+             * to take effect, and after the configuration of the preview buffer
+             * @param enabled true to read the references from the preview buffer
+             * @param comGenerator generator of the COM references. Ownership is not transferred
+             * @param jointsGenerator generator of the joints references. Ownership is not transferred
+             * @param lookahead the look-ahead time (in seconds)
+             */
+            void setReferencesPreview(bool enabled, ReferenceGenerator* comGenerator, ReferenceGenerator* jointsGenerator, double lookahead = 0);
+
             /** Adds an additional constraint to the dynamics equation
              *
              * Constraint is described at acceleration level, i.e.
@@ -163,6 +238,10 @@ namespace codyco {
 
 #pragma mark - Monitorable variables
             
+            /** Returns the desired contact wrenches
+             * @return the wrenches of all the constraints (6 x number of constraints), in the order given at initialization.
+             * The wrenches of the inactive constraints are zero
+             */
             const Eigen::VectorXd& desiredFeetForces();
             
             const Eigen::VectorXd& outputTorques();
@@ -170,17 +249,47 @@ namespace codyco {
             
         private:
             void readReferences();
+            void readPreviewReferences(double time);
             bool jointsInLimitRange();
             bool updateRobotState();
+            bool readRobotState();
+            void computeContactsQuantities(wbi::iWholeBodyModel& model);
+            void computeDynamicsQuantities(wbi::iWholeBodyModel& model);
+            void computeKinematicsQuantities(wbi::iWholeBodyModel& model);
+            void computeEndEffectorsQuantities(wbi::iWholeBodyModel& model);
             void computeContactForces(const Eigen::Ref<Eigen::VectorXd>& desiredCOMAcceleration, Eigen::Ref<Eigen::VectorXd> desiredContactForces);
             void computeTorques(const Eigen::Ref<Eigen::VectorXd>& desiredContactForces, Eigen::Ref<Eigen::VectorXd> torques);
             void writeTorques();
             
             wbi::wholeBodyInterface& m_robot;
             int m_actuatedDOFs;
+            TorqueBalancingSolver* m_solver;
             double m_dynamicsTransitionTime;
 
             ControllerDelegate *m_delegate;
+            RobotStateSnapshot *m_robotStateSnapshot;
+            std::vector<ReferenceGenerator*> m_inlineReferenceGenerators;
+            ReferenceGenerator *m_previewCOMGenerator;
+            ReferenceGenerator *m_previewJointsGenerator;
+
+            /** Executes one of the compute*Quantities methods of the controller
+             */
+            class ModelTask : public ModelComputationTask {
+            public:
+                typedef void (TorqueBalancingController::*Computation)(wbi::iWholeBodyModel&);
+                ModelTask(TorqueBalancingController& controller, Computation computation);
+                virtual bool compute(wbi::iWholeBodyModel& model);
+            private:
+                TorqueBalancingController& m_controller;
+                Computation m_computation;
+            };
+
+            std::vector<wbi::iWholeBodyModel*> m_computationModels;
+            ModelComputationWorkers m_modelWorkers;
+            ModelTask m_contactsTask;
+            ModelTask m_dynamicsTask;
+            ModelTask m_kinematicsTask;
+            ModelComputationTask* m_modelTasks[3];
             
             yarp::os::Mutex m_mutex;
             
@@ -188,15 +297,34 @@ namespace codyco {
             bool m_checkJointLimits;
             
             //configuration-time constants
-            int m_leftFootLinkID;
-            int m_rightFootLinkID;
             int m_centerOfMassLinkID;
 
-            typedef std::map<std::string, class DynamicConstraint> ConstraintsMap;
-            ConstraintsMap m_activeConstraints;
+            /** Constraints, addressed by index.
+             * The set of constraints is fixed after the initialization.
+             */
+            std::vector<DynamicConstraint> m_constraints;
+            int constraintIndex(const std::string& frameName) const;
+
+            /** Indices (in m_constraints) of the active constraints, updated when the state is read.
+             * Contact quantities only contain the active contacts: the i-th active contact
+             * is the contact i in the Jacobian, in the contact forces, etc.
+             */
+            std::vector<int> m_activeContacts;
+
+            enum {
+                MaxContactsSize = 6 * MaximumContactsCount
+            };
+            //sizes depend on the number of active contacts, but the memory is not dynamically allocated
+            typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MaxContactsSize, 1> ContactsVector;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MaxContactsSize, MaxContactsSize> ContactsTimesContactsMatrix;
+            typedef Eigen::Matrix<double, 6, Eigen::Dynamic, 0, 6, MaxContactsSize> CentroidalForceMatrix;
 
             //References
             ControllerReferences& m_references;
+            ControllerReferencesSnapshot m_referencesSnapshot;
+            unsigned long m_referencesGeneration; /*!< generation of the last references read */
+            bool m_referencesPreviewEnabled;
+            double m_referencesPreviewLookahead;
             Eigen::VectorXd m_desiredJointsConfiguration; /*!< actuatedDOFs */
             
             //Gains
@@ -205,9 +333,9 @@ namespace codyco {
 
             //references
             Eigen::Vector3d m_desiredCOMAcceleration;
-            Eigen::VectorXd m_desiredFeetForces; /*!< 12 */
+            Eigen::VectorXd m_desiredFeetForces; /*!< 6 x contacts */
             Eigen::VectorXd m_desiredCentroidalMomentum;  /*!< 6 */
-            Eigen::VectorXd m_desiredContactForces; /*!< 12 (Vectorisation of contact wrenches at feet: left_wrench and right_wrench) */
+            ContactsVector m_desiredContactForces; /*!< 6 x active contacts (Vectorisation of contact wrenches) */
 
             //state of the robot
             Eigen::VectorXd m_jointPositions;  /*!< totalDOFs */
@@ -217,8 +345,13 @@ namespace codyco {
             wbi::Frame m_world2BaseFrame;
             Eigen::VectorXd m_world2BaseFrameSerialization;
             Eigen::Vector3d m_centerOfMassPosition;
-            Eigen::VectorXd m_rightFootPosition; /*!< 7 */
-            Eigen::VectorXd m_leftFootPosition; /*!< 7 */
+            Eigen::Matrix<double, 7, Eigen::Dynamic> m_contactsPosition; /*!< 7 x active contacts (position and axis-angle orientation) */
+
+            //state published in the robot state snapshot
+            Eigen::MatrixXd m_endEffectorsPose; /*!< 7 x published end effectors */
+            Eigen::MatrixXd m_endEffectorsVelocity; /*!< 6 x published end effectors */
+            Eigen::Matrix<double, 6, Eigen::Dynamic, Eigen::RowMajor> m_endEffectorJacobian; /*!< 6 x totalDOFs */
+            int m_centerOfMassEndEffectorIndex; /*!< index of the center of mass in the snapshot (-1 if not published) */
 
             //Limits
             Eigen::VectorXd m_minJointLimits; /* actuatedDOFs */
@@ -226,8 +359,9 @@ namespace codyco {
             Eigen::VectorXd m_torqueSaturationLimit; /* actuatedDOFs */
             
             //Jacobians
-            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> m_contactsJacobian; /*!< (6x2) x totalDOFs (forces and torques for feet)*/
-            Eigen::VectorXd m_contactsDJacobianDq; /*!< (6x2) */
+            //allocated for all the constraints: only the first (6 x active contacts) rows are used
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> m_contactsJacobian; /*!< (6 x contacts) x totalDOFs */
+            Eigen::VectorXd m_contactsDJacobianDq; /*!< (6 x contacts) */
             
             //Kinematic and dynamic variables
             Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> m_massMatrix; /*!< totalDOFs x totalDOFs */
@@ -236,52 +370,47 @@ namespace codyco {
             Eigen::VectorXd m_centroidalMomentum; /*!< 6 */
             
             //variables used in computation.
-            Eigen::MatrixXd m_centroidalForceMatrix; /*!< 6 x 12 */
-            Eigen::VectorXd m_gravityForce; /*!< 6 */
-            Eigen::MatrixXd m_torquesSelector; /*!< totalDOFs x actuatedDOFs */
+            CentroidalForceMatrix m_centroidalForceMatrix; /*!< 6 x (6 x active contacts) */
+            Eigen::Matrix<double, 6, 1> m_gravityForce;
             //pseuo inverses
-            Eigen::MatrixXd m_pseudoInverseOfJcMInvSt; /*!< actuatedDOFs x (6x2) */
-            Eigen::MatrixXd m_nullSpaceProjectorOfJcMInvSt; /*!< actuatedDOFs x actuatedDOFs */
-//            Eigen::MatrixXd m_pseudoInverseOfJcBase; /*!< 6 x 12 */
-            Eigen::MatrixXd m_pseudoInverseOfCentroidalForceMatrix; /*!< 12 x 6 */
-            Eigen::MatrixXd m_nullSpaceOfCentroidalForceMatrix; /*!< 12 x 12 */
-            Eigen::MatrixXd m_pseudoInverseOfTauN0_f; /*!< 12 x actuatedDoFs */
-            Eigen::JacobiSVD<Eigen::MatrixXd::PlainObject> m_svdDecompositionOfJcMInvSt; /*!< (6x2) x actuatedDOFs */
-            Eigen::JacobiSVD<Eigen::MatrixXd::PlainObject> m_svdDecompositionOfJcBase; /*!< 12 x 6 */
-            Eigen::JacobiSVD<Eigen::MatrixXd::PlainObject> m_svdDecompositionOfCentroidalForceMatrix; /*!< 6 x 12 */
-            Eigen::JacobiSVD<Eigen::MatrixXd::PlainObject> m_svdDecompositionOfTauN0_f; /*!< actuatedDoFs x 12 */
-            Eigen::PartialPivLU<Eigen::MatrixXd::PlainObject> m_luDecompositionOfCentroidalMatrix; /*!< 6 x 6. Used for plain inversion */
+            Eigen::Matrix<double, Eigen::Dynamic, 6, 0, MaxContactsSize, 6> m_pseudoInverseOfCentroidalForceMatrix; /*!< (6 x active contacts) x 6 */
+            ContactsTimesContactsMatrix m_nullSpaceOfCentroidalForceMatrix; /*!< (6 x active contacts) x (6 x active contacts) */
+            Eigen::JacobiSVD<CentroidalForceMatrix> m_svdDecompositionOfCentroidalForceMatrix;
+            Eigen::PartialPivLU<Eigen::Matrix<double, 6, 6> > m_luDecompositionOfCentroidalMatrix; /*!< Used for plain inversion */
+
+            //contact forces optimisation
+            bool m_contactForcesOptimizationEnabled;
+            ContactForcesOptimizer m_contactForcesOptimizer;
+            long m_contactForcesOptimizerFallbacks; /*!< number of times the analytic solution has been used instead of the QP one */
             
             //constant auxiliary variables
             double m_gravityUnitVector[3];
             Eigen::Matrix<double, 7, 1> m_rotoTranslationVector; /*!< 7 */
             Eigen::VectorXd m_jointsZeroVector; /*!< actuatedDOFs */
             Eigen::Matrix<double, 6, 1> m_esaZeroVector; /*!< 6 */
-            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> m_jacobianTemporary; /* 6 x totalDOFs */
             Eigen::VectorXd m_dJacobiaDqTemporary; /* 6 */
             
             //TODO: move all buffers inside this struct to simplify reading
             struct Buffers {
                 Buffers(int actuatedDOFs);
-                
-                Eigen::VectorXd baseAndJointsVector;
-                Eigen::VectorXd jointsVector;
-                Eigen::VectorXd jointsVector2;
-                Eigen::VectorXd esaVector;
-
-                Eigen::MatrixXd totalDoFsIdentity;
-                Eigen::MatrixXd totalDoFsTimesTotalDoFs;
-                Eigen::LDLT<Eigen::MatrixXd::PlainObject> totalDoFsLDLTDecomposition;
-                Eigen::MatrixXd twelveTimesTotalDoFs;
-                Eigen::MatrixXd sixTimesSix;
-                Eigen::MatrixXd twelveTimesDoFs;
-                Eigen::MatrixXd dofsTimesSix;
-                Eigen::MatrixXd dofsTimesDoFs;
-                Eigen::MatrixXd twelveTimesTwelve;
+
+                Eigen::VectorXd jointsVector; /*!< actuatedDOFs */
+                Eigen::Matrix<double, 6, 1> esaVector;
+                Eigen::Matrix<double, 3, Eigen::Dynamic, 0, 3, 3 * MaximumContactsCount> contactsRotation; /*!< 3 x (3 x active contacts) */
+                Eigen::VectorXd previewCOM; /*!< 9 */
+                Eigen::VectorXd previewCOMPosition; /*!< 3 */
+                Eigen::VectorXd previewCOMVelocity; /*!< 3 */
+                Eigen::VectorXd previewCOMAcceleration; /*!< 3 */
+                Eigen::VectorXd previewJoints; /*!< actuatedDOFs */
+                Eigen::VectorXd previewConstraints; /*!< number of constraints in the preview buffer */
+                std::vector<int> previewConstraintsIndices; /*!< index in m_constraints of the constraints in the preview buffer (-1 if not found) */
 
             } m_buffers;
 
             yarp::os::BufferedPort<yarp::sig::Vector> debugPort;
+
+        public:
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
         };
     }
 }
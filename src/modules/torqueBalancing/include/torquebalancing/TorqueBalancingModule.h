@@ -26,6 +26,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <Eigen/Core>
 
 namespace paramHelp {
@@ -35,6 +36,7 @@ namespace paramHelp {
 
 namespace wbi {
     class wholeBodyInterface;
+    class iWholeBodyModel;
 }
 
 namespace yarp {
@@ -57,6 +59,7 @@ namespace codyco {
     namespace torquebalancing {
 
         class ControllerReferences;
+        class RobotStateSnapshot;
         class TorqueBalancingController;
         class ControllerDelegate;
         class ReferenceGenerator;
@@ -140,9 +143,11 @@ namespace codyco {
             std::string m_robotName;
 
             wbi::wholeBodyInterface* m_robot;
+            std::vector<wbi::iWholeBodyModel*> m_computationModels; /*!< private models used by the controller */
 
             TorqueBalancingController* m_controller;
             ControllerReferences* m_references;
+            RobotStateSnapshot* m_robotStateSnapshot; /*!< state published by the controller */
 
             std::map<TaskType, ReferenceGeneratorInputReader*> m_generatorReaders;
             std::map<TaskType, ReferenceGenerator*> m_referenceGenerators;
@@ -156,6 +161,8 @@ namespace codyco {
             Eigen::VectorXd m_jointsConfiguration; /*!< Resting position of the impedance control */
             Eigen::VectorXd m_tempHeptaVector; /*!< Temporary vector of 7 elements */
             Eigen::VectorXd m_comReference; /*!< Reference for the center of mass */
+            Eigen::VectorXd m_receivedCOMReference; /*!< Last desired COM reference read in referenceDidChangeValue */
+            Eigen::VectorXd m_receivedJointsReference; /*!< Last desired joints reference read in referenceDidChangeValue */
 
             typedef std::map<std::string, codyco::PIDList> PidMap;
             PidMap m_torquePIDs;
@@ -211,7 +218,7 @@ namespace codyco {
 
 
         public:
-            ParamHelperManager(TorqueBalancingModule& module, int actuatedDOFs);
+            ParamHelperManager(TorqueBalancingModule& module, int actuatedDOFs, int contactsCount);
 
             bool init(yarp::os::ResourceFinder& resourceFinder);
             bool linkVariables();
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef TORQUEBALANCINGSOLVER_H
+#define TORQUEBALANCINGSOLVER_H
+
+#include <Eigen/Core>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        /** @brief Computes the output torques of the balancing controller.
+         *
+         * Given the dynamics of the robot and the desired contact forces it computes
+         * the joint torques realizing the contact forces, while stabilizing the
+         * postural task in the null space.
+         *
+         * Implementations are specialized at compile time on the number of actuated
+         * degrees of freedom (so that all the buffers are fixed-size, or bounded by
+         * MaximumContactsCount along the contacts dimension).
+         * The number of contacts (up to MaximumContactsCount) is given by the size of the contacts Jacobian:
+         * only the active contacts should be passed.
+         * With no contacts the postural torques are only corrected for the base dynamics.
+         * Use createTorqueBalancingSolver to obtain the implementation for a given robot.
+         */
+        class TorqueBalancingSolver {
+        public:
+            typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> JacobianMatrix;
+
+            virtual ~TorqueBalancingSolver();
+
+            /** Returns the number of actuated degrees of freedom handled by this solver
+             * @return the number of actuated DoFs
+             */
+            virtual int actuatedDOFs() const = 0;
+
+            /** Returns true if the solver has been specialized at compile time
+             * for the number of actuated DoFs
+             * @return true if the solver uses fixed-size matrices. False otherwise
+             */
+            virtual bool isFixedSize() const = 0;
+
+            /** Computes the output torques
+             *
+             * @param massMatrix mass matrix of the robot (totalDOFs x totalDOFs)
+             * @param contactsJacobian stacked jacobians of the contacts (6 x contacts x totalDOFs)
+             * @param contactsDJacobianDq stacked \f$\dot{J} \nu\f$ of the contacts (6 x contacts)
+             * @param generalizedBiasForces Coriolis and gravity terms (totalDOFs)
+             * @param posturalTorques torques of the postural task, i.e. gravity compensation and impedance (actuatedDOFs)
+             * @param nullSpaceOfCentroidalForceMatrix null space projector of the centroidal force matrix (6 x contacts square)
+             * @param desiredContactForces contact forces to be realized (6 x contacts)
+             * @param[out] torques the computed torques (actuatedDOFs)
+             */
+            virtual void computeTorques(const Eigen::MatrixXd& massMatrix,
+                                        const Eigen::Ref<const JacobianMatrix>& contactsJacobian,
+                                        const Eigen::Ref<const Eigen::VectorXd>& contactsDJacobianDq,
+                                        const Eigen::VectorXd& generalizedBiasForces,
+                                        const Eigen::VectorXd& posturalTorques,
+                                        const Eigen::Ref<const Eigen::MatrixXd>& nullSpaceOfCentroidalForceMatrix,
+                                        const Eigen::Ref<const Eigen::VectorXd>& desiredContactForces,
+                                        Eigen::Ref<Eigen::VectorXd> torques) = 0;
+        };
+
+        /** Creates the torque solver for the specified number of actuated DoFs.
+         *
+         * If a specialization for actuatedDOFs exists (currently 23 and 25, i.e. the
+         * iCub joint lists used for balancing) the fixed-size version is returned.
+         * Otherwise a solver using dynamically-sized matrices is returned.
+         * @param actuatedDOFs number of actuated joints
+         * @return the solver. Ownership is transferred to the caller
+         */
+        TorqueBalancingSolver* createTorqueBalancingSolver(int actuatedDOFs);
+    }
+}
+
+#endif /* end of include guard: TORQUEBALANCINGSOLVER_H */
@@ -20,7 +20,10 @@
 namespace codyco {
     namespace torquebalancing {
         extern const double PseudoInverseTolerance;
-        extern const double JcMInvSPseudoInverseDampingTerm;
+
+        enum {
+            MaximumContactsCount = 6 /*!< maximum number of contacts (dynamic constraints), e.g. feet, hands and knees */
+        };
     }
 }
 
@@ -0,0 +1,232 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "ContactForcesOptimizer.h"
+
+#include <yarp/os/Time.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        //ADMM parameters (see the OSQP paper for their meaning)
+        static const double ADMMStepSize = 0.1; /*!< rho */
+        static const double ADMMProximalTerm = 1e-6; /*!< sigma */
+        static const double ADMMRelaxation = 1.6; /*!< alpha */
+        static const double ADMMAbsoluteTolerance = 1e-3;
+        static const double ADMMRelativeTolerance = 1e-3;
+
+        ContactForcesOptimizer::Parameters::Parameters()
+        : staticFrictionCoefficient(1.0 / 3.0)
+        , torsionalFrictionCoefficient(2.0 / 150.0)
+        , minimumNormalForce(10)
+        , regularization(1e-4)
+        , timeBudget(2e-3)
+        , maximumIterations(200)
+        {
+            footSizeX[0] = -0.07;
+            footSizeX[1] = 0.12;
+            footSizeY[0] = -0.045;
+            footSizeY[1] = 0.05;
+        }
+
+        ContactForcesOptimizer::ContactForcesOptimizer()
+        : m_hasWarmStart(false)
+        , m_lastIterationsCount(0)
+        , m_contactsCount(0)
+        {
+            resize(2);
+            setParameters(m_parameters);
+        }
+
+        void ContactForcesOptimizer::resize(int contactsCount)
+        {
+            m_contactsCount = contactsCount;
+            const int variablesSize = 6 * contactsCount;
+            const int constraintsSize = contactsCount * ContactConstraintsSize;
+            m_constraintsMatrix.resize(constraintsSize, variablesSize);
+            m_lowerBounds.resize(constraintsSize);
+            m_upperBounds.resize(constraintsSize);
+            m_stepSizes.resize(constraintsSize);
+            m_hessian.resize(variablesSize, variablesSize);
+            m_gradient.resize(variablesSize);
+            m_kktMatrix.resize(variablesSize, variablesSize);
+            m_primal.resize(variablesSize);
+            m_slack.resize(constraintsSize);
+            m_dual.resize(constraintsSize);
+            m_primalTilde.resize(variablesSize);
+            m_variablesVector.resize(variablesSize);
+            m_slackTilde.resize(constraintsSize);
+        }
+
+        void ContactForcesOptimizer::setParameters(const Parameters& parameters)
+        {
+            m_parameters = parameters;
+
+            const double mu = m_parameters.staticFrictionCoefficient;
+            const double torsionalMu = m_parameters.torsionalFrictionCoefficient;
+            //local wrench is [fx fy fz tx ty tz]
+            m_localContactConstraints.setZero();
+            //unilateral: -fz <= -fzmin
+            m_localContactConstraints(0, 2) = -1;
+            //friction: |fx| <= mu fz, |fy| <= mu fz
+            m_localContactConstraints(1, 0) = 1;  m_localContactConstraints(1, 2) = -mu;
+            m_localContactConstraints(2, 0) = -1; m_localContactConstraints(2, 2) = -mu;
+            m_localContactConstraints(3, 1) = 1;  m_localContactConstraints(3, 2) = -mu;
+            m_localContactConstraints(4, 1) = -1; m_localContactConstraints(4, 2) = -mu;
+            //torsional friction: |tz| <= mu_t fz
+            m_localContactConstraints(5, 5) = 1;  m_localContactConstraints(5, 2) = -torsionalMu;
+            m_localContactConstraints(6, 5) = -1; m_localContactConstraints(6, 2) = -torsionalMu;
+            //CoP_x = -ty / fz in [xmin, xmax]
+            m_localContactConstraints(7, 4) = -1; m_localContactConstraints(7, 2) = -m_parameters.footSizeX[1];
+            m_localContactConstraints(8, 4) = 1;  m_localContactConstraints(8, 2) = m_parameters.footSizeX[0];
+            //CoP_y = tx / fz in [ymin, ymax]
+            m_localContactConstraints(9, 3) = 1;   m_localContactConstraints(9, 2) = -m_parameters.footSizeY[1];
+            m_localContactConstraints(10, 3) = -1; m_localContactConstraints(10, 2) = m_parameters.footSizeY[0];
+
+            reset();
+        }
+
+        const ContactForcesOptimizer::Parameters& ContactForcesOptimizer::parameters() const { return m_parameters; }
+
+        void ContactForcesOptimizer::reset()
+        {
+            m_hasWarmStart = false;
+            m_primal.setZero();
+            m_slack.setZero();
+            m_dual.setZero();
+        }
+
+        int ContactForcesOptimizer::lastIterationsCount() const { return m_lastIterationsCount; }
+
+        void ContactForcesOptimizer::buildContactConstraints(int contactIndex, const Eigen::Ref<const Eigen::Matrix3d>& contactRotation)
+        {
+            const int constraintsOffset = contactIndex * ContactConstraintsSize;
+            const int variablesOffset = contactIndex * 6;
+
+            m_constraintsMatrix.middleRows(constraintsOffset, ContactConstraintsSize).setZero();
+
+            //constraints are expressed in the contact frame: w_local = blkdiag(R^T, R^T) w
+            m_constraintsMatrix.block<ContactConstraintsSize, 3>(constraintsOffset, variablesOffset).noalias()
+            = m_localContactConstraints.leftCols<3>() * contactRotation.transpose();
+            m_constraintsMatrix.block<ContactConstraintsSize, 3>(constraintsOffset, variablesOffset + 3).noalias()
+            = m_localContactConstraints.rightCols<3>() * contactRotation.transpose();
+            m_lowerBounds.segment<ContactConstraintsSize>(constraintsOffset).setConstant(-std::numeric_limits<double>::infinity());
+            m_upperBounds.segment<ContactConstraintsSize>(constraintsOffset).setZero();
+            m_upperBounds(constraintsOffset) = -m_parameters.minimumNormalForce;
+        }
+
+        bool ContactForcesOptimizer::solve(const Eigen::Ref<const Eigen::Matrix<double, 6, Eigen::Dynamic> >& centroidalForceMatrix,
+                                           const Eigen::Matrix<double, 6, 1>& desiredWrench,
+                                           const Eigen::Ref<const Eigen::Matrix<double, 3, Eigen::Dynamic> >& contactsRotation,
+                                           Eigen::Ref<Eigen::VectorXd> contactForces)
+        {
+            const double startTime = yarp::os::Time::now();
+            m_lastIterationsCount = 0;
+
+            const int contactsCount = centroidalForceMatrix.cols() / 6;
+            if (contactsCount > MaximumContactsCount
+                || contactsRotation.cols() != 3 * contactsCount) return false;
+            if (contactsCount != m_contactsCount) {
+                resize(contactsCount);
+                reset();
+            }
+
+            //cost: 1/2 f^T (A^T A + lambda I) f - (A^T b)^T f
+            m_hessian.noalias() = centroidalForceMatrix.transpose() * centroidalForceMatrix;
+            m_hessian.diagonal().array() += m_parameters.regularization;
+            m_gradient.noalias() = -centroidalForceMatrix.transpose() * desiredWrench;
+
+            for (int contact = 0; contact < contactsCount; ++contact) {
+                buildContactConstraints(contact, contactsRotation.middleCols<3>(3 * contact));
+            }
+
+            //all the constraints are one-sided inequalities: they share the same step size
+            m_stepSizes.setConstant(ADMMStepSize);
+
+            //KKT matrix: P + sigma I + C^T rho C
+            m_kktMatrix = m_hessian;
+            m_kktMatrix.diagonal().array() += ADMMProximalTerm;
+            m_kktMatrix.noalias() += m_constraintsMatrix.transpose() * m_stepSizes.asDiagonal() * m_constraintsMatrix;
+            m_kktDecomposition.compute(m_kktMatrix);
+            if (m_kktDecomposition.info() != Eigen::Success) {
+                reset();
+                return false;
+            }
+
+            if (!m_hasWarmStart) {
+                m_primal = contactForces;
+                m_slack.noalias() = m_constraintsMatrix * m_primal;
+                m_slack = m_slack.cwiseMax(m_lowerBounds).cwiseMin(m_upperBounds);
+                m_dual.setZero();
+            }
+
+            bool converged = false;
+            while (!converged) {
+                if (m_lastIterationsCount >= m_parameters.maximumIterations
+                    || yarp::os::Time::now() - startTime > m_parameters.timeBudget) {
+                    break;
+                }
+                m_lastIterationsCount++;
+
+                //x_tilde = K^-1 (sigma x - q + C^T (rho z - y))
+                m_slackTilde = m_stepSizes.cwiseProduct(m_slack) - m_dual;
+                m_variablesVector = ADMMProximalTerm * m_primal - m_gradient;
+                m_variablesVector.noalias() += m_constraintsMatrix.transpose() * m_slackTilde;
+                m_primalTilde = m_kktDecomposition.solve(m_variablesVector);
+
+                //z_tilde = C x_tilde, then relaxation
+                m_slackTilde.noalias() = m_constraintsMatrix * m_primalTilde;
+                m_slackTilde = ADMMRelaxation * m_slackTilde + (1 - ADMMRelaxation) * m_slack;
+                m_primal = ADMMRelaxation * m_primalTilde + (1 - ADMMRelaxation) * m_primal;
+
+                //z = Proj(z_relaxed + y / rho), y = y + rho (z_relaxed - z)
+                m_slack = (m_slackTilde + m_dual.cwiseQuotient(m_stepSizes)).cwiseMax(m_lowerBounds).cwiseMin(m_upperBounds);
+                m_dual += m_stepSizes.cwiseProduct(m_slackTilde - m_slack);
+
+                //residuals
+                m_slackTilde.noalias() = m_constraintsMatrix * m_primal;
+                double primalResidual = (m_slackTilde - m_slack).lpNorm<Eigen::Infinity>();
+                double primalScale = std::max(m_slackTilde.lpNorm<Eigen::Infinity>(), m_slack.lpNorm<Eigen::Infinity>());
+
+                m_variablesVector.noalias() = m_hessian * m_primal;
+                m_primalTilde.noalias() = m_constraintsMatrix.transpose() * m_dual;
+                double dualScale = std::max(std::max(m_variablesVector.lpNorm<Eigen::Infinity>(),
+                                                     m_primalTilde.lpNorm<Eigen::Infinity>()),
+                                            m_gradient.lpNorm<Eigen::Infinity>());
+                m_variablesVector += m_primalTilde + m_gradient;
+                double dualResidual = m_variablesVector.lpNorm<Eigen::Infinity>();
+
+                converged = primalResidual <= ADMMAbsoluteTolerance + ADMMRelativeTolerance * primalScale
+                && dualResidual <= ADMMAbsoluteTolerance + ADMMRelativeTolerance * dualScale;
+            }
+
+            if (!m_primal.allFinite()) {
+                reset();
+                return false;
+            }
+            //the (not converged) iterates are kept anyway: the next solve continues from them
+            m_hasWarmStart = true;
+            if (!converged) return false;
+
+            contactForces = m_primal;
+            return true;
+        }
+
+    }
+}
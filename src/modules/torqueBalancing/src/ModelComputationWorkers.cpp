@@ -0,0 +1,179 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "ModelComputationWorkers.h"
+
+#include <yarp/os/Thread.h>
+#include <yarp/os/Semaphore.h>
+#include <wbi/wholeBodyInterface.h>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        ModelComputationTask::~ModelComputationTask() {}
+
+        /** Executes the tasks with index offset, offset + stride, ... on a given model
+         */
+        static bool executeTasks(wbi::iWholeBodyModel& model, ModelComputationTask* const* tasks, int tasksCount, int offset, int stride)
+        {
+            bool result = true;
+            for (int i = offset; i < tasksCount; i += stride) {
+                result = tasks[i]->compute(model) && result;
+            }
+            return result;
+        }
+
+        class ModelComputationWorker : public yarp::os::Thread {
+        public:
+            ModelComputationWorker(wbi::iWholeBodyModel& model, int offset)
+            : m_model(model)
+            , m_offset(offset)
+            , m_tasks(0)
+            , m_tasksCount(0)
+            , m_stride(1)
+            , m_result(true)
+            , m_startSemaphore(0)
+            , m_completionSemaphore(0) {}
+
+            /** Wakes up the worker. Must be followed by a call to waitForCompletion
+             */
+            void dispatch(ModelComputationTask* const* tasks, int tasksCount, int stride)
+            {
+                m_tasks = tasks;
+                m_tasksCount = tasksCount;
+                m_stride = stride;
+                m_startSemaphore.post();
+            }
+
+            bool waitForCompletion()
+            {
+                m_completionSemaphore.wait();
+                return m_result;
+            }
+
+            virtual void run()
+            {
+                while (true) {
+                    m_startSemaphore.wait();
+                    if (isStopping()) break;
+                    m_result = executeTasks(m_model, m_tasks, m_tasksCount, m_offset, m_stride);
+                    m_completionSemaphore.post();
+                }
+            }
+
+            virtual void onStop()
+            {
+                //wake up the thread so that it can exit
+                m_startSemaphore.post();
+            }
+
+        private:
+            wbi::iWholeBodyModel& m_model;
+            const int m_offset;
+            ModelComputationTask* const* m_tasks;
+            int m_tasksCount;
+            int m_stride;
+            bool m_result;
+            //semaphores also act as memory barriers between the two threads
+            yarp::os::Semaphore m_startSemaphore;
+            yarp::os::Semaphore m_completionSemaphore;
+        };
+
+        struct ModelComputationWorkersImplementation {
+            wbi::iWholeBodyModel* callerModel;
+            std::vector<ModelComputationWorker*> workers;
+        };
+
+#pragma mark - ModelComputationWorkers implementation
+
+        ModelComputationWorkers::ModelComputationWorkers()
+        : m_implementation(new ModelComputationWorkersImplementation())
+        {
+            static_cast<ModelComputationWorkersImplementation*>(m_implementation)->callerModel = 0;
+        }
+
+        ModelComputationWorkers::~ModelComputationWorkers()
+        {
+            if (m_implementation) {
+                stop();
+                delete static_cast<ModelComputationWorkersImplementation*>(m_implementation);
+                m_implementation = 0;
+            }
+        }
+
+        bool ModelComputationWorkers::start(const std::vector<wbi::iWholeBodyModel*>& models)
+        {
+            ModelComputationWorkersImplementation* implementation = static_cast<ModelComputationWorkersImplementation*>(m_implementation);
+            stop();
+            if (models.empty() || !models[0]) return false;
+
+            implementation->callerModel = models[0];
+            for (size_t i = 1; i < models.size(); ++i) {
+                if (!models[i]) {
+                    stop();
+                    return false;
+                }
+                ModelComputationWorker *worker = new ModelComputationWorker(*models[i], i);
+                implementation->workers.push_back(worker);
+                if (!worker->start()) {
+                    stop();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void ModelComputationWorkers::stop()
+        {
+            ModelComputationWorkersImplementation* implementation = static_cast<ModelComputationWorkersImplementation*>(m_implementation);
+            for (std::vector<ModelComputationWorker*>::iterator it = implementation->workers.begin();
+                 it != implementation->workers.end(); ++it) {
+                (*it)->stop();
+                delete *it;
+            }
+            implementation->workers.clear();
+            implementation->callerModel = 0;
+        }
+
+        int ModelComputationWorkers::size() const
+        {
+            ModelComputationWorkersImplementation* implementation = static_cast<ModelComputationWorkersImplementation*>(m_implementation);
+            if (!implementation->callerModel) return 0;
+            return implementation->workers.size() + 1;
+        }
+
+        bool ModelComputationWorkers::execute(ModelComputationTask* const* tasks, int tasksCount)
+        {
+            ModelComputationWorkersImplementation* implementation = static_cast<ModelComputationWorkersImplementation*>(m_implementation);
+            if (!implementation->callerModel) return false;
+            int stride = size();
+
+            //only wake up the workers which have something to do
+            int dispatchedWorkers = 0;
+            for (; dispatchedWorkers < static_cast<int>(implementation->workers.size()) && dispatchedWorkers + 1 < tasksCount; ++dispatchedWorkers) {
+                implementation->workers[dispatchedWorkers]->dispatch(tasks, tasksCount, stride);
+            }
+
+            bool result = executeTasks(*implementation->callerModel, tasks, tasksCount, 0, stride);
+
+            for (int i = 0; i < dispatchedWorkers; ++i) {
+                result = implementation->workers[i]->waitForCompletion() && result;
+            }
+            return result;
+        }
+
+    }
+}
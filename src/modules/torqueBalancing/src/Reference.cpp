@@ -24,6 +24,10 @@
 #include <yarp/os/Thread.h>
 #include <set>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 
 //C++ 11
 //namespace std {
@@ -71,14 +75,85 @@ namespace codyco {
             }
         };
 
+        //Triple buffer state: index of the "middle" buffer and flag signaling it contains a value not yet read
+        static const long ReferenceBufferIndexMask = 3;
+        static const long ReferenceNewValueFlag = 4;
+
+        /** Atomically sets the state of the triple buffer and returns the previous one.
+         * It also acts as a full memory barrier.
+         */
+        static long exchangeBufferState(volatile long *state, long newState, yarp::os::Mutex &fallbackLock)
+        {
+#if defined(__GNUC__)
+            //__sync_lock_test_and_set is only an acquire barrier
+            __sync_synchronize();
+            return __sync_lock_test_and_set(state, newState);
+#elif defined(_MSC_VER)
+            return _InterlockedExchange(state, newState);
+#else
+            yarp::os::LockGuard guard(fallbackLock);
+            long oldState = *state;
+            *state = newState;
+            return oldState;
+#endif
+        }
+
+        struct ReferenceBuffer {
+            Eigen::VectorXd value;
+            bool valid;
+            unsigned long generation;
+        };
+
         struct ReferencePrivateImplementation {
-            yarp::os::Mutex m_lock;
+            yarp::os::Mutex writersLock;
+            yarp::os::Mutex readersLock;
+            yarp::os::Mutex stateLock; /*!< only used if atomic operations are not available */
             std::set<ReferenceDelegate*> delegates;
 
             ReferenceReader reader;
             yarp::os::BufferedPort<yarp::sig::Vector> *readerPort;
 
-            ReferencePrivateImplementation(Reference& reference): reader(reference), readerPort(NULL) {}
+            //triple buffer: back is owned by the writers, front by the readers
+            ReferenceBuffer buffers[3];
+            volatile long state;
+            int backIndex;
+            int frontIndex;
+            unsigned long generation;
+
+            ReferencePrivateImplementation(Reference& reference)
+            : reader(reference)
+            , readerPort(NULL)
+            , state(1)
+            , backIndex(0)
+            , frontIndex(2)
+            , generation(0)
+            {
+                for (int i = 0; i < 3; ++i) {
+                    buffers[i].value.setZero(reference.valueSize());
+                    buffers[i].valid = false;
+                    buffers[i].generation = 0;
+                }
+            }
+
+            /** Publishes the back buffer (writers lock must be held)
+             */
+            void publishBackBuffer()
+            {
+                long oldState = exchangeBufferState(&state, backIndex | ReferenceNewValueFlag, stateLock);
+                backIndex = oldState & ReferenceBufferIndexMask;
+            }
+
+            /** Moves the most recent value (if any) to the front buffer (readers lock must be held)
+             * @return the front buffer
+             */
+            const ReferenceBuffer& acquireFrontBuffer()
+            {
+                if (state & ReferenceNewValueFlag) {
+                    long oldState = exchangeBufferState(&state, frontIndex, stateLock);
+                    frontIndex = oldState & ReferenceBufferIndexMask;
+                }
+                return buffers[frontIndex];
+            }
 
             ~ReferencePrivateImplementation() {
                 if (readerPort) {
@@ -156,11 +231,30 @@ namespace codyco {
             return true;
         }
 
-        const Eigen::VectorXd& Reference::value() const
+        bool Reference::read(Eigen::Ref<Eigen::VectorXd> value, unsigned long *generation) const
         {
             ReferencePrivateImplementation *implementation = static_cast<ReferencePrivateImplementation*>(m_implementation);
-            yarp::os::LockGuard guard(implementation->m_lock);
-            return m_value;
+            yarp::os::LockGuard guard(implementation->readersLock);
+            const ReferenceBuffer &buffer = implementation->acquireFrontBuffer();
+            value = buffer.value;
+            if (generation) *generation = buffer.generation;
+            return buffer.valid;
+        }
+
+        bool Reference::hasNewValue() const
+        {
+            ReferencePrivateImplementation *implementation = static_cast<ReferencePrivateImplementation*>(m_implementation);
+            return (implementation->state & ReferenceNewValueFlag) != 0;
+        }
+
+        void Reference::publish()
+        {
+            ReferencePrivateImplementation *implementation = static_cast<ReferencePrivateImplementation*>(m_implementation);
+            ReferenceBuffer &buffer = implementation->buffers[implementation->backIndex];
+            buffer.value = m_value;
+            buffer.valid = m_valid;
+            buffer.generation = ++implementation->generation;
+            implementation->publishBackBuffer();
         }
         
         void Reference::setValue(const Eigen::Ref<const Eigen::VectorXd>& _value)
@@ -172,9 +266,10 @@ namespace codyco {
                     (*delegate)->referenceWillChangeValue(*this, _value);
                 }
             {
-                yarp::os::LockGuard guard(implementation->m_lock);
+                yarp::os::LockGuard guard(implementation->writersLock);
                 m_value = _value;
                 m_valid = true;
+                publish();
             }
             if (implementation->delegates.size() > 0)
                 for (std::set<ReferenceDelegate*>::iterator delegate = implementation->delegates.begin(); delegate != implementation->delegates.end(); delegate++) {
@@ -185,15 +280,23 @@ namespace codyco {
         void Reference::setValid(bool isValid)
         {
             ReferencePrivateImplementation *implementation = static_cast<ReferencePrivateImplementation*>(m_implementation);
-            yarp::os::LockGuard guard(implementation->m_lock);
+            yarp::os::LockGuard guard(implementation->writersLock);
             m_valid = isValid;
+            publish();
         }
         
         bool Reference::isValid()
         {
             ReferencePrivateImplementation *implementation = static_cast<ReferencePrivateImplementation*>(m_implementation);
-            yarp::os::LockGuard guard(implementation->m_lock);
-            return m_valid;
+            yarp::os::LockGuard guard(implementation->readersLock);
+            return implementation->acquireFrontBuffer().valid;
+        }
+
+        unsigned long Reference::generation() const
+        {
+            ReferencePrivateImplementation *implementation = static_cast<ReferencePrivateImplementation*>(m_implementation);
+            yarp::os::LockGuard guard(implementation->readersLock);
+            return implementation->acquireFrontBuffer().generation;
         }
         
         int Reference::valueSize() const
@@ -202,18 +305,34 @@ namespace codyco {
         }
         
 #pragma mark - ControllerReferences implementation
+
+        //maximum number of times a snapshot is taken again if the references changed while being read
+        static const int ControllerReferencesSnapshotAttempts = 3;
+
+        ControllerReferencesSnapshot::ControllerReferencesSnapshot(int actuatedDOFs)
+        : desiredCOMAcceleration(3)
+        , desiredCOMAccelerationValid(false)
+        , desiredJointsConfiguration(actuatedDOFs)
+        , desiredJointsConfigurationValid(false)
+        , generation(0) {}
         
         ControllerReferences::ControllerReferences(int actuatedDOFs)
         : m_desiredCOM(9)
         , m_desiredJointsPosition(actuatedDOFs)
         , m_desiredCOMAcceleration(3)
-        , m_desiredJointsConfiguration(actuatedDOFs) {}
+        , m_desiredJointsConfiguration(actuatedDOFs)
+        , m_preview(9, actuatedDOFs) {}
 
         Reference& ControllerReferences::desiredCOM()
         {
             return m_desiredCOM;
         }
 
+        ReferencePreviewBuffer& ControllerReferences::preview()
+        {
+            return m_preview;
+        }
+
         Reference& ControllerReferences::desiredJointsPosition()
         {
             return m_desiredJointsPosition;
@@ -228,5 +347,20 @@ namespace codyco {
         {
             return m_desiredJointsConfiguration;
         }
+
+        bool ControllerReferences::snapshot(ControllerReferencesSnapshot& snapshot)
+        {
+            unsigned long comGeneration = 0;
+            unsigned long jointsGeneration = 0;
+            for (int attempt = 0; attempt < ControllerReferencesSnapshotAttempts; ++attempt) {
+                snapshot.desiredCOMAccelerationValid = m_desiredCOMAcceleration.read(snapshot.desiredCOMAcceleration, &comGeneration);
+                snapshot.desiredJointsConfigurationValid = m_desiredJointsConfiguration.read(snapshot.desiredJointsConfiguration, &jointsGeneration);
+                snapshot.generation = comGeneration + jointsGeneration;
+                //the joints configuration is the last read: if the COM acceleration
+                //has not changed in the meantime both are the most recent values
+                if (!m_desiredCOMAcceleration.hasNewValue()) return true;
+            }
+            return false;
+        }
     }
 }
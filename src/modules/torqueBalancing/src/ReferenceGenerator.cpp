@@ -88,10 +88,14 @@ namespace codyco {
         }
 
         void ReferenceGenerator::run()
+        {
+            step(yarp::os::Time::now());
+        }
+
+        void ReferenceGenerator::step(double now)
         {
             yarp::os::LockGuard guard(m_mutex);
             if (m_active) {
-                double now = yarp::os::Time::now();
                 if (m_previousTime < 0) m_previousTime = now;
                 double dt = now - m_previousTime;
 
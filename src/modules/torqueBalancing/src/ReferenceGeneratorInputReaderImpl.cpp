@@ -15,6 +15,7 @@
  */
 
 #include "ReferenceGeneratorInputReaderImpl.h"
+#include "RobotStateSnapshot.h"
 #include "config.h"
 #include <wbi/wholeBodyInterface.h>
 #include <codyco/Utils.h>
@@ -30,6 +31,9 @@ namespace codyco {
         EndEffectorPositionReader::EndEffectorPositionReader(wbi::wholeBodyInterface& robot, std::string endEffectorLinkName, int numberOfJoints)
         : m_robot(robot)
         , m_numberOfJoints(numberOfJoints)
+        , m_robotStateSnapshot(0)
+        , m_snapshotIndex(-1)
+        , m_maximumSnapshotAge(0)
         , m_jointsPosition(numberOfJoints)
         , m_jointsVelocity(numberOfJoints + 6) //In this there is also the base (added manually)
         , m_outputSignal(7)
@@ -45,6 +49,29 @@ namespace codyco {
         : m_robot(robot)
         , m_numberOfJoints(numberOfJoints)
         , m_endEffectorLinkID(linkID)
+        , m_robotStateSnapshot(0)
+        , m_snapshotIndex(-1)
+        , m_maximumSnapshotAge(0)
+        , m_jointsPosition(numberOfJoints)
+        , m_jointsVelocity(numberOfJoints)
+        , m_basePositionSerialization(16)
+        , m_baseVelocity(6)
+        , m_outputSignal(7)
+        , m_outputSignalDerivative(6)
+        , m_jacobian(6, numberOfJoints + 6)
+        , m_previousContext(0)
+        {
+            initializer();
+        }
+
+        EndEffectorPositionReader::EndEffectorPositionReader(wbi::wholeBodyInterface& robot, int linkID, int numberOfJoints,
+                                                             const RobotStateSnapshot& robotStateSnapshot, double maximumSnapshotAge)
+        : m_robot(robot)
+        , m_numberOfJoints(numberOfJoints)
+        , m_endEffectorLinkID(linkID)
+        , m_robotStateSnapshot(&robotStateSnapshot)
+        , m_snapshotIndex(robotStateSnapshot.endEffectorIndex(linkID))
+        , m_maximumSnapshotAge(maximumSnapshotAge)
         , m_jointsPosition(numberOfJoints)
         , m_jointsVelocity(numberOfJoints)
         , m_basePositionSerialization(16)
@@ -66,6 +93,12 @@ namespace codyco {
             if (context != 0 && context == m_previousContext) return;
             using namespace yarp::os;
 
+            //the state published by the controller is used if recent (i.e. the controller is running)
+            if (m_robotStateSnapshot && m_robotStateSnapshot->read(m_snapshotIndex, m_outputSignal, m_outputSignalDerivative, m_maximumSnapshotAge)) {
+                m_previousContext = context;
+                return;
+            }
+
             yarp::os::LockGuard guard(dynamic_cast<yarpWbi::yarpWholeBodyInterface*>(&m_robot)->getInterfaceMutex());
             bool status;
             status = m_robot.getEstimates(wbi::ESTIMATE_JOINT_POS, m_jointsPosition.data());
@@ -124,6 +157,12 @@ namespace codyco {
         , m_outputCOM(3)
         , m_outputCOMVelocity(3) {}
 
+        COMReader::COMReader(wbi::wholeBodyInterface& robot, int numberOfJoints,
+                             const RobotStateSnapshot& robotStateSnapshot, double maximumSnapshotAge)
+        : EndEffectorPositionReader(robot, wbi::wholeBodyInterface::COM_LINK_ID, numberOfJoints, robotStateSnapshot, maximumSnapshotAge)
+        , m_outputCOM(3)
+        , m_outputCOMVelocity(3) {}
+
         COMReader::~COMReader() {}
         
         const Eigen::VectorXd& COMReader::getSignal(long context)
@@ -0,0 +1,347 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "ReferencePreviewBuffer.h"
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Time.h>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        class ReferencePreviewBufferReader : public yarp::os::TypedReaderCallback<yarp::os::Bottle> {
+            ReferencePreviewBuffer &buffer;
+
+        public:
+            ReferencePreviewBufferReader(ReferencePreviewBuffer& buffer)
+            : buffer(buffer) {}
+
+            virtual void onRead(yarp::os::Bottle &read) {
+                buffer.addSamples(read, yarp::os::Time::now());
+            }
+        };
+
+        struct ReferencePreviewBufferImplementation {
+            mutable yarp::os::Mutex mutex;
+
+            ReferencePreviewBufferReader reader;
+            yarp::os::BufferedPort<yarp::os::Bottle> *readerPort;
+
+            const int comSize;
+            const int jointsSize;
+            std::vector<std::string> constraintNames;
+
+            //circular buffer: sample i is stored at (first + i) % capacity
+            int capacity;
+            int first;
+            int size;
+            Eigen::VectorXd times;
+            Eigen::MatrixXd com;
+            Eigen::MatrixXd joints;
+            Eigen::MatrixXd constraints;
+            std::vector<unsigned> channels;
+
+            ReferencePreviewBufferImplementation(ReferencePreviewBuffer& buffer, int comSize, int jointsSize)
+            : reader(buffer)
+            , readerPort(0)
+            , comSize(comSize)
+            , jointsSize(jointsSize)
+            , capacity(0)
+            , first(0)
+            , size(0) {}
+
+            int index(int sample) const { return (first + sample) % capacity; }
+
+            void popFront()
+            {
+                first = (first + 1) % capacity;
+                size--;
+            }
+
+            /** Interpolates the COM and joints between two samples.
+             * @param next storage index of the next sample, or -1 to hold the current one
+             */
+            unsigned interpolate(int current, int next, double time,
+                                 Eigen::Ref<Eigen::VectorXd> comOut,
+                                 Eigen::Ref<Eigen::VectorXd> jointsOut) const
+            {
+                double alpha = 0;
+                if (next >= 0) {
+                    alpha = (time - times(current)) / (times(next) - times(current));
+                }
+                unsigned result = 0;
+                if (channels[current] & ReferencePreviewBuffer::ChannelCOM) {
+                    if (next >= 0 && (channels[next] & ReferencePreviewBuffer::ChannelCOM)) {
+                        comOut = (1 - alpha) * com.col(current) + alpha * com.col(next);
+                    } else {
+                        comOut = com.col(current);
+                    }
+                    result |= ReferencePreviewBuffer::ChannelCOM;
+                }
+                if (channels[current] & ReferencePreviewBuffer::ChannelJoints) {
+                    if (next >= 0 && (channels[next] & ReferencePreviewBuffer::ChannelJoints)) {
+                        jointsOut = (1 - alpha) * joints.col(current) + alpha * joints.col(next);
+                    } else {
+                        jointsOut = joints.col(current);
+                    }
+                    result |= ReferencePreviewBuffer::ChannelJoints;
+                }
+                return result;
+            }
+
+            /** Checks a sample and returns its time. Returns false if the sample is malformed
+             */
+            bool validateSample(const yarp::os::Value& value, double &time) const
+            {
+                const yarp::os::Bottle *sample = value.asList();
+                if (!sample || sample->size() < 1 || !(sample->get(0).isDouble() || sample->get(0).isInt())) return false;
+                time = sample->get(0).asDouble();
+                for (int i = 1; i < sample->size(); ++i) {
+                    const yarp::os::Bottle *part = sample->get(i).asList();
+                    if (!part || part->size() < 1) return false;
+                    std::string tag = part->get(0).asString();
+                    if (tag == "com") {
+                        if (part->size() - 1 != 3 && part->size() - 1 != comSize) return false;
+                    } else if (tag == "q") {
+                        if (part->size() - 1 != jointsSize) return false;
+                    } else if (tag == "constraints") {
+                        for (int j = 1; j < part->size(); ++j) {
+                            if (constraintIndex(part->get(j).asString()) < 0) return false;
+                        }
+                    } else return false;
+                }
+                return true;
+            }
+
+            int constraintIndex(const std::string& name) const
+            {
+                for (size_t i = 0; i < constraintNames.size(); ++i) {
+                    if (constraintNames[i] == name) return i;
+                }
+                return -1;
+            }
+
+            void storeSample(const yarp::os::Bottle& sample, int storageIndex, double time)
+            {
+                times(storageIndex) = time;
+                channels[storageIndex] = 0;
+                for (int i = 1; i < sample.size(); ++i) {
+                    const yarp::os::Bottle *part = sample.get(i).asList();
+                    std::string tag = part->get(0).asString();
+                    if (tag == "com") {
+                        com.col(storageIndex).setZero();
+                        for (int j = 1; j < part->size(); ++j) {
+                            com(j - 1, storageIndex) = part->get(j).asDouble();
+                        }
+                        channels[storageIndex] |= ReferencePreviewBuffer::ChannelCOM;
+                    } else if (tag == "q") {
+                        for (int j = 1; j < part->size(); ++j) {
+                            joints(j - 1, storageIndex) = part->get(j).asDouble();
+                        }
+                        channels[storageIndex] |= ReferencePreviewBuffer::ChannelJoints;
+                    } else if (tag == "constraints") {
+                        constraints.col(storageIndex).setZero();
+                        for (int j = 1; j < part->size(); ++j) {
+                            constraints(constraintIndex(part->get(j).asString()), storageIndex) = 1;
+                        }
+                        channels[storageIndex] |= ReferencePreviewBuffer::ChannelConstraints;
+                    }
+                }
+            }
+        };
+
+#pragma mark - ReferencePreviewBuffer implementation
+
+        ReferencePreviewBuffer::ReferencePreviewBuffer(int comSize, int jointsSize)
+        : m_implementation(0)
+        {
+            m_implementation = new ReferencePreviewBufferImplementation(*this, comSize, jointsSize);
+        }
+
+        ReferencePreviewBuffer::~ReferencePreviewBuffer()
+        {
+            tearDownReaderPort();
+            if (m_implementation) {
+                delete static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+                m_implementation = 0;
+            }
+        }
+
+        bool ReferencePreviewBuffer::configure(int capacity, const std::vector<std::string>& constraintNames)
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            if (capacity < 1) return false;
+            yarp::os::LockGuard guard(implementation->mutex);
+            implementation->constraintNames = constraintNames;
+            implementation->capacity = capacity;
+            implementation->first = 0;
+            implementation->size = 0;
+            implementation->times.setZero(capacity);
+            implementation->com.setZero(implementation->comSize, capacity);
+            implementation->joints.setZero(implementation->jointsSize, capacity);
+            implementation->constraints.setZero(constraintNames.size(), capacity);
+            implementation->channels.assign(capacity, 0);
+            return true;
+        }
+
+        bool ReferencePreviewBuffer::setUpReaderPort(std::string portName)
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            if (!implementation->readerPort) {
+                implementation->readerPort = new yarp::os::BufferedPort<yarp::os::Bottle>();
+                if (!implementation->readerPort) return false;
+            }
+            bool result = implementation->readerPort->open(portName);
+            implementation->readerPort->useCallback(implementation->reader);
+            return result;
+        }
+
+        bool ReferencePreviewBuffer::tearDownReaderPort()
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            if (implementation->readerPort) {
+                implementation->readerPort->disableCallback();
+                implementation->readerPort->interrupt();
+                implementation->readerPort->close();
+                delete implementation->readerPort;
+                implementation->readerPort = 0;
+            }
+            return true;
+        }
+
+        int ReferencePreviewBuffer::capacity() const
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            yarp::os::LockGuard guard(implementation->mutex);
+            return implementation->capacity;
+        }
+
+        int ReferencePreviewBuffer::size() const
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            yarp::os::LockGuard guard(implementation->mutex);
+            return implementation->size;
+        }
+
+        const std::vector<std::string>& ReferencePreviewBuffer::constraintNames() const
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            return implementation->constraintNames;
+        }
+
+        void ReferencePreviewBuffer::clear()
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            yarp::os::LockGuard guard(implementation->mutex);
+            implementation->first = 0;
+            implementation->size = 0;
+        }
+
+        bool ReferencePreviewBuffer::addSamples(const yarp::os::Bottle& chunk, double receptionTime)
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+
+            int firstSample = 0;
+            double timeOffset = 0;
+            if (chunk.size() > 0 && chunk.get(0).isString()) {
+                if (chunk.get(0).asString() != "relative") {
+                    yWarning("Preview chunk discarded: unknown keyword %s", chunk.get(0).asString().c_str());
+                    return false;
+                }
+                firstSample = 1;
+                timeOffset = receptionTime;
+            }
+            int samplesCount = chunk.size() - firstSample;
+            if (samplesCount <= 0) return false;
+
+            //validate the whole chunk before modifying the buffer
+            double firstTime = 0;
+            double previousTime = 0;
+            for (int i = firstSample; i < chunk.size(); ++i) {
+                double time;
+                if (!implementation->validateSample(chunk.get(i), time)) {
+                    yWarning("Preview chunk discarded: sample %d is malformed", i - firstSample);
+                    return false;
+                }
+                if (i == firstSample) {
+                    firstTime = time;
+                } else if (time <= previousTime) {
+                    yWarning("Preview chunk discarded: sample times must be increasing");
+                    return false;
+                }
+                previousTime = time;
+            }
+
+            yarp::os::LockGuard guard(implementation->mutex);
+            //the chunk replaces the samples from its first time instant on
+            int keptSamples = implementation->size;
+            while (keptSamples > 0 && implementation->times(implementation->index(keptSamples - 1)) >= firstTime + timeOffset) {
+                keptSamples--;
+            }
+            if (keptSamples + samplesCount > implementation->capacity) {
+                yWarning("Preview chunk discarded: %d samples do not fit in the buffer (%d already stored, capacity %d)",
+                         samplesCount, keptSamples, implementation->capacity);
+                return false;
+            }
+
+            implementation->size = keptSamples;
+            for (int i = firstSample; i < chunk.size(); ++i) {
+                const yarp::os::Bottle *sample = chunk.get(i).asList();
+                implementation->storeSample(*sample, implementation->index(implementation->size), sample->get(0).asDouble() + timeOffset);
+                implementation->size++;
+            }
+            return true;
+        }
+
+        unsigned ReferencePreviewBuffer::sampleAtTime(double time,
+                                                      Eigen::Ref<Eigen::VectorXd> com,
+                                                      Eigen::Ref<Eigen::VectorXd> joints,
+                                                      Eigen::Ref<Eigen::VectorXd> constraints)
+        {
+            ReferencePreviewBufferImplementation *implementation = static_cast<ReferencePreviewBufferImplementation*>(m_implementation);
+            yarp::os::LockGuard guard(implementation->mutex);
+            if (implementation->size == 0 || time < implementation->times(implementation->index(0))) return 0;
+
+            unsigned result = 0;
+            //the constraints state is the one of the last sample (specifying it) before time
+            while (true) {
+                int current = implementation->index(0);
+                if (implementation->channels[current] & ChannelConstraints) {
+                    constraints = implementation->constraints.col(current);
+                    //already returned: the state is returned only when changed
+                    implementation->channels[current] &= ~ChannelConstraints;
+                    result |= ChannelConstraints;
+                }
+                if (implementation->size < 2 || implementation->times(implementation->index(1)) > time) break;
+                implementation->popFront();
+            }
+
+            int current = implementation->index(0);
+            if (implementation->size == 1) {
+                //last sample: it is returned (once) as it is
+                result |= implementation->interpolate(current, -1, time, com, joints);
+                implementation->popFront();
+                return result;
+            }
+            return result | implementation->interpolate(current, implementation->index(1), time, com, joints);
+        }
+
+    }
+}
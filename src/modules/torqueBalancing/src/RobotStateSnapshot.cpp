@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "RobotStateSnapshot.h"
+
+#include <yarp/os/Time.h>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        RobotStateSnapshot::RobotStateSnapshot(const std::vector<int>& endEffectorLinkIDs)
+        : m_endEffectorLinkIDs(endEffectorLinkIDs)
+        , m_snapshot(13 * endEffectorLinkIDs.size() + 1)
+        , m_writeBuffer(13 * endEffectorLinkIDs.size() + 1)
+        , m_readBuffers(endEffectorLinkIDs.size(), Eigen::VectorXd(13 * endEffectorLinkIDs.size() + 1))
+        {
+            m_writeBuffer.setZero();
+        }
+
+        const std::vector<int>& RobotStateSnapshot::endEffectorLinkIDs() const { return m_endEffectorLinkIDs; }
+
+        int RobotStateSnapshot::endEffectorIndex(int linkID) const
+        {
+            for (size_t i = 0; i < m_endEffectorLinkIDs.size(); ++i) {
+                if (m_endEffectorLinkIDs[i] == linkID) return i;
+            }
+            return -1;
+        }
+
+        void RobotStateSnapshot::publish(const Eigen::Ref<const Eigen::MatrixXd>& endEffectorsPose,
+                                         const Eigen::Ref<const Eigen::MatrixXd>& endEffectorsVelocity,
+                                         double timestamp)
+        {
+            //only one publisher (the controller) is supported: the buffer is not protected
+            const int endEffectorsCount = m_endEffectorLinkIDs.size();
+            for (int i = 0; i < endEffectorsCount; ++i) {
+                m_writeBuffer.segment<7>(7 * i) = endEffectorsPose.col(i);
+                m_writeBuffer.segment<6>(7 * endEffectorsCount + 6 * i) = endEffectorsVelocity.col(i);
+            }
+            m_writeBuffer(13 * endEffectorsCount) = timestamp;
+            m_snapshot.setValue(m_writeBuffer);
+        }
+
+        bool RobotStateSnapshot::read(int endEffectorIndex,
+                                      Eigen::Ref<Eigen::VectorXd> pose,
+                                      Eigen::Ref<Eigen::VectorXd> velocity,
+                                      double maximumAge) const
+        {
+            if (endEffectorIndex < 0 || endEffectorIndex >= static_cast<int>(m_endEffectorLinkIDs.size())) return false;
+            //only one reader at a time for each end effector is supported: its buffer is not protected
+            Eigen::VectorXd& readBuffer = m_readBuffers[endEffectorIndex];
+            const int endEffectorsCount = m_endEffectorLinkIDs.size();
+            if (!m_snapshot.read(readBuffer)) return false;
+            if (yarp::os::Time::now() - readBuffer(13 * endEffectorsCount) > maximumAge) return false;
+            pose = readBuffer.segment<7>(7 * endEffectorIndex);
+            velocity = readBuffer.segment<6>(7 * endEffectorsCount + 6 * endEffectorIndex);
+            return true;
+        }
+
+    }
+}
@@ -17,6 +17,10 @@
 #include "TorqueBalancingController.h"
 #include "Reference.h"
 #include "DynamicConstraint.h"
+#include "TorqueBalancingSolver.h"
+#include "PseudoInverse.h"
+#include "RobotStateSnapshot.h"
+#include "ReferenceGenerator.h"
 
 #include <wbi/wholeBodyInterface.h>
 #include <wbi/wbiUtil.h>
@@ -24,6 +28,7 @@
 #include <yarpWholeBodyInterface/yarpWholeBodyInterface.h>
 #include <yarp/os/LogStream.h>
 #include <yarp/os/LockGuard.h>
+#include <yarp/os/Time.h>
 #include <codyco/Utils.h>
 
 #include <iCub/ctrl/minJerkCtrl.h>
@@ -32,6 +37,7 @@
 #include <limits>
 
 #include <Eigen/LU>
+#include <Eigen/Geometry>
 
 #define TORQUEBALANCING_STATEACTIVE_THRESHOLD 0.05
 
@@ -49,12 +55,23 @@ namespace codyco {
         : RateThread(period)
         , m_robot(robot)
         , m_actuatedDOFs(actuatedDOFs)
+        , m_solver(createTorqueBalancingSolver(actuatedDOFs))
         , m_dynamicsTransitionTime(dynamicSmoothingTime)
         , m_delegate(0)
+        , m_robotStateSnapshot(0)
+        , m_previewCOMGenerator(0)
+        , m_previewJointsGenerator(0)
+        , m_contactsTask(*this, &TorqueBalancingController::computeContactsQuantities)
+        , m_dynamicsTask(*this, &TorqueBalancingController::computeDynamicsQuantities)
+        , m_kinematicsTask(*this, &TorqueBalancingController::computeKinematicsQuantities)
         , m_active(false)
         , m_checkJointLimits(true)
         , m_centerOfMassLinkID(wbi::wholeBodyInterface::COM_LINK_ID)
         , m_references(references)
+        , m_referencesSnapshot(actuatedDOFs)
+        , m_referencesGeneration(0)
+        , m_referencesPreviewEnabled(false)
+        , m_referencesPreviewLookahead(0)
         , m_desiredJointsConfiguration(actuatedDOFs)
         , m_centroidalMomentumGain(0)
         , m_impedanceGains(actuatedDOFs)
@@ -68,8 +85,9 @@ namespace codyco {
         , m_baseVelocity(6)
         , m_world2BaseFrameSerialization(16)
         , m_centerOfMassPosition(3)
-        , m_rightFootPosition(7)
-        , m_leftFootPosition(7)
+        , m_contactsPosition(7, 2)
+        , m_endEffectorJacobian(6, actuatedDOFs + 6)
+        , m_centerOfMassEndEffectorIndex(-1)
         , m_minJointLimits(actuatedDOFs)
         , m_maxJointLimits(actuatedDOFs)
         , m_torqueSaturationLimit(actuatedDOFs)
@@ -79,43 +97,46 @@ namespace codyco {
         , m_generalizedBiasForces(actuatedDOFs + 6)
         , m_gravityBiasTorques(actuatedDOFs + 6)
         , m_centroidalMomentum(6)
-        , m_centroidalForceMatrix(6, 12)
-        , m_gravityForce(6)
-        , m_torquesSelector(actuatedDOFs + 6, actuatedDOFs)
-        , m_pseudoInverseOfJcMInvSt(actuatedDOFs, 6 * 2)
-        , m_nullSpaceProjectorOfJcMInvSt(actuatedDOFs, actuatedDOFs)
-        //        , m_pseudoInverseOfJcBase(6, 12)
-        , m_pseudoInverseOfCentroidalForceMatrix(12, 6)
-        , m_nullSpaceOfCentroidalForceMatrix(12, 12)
-        , m_pseudoInverseOfTauN0_f(12, actuatedDOFs)
-        , m_svdDecompositionOfJcMInvSt(6 * 2, actuatedDOFs)
-        , m_svdDecompositionOfJcBase(12, 6)
-        , m_svdDecompositionOfCentroidalForceMatrix(6, 12)
-        , m_svdDecompositionOfTauN0_f(actuatedDOFs, 12)
-        , m_luDecompositionOfCentroidalMatrix(6)
+        , m_svdDecompositionOfCentroidalForceMatrix(6, 12, Eigen::ComputeFullU | Eigen::ComputeFullV)
+        , m_contactForcesOptimizationEnabled(false)
+        , m_contactForcesOptimizerFallbacks(0)
         , m_rotoTranslationVector(7)
         , m_jointsZeroVector(actuatedDOFs)
         , m_esaZeroVector(6)
-        , m_jacobianTemporary(6, actuatedDOFs + 6)
         , m_dJacobiaDqTemporary(6)
-        , m_buffers(actuatedDOFs) {}
+        , m_buffers(actuatedDOFs)
+        {
+            //the mass matrix (the most expensive computation) goes first
+            m_modelTasks[0] = &m_dynamicsTask;
+            m_modelTasks[1] = &m_contactsTask;
+            m_modelTasks[2] = &m_kinematicsTask;
+        }
+
+        TorqueBalancingController::ModelTask::ModelTask(TorqueBalancingController& controller, Computation computation)
+        : m_controller(controller)
+        , m_computation(computation) {}
+
+        bool TorqueBalancingController::ModelTask::compute(wbi::iWholeBodyModel& model)
+        {
+            (m_controller.*m_computation)(model);
+            return true;
+        }
 
         TorqueBalancingController::Buffers::Buffers(int actuatedDOFs)
-        : baseAndJointsVector(actuatedDOFs + 6)
-        , jointsVector(actuatedDOFs)
-        , jointsVector2(actuatedDOFs)
-        , esaVector(6)
-        , totalDoFsIdentity(Eigen::MatrixXd::Identity(actuatedDOFs + 6, actuatedDOFs + 6))
-        , totalDoFsTimesTotalDoFs(actuatedDOFs + 6, actuatedDOFs + 6)
-        , totalDoFsLDLTDecomposition(actuatedDOFs + 6)
-        , twelveTimesTotalDoFs(12, actuatedDOFs + 6)
-        , sixTimesSix(6, 6)
-        , twelveTimesDoFs(12, actuatedDOFs)
-        , dofsTimesSix(actuatedDOFs, 6)
-        , dofsTimesDoFs(actuatedDOFs, actuatedDOFs)
-        , twelveTimesTwelve(12, 12) {}
-
-        TorqueBalancingController::~TorqueBalancingController() {}
+        : jointsVector(actuatedDOFs)
+        , previewCOM(9)
+        , previewCOMPosition(3)
+        , previewCOMVelocity(3)
+        , previewCOMAcceleration(3)
+        , previewJoints(actuatedDOFs) {}
+
+        TorqueBalancingController::~TorqueBalancingController()
+        {
+            if (m_solver) {
+                delete m_solver;
+                m_solver = 0;
+            }
+        }
 
 #pragma mark - RateThread methods
         bool TorqueBalancingController::threadInit()
@@ -123,23 +144,21 @@ namespace codyco {
             using namespace Eigen;
             //Initialize constant variables
             bool linkFound = true;
-            linkFound = m_robot.getFrameList().idToIndex("l_sole", m_leftFootLinkID);
-            linkFound = linkFound && m_robot.getFrameList().idToIndex("r_sole", m_rightFootLinkID);
-
-            //centroidal force matrix
-            m_centroidalForceMatrix.setZero();
-            m_centroidalForceMatrix.block<3, 3>(0, 0) = Matrix3d::Identity();
-            m_centroidalForceMatrix.block<3, 3>(0, 6) = Matrix3d::Identity();
-            m_centroidalForceMatrix.block<3, 3>(3, 3) = Matrix3d::Identity();
-            m_centroidalForceMatrix.block<3, 3>(3, 9) = Matrix3d::Identity();
+            for (std::vector<DynamicConstraint>::iterator constraint = m_constraints.begin();
+                 constraint != m_constraints.end(); ++constraint) {
+                int frameID = -1;
+                if (!m_robot.getFrameList().idToIndex(constraint->frameName().c_str(), frameID)) {
+                    yError("Frame %s not found in the model", constraint->frameName().c_str());
+                    linkFound = false;
+                }
+                constraint->setFrameID(frameID);
+            }
+
             //gravity
             m_gravityForce.setZero();
             m_gravityUnitVector[0] = m_gravityUnitVector[1] = 0;
             m_gravityUnitVector[2] = -9.81;
 
-            m_torquesSelector.setZero();
-            m_torquesSelector.bottomRows(m_actuatedDOFs).setIdentity();
-
             m_jointsZeroVector.setZero();
             m_esaZeroVector.setZero();
             m_torqueSaturationLimit.setConstant(std::numeric_limits<double>::max());
@@ -149,8 +168,7 @@ namespace codyco {
             m_jointVelocities.setZero();
             m_baseVelocity.setZero();
             m_centerOfMassPosition.setZero();
-            m_rightFootPosition.setZero();
-            m_leftFootPosition.setZero();
+            m_contactsPosition.setZero();
             m_contactsJacobian.setZero();
             m_contactsDJacobianDq.setZero();
             m_generalizedBiasForces.setZero();
@@ -182,6 +200,25 @@ namespace codyco {
                 yInfo("Joint limits disabled");
             }
 
+            if (!m_solver) {
+                yError("Failed to create the torque solver.");
+                return false;
+            }
+            yInfo("Torque solver for %d DoFs uses %s matrices", m_solver->actuatedDOFs(), m_solver->isFixedSize() ? "fixed-size" : "dynamic");
+            if (m_contactForcesOptimizationEnabled) {
+                yInfo("Contact forces computed by QP optimisation (time budget %lf s)", m_contactForcesOptimizer.parameters().timeBudget);
+            }
+            m_contactForcesOptimizer.reset();
+            m_contactForcesOptimizerFallbacks = 0;
+
+            if (!m_computationModels.empty()) {
+                if (!m_modelWorkers.start(m_computationModels)) {
+                    yError("Failed to start the model computation workers.");
+                    return false;
+                }
+                yInfo("Model quantities computed by %d workers", m_modelWorkers.size());
+            }
+
             //read the initial configuration
             int count = 10;
 
@@ -191,21 +228,25 @@ namespace codyco {
             } while(!result && count >0);
 
             std::stringstream formattedConstraintsString;
-            formattedConstraintsString << m_activeConstraints.size() << " Dyn. Constraints = ";
-            for (ConstraintsMap::const_iterator it = m_activeConstraints.begin();
-                 it != m_activeConstraints.end(); it++) {
-                formattedConstraintsString << it->first << " ";
+            formattedConstraintsString << m_constraints.size() << " Dyn. Constraints = ";
+            for (std::vector<DynamicConstraint>::const_iterator it = m_constraints.begin();
+                 it != m_constraints.end(); it++) {
+                formattedConstraintsString << it->frameName() << " ";
             }
             yInfo("%s", formattedConstraintsString.str().c_str());
 
 
 //            debugPort.open("/tb/debug:o");
 
-            return linkFound && result && !m_activeConstraints.empty();
+            return linkFound && result && !m_constraints.empty();
         }
 
         void TorqueBalancingController::threadRelease()
         {
+            m_modelWorkers.stop();
+            if (m_contactForcesOptimizationEnabled) {
+                yInfo("Contact forces QP fell back to the analytic solution %ld times", m_contactForcesOptimizerFallbacks);
+            }
             debugPort.close();
         }
 
@@ -214,9 +255,6 @@ namespace codyco {
             yarp::os::LockGuard guard(m_mutex);
             if (!m_active) return;
 
-            //read references
-            readReferences();
-
             //read / update state
             if (!updateRobotState()) {
                 yInfo() << "Failed to update state. Deactivating control";
@@ -226,6 +264,29 @@ namespace codyco {
                 return;
             }
 
+            double now = yarp::os::Time::now();
+            //share the state with the other threads
+            if (m_robotStateSnapshot) {
+                if (m_centerOfMassEndEffectorIndex >= 0) {
+                    //linear part of the centroidal momentum is m * v_com
+                    m_endEffectorsVelocity.col(m_centerOfMassEndEffectorIndex).head<3>() = m_centroidalMomentum.head<3>() / m_massMatrix(0, 0);
+                }
+                m_robotStateSnapshot->publish(m_endEffectorsPose, m_endEffectorsVelocity, now);
+            }
+
+            if (m_referencesPreviewEnabled) {
+                readPreviewReferences(now + m_referencesPreviewLookahead);
+            }
+
+            //step the inline generators: they all see the state just published
+            for (std::vector<ReferenceGenerator*>::const_iterator it = m_inlineReferenceGenerators.begin();
+                 it != m_inlineReferenceGenerators.end(); ++it) {
+                (*it)->step(now);
+            }
+
+            //read references
+            readReferences();
+
             //Check limits
             if (m_checkJointLimits && !jointsInLimitRange()) {
                 yInfo() << "Joint limits reached. Deactivating control";
@@ -235,7 +296,8 @@ namespace codyco {
                 return;
             }
 
-            //compute desired feet forces
+            //compute desired feet forces (only the active contacts are considered)
+            m_desiredContactForces.resize(6 * m_activeContacts.size());
             computeContactForces(m_desiredCOMAcceleration, m_desiredContactForces);
 
             //compute torques
@@ -278,6 +340,7 @@ namespace codyco {
             yarp::os::LockGuard guard(m_mutex);
             if (isActive) {
                 m_desiredCOMAcceleration.setZero(); //reset reference
+                m_referencesGeneration = 0; //force reading the references at the next run
                 //Workaround for the delay of the setControlMode
                 //simulate a control loop to obtain the torques
                 //readReferences();
@@ -322,6 +385,19 @@ namespace codyco {
             return m_torqueSaturationLimit;
         }
 
+        void TorqueBalancingController::setContactForcesOptimization(bool enabled, const ContactForcesOptimizer::Parameters& parameters)
+        {
+            yarp::os::LockGuard guard(m_mutex);
+            m_contactForcesOptimizationEnabled = enabled;
+            m_contactForcesOptimizer.setParameters(parameters);
+        }
+
+        bool TorqueBalancingController::usesContactForcesOptimization()
+        {
+            yarp::os::LockGuard guard(m_mutex);
+            return m_contactForcesOptimizationEnabled;
+        }
+
         void TorqueBalancingController::setDelegate(ControllerDelegate *delegate)
         {
             yarp::os::LockGuard guard(m_mutex);
@@ -332,42 +408,94 @@ namespace codyco {
         bool TorqueBalancingController::setInitialConstraintSet(const std::vector<std::string> &constraintsLinkName)
         {
             if (isRunning()) return false;
-            //TODO: two days before the demo is not the right moment to make the constraints generic.
-            // For now simply accept the l_sole or r_sole constraints.
-            // move everything to something more generic ASAP
+            if (constraintsLinkName.empty() || constraintsLinkName.size() > MaximumContactsCount) {
+                yError("The number of constraints must be between 1 and %d", MaximumContactsCount);
+                return false;
+            }
+
             bool result = true;
-            m_activeConstraints.clear();
+            m_constraints.clear();
+            m_constraints.reserve(constraintsLinkName.size());
             for (std::vector<std::string>::const_iterator it = constraintsLinkName.begin();
                  it != constraintsLinkName.end(); it++) {
-                if ((*it).compare("l_sole") == 0) {
-                    DynamicConstraint leftFoot;
-                    result = result && leftFoot.init(true, getRate() / 1000.0, m_dynamicsTransitionTime);
-                    m_activeConstraints.insert(ConstraintsMap::value_type(*it, leftFoot));
-
-                } else if ((*it).compare("r_sole") == 0) {
-                    DynamicConstraint rightFoot;
-                    result = result && rightFoot.init(true, getRate() / 1000.0, m_dynamicsTransitionTime);
-                    m_activeConstraints.insert(ConstraintsMap::value_type(*it, rightFoot));
+                if (constraintIndex(*it) >= 0) {
+                    yWarning("Constraint %s specified more than once", it->c_str());
+                    continue;
                 }
+                DynamicConstraint constraint(*it);
+                result = result && constraint.init(true, getRate() / 1000.0, m_dynamicsTransitionTime);
+                m_constraints.push_back(constraint);
             }
 
-            return result && m_activeConstraints.size() >= 1 && m_activeConstraints.size() <= 2;
+            //allocate the contact quantities for all the constraints
+            //(the control loop only uses the part corresponding to the active ones)
+            const int contactsCount = m_constraints.size();
+            m_desiredFeetForces.setZero(6 * contactsCount);
+            m_desiredContactForces.setZero(6 * contactsCount);
+            m_contactsPosition.setZero(7, contactsCount);
+            m_contactsJacobian.setZero(6 * contactsCount, m_actuatedDOFs + 6);
+            m_contactsDJacobianDq.setZero(6 * contactsCount);
+            m_activeContacts.clear();
+            m_activeContacts.reserve(contactsCount);
+
+            return result;
+        }
+
+        int TorqueBalancingController::constraintIndex(const std::string& frameName) const
+        {
+            for (size_t i = 0; i < m_constraints.size(); ++i) {
+                if (m_constraints[i].frameName() == frameName) return i;
+            }
+            return -1;
+        }
+
+        bool TorqueBalancingController::setComputationModels(const std::vector<wbi::iWholeBodyModel*>& models)
+        {
+            if (isRunning()) return false;
+            m_computationModels = models;
+            return true;
+        }
+
+        void TorqueBalancingController::setRobotStateSnapshot(RobotStateSnapshot* snapshot)
+        {
+            if (isRunning()) return;
+            m_robotStateSnapshot = snapshot;
+            const int endEffectorsCount = snapshot ? snapshot->endEffectorLinkIDs().size() : 0;
+            m_endEffectorsPose.setZero(7, endEffectorsCount);
+            m_endEffectorsVelocity.setZero(6, endEffectorsCount);
+            m_endEffectorJacobian.setZero(6, m_actuatedDOFs + 6);
+            m_centerOfMassEndEffectorIndex = snapshot ? snapshot->endEffectorIndex(m_centerOfMassLinkID) : -1;
+        }
+
+        void TorqueBalancingController::setInlineReferenceGenerators(const std::vector<ReferenceGenerator*>& generators)
+        {
+            if (isRunning()) return;
+            m_inlineReferenceGenerators = generators;
+        }
+
+        void TorqueBalancingController::setReferencesPreview(bool enabled, ReferenceGenerator* comGenerator, ReferenceGenerator* jointsGenerator, double lookahead)
+        {
+            if (isRunning()) return;
+            m_referencesPreviewEnabled = enabled;
+            m_previewCOMGenerator = comGenerator;
+            m_previewJointsGenerator = jointsGenerator;
+            m_referencesPreviewLookahead = lookahead;
+            const std::vector<std::string>& constraintNames = m_references.preview().constraintNames();
+            m_buffers.previewConstraints.setZero(constraintNames.size());
+            //names are resolved once: the control loop only uses indices
+            m_buffers.previewConstraintsIndices.resize(constraintNames.size());
+            for (size_t i = 0; i < constraintNames.size(); ++i) {
+                m_buffers.previewConstraintsIndices[i] = constraintIndex(constraintNames[i]);
+            }
         }
 
         bool TorqueBalancingController::addDynamicConstraint(std::string frameName, bool /*smooth*/)
         {
-            //For now full jacobians are not written in an "iterative" way.
-            //just hardcode all the possible scenarios. (as in MATLAB version)
-            //This must be changed in the future
-            //            ConstraintsMap::iterator found = m_activeConstraints.find(frameName);
-            //            if (found != m_activeConstraints.end()) return false;
-            //            DynamicContraint constraint(frameName);
-            //            constraint.createMemory();
-            //            m_activeConstraints.insert(ConstraintsMap::value_type(frameName, constraint));
+            //only the constraints specified at initialization can be activated
             yarp::os::LockGuard guard(m_mutex);
-            ConstraintsMap::iterator found = m_activeConstraints.find(frameName);
-            if (found == m_activeConstraints.end()) return false;
-            found->second.activate();
+            int index = constraintIndex(frameName);
+            if (index < 0) return false;
+            m_constraints[index].activate();
 
             return true;
         }
@@ -375,9 +503,9 @@ namespace codyco {
         bool TorqueBalancingController::removeDynamicConstraint(std::string frameName, bool /*smooth*/)
         {
             yarp::os::LockGuard guard(m_mutex);
-            ConstraintsMap::iterator found = m_activeConstraints.find(frameName);
-            if (found == m_activeConstraints.end()) return false;
-            found->second.deactivate();
+            int index = constraintIndex(frameName);
+            if (index < 0) return false;
+            m_constraints[index].deactivate();
 
             return true;
         }
@@ -400,10 +528,48 @@ namespace codyco {
 
         void TorqueBalancingController::readReferences()
         {
-            if (m_references.desiredCOMAcceleration().isValid())
-                m_desiredCOMAcceleration = m_references.desiredCOMAcceleration().value();
-            if (m_references.desiredJointsConfiguration().isValid()) {
-                m_desiredJointsConfiguration = m_references.desiredJointsConfiguration().value();
+            //references are read without waiting for the generators
+            m_references.snapshot(m_referencesSnapshot);
+            if (m_referencesSnapshot.generation == m_referencesGeneration) return; //nothing changed
+            m_referencesGeneration = m_referencesSnapshot.generation;
+
+            if (m_referencesSnapshot.desiredCOMAccelerationValid)
+                m_desiredCOMAcceleration = m_referencesSnapshot.desiredCOMAcceleration;
+            if (m_referencesSnapshot.desiredJointsConfigurationValid) {
+                m_desiredJointsConfiguration = m_referencesSnapshot.desiredJointsConfiguration;
+            }
+        }
+
+        void TorqueBalancingController::readPreviewReferences(double time)
+        {
+            unsigned channels = m_references.preview().sampleAtTime(time, m_buffers.previewCOM, m_buffers.previewJoints, m_buffers.previewConstraints);
+            //the samples are given directly to the generators (not through the references and their delegate,
+            //which are written by the ports threads), so they override the streamed references at each step
+            if ((channels & ReferencePreviewBuffer::ChannelCOM) && m_previewCOMGenerator) {
+                m_buffers.previewCOMPosition = m_buffers.previewCOM.head(3);
+                if (m_previewCOMGenerator->referenceFilter()) {
+                    m_previewCOMGenerator->setSignalReference(m_buffers.previewCOMPosition);
+                } else {
+                    m_buffers.previewCOMVelocity = m_buffers.previewCOM.segment(3, 3);
+                    m_buffers.previewCOMAcceleration = m_buffers.previewCOM.tail(3);
+                    m_previewCOMGenerator->setAllReferences(m_buffers.previewCOMPosition, m_buffers.previewCOMVelocity, m_buffers.previewCOMAcceleration);
+                }
+            }
+            if ((channels & ReferencePreviewBuffer::ChannelJoints) && m_previewJointsGenerator) {
+                m_previewJointsGenerator->setSignalReference(m_buffers.previewJoints);
+            }
+            if (channels & ReferencePreviewBuffer::ChannelConstraints) {
+                for (size_t i = 0; i < m_buffers.previewConstraintsIndices.size(); ++i) {
+                    int index = m_buffers.previewConstraintsIndices[i];
+                    if (index < 0) continue;
+                    DynamicConstraint& constraint = m_constraints[index];
+                    bool active = m_buffers.previewConstraints(i) > 0.5;
+                    if (active && !constraint.isActive()) {
+                        constraint.activate();
+                    } else if (!active && constraint.isActive()) {
+                        constraint.deactivate();
+                    }
+                }
             }
         }
 
@@ -421,7 +587,27 @@ namespace codyco {
 
         bool TorqueBalancingController::updateRobotState()
         {
-            yarp::os::LockGuard guard(dynamic_cast<yarpWbi::yarpWholeBodyInterface*>(&m_robot)->getInterfaceMutex());
+            if (m_modelWorkers.size() == 0) {
+                //the model of the robot interface is shared with the other threads:
+                //keep the lock for all the computations
+                yarp::os::LockGuard guard(dynamic_cast<yarpWbi::yarpWholeBodyInterface*>(&m_robot)->getInterfaceMutex());
+                if (!readRobotState()) return false;
+                computeContactsQuantities(m_robot);
+                computeKinematicsQuantities(m_robot);
+                computeDynamicsQuantities(m_robot);
+                return true;
+            }
+
+            {
+                yarp::os::LockGuard guard(dynamic_cast<yarpWbi::yarpWholeBodyInterface*>(&m_robot)->getInterfaceMutex());
+                if (!readRobotState()) return false;
+            }
+            //the state is now a snapshot: each worker uses its own model
+            return m_modelWorkers.execute(m_modelTasks, 3);
+        }
+
+        bool TorqueBalancingController::readRobotState()
+        {
 #if defined(DEBUG) && defined(EIGEN_RUNTIME_NO_MALLOC)
             Eigen::internal::set_is_malloc_allowed(false);
 #endif
@@ -435,74 +621,74 @@ namespace codyco {
 
             result = result && m_robot.getEstimates(wbi::ESTIMATE_BASE_VEL, m_baseVelocity.data());
 
-            //update jacobians (both feet in one variable)
-            ConstraintsMap::iterator leftFootConstraint = m_activeConstraints.find("l_sole");
-            if (leftFootConstraint != m_activeConstraints.end()) {
-                leftFootConstraint->second.updateStateInterpolation();
-            }
-            ConstraintsMap::iterator rightFootConstraint = m_activeConstraints.find("r_sole");
-            if (rightFootConstraint != m_activeConstraints.end()) {
-                rightFootConstraint->second.updateStateInterpolation();
+            //update constraints status (before the quantities depending on them are computed)
+            m_activeContacts.clear();
+            for (size_t contact = 0; contact < m_constraints.size(); ++contact) {
+                m_constraints[contact].updateStateInterpolation();
+                if (m_constraints[contact].isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
+                    m_activeContacts.push_back(contact);
+                }
             }
 
-            m_contactsJacobian.setZero();
-            if (leftFootConstraint != m_activeConstraints.end()
-                && leftFootConstraint->second.isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
-                m_jacobianTemporary.setZero();
-                m_robot.computeJacobian(m_jointPositions.data(), m_world2BaseFrame, m_leftFootLinkID, m_jacobianTemporary.data());
-                m_jacobianTemporary *= leftFootConstraint->second.continuousValue();
-                m_contactsJacobian.topRows(6) = m_jacobianTemporary;
-            }
-            if (rightFootConstraint != m_activeConstraints.end()
-                && rightFootConstraint->second.isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
-                m_jacobianTemporary.setZero();
-                m_robot.computeJacobian(m_jointPositions.data(), m_world2BaseFrame, m_rightFootLinkID, m_jacobianTemporary.data());
-                m_jacobianTemporary *= rightFootConstraint->second.continuousValue();
-                m_contactsJacobian.bottomRows(6) = m_jacobianTemporary;
+#if defined(DEBUG) && defined(EIGEN_RUNTIME_NO_MALLOC)
+            Eigen::internal::set_is_malloc_allowed(true);
+#endif
+            return result;
+        }
+
+        void TorqueBalancingController::computeContactsQuantities(wbi::iWholeBodyModel& model)
+        {
+            //update jacobians (all the active contacts in one variable, 6 rows for each contact)
+            //inactive contacts are not stacked: single support computes half of the rows
+            for (size_t contact = 0; contact < m_activeContacts.size(); ++contact) {
+                const DynamicConstraint& constraint = m_constraints[m_activeContacts[contact]];
+                //rows of the jacobian are contiguous (row major): the model writes directly in them
+                model.computeJacobian(m_jointPositions.data(), m_world2BaseFrame, constraint.frameID(), m_contactsJacobian.row(6 * contact).data());
+                m_contactsJacobian.middleRows<6>(6 * contact) *= constraint.continuousValue();
+                model.computeDJdq(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), constraint.frameID(), m_contactsDJacobianDq.segment<6>(6 * contact).data());
+                m_contactsDJacobianDq.segment<6>(6 * contact) *= constraint.continuousValue();
             }
+        }
 
+        void TorqueBalancingController::computeKinematicsQuantities(wbi::iWholeBodyModel& model)
+        {
             //update kinematic quantities
-            m_robot.forwardKinematics(m_jointPositions.data(), m_world2BaseFrame, m_centerOfMassLinkID, m_rotoTranslationVector.data());
+            model.forwardKinematics(m_jointPositions.data(), m_world2BaseFrame, m_centerOfMassLinkID, m_rotoTranslationVector.data());
             m_centerOfMassPosition = m_rotoTranslationVector.head<3>();
-            m_robot.forwardKinematics(m_jointPositions.data(), m_world2BaseFrame, m_leftFootLinkID, m_leftFootPosition.data());
-            m_robot.forwardKinematics(m_jointPositions.data(), m_world2BaseFrame, m_rightFootLinkID, m_rightFootPosition.data());
-//            yarp::sig::Vector &v = debugPort.prepare();
-//            v.resize(6+16);
-//            v(0) = m_leftFootPosition(0) - m_centerOfMassPosition(0);
-//            v(1) = m_leftFootPosition(1) - m_centerOfMassPosition(1);
-//            v(2) = m_leftFootPosition(2) - m_centerOfMassPosition(2);
-//            v(3) = m_rightFootPosition(0) - m_centerOfMassPosition(0);
-//            v(4) = m_rightFootPosition(1) - m_centerOfMassPosition(1);
-//            v(5) = m_rightFootPosition(2) - m_centerOfMassPosition(2);
-//            for (int i = 0; i < 16; i++) {
-//                v(6+ i) = m_world2BaseFrameSerialization.data()[i];
-//            }
-//            debugPort.write();
-
-            //update dynamic quantities
-            m_robot.computeMassMatrix(m_jointPositions.data(), m_world2BaseFrame, m_massMatrix.data());
-            m_robot.computeCentroidalMomentum(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), m_centroidalMomentum.data());
-
-            m_contactsDJacobianDq.setZero();
-            if (leftFootConstraint != m_activeConstraints.end()
-                && leftFootConstraint->second.isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
-                m_robot.computeDJdq(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), m_leftFootLinkID, m_contactsDJacobianDq.head(6).data());
-                m_contactsDJacobianDq.head(6) *= leftFootConstraint->second.continuousValue();
+            if (m_robotStateSnapshot) {
+                computeEndEffectorsQuantities(model);
             }
-            if (rightFootConstraint != m_activeConstraints.end()
-                && rightFootConstraint->second.isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
-                m_robot.computeDJdq(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), m_rightFootLinkID, m_contactsDJacobianDq.tail(6).data());
-                m_contactsDJacobianDq.tail(6) *= rightFootConstraint->second.continuousValue();
+            for (size_t contact = 0; contact < m_activeContacts.size(); ++contact) {
+                //columns are contiguous: each column is the position of an active contact
+                model.forwardKinematics(m_jointPositions.data(), m_world2BaseFrame, m_constraints[m_activeContacts[contact]].frameID(), m_contactsPosition.col(contact).data());
             }
 
             //Compute bias forces
-            m_robot.computeGeneralizedBiasForces(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), m_gravityUnitVector, m_generalizedBiasForces.data());
-            m_robot.computeGeneralizedBiasForces(m_jointPositions.data(), m_world2BaseFrame, m_jointsZeroVector.data(), m_esaZeroVector.data(), m_gravityUnitVector, m_gravityBiasTorques.data());
+            model.computeGeneralizedBiasForces(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), m_gravityUnitVector, m_generalizedBiasForces.data());
+            model.computeGeneralizedBiasForces(m_jointPositions.data(), m_world2BaseFrame, m_jointsZeroVector.data(), m_esaZeroVector.data(), m_gravityUnitVector, m_gravityBiasTorques.data());
+        }
 
-#if defined(DEBUG) && defined(EIGEN_RUNTIME_NO_MALLOC)
-            Eigen::internal::set_is_malloc_allowed(true);
-#endif
-            return result;
+        void TorqueBalancingController::computeEndEffectorsQuantities(wbi::iWholeBodyModel& model)
+        {
+            const std::vector<int>& endEffectors = m_robotStateSnapshot->endEffectorLinkIDs();
+            for (size_t endEffector = 0; endEffector < endEffectors.size(); ++endEffector) {
+                if (static_cast<int>(endEffector) == m_centerOfMassEndEffectorIndex) {
+                    //velocity is computed from the centroidal momentum (see run)
+                    m_endEffectorsPose.col(endEffector) = m_rotoTranslationVector;
+                    continue;
+                }
+                model.forwardKinematics(m_jointPositions.data(), m_world2BaseFrame, endEffectors[endEffector], m_endEffectorsPose.col(endEffector).data());
+                model.computeJacobian(m_jointPositions.data(), m_world2BaseFrame, endEffectors[endEffector], m_endEffectorJacobian.data());
+                m_endEffectorsVelocity.col(endEffector).noalias() = m_endEffectorJacobian.leftCols<6>() * m_baseVelocity;
+                m_endEffectorsVelocity.col(endEffector).noalias() += m_endEffectorJacobian.rightCols(m_actuatedDOFs) * m_jointVelocities;
+            }
+        }
+
+        void TorqueBalancingController::computeDynamicsQuantities(wbi::iWholeBodyModel& model)
+        {
+            //update dynamic quantities
+            model.computeMassMatrix(m_jointPositions.data(), m_world2BaseFrame, m_massMatrix.data());
+            model.computeCentroidalMomentum(m_jointPositions.data(), m_world2BaseFrame, m_jointVelocities.data(), m_baseVelocity.data(), m_centroidalMomentum.data());
         }
 
         void TorqueBalancingController::computeContactForces(const Eigen::Ref<Eigen::VectorXd>& desiredCOMAcceleration, Eigen::Ref<Eigen::VectorXd> desiredContactForces)
@@ -514,30 +700,14 @@ namespace codyco {
             double mass = m_massMatrix(0, 0);
             m_gravityForce(2) = -mass * 9.81;
 
-            ConstraintsMap::const_iterator leftFootConstraint = m_activeConstraints.find("l_sole");
-            ConstraintsMap::const_iterator rightFootConstraint = m_activeConstraints.find("r_sole");
-
-            //building centroidalForceMatrix
-            bool leftConstraintIsActive = false;
-            bool rightConstraintIsActive = false;
-
-            m_centroidalForceMatrix.setZero();
-            if (leftFootConstraint != m_activeConstraints.end()
-                && leftFootConstraint->second.isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
-                leftConstraintIsActive = true;
-                m_centroidalForceMatrix.block<3, 3>(0, 0).setIdentity();
-                m_centroidalForceMatrix.block<3, 3>(3, 3).setIdentity();
-                math::skewSymmentricMatrixFrom3DVector(m_leftFootPosition.head<3>() - m_centerOfMassPosition, m_centroidalForceMatrix.block<3, 3>(3, 0));
-                m_centroidalForceMatrix.leftCols(6) *= leftFootConstraint->second.continuousValue();
-            }
-
-            if (rightFootConstraint != m_activeConstraints.end()
-                && rightFootConstraint->second.isActiveWithThreshold(TORQUEBALANCING_STATEACTIVE_THRESHOLD)) {
-                rightConstraintIsActive = true;
-                m_centroidalForceMatrix.block<3, 3>(0, 6).setIdentity();
-                m_centroidalForceMatrix.block<3, 3>(3, 9).setIdentity();
-                math::skewSymmentricMatrixFrom3DVector(m_rightFootPosition.head<3>() - m_centerOfMassPosition, m_centroidalForceMatrix.block<3, 3>(3, 6));
-                m_centroidalForceMatrix.rightCols(6) *= rightFootConstraint->second.continuousValue();
+            //building centroidalForceMatrix (active contacts only)
+            const int activeContactsCount = m_activeContacts.size();
+            m_centroidalForceMatrix.setZero(6, 6 * activeContactsCount);
+            for (int contact = 0; contact < activeContactsCount; ++contact) {
+                m_centroidalForceMatrix.block<3, 3>(0, 6 * contact).setIdentity();
+                m_centroidalForceMatrix.block<3, 3>(3, 6 * contact + 3).setIdentity();
+                math::skewSymmentricMatrixFrom3DVector(m_contactsPosition.col(contact).head<3>() - m_centerOfMassPosition, m_centroidalForceMatrix.block<3, 3>(3, 6 * contact));
+                m_centroidalForceMatrix.middleCols<6>(6 * contact) *= m_constraints[m_activeContacts[contact]].continuousValue();
             }
 
             m_desiredCentroidalMomentum.head<3>() = mass * desiredCOMAcceleration;
@@ -548,23 +718,49 @@ namespace codyco {
             //Becaues it is not stable yet we use the explicit computation of the SVD
             //            m_svdDecompositionOfCentroidalForceMatrix.compute(m_centroidalForceMatrix).solve(m_desiredCentroidalMomentum - m_gravityForce);
             m_buffers.esaVector = m_desiredCentroidalMomentum - m_gravityForce;
-            if (leftConstraintIsActive ^ rightConstraintIsActive) {
-                m_desiredFeetForces.setZero();
+            if (activeContactsCount == 0) {
+                //no contacts: no forces can be applied
+                m_nullSpaceOfCentroidalForceMatrix.resize(0, 0);
+
+            } else if (activeContactsCount == 1) {
                 //substitute the pseudoinverse with its inverse
-                m_luDecompositionOfCentroidalMatrix.compute(m_centroidalForceMatrix.block<6, 6>(0, leftConstraintIsActive ? 0 : 6));
-                m_desiredFeetForces.segment(leftConstraintIsActive ? 0 : 6, 6) = m_luDecompositionOfCentroidalMatrix.solve(m_buffers.esaVector);
-                m_nullSpaceOfCentroidalForceMatrix.setZero();
+                m_luDecompositionOfCentroidalMatrix.compute(m_centroidalForceMatrix.leftCols<6>());
+                desiredContactForces = m_luDecompositionOfCentroidalMatrix.solve(m_buffers.esaVector);
+                m_nullSpaceOfCentroidalForceMatrix.setZero(6, 6);
 
             } else {
-                math::pseudoInverse(m_centroidalForceMatrix, m_svdDecompositionOfCentroidalForceMatrix,
-                                    m_pseudoInverseOfCentroidalForceMatrix, PseudoInverseTolerance);
-                m_desiredFeetForces.noalias() = m_pseudoInverseOfCentroidalForceMatrix * m_buffers.esaVector;
+                m_pseudoInverseOfCentroidalForceMatrix.resize(6 * activeContactsCount, 6);
+                pseudoInverse(m_centroidalForceMatrix, m_svdDecompositionOfCentroidalForceMatrix,
+                              m_pseudoInverseOfCentroidalForceMatrix, PseudoInverseTolerance);
+                desiredContactForces.noalias() = m_pseudoInverseOfCentroidalForceMatrix * m_buffers.esaVector;
 
                 //TODO: change the following line by using the null space basis obtained by the pseudoinverse method
-                m_nullSpaceOfCentroidalForceMatrix.setIdentity();
-                m_nullSpaceOfCentroidalForceMatrix -= m_pseudoInverseOfCentroidalForceMatrix * m_centroidalForceMatrix;
+                m_nullSpaceOfCentroidalForceMatrix.setIdentity(6 * activeContactsCount, 6 * activeContactsCount);
+                m_nullSpaceOfCentroidalForceMatrix.noalias() -= m_pseudoInverseOfCentroidalForceMatrix * m_centroidalForceMatrix;
+            }
+
+            if (m_contactForcesOptimizationEnabled && activeContactsCount > 0) {
+                //contacts orientation is given as axis-angle
+                m_buffers.contactsRotation.resize(3, 3 * activeContactsCount);
+                for (int contact = 0; contact < activeContactsCount; ++contact) {
+                    m_buffers.contactsRotation.middleCols<3>(3 * contact) = AngleAxisd(m_contactsPosition(6, contact), m_contactsPosition.col(contact).segment<3>(3)).toRotationMatrix();
+                }
+                //the analytic solution is used as initial guess and as fallback
+                if (m_contactForcesOptimizer.solve(m_centroidalForceMatrix, m_buffers.esaVector,
+                                                   m_buffers.contactsRotation, desiredContactForces)) {
+                    //forces already satisfy the contact constraints:
+                    //they must not be redistributed in the null space of the centroidal force matrix
+                    m_nullSpaceOfCentroidalForceMatrix.setZero();
+                } else {
+                    m_contactForcesOptimizerFallbacks++;
+                }
+            }
+
+            //monitored forces are ordered as the constraints
+            m_desiredFeetForces.setZero();
+            for (int contact = 0; contact < activeContactsCount; ++contact) {
+                m_desiredFeetForces.segment<6>(6 * m_activeContacts[contact]) = desiredContactForces.segment<6>(6 * contact);
             }
-            desiredContactForces = m_desiredFeetForces;
 #if defined(DEBUG) && defined(EIGEN_RUNTIME_NO_MALLOC)
             Eigen::internal::set_is_malloc_allowed(true);
 #endif
@@ -578,74 +774,15 @@ namespace codyco {
             Eigen::internal::set_is_malloc_allowed(false);
 #endif
 
-            //Names are taken from "math" from brevity
-            MatrixXd JcMInv = m_contactsJacobian * m_massMatrix.inverse(); //to become instance (?)
-            MatrixXd JcMInvJct = JcMInv * m_contactsJacobian.transpose(); //to become instance (?)
-            MatrixXd JcMInvTorqueSelector = JcMInv * m_torquesSelector; //to become instance (?)
-            MatrixXd jointProjectedBaseAccelerations = m_massMatrix.block(6, 0, m_actuatedDOFs, 6) * m_massMatrix.topLeftCorner<6, 6>().inverse();
-
-            math::dampedPseudoInverse(JcMInvTorqueSelector, m_svdDecompositionOfJcMInvSt, m_pseudoInverseOfJcMInvSt,
-                                      PseudoInverseTolerance,
-                                      JcMInvSPseudoInverseDampingTerm);
-            math::pseudoInverse(JcMInvTorqueSelector, m_svdDecompositionOfJcMInvSt,
-                                m_pseudoInverseOfJcMInvSt, PseudoInverseTolerance);
-            //TODO: change the following line by using the null space basis obtained by the pseudoinverse method
-            MatrixXd JcNullSpaceProjector = MatrixXd::Identity(m_actuatedDOFs, m_actuatedDOFs) - m_pseudoInverseOfJcMInvSt * JcMInvTorqueSelector;
-
-            MatrixXd mult_f_tau0 =  jointProjectedBaseAccelerations * m_contactsJacobian.leftCols(6).transpose() - m_contactsJacobian.rightCols(m_actuatedDOFs).transpose();
-
-            VectorXd  torques0 =  m_gravityBiasTorques.tail(m_actuatedDOFs) - m_impedanceGains.asDiagonal() * (m_jointPositions - m_desiredJointsConfiguration) - jointProjectedBaseAccelerations * m_generalizedBiasForces.head<6>();
-
-            MatrixXd mult_f_tau = -m_pseudoInverseOfJcMInvSt * JcMInvJct + JcNullSpaceProjector * mult_f_tau0;
-
-            VectorXd n_tau = m_pseudoInverseOfJcMInvSt * (JcMInv * m_generalizedBiasForces - m_contactsDJacobianDq) + JcNullSpaceProjector * torques0;
-
-            //TODO: change the following line by using the null space basis obtained by the pseudoinverse method
-//            MatrixXd forceMatrixNullSpaceProjector = MatrixXd::Identity(12, 12) - m_pseudoInverseOfCentroidalForceMatrix * m_centroidalForceMatrix;
-
-            MatrixXd mat = mult_f_tau * m_nullSpaceOfCentroidalForceMatrix;
-
-            math::pseudoInverse(mult_f_tau * m_nullSpaceOfCentroidalForceMatrix, m_svdDecompositionOfTauN0_f,m_pseudoInverseOfTauN0_f, PseudoInverseTolerance, Eigen::ComputeFullV|Eigen::ComputeFullU);
-
-            torques = (MatrixXd::Identity(n_tau.size(), n_tau.size()) -mult_f_tau * m_nullSpaceOfCentroidalForceMatrix * m_pseudoInverseOfTauN0_f) * (n_tau + mult_f_tau * desiredContactForces);
-
-//            m_buffers.totalDoFsLDLTDecomposition.compute(m_massMatrix);
-//            Eigen::internal::solve_retval<LDLT<MatrixXd::PlainObject>, MatrixXd> var =
-//            m_buffers.totalDoFsLDLTDecomposition.solve(m_buffers.totalDoFsIdentity);
-//            m_buffers.totalDoFsTimesTotalDoFs = var.rhs();
-//
-//            m_buffers.twelveTimesTotalDoFs.noalias() = m_contactsJacobian * m_buffers.totalDoFsTimesTotalDoFs;
-//            m_buffers.twelveTimesTwelve.noalias() = m_buffers.twelveTimesTotalDoFs * m_contactsJacobian.transpose();
-//            m_buffers.sixTimesSix.noalias() = m_massMatrix.topLeftCorner<6, 6>().inverse();
-//            m_buffers.twelveTimesDoFs.noalias() = m_buffers.twelveTimesTotalDoFs * m_torquesSelector;
-//            m_buffers.dofsTimesSix.noalias() = m_massMatrix.block(6, 0, m_actuatedDOFs, 6) * m_buffers.sixTimesSix; //* m_massMatrix.topLeftCorner<6, 6>().inverse();
-//
-//            math::dampedPseudoInverse(m_buffers.twelveTimesDoFs, m_svdDecompositionOfJcMInvSt, m_pseudoInverseOfJcMInvSt,
-//                                      PseudoInverseTolerance,
-//                                      JcMInvSPseudoInverseDampingTerm);
-//            math::pseudoInverse(m_buffers.twelveTimesDoFs, m_svdDecompositionOfJcMInvSt,
-//                                m_pseudoInverseOfJcMInvSt, PseudoInverseTolerance);
-//            //TODO: change the following line by using the null space basis obtained by the pseudoinverse method
-//
-//            m_nullSpaceProjectorOfJcMInvSt.setIdentity();
-//            m_nullSpaceProjectorOfJcMInvSt/*.noalias()*/ -= m_pseudoInverseOfJcMInvSt * m_buffers.twelveTimesDoFs;
-//
-//
-//            MatrixXd mult_f_tau0 =  m_buffers.dofsTimesSix * m_contactsJacobian.leftCols(6).transpose() - m_contactsJacobian.rightCols(m_actuatedDOFs).transpose();
-//
-//            m_buffers.jointsVector =  m_gravityBiasTorques.tail(m_actuatedDOFs) - m_impedanceGains.asDiagonal() * (m_jointPositions - m_desiredJointsConfiguration) - m_buffers.dofsTimesSix * m_generalizedBiasForces.head<6>();
-//
-//            MatrixXd mult_f_tau = -m_pseudoInverseOfJcMInvSt * m_buffers.twelveTimesTwelve + m_nullSpaceProjectorOfJcMInvSt * mult_f_tau0;
-//
-//            m_buffers.jointsVector2 = m_pseudoInverseOfJcMInvSt * m_buffers.twelveTimesTotalDoFs * m_generalizedBiasForces;
-//            m_buffers.jointsVector2 -= m_pseudoInverseOfJcMInvSt * m_contactsDJacobianDq;
-//            m_buffers.jointsVector2 += m_nullSpaceProjectorOfJcMInvSt * m_buffers.jointsVector;
-//
-//            math::pseudoInverse(mult_f_tau * m_nullSpaceOfCentroidalForceMatrix, m_svdDecompositionOfTauN0_f,m_pseudoInverseOfTauN0_f, PseudoInverseTolerance, Eigen::ComputeFullV|Eigen::ComputeFullU);
-//
-//            m_buffers.dofsTimesDoFs.setIdentity();
-//
-//            torques = (m_buffers.dofsTimesDoFs - mult_f_tau * m_nullSpaceOfCentroidalForceMatrix * m_pseudoInverseOfTauN0_f) * (m_buffers.jointsVector2 + mult_f_tau * desiredContactForces);
+            //postural task: gravity compensation and impedance
+            m_buffers.jointsVector = m_gravityBiasTorques.tail(m_actuatedDOFs) - m_impedanceGains.asDiagonal() * (m_jointPositions - m_desiredJointsConfiguration);
+
+            //only the rows of the active contacts are passed: the solver sizes itself on them
+            const int activeContactsSize = 6 * m_activeContacts.size();
+            m_solver->computeTorques(m_massMatrix, m_contactsJacobian.topRows(activeContactsSize),
+                                     m_contactsDJacobianDq.head(activeContactsSize),
+                                     m_generalizedBiasForces, m_buffers.jointsVector,
+                                     m_nullSpaceOfCentroidalForceMatrix, desiredContactForces, torques);
 
             //apply saturation
             //TODO: this must be checked: valgrind says it contains a jump on an unitialized variable
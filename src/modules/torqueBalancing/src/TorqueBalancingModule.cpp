@@ -18,12 +18,14 @@
 #include "config.h"
 #include "TorqueBalancingController.h"
 #include "Reference.h"
+#include "RobotStateSnapshot.h"
 #include "ReferenceGenerator.h"
 #include "ReferenceGeneratorInputReaderImpl.h"
 #include "MinimumJerkTrajectoryGenerator.h"
 #include "ParamHelperConfig.h"
 
 #include <yarpWholeBodyInterface/yarpWholeBodyInterface.h>
+#include <yarpWholeBodyInterface/yarpWholeBodyModel.h>
 #include <paramHelp/paramHelperServer.h>
 #include <codyco/ModelParsing.h>
 #include <codyco/Utils.h>
@@ -32,6 +34,7 @@
 #include <yarp/os/LogStream.h>
 #include <yarp/os/LockGuard.h>
 #include <yarp/dev/ControlBoardPid.h>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -59,6 +62,7 @@ namespace codyco {
         , m_robot(0)
         , m_controller(0)
         , m_references(0)
+        , m_robotStateSnapshot(0)
         , m_rpcPort(0)
         , m_constraintsPort(0)
         , m_paramHelperManager(0)
@@ -112,6 +116,49 @@ namespace codyco {
             Value falseValue;
             falseValue.fromString("false");
             bool autoStart = rf.check("autostart", falseValue, "Looking for autostart option").asBool();
+            int modelWorkers = rf.check("model_workers", Value(0), "Looking for number of model computation workers").asInt();
+            bool inlineReferences = rf.check("inline_references", falseValue, "Looking for inline reference generation option").asBool();
+
+            //Check contact forces optimisation parameters
+            //Structure is: group [contact_forces_qp] with keys
+            //              enabled, friction, torsional_friction, min_normal_force,
+            //              cop_x (min max), cop_y (min max), regularization,
+            //              time_budget (seconds), max_iterations
+            bool contactForcesOptimization = false;
+            ContactForcesOptimizer::Parameters contactForcesOptimizerParameters;
+            Bottle &contactForcesOptimizerGroup = rf.findGroup("contact_forces_qp");
+            if (!contactForcesOptimizerGroup.isNull()) {
+                contactForcesOptimization = contactForcesOptimizerGroup.check("enabled", trueValue).asBool();
+                contactForcesOptimizerParameters.staticFrictionCoefficient = contactForcesOptimizerGroup.check("friction", Value(contactForcesOptimizerParameters.staticFrictionCoefficient)).asDouble();
+                contactForcesOptimizerParameters.torsionalFrictionCoefficient = contactForcesOptimizerGroup.check("torsional_friction", Value(contactForcesOptimizerParameters.torsionalFrictionCoefficient)).asDouble();
+                contactForcesOptimizerParameters.minimumNormalForce = contactForcesOptimizerGroup.check("min_normal_force", Value(contactForcesOptimizerParameters.minimumNormalForce)).asDouble();
+                contactForcesOptimizerParameters.regularization = contactForcesOptimizerGroup.check("regularization", Value(contactForcesOptimizerParameters.regularization)).asDouble();
+                contactForcesOptimizerParameters.timeBudget = contactForcesOptimizerGroup.check("time_budget", Value(contactForcesOptimizerParameters.timeBudget)).asDouble();
+                contactForcesOptimizerParameters.maximumIterations = contactForcesOptimizerGroup.check("max_iterations", Value(contactForcesOptimizerParameters.maximumIterations)).asInt();
+                Bottle *copLimits = contactForcesOptimizerGroup.find("cop_x").asList();
+                if (copLimits && copLimits->size() == 2) {
+                    contactForcesOptimizerParameters.footSizeX[0] = copLimits->get(0).asDouble();
+                    contactForcesOptimizerParameters.footSizeX[1] = copLimits->get(1).asDouble();
+                }
+                copLimits = contactForcesOptimizerGroup.find("cop_y").asList();
+                if (copLimits && copLimits->size() == 2) {
+                    contactForcesOptimizerParameters.footSizeY[0] = copLimits->get(0).asDouble();
+                    contactForcesOptimizerParameters.footSizeY[1] = copLimits->get(1).asDouble();
+                }
+            }
+
+            //Check references preview parameters
+            //Structure is: group [references_preview] with keys
+            //              enabled, capacity (number of samples), lookahead (seconds)
+            bool referencesPreview = false;
+            int referencesPreviewCapacity = 1000;
+            double referencesPreviewLookahead = 0;
+            Bottle &referencesPreviewGroup = rf.findGroup("references_preview");
+            if (!referencesPreviewGroup.isNull()) {
+                referencesPreview = referencesPreviewGroup.check("enabled", trueValue).asBool();
+                referencesPreviewCapacity = referencesPreviewGroup.check("capacity", Value(referencesPreviewCapacity)).asInt();
+                referencesPreviewLookahead = referencesPreviewGroup.check("lookahead", Value(referencesPreviewLookahead)).asDouble();
+            }
 
             //Check smooth parameter
             //Structure is: key: smooth
@@ -164,10 +211,32 @@ namespace codyco {
                 }
             }
 
+            //Read initial constraints for the controller
+            std::vector<std::string> constraintsLinkName;
+            if (rf.check("constraint_links", "Checking rigid constraints")) {
+                Bottle &constraints = rf.findGroup("constraint_links");
+                if (constraints.size() == 2) {
+                    Bottle *list = constraints.get(1).asList();
+                    if (list) {
+                        for (int i = 0; i < list->size(); i++) {
+                            Value &linkName = list->get(i);
+                            if (linkName.isString())
+                                constraintsLinkName.push_back(linkName.asString());
+                        }
+                    }
+                }
+            }
+
+            //Default case: two feet balancing (back compatibily)
+            if (constraintsLinkName.empty()) {
+                constraintsLinkName.push_back("l_sole");
+                constraintsLinkName.push_back("r_sole");
+            }
+
             //PARAMETERS SECTION
             //Creating parameter server helper
             //link controller and references variables to param helper manager
-            m_paramHelperManager = new ParamHelperManager(*this, actuatedDOFs);
+            m_paramHelperManager = new ParamHelperManager(*this, actuatedDOFs, constraintsLinkName.size());
             if (!m_paramHelperManager || !m_paramHelperManager->init(rf)) {
                 yError("Could not initialize parameter helper.");
                 return false;
@@ -204,6 +273,8 @@ namespace codyco {
                 yError("Could not create shared references object.");
                 return false;
             }
+            m_receivedCOMReference.resize(m_references->desiredCOM().valueSize());
+            m_receivedJointsReference.resize(m_references->desiredJointsPosition().valueSize());
 
             //Setup streaming
             if (!m_references->desiredCOM().setUpReaderPort(("/" + getName("/comDes:i")))) {
@@ -231,6 +302,19 @@ namespace codyco {
                 return false;
             }
 
+            //create the private models used by the controller to compute the model quantities concurrently
+            for (int i = 0; i < modelWorkers; ++i) {
+                std::ostringstream modelName;
+                modelName << m_moduleName << "_model" << i;
+                yarpWbi::yarpWholeBodyModel *model = new yarpWbi::yarpWholeBodyModel(modelName.str().c_str(), wbiProperties);
+                m_computationModels.push_back(model);
+                model->addJoints(iCubMainJoints);
+                if (!model->init()) {
+                    yError("Could not initialize model for computation worker %d.", i);
+                    return false;
+                }
+            }
+
             //check torque gains after init
             m_defaultTorquePIDsKey = rf.check("defaultTorqueGainsKey", Value::getNullValue(), "Checking default PIDs set");
             if (rf.check("torqueGains", "Looking for torque gains section")) {
@@ -274,7 +358,9 @@ namespace codyco {
             ReferenceGenerator* generator = 0;
 
             //COM task
-            reader = new COMReader(*m_robot, actuatedDOFs);
+            //the COM is read from the state published by the controller (if recent, i.e. the controller is running)
+            m_robotStateSnapshot = new RobotStateSnapshot(std::vector<int>(1, wbi::wholeBodyInterface::COM_LINK_ID));
+            reader = new COMReader(*m_robot, actuatedDOFs, *m_robotStateSnapshot, 2 * m_controllerThreadPeriod / 1000.0);
             if (reader) {
                 m_generatorReaders.insert(std::pair<TaskType, ReferenceGeneratorInputReader*>(TaskTypeCOM, reader));
             } else {
@@ -332,6 +418,17 @@ namespace codyco {
             }
             m_controller->setDelegate(this);
             m_controller->setCheckJointLimits(checkJointLimits);
+            m_controller->setContactForcesOptimization(contactForcesOptimization, contactForcesOptimizerParameters);
+            m_controller->setComputationModels(m_computationModels);
+            m_controller->setRobotStateSnapshot(m_robotStateSnapshot);
+            if (inlineReferences) {
+                //generators are stepped by the controller: COM first, then joints
+                yInfo() << "Reference generators are stepped inside the controller loop";
+                std::vector<ReferenceGenerator*> inlineGenerators;
+                inlineGenerators.push_back(m_referenceGenerators[TaskTypeCOM]);
+                inlineGenerators.push_back(m_referenceGenerators[TaskTypeImpedanceControl]);
+                m_controller->setInlineReferenceGenerators(inlineGenerators);
+            }
 
             //link controller and references variables to param helper manager
             if (!m_paramHelperManager->linkVariables()
@@ -341,38 +438,30 @@ namespace codyco {
                 return false;
             }
 
-            //Read initial constraints for the controller
-            std::vector<std::string> constraintsLinkName;
-            if (rf.check("constraint_links", "Checking rigid constraints")) {
-                Bottle &constraints = rf.findGroup("constraint_links");
-                if (constraints.size() == 2) {
-                    Bottle *list = constraints.get(1).asList();
-                    if (list) {
-                        for (int i = 0; i < list->size(); i++) {
-                            Value &linkName = list->get(i);
-                            if (linkName.isString())
-                                constraintsLinkName.push_back(linkName.asString());
-                        }
-                    }
-                }
-            }
-
-            //Default case: two feet balancing (back compatibily)
-            if (constraintsLinkName.empty()) {
-                constraintsLinkName.push_back("l_sole");
-                constraintsLinkName.push_back("r_sole");
-            }
+            //Constraints for the controller have been read with the parameters
             if (!m_controller->setInitialConstraintSet(constraintsLinkName)) {
                 yError("Could not set initial dynamic constraints.");
                 return false;
             }
 
+            if (referencesPreview) {
+                yInfo() << "References preview is ENABLED with look-ahead " << referencesPreviewLookahead;
+                if (!m_references->preview().configure(referencesPreviewCapacity, constraintsLinkName)
+                    || !m_references->preview().setUpReaderPort(("/" + getName("/preview:i")))) {
+                    yError("References preview port failed to start.");
+                    return false;
+                }
+                m_controller->setReferencesPreview(true, m_referenceGenerators[TaskTypeCOM], m_referenceGenerators[TaskTypeImpedanceControl], referencesPreviewLookahead);
+            }
+
             //start threads. Controllers start always in inactive state
             //This is needed because they have to be initialized before setting gains, etc..
             bool threadsStarted = true;
 
-            for (std::map<TaskType, ReferenceGenerator*>::iterator it = m_referenceGenerators.begin(); it != m_referenceGenerators.end(); it++) {
-                threadsStarted = threadsStarted && it->second->start();
+            if (!inlineReferences) {
+                for (std::map<TaskType, ReferenceGenerator*>::iterator it = m_referenceGenerators.begin(); it != m_referenceGenerators.end(); it++) {
+                    threadsStarted = threadsStarted && it->second->start();
+                }
             }
             threadsStarted = threadsStarted && m_controller->start();
 
@@ -477,6 +566,17 @@ namespace codyco {
             m_generatorReaders.clear();
 
             //clear the other variables
+            if (m_robotStateSnapshot) {
+                delete m_robotStateSnapshot;
+                m_robotStateSnapshot = 0;
+            }
+
+            for (std::vector<wbi::iWholeBodyModel*>::iterator it = m_computationModels.begin(); it != m_computationModels.end(); it++) {
+                (*it)->close();
+                delete *it;
+            }
+            m_computationModels.clear();
+
             if (m_robot) {
                 m_robot->close();
                 delete m_robot;
@@ -488,6 +588,7 @@ namespace codyco {
                 m_references->desiredJointsPosition().removeDelegate(this);
                 m_references->desiredCOM().tearDownReaderPort();
                 m_references->desiredJointsPosition().tearDownReaderPort();
+                m_references->preview().tearDownReaderPort();
 
                 delete m_references;
                 m_references = 0;
@@ -503,19 +604,21 @@ namespace codyco {
                 taskType = TaskTypeCOM;
                 std::map<TaskType, ReferenceGenerator*>::iterator found = m_referenceGenerators.find(taskType);
                 if (found != m_referenceGenerators.end()) {
-                    const Eigen::VectorXd &newReference = reference.value();
+                    //copy the value, as the buffer of the reference can be reused by the writers
+                    reference.read(m_receivedCOMReference);
                     //check if smoother is active.
                     if (found->second->referenceFilter()) {
-                        found->second->setSignalReference(newReference.head(3));
+                        found->second->setSignalReference(m_receivedCOMReference.head(3));
                     } else {
-                        found->second->setAllReferences(newReference.head(3), newReference.segment(3, 3), newReference.tail(3));
+                        found->second->setAllReferences(m_receivedCOMReference.head(3), m_receivedCOMReference.segment(3, 3), m_receivedCOMReference.tail(3));
                     }
                 }
             } else if (&reference == &m_references->desiredJointsPosition()) {
                 taskType = TaskTypeImpedanceControl;
                 std::map<TaskType, ReferenceGenerator*>::iterator found = m_referenceGenerators.find(taskType);
                 if (found != m_referenceGenerators.end()) {
-                    found->second->setSignalReference(reference.value());
+                    reference.read(m_receivedJointsReference);
+                    found->second->setSignalReference(m_receivedJointsReference);
                 }
             } else return;
         }
@@ -583,6 +686,7 @@ namespace codyco {
             //When the control switch from inactive to active
             //it should discard all previous references: the robot should stay still
             if (isActive) {
+                m_references->preview().clear();
                 yarp::os::LockGuard guard(dynamic_cast<yarpWbi::yarpWholeBodyInterface*>(m_robot)->getInterfaceMutex());
                 m_robot->getEstimates(wbi::ESTIMATE_JOINT_POS, m_jointsConfiguration.data());
                 wbi::Frame frame;
@@ -757,7 +861,7 @@ namespace codyco {
 
 #pragma mark - ParamHelperManager methods
 
-        TorqueBalancingModule::ParamHelperManager::ParamHelperManager(TorqueBalancingModule& module, int actuatedDOFs)
+        TorqueBalancingModule::ParamHelperManager::ParamHelperManager(TorqueBalancingModule& module, int actuatedDOFs, int contactsCount)
         : m_module(module)
         , m_initialized(false)
         , m_parameterServer(0)
@@ -771,7 +875,7 @@ namespace codyco {
         , m_monitoredDesiredCOMAcceleration(3)
         , m_monitoredCOMError(3)
         , m_monitoredCOMIntegralError(3)
-        , m_monitoredFeetForces(12)
+        , m_monitoredFeetForces(6 * contactsCount)
         , m_monitoredOutputTorques(actuatedDOFs)
         , m_monitoredDesiredCOM(3)
         , m_monitoredMeasuredCOM(3)
@@ -782,6 +886,8 @@ namespace codyco {
             TorqueBalancingModuleParameterDescriptions[TorqueBalancingModuleParameterSize - 3]->size = newSize;
             TorqueBalancingModuleParameterDescriptions[TorqueBalancingModuleParameterSize - 2]->size = newSize;
             TorqueBalancingModuleParameterDescriptions[TorqueBalancingModuleParameterSize - 1]->size = newSize;
+            //one wrench for each of the contacts specified at initialization
+            TorqueBalancingModuleParameterDescriptions[TorqueBalancingModuleParameterMonitorFeetForces]->size = paramHelp::ParamSize(6 * contactsCount, false);
         }
 
         TorqueBalancingModule::ParamHelperManager::~ParamHelperManager()
@@ -914,7 +1020,12 @@ namespace codyco {
                 m_monitoredDesiredCOM = comGenerator->actualReference();
                 m_monitoredMeasuredCOM = comGenerator->inputReader().getSignal().segment<3>(0);
             }
-            m_monitoredFeetForces = m_module.m_controller->desiredFeetForces();
+            //the monitored vector is linked to the parameter server: its size must not change
+            //(it is sized on the contacts specified at initialization, duplicates excluded by the controller)
+            const Eigen::VectorXd& desiredFeetForces = m_module.m_controller->desiredFeetForces();
+            int monitoredForcesSize = std::min<int>(m_monitoredFeetForces.size(), desiredFeetForces.size());
+            m_monitoredFeetForces.setZero();
+            m_monitoredFeetForces.head(monitoredForcesSize) = desiredFeetForces.head(monitoredForcesSize);
             m_monitoredOutputTorques = m_module.m_controller->outputTorques();
 
             //send variables
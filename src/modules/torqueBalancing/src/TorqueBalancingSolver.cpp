@@ -0,0 +1,205 @@
+/**
+ * Copyright (C) 2016 CoDyCo
+ * @author: Francesco Romano
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "TorqueBalancingSolver.h"
+#include "PseudoInverse.h"
+#include "config.h"
+
+#include <Eigen/Cholesky>
+#include <Eigen/SVD>
+
+namespace codyco {
+    namespace torquebalancing {
+
+        TorqueBalancingSolver::~TorqueBalancingSolver() {}
+
+        /** Implementation of the torque solver for a given number of actuated DoFs.
+         *
+         * If ActuatedDOFs is Eigen::Dynamic all the buffers are dynamically sized
+         * (and allocated again only when the number of contacts changes).
+         * Otherwise all the matrices are fixed-size, or have a fixed maximum size
+         * along the contacts dimension (MaximumContactsCount contacts).
+         *
+         * The inverse of the mass matrix is never formed explicitly: every product
+         * with M^-1 is obtained by solving with the LDLT factorisation of M.
+         */
+        template <int ActuatedDOFs>
+        class TorqueBalancingSolverImpl : public TorqueBalancingSolver {
+        public:
+            enum {
+                TotalDOFs = ActuatedDOFs == Eigen::Dynamic ? Eigen::Dynamic : ActuatedDOFs + 6,
+                MaxContactsSize = 6 * MaximumContactsCount
+            };
+
+            typedef Eigen::Matrix<double, TotalDOFs, TotalDOFs> MassMatrixType;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, TotalDOFs, Eigen::RowMajor, MaxContactsSize, TotalDOFs> ContactsJacobianType;
+            typedef Eigen::Matrix<double, TotalDOFs, 1> TotalDOFsVectorType;
+            typedef Eigen::Matrix<double, ActuatedDOFs, 1> JointsVectorType;
+
+        private:
+            const int m_actuatedDOFs;
+
+            Eigen::LDLT<MassMatrixType> m_massMatrixDecomposition; /*!< factorisation of M */
+            Eigen::LLT<Eigen::Matrix<double, 6, 6> > m_baseMassMatrixDecomposition; /*!< factorisation of M_bb (base block of M) */
+
+            //matrices with a contacts dimension (6 x number of contacts)
+            typedef Eigen::Matrix<double, TotalDOFs, Eigen::Dynamic, 0, TotalDOFs, MaxContactsSize> TotalDOFsTimesContactsType;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MaxContactsSize, MaxContactsSize> ContactsTimesContactsType;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, ActuatedDOFs, 0, MaxContactsSize, ActuatedDOFs> ContactsTimesJointsType;
+            typedef Eigen::Matrix<double, ActuatedDOFs, Eigen::Dynamic, 0, ActuatedDOFs, MaxContactsSize> JointsTimesContactsType;
+            typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MaxContactsSize, 1> ContactsVectorType;
+
+            TotalDOFsTimesContactsType m_massMatrixInverseTimesJacobianTransposed; /*!< M^-1 Jc^T */
+            ContactsTimesContactsType m_JcMInvJct; /*!< Jc M^-1 Jc^T */
+            ContactsTimesContactsType m_contactsTimesContacts;
+            ContactsTimesJointsType m_JcMInvS; /*!< Jc M^-1 S^T */
+            Eigen::Matrix<double, 6, ActuatedDOFs> m_baseProjectedJointsMass; /*!< M_bb^-1 M_bj */
+            JointsTimesContactsType m_multFTau; /*!< mult_f_tau */
+            JointsTimesContactsType m_multFTauNullSpace; /*!< mult_f_tau N_f */
+            JointsTimesContactsType m_pseudoInverseOfJcMInvS;
+            ContactsTimesJointsType m_pseudoInverseOfMultFTauNullSpace;
+            Eigen::JacobiSVD<ContactsTimesJointsType> m_svdDecompositionOfJcMInvS;
+            Eigen::JacobiSVD<JointsTimesContactsType> m_svdDecompositionOfMultFTauNullSpace;
+
+            JointsVectorType m_jointsVector;
+            ContactsVectorType m_contactsVector;
+
+            /** Resizes the buffers depending on the number of contacts
+             */
+            void resizeContactsBuffers(int contactsSize)
+            {
+                const int totalDOFs = m_actuatedDOFs + 6;
+                m_massMatrixInverseTimesJacobianTransposed.resize(totalDOFs, contactsSize);
+                m_JcMInvJct.resize(contactsSize, contactsSize);
+                m_contactsTimesContacts.resize(contactsSize, contactsSize);
+                m_JcMInvS.resize(contactsSize, m_actuatedDOFs);
+                m_multFTau.resize(m_actuatedDOFs, contactsSize);
+                m_multFTauNullSpace.resize(m_actuatedDOFs, contactsSize);
+                m_pseudoInverseOfJcMInvS.resize(m_actuatedDOFs, contactsSize);
+                m_pseudoInverseOfMultFTauNullSpace.resize(contactsSize, m_actuatedDOFs);
+                m_contactsVector.resize(contactsSize);
+            }
+
+        public:
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+            explicit TorqueBalancingSolverImpl(int actuatedDOFs)
+            : m_actuatedDOFs(actuatedDOFs)
+            , m_massMatrixDecomposition(actuatedDOFs + 6)
+            , m_baseProjectedJointsMass(6, actuatedDOFs)
+            //buffers are initially allocated for two contacts (the feet)
+            , m_svdDecompositionOfJcMInvS(12, actuatedDOFs, Eigen::ComputeFullU | Eigen::ComputeFullV)
+            , m_svdDecompositionOfMultFTauNullSpace(actuatedDOFs, 12, Eigen::ComputeFullU | Eigen::ComputeFullV)
+            , m_jointsVector(actuatedDOFs)
+            {
+                resizeContactsBuffers(12);
+            }
+
+            virtual int actuatedDOFs() const { return m_actuatedDOFs; }
+
+            virtual bool isFixedSize() const { return ActuatedDOFs != Eigen::Dynamic; }
+
+            virtual void computeTorques(const Eigen::MatrixXd& massMatrixIn,
+                                        const Eigen::Ref<const JacobianMatrix>& contactsJacobianIn,
+                                        const Eigen::Ref<const Eigen::VectorXd>& contactsDJacobianDq,
+                                        const Eigen::VectorXd& generalizedBiasForcesIn,
+                                        const Eigen::VectorXd& posturalTorquesIn,
+                                        const Eigen::Ref<const Eigen::MatrixXd>& nullSpaceOfCentroidalForceMatrix,
+                                        const Eigen::Ref<const Eigen::VectorXd>& desiredContactForces,
+                                        Eigen::Ref<Eigen::VectorXd> torques)
+            {
+                if (contactsJacobianIn.rows() != m_JcMInvJct.rows()) {
+                    resizeContactsBuffers(contactsJacobianIn.rows());
+                }
+
+                //Map the (dynamically sized) input to the size known at compile time
+                Eigen::Map<const MassMatrixType> massMatrix(massMatrixIn.data(), massMatrixIn.rows(), massMatrixIn.cols());
+                Eigen::Map<const ContactsJacobianType, 0, Eigen::OuterStride<> > contactsJacobian(contactsJacobianIn.data(), contactsJacobianIn.rows(), contactsJacobianIn.cols(),
+                                                                                                  Eigen::OuterStride<>(contactsJacobianIn.outerStride()));
+                Eigen::Map<const TotalDOFsVectorType> generalizedBiasForces(generalizedBiasForcesIn.data(), generalizedBiasForcesIn.size());
+                Eigen::Map<const JointsVectorType> posturalTorques(posturalTorquesIn.data(), posturalTorquesIn.size());
+
+                //Names are taken from "math" from brevity
+                //jointProjectedBaseAccelerations = M_jb M_bb^-1 = (M_bb^-1 M_bj)^T
+                m_baseMassMatrixDecomposition.compute(massMatrix.template topLeftCorner<6, 6>());
+                m_baseProjectedJointsMass = m_baseMassMatrixDecomposition.solve(massMatrix.topRightCorner(6, m_actuatedDOFs));
+
+                //torques0 = g_j - K_imp (q - q_des) - M_jb M_bb^-1 h_b
+                m_jointsVector = posturalTorques;
+                m_jointsVector.noalias() -= m_baseProjectedJointsMass.transpose() * generalizedBiasForces.template head<6>();
+
+                if (contactsJacobianIn.rows() == 0) {
+                    //no contacts: there is nothing to project
+                    torques = m_jointsVector;
+                    return;
+                }
+
+                //M is factorised once and all the products with its inverse are obtained by solving
+                m_massMatrixDecomposition.compute(massMatrix);
+                m_massMatrixInverseTimesJacobianTransposed = m_massMatrixDecomposition.solve(contactsJacobian.transpose()); // M^-1 Jc^T
+                //JcMInv = (M^-1 Jc^T)^T as M is symmetric
+                m_JcMInvJct.noalias() = contactsJacobian * m_massMatrixInverseTimesJacobianTransposed;
+                //S = [0 I]^T simply selects the joint columns
+                m_JcMInvS = m_massMatrixInverseTimesJacobianTransposed.bottomRows(m_actuatedDOFs).transpose();
+
+                pseudoInverse(m_JcMInvS, m_svdDecompositionOfJcMInvS,
+                              m_pseudoInverseOfJcMInvS, PseudoInverseTolerance);
+
+                //The null space projector N = I - pinv(JcMInvS) JcMInvS is never built:
+                //N x is computed as x - pinv(JcMInvS) (JcMInvS x)
+
+                //mult_f_tau0 = M_jb M_bb^-1 Jc_b^T - Jc_j^T
+                m_multFTau.noalias() = m_baseProjectedJointsMass.transpose() * contactsJacobian.template leftCols<6>().transpose();
+                m_multFTau -= contactsJacobian.rightCols(m_actuatedDOFs).transpose();
+
+                //mult_f_tau = -pinv(JcMInvS) JcMInvJct + N mult_f_tau0
+                m_contactsTimesContacts.noalias() = m_JcMInvS * m_multFTau;
+                m_contactsTimesContacts += m_JcMInvJct;
+                m_multFTau.noalias() -= m_pseudoInverseOfJcMInvS * m_contactsTimesContacts;
+
+                //n_tau = pinv(JcMInvS) (JcMInv h - dJc nu) + N torques0
+                m_contactsVector = -contactsDJacobianDq;
+                m_contactsVector.noalias() += m_massMatrixInverseTimesJacobianTransposed.transpose() * generalizedBiasForces;
+                m_contactsVector.noalias() -= m_JcMInvS * m_jointsVector;
+                m_jointsVector.noalias() += m_pseudoInverseOfJcMInvS * m_contactsVector;
+
+                //mult_f_tau N_f and its pseudoinverse
+                m_multFTauNullSpace.noalias() = m_multFTau * nullSpaceOfCentroidalForceMatrix;
+                pseudoInverse(m_multFTauNullSpace, m_svdDecompositionOfMultFTauNullSpace,
+                              m_pseudoInverseOfMultFTauNullSpace, PseudoInverseTolerance);
+
+                //torques = (I - mult_f_tau N_f pinv(mult_f_tau N_f)) (n_tau + mult_f_tau f)
+                m_jointsVector.noalias() += m_multFTau * desiredContactForces;
+                m_contactsVector.noalias() = m_pseudoInverseOfMultFTauNullSpace * m_jointsVector;
+                m_jointsVector.noalias() -= m_multFTauNullSpace * m_contactsVector;
+                torques = m_jointsVector;
+            }
+        };
+
+        TorqueBalancingSolver* createTorqueBalancingSolver(int actuatedDOFs)
+        {
+            switch (actuatedDOFs) {
+                case 23:
+                    return new TorqueBalancingSolverImpl<23>(actuatedDOFs);
+                case 25:
+                    return new TorqueBalancingSolverImpl<25>(actuatedDOFs);
+                default:
+                    return new TorqueBalancingSolverImpl<Eigen::Dynamic>(actuatedDOFs);
+            }
+        }
+
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Silvio Traversaro
+ * email:  silvio.traversaro@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef _WHOLE_BODY_DYNAMICS_OFFSET_TRACKER_H_
+#define _WHOLE_BODY_DYNAMICS_OFFSET_TRACKER_H_
+
+#include <yarp/sig/Vector.h>
+
+#include <vector>
+
+/**
+ * Parameters of the OffsetTracker.
+ */
+struct OffsetTrackerParameters
+{
+    OffsetTrackerParameters();
+
+    /** max absolute joint velocity (rad/s) in a quasi-static phase */
+    double max_joint_velocity;
+    /** max standard deviation (N) of each force measured by the F/T sensors in a quasi-static phase */
+    double max_force_std;
+    /** max standard deviation (Nm) of each torque measured by the F/T sensors in a quasi-static phase */
+    double max_torque_std;
+    /** time (s) the quasi-static conditions should hold before using the measurements */
+    double min_quasi_static_time;
+    /** time constant (s) of the moving mean and variance of the F/T measurements */
+    double statistics_time_constant;
+    /** expected drift (N/sqrt(s)) of the force offsets, modeled as a random walk */
+    double force_offset_drift;
+    /** expected drift (Nm/sqrt(s)) of the torque offsets, modeled as a random walk */
+    double torque_offset_drift;
+};
+
+/**
+ * Background estimator of the offsets of the six axis F/T sensors.
+ *
+ * The tracker detects the quasi-static phases of the robot (joints almost still,
+ * F/T measurements with low variance and only known contacts) and during
+ * these phases refines the offset of each sensor component with a scalar
+ * Kalman filter, in which the offset is a random walk and the measurement is
+ * the difference between the measured and the model predicted F/T.
+ *
+ * The cost of each update is linear in the number of sensors, and all the
+ * buffers are allocated at configuration.
+ */
+class OffsetTracker
+{
+public:
+    OffsetTracker(int nrOfFTSensors, const OffsetTrackerParameters & params);
+    void reset(int nrOfFTSensors, const OffsetTrackerParameters & params);
+
+    /**
+     * Update the quasi-static phase detection with the measurements of a cycle.
+     *
+     * @param dt time (s) elapsed since the last update
+     * @param dqj joint velocities
+     * @param measured_ft raw measurements of the F/T sensors
+     * @param known_contacts true if the robot has only the contacts assumed by the model
+     * @return true if the robot has been quasi-static for at least min_quasi_static_time
+     */
+    bool updateQuasiStaticDetection(const double dt,
+                                    const yarp::sig::Vector & dqj,
+                                    const std::vector<yarp::sig::Vector> & measured_ft,
+                                    const bool known_contacts);
+
+    /** True if the last call to updateQuasiStaticDetection detected a quasi-static phase */
+    bool isQuasiStatic() const;
+
+    /**
+     * Refine the offset of a sensor during a quasi-static phase.
+     *
+     * @param dt time (s) elapsed since the last refinement of the offset
+     * @param measured_ft raw measurement of the F/T sensor
+     * @param model_ft F/T predicted by the model
+     */
+    void updateOffset(const unsigned int ft_id,
+                      const double dt,
+                      const yarp::sig::Vector & measured_ft,
+                      const yarp::sig::Vector & model_ft);
+
+    /**
+     * Set the offset of a sensor (for example after a calibration),
+     * that is then considered exact.
+     */
+    void setOffset(const unsigned int ft_id, const yarp::sig::Vector & offset);
+
+    const yarp::sig::Vector & getOffset(const unsigned int ft_id) const;
+
+    /** Get the standard deviation of each component of the offset estimate */
+    void getOffsetStd(const unsigned int ft_id, yarp::sig::Vector & offset_std) const;
+
+private:
+    OffsetTrackerParameters parameters;
+
+    std::vector<yarp::sig::Vector> ft_mean;
+    std::vector<yarp::sig::Vector> ft_variance;
+    bool statistics_initialized;
+    double quasi_static_time;
+    bool quasi_static;
+
+    std::vector<yarp::sig::Vector> offset;
+    std::vector<yarp::sig::Vector> offset_variance;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Silvio Traversaro
+ * email:  silvio.traversaro@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#ifndef _WHOLE_BODY_DYNAMICS_PREALLOCATED_PORTABLES_H_
+#define _WHOLE_BODY_DYNAMICS_PREALLOCATED_PORTABLES_H_
+
+#include <yarp/os/Portable.h>
+#include <yarp/sig/Vector.h>
+#include <yarp/sig/Matrix.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * The classes in this file are the data published by wholeBodyDynamicsTree
+ * on its output ports.
+ *
+ * Each class serializes itself with the same layout of the yarp::os::Bottle
+ * (or yarp::os::Property) previously built at each cycle, so existing readers
+ * are not affected. The size of the data is fixed at configuration, so writing
+ * them does not involve any string handling or dynamic memory allocation.
+ */
+
+/**
+ * Estimated torques published on a torque port:
+ * the magic number (int) followed by the torques (double), as read by
+ * the virtualAnalogSensor of the robot.
+ */
+class TorquesPortable : public yarp::os::Portable
+{
+public:
+    TorquesPortable();
+
+    int magic_number;
+    yarp::sig::Vector torques;
+
+    virtual bool read(yarp::os::ConnectionReader& connection);
+    virtual bool write(yarp::os::ConnectionWriter& connection);
+};
+
+/**
+ * State of the floating base estimated by the odometry:
+ * ((4 4 (world_H_floatingbase)) (floatingbase_twist) (floatingbase_acctwist))
+ */
+class FloatingBaseStatePortable : public yarp::os::Portable
+{
+public:
+    FloatingBaseStatePortable();
+
+    yarp::sig::Matrix world_H_floatingbase;
+    yarp::sig::Vector floatingbase_twist;
+    yarp::sig::Vector floatingbase_acctwist;
+
+    virtual bool read(yarp::os::ConnectionReader& connection);
+    virtual bool write(yarp::os::ConnectionWriter& connection);
+};
+
+/**
+ * World transforms of a set of frames, serialized as a Property
+ * with the frame names as keys: ((frame_name (4 4 (world_H_frame))) ...)
+ */
+class FramesPortable : public yarp::os::Portable
+{
+public:
+    FramesPortable();
+
+    /**
+     * Set the names of the frames (the pointed vector is not copied
+     * and it must be valid until the data is written), and allocate
+     * the transforms accordingly.
+     */
+    void setFrameNames(const std::vector<std::string> * frame_names);
+
+    std::vector<yarp::sig::Matrix> world_H_frames;
+
+    virtual bool read(yarp::os::ConnectionReader& connection);
+    virtual bool write(yarp::os::ConnectionWriter& connection);
+
+private:
+    const std::vector<std::string> * frame_names;
+};
+
+#endif
@@ -20,10 +20,16 @@
 
 #include <yarp/sig/Vector.h>
 
-#include <kdl/jntarray.hpp>
-
 #include <vector>
 
+/**
+ * Joint state of the robot.
+ *
+ * Each quantity is stored once, in a yarp::sig::Vector: the buffers
+ * are passed by reference to the iDynTree model, to the filters and
+ * (through their data() pointer) to the whole body sensors interface,
+ * so no conversion or copy is needed to keep them in sync.
+ */
 class RobotJointStatus
 {
     yarp::sig::Vector qj;
@@ -31,45 +37,20 @@ class RobotJointStatus
     yarp::sig::Vector ddqj;
     yarp::sig::Vector torquesj;
 
-    KDL::JntArray qj_kdl;
-    KDL::JntArray dqj_kdl;
-    KDL::JntArray ddqj_kdl;
-    KDL::JntArray torquesj_kdl;
-
 public:
     bool zero();
     RobotJointStatus(int nrOfDOFs=0);
     bool setNrOfDOFs(int nrOfDOFs);
 
-    bool setJointPosYARP(const yarp::sig::Vector & qj);
-    bool setJointVelYARP(const yarp::sig::Vector & dqj);
-    bool setJointAccYARP(const yarp::sig::Vector & ddqj);
-    bool setJointTorquesYARP(const yarp::sig::Vector & torquesj);
-
-    bool setJointPosKDL(const KDL::JntArray & qj);
-    bool setJointVelKDL(const KDL::JntArray & dqj);
-    bool setJointAccKDL(const KDL::JntArray & ddqj);
-    bool setJointTorquesKDL(const KDL::JntArray & torquesj);
-
-    yarp::sig::Vector & getJointPosYARP();
-    yarp::sig::Vector & getJointVelYARP();
-    yarp::sig::Vector & getJointAccYARP();
-    yarp::sig::Vector & getJointTorquesYARP();
-
-    KDL::JntArray & getJointPosKDL();
-    KDL::JntArray & getJointVelKDL();
-    KDL::JntArray & getJointAccKDL();
-    KDL::JntArray & getJointTorquesKDL();
-
-    /**
-     * Copy in the yarp buffers the content of the KDL buffers.
-     */
-    bool updateYarpBuffers();
+    bool setJointPos(const yarp::sig::Vector & qj);
+    bool setJointVel(const yarp::sig::Vector & dqj);
+    bool setJointAcc(const yarp::sig::Vector & ddqj);
+    bool setJointTorques(const yarp::sig::Vector & torquesj);
 
-    /**
-     * Copy in the KDL buffers the content of the YARP buffers.
-     */
-    bool updateKDLBuffers();
+    yarp::sig::Vector & getJointPos();
+    yarp::sig::Vector & getJointVel();
+    yarp::sig::Vector & getJointAcc();
+    yarp::sig::Vector & getJointTorques();
 };
 
 class RobotSensorStatus
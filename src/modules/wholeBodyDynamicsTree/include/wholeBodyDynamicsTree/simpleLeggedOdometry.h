@@ -45,7 +45,9 @@
  *      ${}^{world} H_{fixed} = {}^{world} H_{old_fixed} {}^{old_fixed} H_{new_fixed}(qj)$
  * 2b) After the update, the getWorldToFrameTransform(int frame_id) can be obtained as at the point 1b .
  *
- * \note we should update the state used by the odometry by calling the appropritate getDynTree().setAng() method.
+ * \note the odometry does not own its model: it uses the geometric model passed in init,
+ *       that is shared with the other users (e.g. the estimation), so the joint state
+ *       of the model should be set by the owner of the model before calling updateFloatingBase().
  */
 class simpleLeggedOdometry
 {
@@ -59,11 +61,11 @@ class simpleLeggedOdometry
 
         ~simpleLeggedOdometry();
 
-        bool init(KDL::CoDyCo::UndirectedTree & undirected_tree,
+        bool init(iCub::iDynTree::DynTree * model,
                   const std::string & initial_world_frame_position,
                   const std::string & initial_fixed_link);
 
-        bool init(KDL::CoDyCo::UndirectedTree & undirected_tree,
+        bool init(iCub::iDynTree::DynTree * model,
                   const int initial_world_frame_position_index,
                   const int initial_fixed_link_index);
 
@@ -98,9 +100,10 @@ class simpleLeggedOdometry
         KDL::Frame getWorldFrameTransform(const int frame_index);
 
         /**
-         * Set the joint positions, velocities and accelerations
+         * Update the world pose of the floating base of the model,
+         * given the joint positions currently set in the model.
          */
-        bool setJointsState(const KDL::JntArray & qj, const KDL::JntArray & dqj, const KDL::JntArray & ddqj);
+        bool updateFloatingBase();
 
         /**
          * Get iDynTree underlyng object
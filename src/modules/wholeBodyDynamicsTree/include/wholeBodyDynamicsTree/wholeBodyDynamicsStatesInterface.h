@@ -69,7 +69,6 @@ using namespace yarpWbi;
         yarp::os::BufferedPort<iCub::skinDynLib::skinContactList> * port_skin_contacts;
 
         yarp::sig::Vector           q, qStamps;         // last joint position estimation
-        yarp::sig::Vector           tauJ, tauJStamps;
 
         std::vector<yarp::sig::Vector> forcetorques;
         yarp::sig::Vector forcetorquesStamps;
@@ -92,6 +91,10 @@ using namespace yarpWbi;
         bool assume_fixed_base_from_odometry;
         yarp::os::Property wbi_yarp_conf;
 
+        int estimation_floating_base_link_index;
+        int l_sole_link_index;
+        int r_sole_link_index;
+
         yarp::sig::Vector omega_used_IMU;
         yarp::sig::Vector domega_used_IMU;
         yarp::sig::Vector ddp_used_IMU;
@@ -123,10 +126,19 @@ using namespace yarpWbi;
         /** Store external wrenches ad the end effectors */
         void readEndEffectorsExternalWrench();
 
+        /**
+         * Get the link used as floating base (i.e. where the IMU measure is applied)
+         * in the estimation, or -1 if the estimation can't be performed.
+         */
+        int getEstimationFloatingBaseLink();
+
     public:
+        /**
+         * Model used for the estimation (not owned by the estimator).
+         * The model is shared with the calibration and the odometry, so its
+         * floating base link is set at each estimation.
+         */
         iCub::iDynTree::TorqueEstimationTree * robot_estimation_model;
-        iCub::iDynTree::TorqueEstimationTree * robot_estimation_model_on_l_sole;
-        iCub::iDynTree::TorqueEstimationTree * robot_estimation_model_on_r_sole;
 
         std::string current_fixed_link_name;
 
@@ -136,10 +148,12 @@ using namespace yarpWbi;
 
          /** Constructor.
          *
+         * @param robot_model pointer to the model used for the estimation
          * @param port_skin_contacts pointer to a port reading a skinContactList from the robot skin
          * \todo TODO skin_contacts should be read from the WholeBodySensors interface
          */
         ExternalWrenchesAndTorquesEstimator(int _period,
+                                       iCub::iDynTree::TorqueEstimationTree * _robot_model,
                                        yarpWbi::yarpWholeBodySensors *_sensors,
                                        yarp::os::BufferedPort<iCub::skinDynLib::skinContactList> * _port_skin_contacts,
                                        yarp::os::Property & _wbi_yarp_conf);
@@ -154,6 +168,12 @@ using namespace yarpWbi;
         /** Set the minimum number of activated taxels an skin contact should have to be considered by the estimation  */
         bool setMinTaxel(const int min_taxel);
 
+        /**
+         * True if the skin is not detecting any contact, so the last
+         * estimation used only the default contacts of each subtree.
+         */
+        bool usesOnlyDefaultContacts() const;
+
 
     };
 
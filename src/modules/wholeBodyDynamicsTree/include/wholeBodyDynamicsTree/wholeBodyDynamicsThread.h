@@ -43,9 +43,11 @@
 #include <yarpWholeBodyInterface/yarpWholeBodyInterface.h>
 #include "wholeBodyDynamicsTree/wholeBodyDynamicsStatesInterface.h"
 #include "wholeBodyDynamicsTree/simpleLeggedOdometry.h"
+#include "wholeBodyDynamicsTree/offsetTracker.h"
 
 #include "ctrlLibRT/filters.h"
 #include "wholeBodyDynamicsTree/robotStatus.h"
+#include "wholeBodyDynamicsTree/preallocatedPortables.h"
 
 struct outputTorquePortInformation
 {
@@ -53,7 +55,7 @@ struct outputTorquePortInformation
     int magic_number;
     std::vector< int > wbi_numeric_ids_to_publish;
     yarp::sig::Vector output_vector;
-    yarp::os::BufferedPort<yarp::os::Bottle> * output_port;
+    yarp::os::BufferedPort<TorquesPortable> * output_port;
 };
 
 struct outputWrenchPortInformation
@@ -142,6 +144,9 @@ class wholeBodyDynamicsThread: public yarp::os::RateThread
     /** offset smoothe class */
     OffsetSmoother * offset_smoother;
 
+    /** background estimator of the F/T offsets, used if offset_tracking is enabled */
+    OffsetTracker * offset_tracker;
+
     /** helper variable for printing every printPeriod milliseconds */
     int                 printCountdown;
     /** period after which some diagnostic messages are print */
@@ -166,7 +171,7 @@ class wholeBodyDynamicsThread: public yarp::os::RateThread
 
     template <class T> void broadcastData(T& _values, yarp::os::BufferedPort<T> *_port);
     void closePort(yarp::os::Contactable *_port);
-    void writeTorque(const yarp::sig::Vector & _values, int _address, yarp::os::BufferedPort<yarp::os::Bottle> *_port);
+    void writeTorque(const yarp::sig::Vector & _values, int _address, yarp::os::BufferedPort<TorquesPortable> *_port);
     void publishTorques();
     void publishContacts();
     void getExternalWrenches();
@@ -182,6 +187,19 @@ class wholeBodyDynamicsThread: public yarp::os::RateThread
     void estimation_run();
     void calibration_run();
     void calibration_on_double_support_run();
+    /**
+     * Compute in sensor_status.model_ft_sensors the F/T measurements predicted
+     * by the model for a robot standing still, with the given floating base link
+     * and, if double_support is true, with both feet in contact.
+     */
+    bool computeStaticModelFTs(const int floating_base_link, const bool double_support);
+    /** get the floating base link used for the calibrations on double support */
+    int getDoubleSupportCalibrationFloatingBaseLink();
+    /** refine the F/T offsets during the quasi-static phases (offset_tracking option) */
+    void trackOffsets();
+    /** check that the forces measured on the feet are consistent with the support assumed by the offset tracking */
+    bool offsetTrackingSupportIsLoaded();
+    void handOverTrackedOffsets();
 
     //Data structures for mapping between wbi and output ports
     // this are populated by the WBD_TORQUE_PORTS group
@@ -213,16 +231,32 @@ class wholeBodyDynamicsThread: public yarp::os::RateThread
     bool smooth_calibration;
     bool first_calibration;
     double smooth_calibration_period_in_ms;
+
+    //Offset tracking related variables
+    bool offset_tracking;
+    bool offset_tracking_on_double_support;
+    int offset_tracking_floating_base_link_idyntree_id;
+    double offset_tracking_update_period;
+    double offset_tracking_phase_start;
+    double offset_tracking_last_handover;
+    double offset_tracking_min_support_force;
+    int offset_tracking_left_foot_ft_id;
+    int offset_tracking_right_foot_ft_id;
+    std::string offset_tracking_support_foot;
     yarp::os::Mutex run_mutex;
     bool run_mutex_acquired;
     yarp::os::Mutex calibration_mutex;
     RobotJointStatus joint_status;
     RobotSensorStatus sensor_status;
 
-    iCub::iDynTree::TorqueEstimationTree * icub_model_calibration;
-    iCub::iDynTree::TorqueEstimationTree * icub_model_world_base_position;
-    iCub::iDynTree::TorqueEstimationTree * icub_model_calibration_on_l_sole;
-    iCub::iDynTree::TorqueEstimationTree * icub_model_calibration_on_r_sole;
+    /**
+     * Geometric and dynamic model of the robot, shared by the estimation,
+     * the calibration and the odometry: each user sets the floating base
+     * link it needs before performing its computations.
+     */
+    iCub::iDynTree::TorqueEstimationTree * icub_model;
+    int calibration_floating_base_link_idyntree_id;
+    int active_calibration_floating_base_link_idyntree_id;
     std::string calibration_support_link;
 
     int samples_requested_for_calibration;
@@ -277,17 +311,12 @@ class wholeBodyDynamicsThread: public yarp::os::RateThread
     ///////////////////////////////////////////////////////////
     simpleLeggedOdometry odometry_helper;
     int odometry_floating_base_frame_index;
-    yarp::sig::Matrix world_H_floatingbase;
-    yarp::sig::Vector floatingbase_twist;
-    yarp::sig::Vector floatingbase_acctwist;
     bool odometry_enabled;
-    yarp::os::BufferedPort<yarp::os::Bottle> * port_floatingbasestate;
+    yarp::os::BufferedPort<FloatingBaseStatePortable> * port_floatingbasestate;
     bool frames_streaming_enabled;
-    yarp::os::BufferedPort<yarp::os::Property> * port_frames;
+    yarp::os::BufferedPort<FramesPortable> * port_frames;
     std::vector<int> frames_to_stream_indices;
     std::vector<std::string> frames_to_stream;
-    std::vector<yarp::os::Bottle> buffer_bottles;
-    yarp::sig::Matrix buffer_transform_matrix;
     bool com_streaming_enabled;
     yarp::os::BufferedPort<yarp::sig::Vector> * port_com;
     std::string current_fixed_link_name;
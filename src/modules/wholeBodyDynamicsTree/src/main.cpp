@@ -154,6 +154,29 @@ filtering of:
    cutoff_velacc configuration parameter. In the case the cutoff_velacc parameter is specified,
    the cutoff frequency (in Hz) of the filter is given by the value of the cutoff_velacc parameter.
 
+\section offset_tracking Offset tracking
+The offsets of the F/T sensors drift between calibrations. If the offset_tracking
+option is used, wholeBodyDynamicsTree refines them in background, without the
+need of calling calib on the RPC port:
+ - a quasi-static phase is detected when the absolute value of all joint velocities
+   is below offset_tracking_max_joint_vel, the standard deviation of all F/T
+   measurements is below offset_tracking_max_force_std/offset_tracking_max_torque_std
+   and the skin is not detecting any contact, for at least offset_tracking_min_static_time seconds;
+ - during a quasi-static phase the F/T predicted by the model (computed as in the
+   calibration, on double support or on the given fixed link) is compared with the
+   measured ones, and the offset of each component is refined by a scalar Kalman filter
+   that models the offset as a random walk (offset_tracking_force_drift/offset_tracking_torque_drift).
+   The offsets are refined only if the forces measured by the F/T sensors of the feet are consistent
+   with the assumed support: on double support both feet should measure more than
+   offset_tracking_min_support_force newtons, on a foot only that foot (that should also
+   be the fixed link of the odometry, if enabled), otherwise neither;
+ - the refined offsets are smoothly applied (with the smooth_calibration period, 1 second
+   if not specified) at the end of each quasi-static phase, and every
+   offset_tracking_update_period seconds during a long one.
+
+The offsets obtained by a calib command are considered exact, and are the starting point
+of the tracking.
+
 
 \author Silvio Traversaro
 
@@ -207,6 +230,13 @@ int main (int argc, char * argv[])
         yInfo()<< "\t--min_taxel  threshold   :Filter input skin contacts: if the activated taxels are lower than the threshold, ignore the contact (default: 1)." ;
         yInfo()<< "\t--smooth_calibration switch_period : Perform a smooth calibration (i.e.: don't stop estimating torques during calibration, and then smoothly change the ft offsets)";
         yInfo()<< "\t                                     the switch_period express the period (in ms) used for offset interpolation.";
+        yInfo()<< "\t--offset_tracking support : Refine the ft offsets in background while the robot is quasi-static (see the offset tracking section of the documentation)";
+        yInfo()<< "\t                            the support is double_support (default) or the name of the link assumed fixed, as in the calibration.";
+        yInfo()<< "\t--offset_tracking_max_joint_vel, --offset_tracking_max_force_std, --offset_tracking_max_torque_std, --offset_tracking_min_static_time :";
+        yInfo()<< "\t                            thresholds (rad/s, N, Nm, s) used to detect the quasi-static phases (default: 0.02 0.5 0.05 2.0).";
+        yInfo()<< "\t--offset_tracking_force_drift, --offset_tracking_torque_drift : expected drift of the offsets, in N/sqrt(s) and Nm/sqrt(s) (default: 0.05 0.005).";
+        yInfo()<< "\t--offset_tracking_update_period : period (in s) after which the tracked offsets are applied during a quasi-static phase (default: 5.0).";
+        yInfo()<< "\t--offset_tracking_min_support_force : force (in N) above which a foot is considered in contact when checking the support (default: 50.0).";
         yInfo()<< "\t--cutoff_imu           :cutoff frequency (in Hz) of the low pass filters used for IMU.";
         yInfo()<< "\t--cutoff_ft            :cutoff frequency (in Hz) of the low pass filters used for six axis F/T sensors measurements.";
         yInfo()<< "\t                        if not present, no filtering is perfomed on F/T sensor measurements.";
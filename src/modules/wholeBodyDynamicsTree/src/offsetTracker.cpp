@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Silvio Traversaro
+ * email:  silvio.traversaro@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#include "wholeBodyDynamicsTree/offsetTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace yarp::sig;
+
+namespace
+{
+    // the first three components of a F/T measurement are forces, the last three torques
+    inline bool isForceComponent(const int component)
+    {
+        return component < 3;
+    }
+}
+
+//*****************************************************************************
+OffsetTrackerParameters::OffsetTrackerParameters(): max_joint_velocity(0.02),
+                                                    max_force_std(0.5),
+                                                    max_torque_std(0.05),
+                                                    min_quasi_static_time(2.0),
+                                                    statistics_time_constant(0.5),
+                                                    force_offset_drift(0.05),
+                                                    torque_offset_drift(0.005)
+{
+}
+
+//*****************************************************************************
+OffsetTracker::OffsetTracker(int nrOfFTSensors, const OffsetTrackerParameters & params)
+{
+    this->reset(nrOfFTSensors,params);
+}
+
+void OffsetTracker::reset(int nrOfFTSensors, const OffsetTrackerParameters & params)
+{
+    this->parameters = params;
+    this->ft_mean.assign(nrOfFTSensors,Vector(6,0.0));
+    this->ft_variance.assign(nrOfFTSensors,Vector(6,0.0));
+    this->statistics_initialized = false;
+    this->quasi_static_time = 0.0;
+    this->quasi_static = false;
+    this->offset.assign(nrOfFTSensors,Vector(6,0.0));
+    this->offset_variance.assign(nrOfFTSensors,Vector(6,0.0));
+}
+
+bool OffsetTracker::updateQuasiStaticDetection(const double dt,
+                                               const Vector & dqj,
+                                               const std::vector<Vector> & measured_ft,
+                                               const bool known_contacts)
+{
+    // Exponentially weighted mean and variance of the F/T measurements
+    if( !statistics_initialized )
+    {
+        for(unsigned int ft=0; ft < ft_mean.size(); ft++ )
+        {
+            ft_mean[ft] = measured_ft[ft];
+            ft_variance[ft].zero();
+        }
+        statistics_initialized = true;
+    }
+
+    double alpha = dt/(parameters.statistics_time_constant+dt);
+    bool low_ft_variance = true;
+    for(unsigned int ft=0; ft < ft_mean.size(); ft++ )
+    {
+        for(int i=0; i < 6; i++ )
+        {
+            double delta = measured_ft[ft][i]-ft_mean[ft][i];
+            ft_mean[ft][i] += alpha*delta;
+            ft_variance[ft][i] = (1.0-alpha)*(ft_variance[ft][i]+alpha*delta*delta);
+
+            double max_std = isForceComponent(i) ? parameters.max_force_std : parameters.max_torque_std;
+            if( ft_variance[ft][i] > max_std*max_std )
+            {
+                low_ft_variance = false;
+            }
+        }
+    }
+
+    bool still_joints = true;
+    for(size_t j=0; j < dqj.size(); j++ )
+    {
+        if( fabs(dqj[j]) > parameters.max_joint_velocity )
+        {
+            still_joints = false;
+            break;
+        }
+    }
+
+    if( known_contacts && still_joints && low_ft_variance )
+    {
+        quasi_static_time += dt;
+    }
+    else
+    {
+        quasi_static_time = 0.0;
+    }
+
+    quasi_static = (quasi_static_time >= parameters.min_quasi_static_time);
+
+    return quasi_static;
+}
+
+bool OffsetTracker::isQuasiStatic() const
+{
+    return quasi_static;
+}
+
+void OffsetTracker::updateOffset(const unsigned int ft_id,
+                                 const double dt,
+                                 const Vector & measured_ft,
+                                 const Vector & model_ft)
+{
+    for(int i=0; i < 6; i++ )
+    {
+        double drift = isForceComponent(i) ? parameters.force_offset_drift : parameters.torque_offset_drift;
+        double max_std = isForceComponent(i) ? parameters.max_force_std : parameters.max_torque_std;
+
+        // prediction: the offset is a random walk
+        offset_variance[ft_id][i] += drift*drift*dt;
+
+        // correction: the measurement noise is the one observed in the quasi-static phase,
+        // bounded from below to avoid trusting a single sample too much
+        double measurement_variance = std::max(ft_variance[ft_id][i],0.01*max_std*max_std);
+        double gain = offset_variance[ft_id][i]/(offset_variance[ft_id][i]+measurement_variance);
+        double residual = measured_ft[i]-model_ft[i];
+        offset[ft_id][i] += gain*(residual-offset[ft_id][i]);
+        offset_variance[ft_id][i] *= (1.0-gain);
+    }
+}
+
+void OffsetTracker::setOffset(const unsigned int ft_id, const Vector & _offset)
+{
+    offset[ft_id] = _offset;
+    offset_variance[ft_id].zero();
+}
+
+const Vector & OffsetTracker::getOffset(const unsigned int ft_id) const
+{
+    return offset[ft_id];
+}
+
+void OffsetTracker::getOffsetStd(const unsigned int ft_id, Vector & offset_std) const
+{
+    offset_std.resize(6);
+    for(int i=0; i < 6; i++ )
+    {
+        offset_std[i] = sqrt(offset_variance[ft_id][i]);
+    }
+}
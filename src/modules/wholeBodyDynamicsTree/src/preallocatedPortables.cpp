@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Silvio Traversaro
+ * email:  silvio.traversaro@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+*/
+
+#include "wholeBodyDynamicsTree/preallocatedPortables.h"
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
+
+using namespace yarp::os;
+
+// Note: yarp::sig::Vector::write and yarp::sig::Matrix::write produce
+// exactly the binary layout of a (nested) list element of a Bottle,
+// so they are used directly to serialize the nested lists.
+
+//*****************************************************************************
+TorquesPortable::TorquesPortable(): magic_number(0)
+{
+}
+
+bool TorquesPortable::read(ConnectionReader& connection)
+{
+    Bottle bot;
+    if( !bot.read(connection) || bot.size() < 1 )
+    {
+        return false;
+    }
+    magic_number = bot.get(0).asInt();
+    torques.resize(bot.size()-1);
+    for(int i=0; i < (int)torques.size(); i++ )
+    {
+        torques[i] = bot.get(i+1).asDouble();
+    }
+    return true;
+}
+
+bool TorquesPortable::write(ConnectionWriter& connection)
+{
+    if( connection.isTextMode() )
+    {
+        Bottle bot;
+        bot.addInt(magic_number);
+        for(int i=0; i < (int)torques.size(); i++ )
+        {
+            bot.addDouble(torques[i]);
+        }
+        return bot.write(connection);
+    }
+
+    connection.appendInt(BOTTLE_TAG_LIST);
+    connection.appendInt(1+torques.size());
+    connection.appendInt(BOTTLE_TAG_INT);
+    connection.appendInt(magic_number);
+    for(int i=0; i < (int)torques.size(); i++ )
+    {
+        connection.appendInt(BOTTLE_TAG_DOUBLE);
+        connection.appendDouble(torques[i]);
+    }
+    connection.convertTextMode();
+    return !connection.isError();
+}
+
+//*****************************************************************************
+FloatingBaseStatePortable::FloatingBaseStatePortable(): world_H_floatingbase(4,4),
+                                                        floatingbase_twist(6,0.0),
+                                                        floatingbase_acctwist(6,0.0)
+{
+    world_H_floatingbase.eye();
+}
+
+bool FloatingBaseStatePortable::read(ConnectionReader& connection)
+{
+    Bottle bot;
+    if( !bot.read(connection) || bot.size() != 3 )
+    {
+        return false;
+    }
+    return Portable::copyPortable(*(bot.get(0).asList()),world_H_floatingbase) &&
+           Portable::copyPortable(*(bot.get(1).asList()),floatingbase_twist) &&
+           Portable::copyPortable(*(bot.get(2).asList()),floatingbase_acctwist);
+}
+
+bool FloatingBaseStatePortable::write(ConnectionWriter& connection)
+{
+    if( connection.isTextMode() )
+    {
+        Bottle bot;
+        bot.addList().read(world_H_floatingbase);
+        bot.addList().read(floatingbase_twist);
+        bot.addList().read(floatingbase_acctwist);
+        return bot.write(connection);
+    }
+
+    connection.appendInt(BOTTLE_TAG_LIST);
+    connection.appendInt(3);
+    bool ok = world_H_floatingbase.write(connection);
+    ok = ok && floatingbase_twist.write(connection);
+    ok = ok && floatingbase_acctwist.write(connection);
+    connection.convertTextMode();
+    return ok && !connection.isError();
+}
+
+//*****************************************************************************
+FramesPortable::FramesPortable(): frame_names(0)
+{
+}
+
+void FramesPortable::setFrameNames(const std::vector<std::string> * _frame_names)
+{
+    frame_names = _frame_names;
+    size_t nr_of_frames = frame_names ? frame_names->size() : 0;
+    if( world_H_frames.size() != nr_of_frames )
+    {
+        world_H_frames.resize(nr_of_frames,yarp::sig::Matrix(4,4));
+    }
+}
+
+bool FramesPortable::read(ConnectionReader& /*connection*/)
+{
+    // the frames are only published: read them with a yarp::os::Property
+    return false;
+}
+
+bool FramesPortable::write(ConnectionWriter& connection)
+{
+    if( !frame_names || frame_names->size() != world_H_frames.size() )
+    {
+        return false;
+    }
+
+    if( connection.isTextMode() )
+    {
+        Bottle bot;
+        for(size_t i=0; i < frame_names->size(); i++ )
+        {
+            Bottle & frame_bot = bot.addList();
+            frame_bot.addString((*frame_names)[i].c_str());
+            frame_bot.addList().read(world_H_frames[i]);
+        }
+        return bot.write(connection);
+    }
+
+    connection.appendInt(BOTTLE_TAG_LIST);
+    connection.appendInt(frame_names->size());
+    bool ok = true;
+    for(size_t i=0; i < frame_names->size() && ok; i++ )
+    {
+        // (frame_name (4 4 (world_H_frame)))
+        const std::string & frame_name = (*frame_names)[i];
+        connection.appendInt(BOTTLE_TAG_LIST);
+        connection.appendInt(2);
+        connection.appendInt(BOTTLE_TAG_STRING);
+        connection.appendInt(frame_name.length()+1);
+        connection.appendBlock(frame_name.c_str(),frame_name.length()+1);
+        ok = world_H_frames[i].write(connection);
+    }
+    connection.convertTextMode();
+    return ok && !connection.isError();
+}
@@ -18,8 +18,6 @@
 
 #include "wholeBodyDynamicsTree/robotStatus.h"
 
-#include <iCub/iDynTree/yarp_kdl.h>
-
 #include <wbi/iWholeBodySensors.h>
 
 RobotJointStatus::RobotJointStatus(int nrOfDOFs)
@@ -37,11 +35,6 @@ bool RobotJointStatus::setNrOfDOFs(int nrOfDOFs)
     ddqj.resize(nrOfDOFs);
     torquesj.resize(nrOfDOFs);
 
-    qj_kdl.resize(nrOfDOFs);
-    dqj_kdl.resize(nrOfDOFs);
-    ddqj_kdl.resize(nrOfDOFs);
-    torquesj_kdl.resize(nrOfDOFs);
-
     return zero();
 }
 
@@ -52,123 +45,57 @@ bool RobotJointStatus::zero()
     ddqj.zero();
     torquesj.zero();
 
-    SetToZero(qj_kdl);
-    SetToZero(dqj_kdl);
-    SetToZero(ddqj_kdl);
-    SetToZero(torquesj_kdl);
-
     return true;
 }
 
-bool RobotJointStatus::setJointPosYARP(const yarp::sig::Vector& _qj)
+bool RobotJointStatus::setJointPos(const yarp::sig::Vector& _qj)
 {
+    if( _qj.size() != qj.size() ) return false;
     qj = _qj;
-    return YarptoKDL(qj,qj_kdl);
+    return true;
 }
 
-bool RobotJointStatus::setJointVelYARP(const yarp::sig::Vector& _dqj)
+bool RobotJointStatus::setJointVel(const yarp::sig::Vector& _dqj)
 {
+    if( _dqj.size() != dqj.size() ) return false;
     dqj = _dqj;
-    return YarptoKDL(dqj,dqj_kdl);
+    return true;
 }
 
-bool RobotJointStatus::setJointAccYARP(const yarp::sig::Vector& _ddqj)
+bool RobotJointStatus::setJointAcc(const yarp::sig::Vector& _ddqj)
 {
+    if( _ddqj.size() != ddqj.size() ) return false;
     ddqj = _ddqj;
-    return YarptoKDL(ddqj,ddqj_kdl);
+    return true;
 }
 
-bool RobotJointStatus::setJointTorquesYARP(const yarp::sig::Vector& _torquesj)
+bool RobotJointStatus::setJointTorques(const yarp::sig::Vector& _torquesj)
 {
+    if( _torquesj.size() != torquesj.size() ) return false;
     torquesj = _torquesj;
-    return YarptoKDL(torquesj,torquesj_kdl);
-}
-
-
-bool RobotJointStatus::setJointPosKDL(const KDL::JntArray& _qj)
-{
-    qj_kdl = _qj;
-    return KDLtoYarp(qj_kdl,qj);
-}
-
-bool RobotJointStatus::setJointVelKDL(const KDL::JntArray& _dqj)
-{
-    dqj_kdl = _dqj;
-    return KDLtoYarp(dqj_kdl,dqj);
-}
-
-bool RobotJointStatus::setJointAccKDL(const KDL::JntArray& _ddqj)
-{
-    ddqj_kdl = _ddqj;
-    return KDLtoYarp(ddqj_kdl,ddqj);
-}
-
-bool RobotJointStatus::setJointTorquesKDL(const KDL::JntArray& _torquesj)
-{
-    torquesj_kdl = _torquesj;
-    return KDLtoYarp(torquesj_kdl,torquesj);
-}
-
-KDL::JntArray& RobotJointStatus::getJointPosKDL()
-{
-    return qj_kdl;
-}
-
-KDL::JntArray& RobotJointStatus::getJointVelKDL()
-{
-    return dqj_kdl;
-}
-
-KDL::JntArray& RobotJointStatus::getJointAccKDL()
-{
-    return ddqj_kdl;
-}
-
-KDL::JntArray& RobotJointStatus::getJointTorquesKDL()
-{
-    return torquesj_kdl;
+    return true;
 }
 
-yarp::sig::Vector& RobotJointStatus::getJointPosYARP()
+yarp::sig::Vector& RobotJointStatus::getJointPos()
 {
     return qj;
 }
 
-yarp::sig::Vector& RobotJointStatus::getJointVelYARP()
+yarp::sig::Vector& RobotJointStatus::getJointVel()
 {
     return dqj;
 }
 
-yarp::sig::Vector& RobotJointStatus::getJointAccYARP()
+yarp::sig::Vector& RobotJointStatus::getJointAcc()
 {
     return ddqj;
 }
 
-yarp::sig::Vector& RobotJointStatus::getJointTorquesYARP()
+yarp::sig::Vector& RobotJointStatus::getJointTorques()
 {
     return torquesj;
 }
 
-bool RobotJointStatus::updateYarpBuffers()
-{
-    bool ok = true;
-    ok = ok && KDLtoYarp(qj_kdl,qj);
-    ok = ok && KDLtoYarp(dqj_kdl,dqj);
-    ok = ok && KDLtoYarp(ddqj_kdl,ddqj);
-    ok = ok && KDLtoYarp(torquesj_kdl,torquesj);
-    return ok;
-}
-
-bool RobotJointStatus::updateKDLBuffers()
-{
-    bool ok = true;
-    ok = ok && YarptoKDL(qj,qj_kdl);
-    ok = ok && YarptoKDL(dqj,dqj_kdl);
-    ok = ok && YarptoKDL(ddqj,ddqj_kdl);
-    ok = ok && YarptoKDL(torquesj,torquesj_kdl);
-    return ok;
-}
-
 RobotSensorStatus::RobotSensorStatus(int nrOfFTSensors)
 {
     setNrOfFTSensors(nrOfFTSensors);
@@ -29,39 +29,38 @@ simpleLeggedOdometry::simpleLeggedOdometry():
 
 simpleLeggedOdometry::~simpleLeggedOdometry()
 {
-    if( odometry_model )
-    {
-        delete odometry_model;
-        odometry_model=0;
-    }
 }
 
-bool simpleLeggedOdometry::init(KDL::CoDyCo::UndirectedTree & undirected_tree,
+bool simpleLeggedOdometry::init(iCub::iDynTree::DynTree * model,
                                 const std::string& initial_world_frame_position,
                                 const std::string& initial_fixed_link)
 {
-    int initial_world_frame_position_index = undirected_tree.getLink(initial_world_frame_position)->getLinkIndex();
-    int initial_fixed_link_index = undirected_tree.getLink(initial_fixed_link)->getLinkIndex();;
+    if( !model )
+    {
+        return false;
+    }
+
+    int initial_world_frame_position_index = model->getLinkIndex(initial_world_frame_position);
+    int initial_fixed_link_index = model->getLinkIndex(initial_fixed_link);
     if( initial_fixed_link_index < 0 ||
         initial_world_frame_position_index < 0 )
     {
         return false;
     }
 
-    return init(undirected_tree,initial_world_frame_position_index,initial_fixed_link_index);
+    return init(model,initial_world_frame_position_index,initial_fixed_link_index);
 }
 
-bool simpleLeggedOdometry::init(KDL::CoDyCo::UndirectedTree & undirected_tree,
+bool simpleLeggedOdometry::init(iCub::iDynTree::DynTree * model,
                                 const int initial_world_frame_position_index,
                                 const int initial_fixed_link_index)
 {
-    if( odometry_model )
+    if( !model )
     {
-        delete odometry_model;
-        odometry_model=0;
+        return false;
     }
 
-    odometry_model = new iCub::iDynTree::DynTree(undirected_tree.getTree(),undirected_tree.getSerialization());
+    odometry_model = model;
     bool ok = reset(initial_world_frame_position_index,initial_fixed_link_index);
     return ok;
 }
@@ -122,28 +121,11 @@ KDL::Frame simpleLeggedOdometry::getWorldFrameTransform(const int frame_index)
     return this->world_H_fixed*fixed_H_frame;
 }
 
-bool simpleLeggedOdometry::setJointsState(const KDL::JntArray& qj,
-                                          const KDL::JntArray& dqj,
-                                          const KDL::JntArray& ddqj)
+bool simpleLeggedOdometry::updateFloatingBase()
 {
-    if( qj.rows() != static_cast<unsigned int>(odometry_model->getNrOfDOFs())  ||
-        dqj.rows() != static_cast<unsigned int>(odometry_model->getNrOfDOFs())  ||
-        ddqj.rows() != static_cast<unsigned int>(odometry_model->getNrOfDOFs()) )
-    {
-        return false;
-    }
-
-    bool ok = true ;
-
-    ok = ok && odometry_model->setAngKDL(qj);
-    ok = ok && odometry_model->setDAngKDL(dqj);
-    ok = ok && odometry_model->setD2AngKDL(ddqj);
-
-    //Update also the floating base position, given this new joint positions
+    //Update the floating base position, given the joint positions of the model
     KDL::Frame world_H_base = this->getWorldFrameTransform(odometry_model->getFloatingBaseLink());
-    ok = ok && odometry_model->setWorldBasePoseKDL(world_H_base);
-
-    return ok;
+    return odometry_model->setWorldBasePoseKDL(world_H_base);
 }
 
 const iCub::iDynTree::DynTree & simpleLeggedOdometry::getDynTree()
@@ -50,17 +50,22 @@ using namespace iCub::ctrl;
 // *********************************************************************************************************************
 // *********************************************************************************************************************
 ExternalWrenchesAndTorquesEstimator::ExternalWrenchesAndTorquesEstimator(int _period,
+                                                               iCub::iDynTree::TorqueEstimationTree * _robot_model,
                                                                yarpWholeBodySensors *_sensors,
                                                                yarp::os::BufferedPort<iCub::skinDynLib::skinContactList> * _port_skin_contacts,
                                                                yarp::os::Property & _wbi_yarp_conf
                                                               )
 :  periodInMilliSeconds(_period),
    sensors(_sensors),
+   robot_estimation_model(_robot_model),
    port_skin_contacts(_port_skin_contacts),
    enable_omega_domega_IMU(false),
    min_taxel(0),
    wbi_yarp_conf(_wbi_yarp_conf),
-   assume_fixed_base_from_odometry(false)
+   assume_fixed_base_from_odometry(false),
+   estimation_floating_base_link_index(-1),
+   l_sole_link_index(-1),
+   r_sole_link_index(-1)
 {
 
     resizeAll(sensors->getSensorNumber(SENSOR_ENCODER));
@@ -93,59 +98,38 @@ bool ExternalWrenchesAndTorquesEstimator::init()
     resizeFTs(sensors->getSensorNumber(SENSOR_FORCE_TORQUE));
     resizeIMUs(sensors->getSensorNumber(SENSOR_IMU));
 
-    //Allocation model
-    if(  !wbi_yarp_conf.check("urdf") && !wbi_yarp_conf.check("urdf_file") )
+    if( !robot_estimation_model )
     {
-        std::cerr << "yarpWholeBodyModel error: urdf not found in configuration files" << std::endl;
+        std::cerr << "[ERR] wholeBodyDynamicsStatesInterface error: no model available for the estimation" << std::endl;
         return false;
     }
 
-    std::string urdf_file;
-    if( wbi_yarp_conf.check("urdf") )
+    // The model is shared with the calibration and the odometry:
+    // instead of allocating a different model for each fixed link,
+    // the floating base link of the model is changed before each estimation
+    if( !assume_fixed_base )
     {
-        urdf_file = wbi_yarp_conf.find("urdf").asString().c_str();
-    }
-    else
-    {
-        urdf_file = wbi_yarp_conf.find("urdf_file").asString().c_str();
-    }
-
-    yarp::os::ResourceFinder rf;
-    std::string urdf_file_path = rf.findFileByName(urdf_file.c_str());
-
-    std::vector<std::string> dof_serialization;
-    IDList torque_estimation_list = sensors->getSensorList(SENSOR_ENCODER);
-    for(int dof=0; dof < (int)torque_estimation_list.size(); dof++)
-    {
-        ID wbi_id;
-        torque_estimation_list.indexToID(dof,wbi_id);
-        dof_serialization.push_back(wbi_id.toString());
-    }
-
-    std::vector<std::string> ft_serialization;
-    IDList ft_sensor_list = sensors->getSensorList(SENSOR_FORCE_TORQUE);
-    for(int ft=0; ft < (int)ft_sensor_list.size(); ft++)
-    {
-        ID wbi_id;
-        ft_sensor_list.indexToID(ft,wbi_id);
-        ft_serialization.push_back(wbi_id.toString());
-    }
-
-    {
-        std::cerr << "[DEBUG] Create TorqueEstimationTree with " << ft_serialization.size() << " ft sensors" << std::endl;
-        if( !assume_fixed_base )
+        estimation_floating_base_link_index = robot_estimation_model->getFloatingBaseLink();
+    } else {
+        estimation_floating_base_link_index = robot_estimation_model->getLinkIndex(fixed_link);
+        if( estimation_floating_base_link_index < 0 )
         {
-            robot_estimation_model = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization);
-        } else {
-            robot_estimation_model = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,fixed_link);
+            std::cerr << "[ERR] wholeBodyDynamicsStatesInterface error: fixed link " << fixed_link << " not found in urdf model" << std::endl;
+            return false;
         }
+    }
 
-        if( this->assume_fixed_base_from_odometry )
+    if( this->assume_fixed_base_from_odometry )
+    {
+        l_sole_link_index = robot_estimation_model->getLinkIndex("l_sole");
+        r_sole_link_index = robot_estimation_model->getLinkIndex("r_sole");
+        if( l_sole_link_index < 0 || r_sole_link_index < 0 )
         {
-            robot_estimation_model_on_l_sole = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,"l_sole");
-            robot_estimation_model_on_r_sole = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,"r_sole");
+            std::cerr << "[ERR] wholeBodyDynamicsStatesInterface error: l_sole or r_sole not found in urdf model" << std::endl;
+            return false;
         }
     }
+
     //Load mapping from skinDynLib to iDynTree links from configuration files
 
     if( !this->wbi_yarp_conf.check("IDYNTREE_SKINDYNLIB_LINKS") )
@@ -169,11 +153,6 @@ bool ExternalWrenchesAndTorquesEstimator::init()
         int skinDynLib_body_part = map_bot->get(1).asList()->get(1).asInt();
         int skinDynLib_link_index = map_bot->get(1).asList()->get(2).asInt();
         bool ret_sdl = robot_estimation_model->addSkinDynLibAlias(iDynTree_link_name,iDynTree_skinFrame_name,skinDynLib_body_part,skinDynLib_link_index);
-        if( this->assume_fixed_base_from_odometry )
-        {
-            robot_estimation_model_on_l_sole->addSkinDynLibAlias(iDynTree_link_name,iDynTree_skinFrame_name,skinDynLib_body_part,skinDynLib_link_index);
-            robot_estimation_model_on_r_sole->addSkinDynLibAlias(iDynTree_link_name,iDynTree_skinFrame_name,skinDynLib_body_part,skinDynLib_link_index);
-        }
 
         if( !ret_sdl )
         {
@@ -313,11 +292,9 @@ void ExternalWrenchesAndTorquesEstimator::estimateExternalWrenchAndInternalJoint
         readSkinContacts();
 
         ///< Estimate joint torque sensors from force/torque measurements
-        estimateExternalForcesAndJointTorques(joint_status,sensor_status);
-
-        ///< Filter obtained joint torque measures
+        ///< (the torques are stored in joint_status)
         // \todo reintroduce the filter ?
-        joint_status.setJointTorquesYARP(tauJ);// tauJFilt->filt(tauJ);  ///< low pass filter
+        estimateExternalForcesAndJointTorques(joint_status,sensor_status);
 
 
     }
@@ -517,20 +494,29 @@ void ExternalWrenchesAndTorquesEstimator::estimateExternalForcesAndJointTorques(
         ddp_used_IMU[2] = gravity;
     }
 
-    assert((int)joint_status.getJointPosYARP().size() == robot_estimation_model->getNrOfDOFs());
-    assert((int)joint_status.getJointVelYARP().size() == robot_estimation_model->getNrOfDOFs());
-    assert((int)joint_status.getJointAccYARP().size() == robot_estimation_model->getNrOfDOFs());
+    assert((int)joint_status.getJointPos().size() == robot_estimation_model->getNrOfDOFs());
+    assert((int)joint_status.getJointVel().size() == robot_estimation_model->getNrOfDOFs());
+    assert((int)joint_status.getJointAcc().size() == robot_estimation_model->getNrOfDOFs());
 
 
     yAssert(omega_used_IMU.size() == 3);
     yAssert(domega_used_IMU.size() == 3);
     yAssert(ddp_used_IMU.size() == 3);
-    if( !assume_fixed_base_from_odometry )
+
+    // The joint state is always set, as the model is used also by the odometry
+    robot_estimation_model->setAng(joint_status.getJointPos());
+    robot_estimation_model->setDAng(joint_status.getJointVel());
+    robot_estimation_model->setD2Ang(joint_status.getJointAcc());
+
+    int floating_base_link = getEstimationFloatingBaseLink();
+    if( floating_base_link >= 0 )
     {
+        if( robot_estimation_model->getFloatingBaseLink() != floating_base_link )
+        {
+            robot_estimation_model->setFloatingBaseLink(floating_base_link);
+        }
+
         bool ok = robot_estimation_model->setInertialMeasure(omega_used_IMU,domega_used_IMU,ddp_used_IMU);
-        robot_estimation_model->setAng(joint_status.getJointPosYARP());
-        robot_estimation_model->setDAng(joint_status.getJointVelYARP());
-        robot_estimation_model->setD2Ang(joint_status.getJointAccYARP());
 
         for(int i=0; i < robot_estimation_model->getNrOfFTSensors(); i++ ) {
             assert(sensor_status.estimated_ft_sensors[i].size() == 6);
@@ -551,61 +537,6 @@ void ExternalWrenchesAndTorquesEstimator::estimateExternalForcesAndJointTorques(
         estimatedLastDynContacts = robot_estimation_model->getContacts();
     }
 
-    if( assume_fixed_base_from_odometry )
-    {
-        if( this->current_fixed_link_name == "r_foot" )
-        {
-            bool ok = robot_estimation_model_on_r_sole->setInertialMeasure(omega_used_IMU,domega_used_IMU,ddp_used_IMU);
-            robot_estimation_model_on_r_sole->setAng(joint_status.getJointPosYARP());
-            robot_estimation_model_on_r_sole->setDAng(joint_status.getJointVelYARP());
-            robot_estimation_model_on_r_sole->setD2Ang(joint_status.getJointAccYARP());
-
-            for(int i=0; i < robot_estimation_model_on_r_sole->getNrOfFTSensors(); i++ ) {
-                assert(sensor_status.estimated_ft_sensors[i].size() == 6);
-                ok  = ok && robot_estimation_model_on_r_sole->setSensorMeasurement(i,sensor_status.estimated_ft_sensors[i]);
-            }
-            robot_estimation_model_on_r_sole->setContacts(dynContacts);
-
-            ok = ok && robot_estimation_model_on_r_sole->kinematicRNEA();
-            ok = ok && robot_estimation_model_on_r_sole->estimateContactForcesFromSkin();
-            ok = ok && robot_estimation_model_on_r_sole->dynamicRNEA();
-            ok = ok && robot_estimation_model_on_r_sole->computePositions();
-
-            if( !ok )
-            {
-                yError() << "wholeBodyDynamics: external forces computation and torque estimation failed";
-            }
-
-            estimatedLastDynContacts = robot_estimation_model_on_r_sole->getContacts();
-        }
-
-        if( this->current_fixed_link_name == "l_foot" )
-        {
-            bool ok = robot_estimation_model_on_l_sole->setInertialMeasure(omega_used_IMU,domega_used_IMU,ddp_used_IMU);
-            robot_estimation_model_on_l_sole->setAng(joint_status.getJointPosYARP());
-            robot_estimation_model_on_l_sole->setDAng(joint_status.getJointVelYARP());
-            robot_estimation_model_on_l_sole->setD2Ang(joint_status.getJointAccYARP());
-
-            for(int i=0; i < robot_estimation_model_on_l_sole->getNrOfFTSensors(); i++ ) {
-                assert(sensor_status.estimated_ft_sensors[i].size() == 6);
-                ok  = ok && robot_estimation_model_on_l_sole->setSensorMeasurement(i,sensor_status.estimated_ft_sensors[i]);
-            }
-            robot_estimation_model_on_l_sole->setContacts(dynContacts);
-
-            ok = ok && robot_estimation_model_on_l_sole->kinematicRNEA();
-            ok = ok && robot_estimation_model_on_l_sole->estimateContactForcesFromSkin();
-            ok = ok && robot_estimation_model_on_l_sole->dynamicRNEA();
-            ok = ok && robot_estimation_model_on_l_sole->computePositions();
-
-            if( !ok )
-            {
-                yError() << "wholeBodyDynamics: external forces computation and torque estimation failed";
-            }
-
-            estimatedLastDynContacts = robot_estimation_model_on_l_sole->getContacts();
-        }
-    }
-
     //Create estimatedLastSkinDynContacts using original skinContacts list read from skinManager
     // for each dynContact find the related skinContact (if any) and set the wrench in it
     unsigned long cId;
@@ -635,25 +566,32 @@ void ExternalWrenchesAndTorquesEstimator::estimateExternalForcesAndJointTorques(
 
 
 
-    assert((int)tauJ.size() == robot_estimation_model->getNrOfDOFs());
+    if( floating_base_link >= 0 )
+    {
+        assert((int)joint_status.getJointTorques().size() == robot_estimation_model->getNrOfDOFs());
+        joint_status.setJointTorques(robot_estimation_model->getTorques());
+    }
+
+}
+
+int ExternalWrenchesAndTorquesEstimator::getEstimationFloatingBaseLink()
+{
     if( !this->assume_fixed_base_from_odometry )
     {
-        tauJ = robot_estimation_model->getTorques();
+        return estimation_floating_base_link_index;
     }
 
-    if( this->assume_fixed_base_from_odometry )
+    if( this->current_fixed_link_name == "r_foot" )
     {
-        if( this->current_fixed_link_name == "r_foot" )
-        {
-            tauJ = robot_estimation_model_on_r_sole->getTorques();
-        }
+        return r_sole_link_index;
+    }
 
-        if( this->current_fixed_link_name == "l_foot" )
-        {
-            tauJ = robot_estimation_model_on_l_sole->getTorques();
-        }
+    if( this->current_fixed_link_name == "l_foot" )
+    {
+        return l_sole_link_index;
     }
 
+    return -1;
 }
 
 
@@ -675,8 +613,6 @@ void ExternalWrenchesAndTorquesEstimator::resizeAll(int n)
 {
     q.resize(n,0.0);
     qStamps.resize(n,INITIAL_TIMESTAMP);
-    tauJ.resize(n,0.0);
-    tauJStamps.resize(n,INITIAL_TIMESTAMP);
 }
 
 
@@ -713,3 +649,16 @@ bool ExternalWrenchesAndTorquesEstimator::setMinTaxel(const int _min_taxel)
     min_taxel = _min_taxel;
     return true;
 }
+
+bool ExternalWrenchesAndTorquesEstimator::usesOnlyDefaultContacts() const
+{
+    // when the skin stops detecting contacts the old ones are kept, with no active taxels
+    for(skinContactList::const_iterator it=skinContacts.begin(); it!=skinContacts.end(); it++)
+    {
+        if( (int)it->getActiveTaxels() > min_taxel )
+        {
+            return false;
+        }
+    }
+    return true;
+}
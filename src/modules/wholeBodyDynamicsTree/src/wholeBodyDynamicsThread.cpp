@@ -32,6 +32,7 @@
 #include <yarp/math/SVD.h>
 
 // System includes
+#include <cmath>
 #include <cstring>
 #include <ctime>
 
@@ -72,6 +73,10 @@ wholeBodyDynamicsThread::wholeBodyDynamicsThread(string _name,
        fixed_link_calibration(_fixed_link_calibration),
        assume_fixed_base_calibration_from_odometry(_assume_fixed_base_calibration_from_odometry),
        run_mutex_acquired(false),
+       offset_smoother(0),
+       offset_tracker(0),
+       offset_tracking(false),
+       icub_model(0),
        odometry_enabled(false)
 {
         // TODO FIXME move all this logic in threadInit
@@ -117,21 +122,10 @@ wholeBodyDynamicsThread::wholeBodyDynamicsThread(string _name,
         ft_serialization.push_back(wbi_id.toString());
     }
 
-       if( assume_fixed_base_calibration ) {
-           icub_model_calibration = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,fixed_link_calibration);
-           icub_model_world_base_position = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,fixed_link_calibration);
-       }
-       else if( assume_fixed_base_calibration_from_odometry )
-       {
-           icub_model_calibration_on_l_sole = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,"l_sole");
-           icub_model_calibration_on_r_sole = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization,"r_sole");
-           icub_model_calibration = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization);
-       }
-       else
-       {
-           icub_model_calibration = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization);
-           icub_model_world_base_position = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization);
-       }
+    // A single model is used for estimation, calibration and odometry:
+    // the fixed links of the different computations are handled by changing
+    // the floating base link of the model
+    icub_model = new iCub::iDynTree::TorqueEstimationTree(urdf_file_path,dof_serialization,ft_serialization);
 
     iCubGuiBase.resize(6);
     FilteredInertialForGravityComp.resize(6);
@@ -217,7 +211,7 @@ bool wholeBodyDynamicsThread::loadExternalWrenchesPortsConfigurations()
     for(unsigned i=0; i < output_wrench_ports.size(); i++ )
     {
         output_wrench_ports[i].link_index =
-            icub_model_calibration->getFrameIndex(output_wrench_ports[i].link);
+            icub_model->getFrameIndex(output_wrench_ports[i].link);
         if( output_wrench_ports[i].link_index < 0 )
         {
             yError() << "Link " << output_wrench_ports[i].link << " not found in the model.";
@@ -225,13 +219,7 @@ bool wholeBodyDynamicsThread::loadExternalWrenchesPortsConfigurations()
         }
 
         output_wrench_ports[i].origin_frame_index =
-            icub_model_calibration->getFrameIndex(output_wrench_ports[i].origin_frame);
-
-        if( this->assume_fixed_base_calibration_from_odometry )
-        {
-            yAssert(icub_model_calibration->getFrameIndex(output_wrench_ports[i].origin_frame) == icub_model_calibration_on_l_sole->getFrameIndex(output_wrench_ports[i].origin_frame));
-            yAssert(icub_model_calibration->getFrameIndex(output_wrench_ports[i].origin_frame) == icub_model_calibration_on_r_sole->getFrameIndex(output_wrench_ports[i].origin_frame))
-        }
+            icub_model->getFrameIndex(output_wrench_ports[i].origin_frame);
 
 
         if( output_wrench_ports[i].origin_frame_index < 0 )
@@ -242,13 +230,7 @@ bool wholeBodyDynamicsThread::loadExternalWrenchesPortsConfigurations()
 
 
         output_wrench_ports[i].orientation_frame_index =
-            icub_model_calibration->getFrameIndex(output_wrench_ports[i].orientation_frame);
-
-        if( this->assume_fixed_base_calibration_from_odometry )
-        {
-            yAssert(icub_model_calibration->getFrameIndex(output_wrench_ports[i].orientation_frame) == icub_model_calibration_on_l_sole->getFrameIndex(output_wrench_ports[i].orientation_frame));
-            yAssert(icub_model_calibration->getFrameIndex(output_wrench_ports[i].orientation_frame) == icub_model_calibration_on_r_sole->getFrameIndex(output_wrench_ports[i].orientation_frame))
-        }
+            icub_model->getFrameIndex(output_wrench_ports[i].orientation_frame);
 
 
         if( output_wrench_ports[i].orientation_frame_index < 0 )
@@ -342,6 +324,12 @@ bool wholeBodyDynamicsThread::loadEstimatedTorquesPortsConfigurations()
 //*************************************************************************************************************************
 bool wholeBodyDynamicsThread::threadInit()
 {
+    if( !icub_model )
+    {
+        yError() << "wholeBodyDynamicsThread::threadInit() error: model of the robot not loaded";
+        return false;
+    }
+
     bool ret = this->loadExternalWrenchesPortsConfigurations();
 
     ret = ret && this->loadEstimatedTorquesPortsConfigurations();
@@ -358,6 +346,7 @@ bool wholeBodyDynamicsThread::threadInit()
     // Open estimator
     int periodInMilliseconds = (int)getRate();
     this->externalWrenchTorqueEstimator = new ExternalWrenchesAndTorquesEstimator(periodInMilliseconds,
+                                                                                  icub_model,
                                                                                   (yarpWbi::yarpWholeBodySensors *)sensors,
                                                                                             port_contacts_input,
                                                                                              yarp_options);
@@ -403,20 +392,79 @@ bool wholeBodyDynamicsThread::threadInit()
         yInfo() << "Smooth calibration option enabled, with switching period of  " << smooth_calibration_period_in_ms << " milliseconds";
     }
 
+    // Open offset tracking configuration
+    OffsetTrackerParameters offset_tracking_params;
+    offset_tracking = yarp_options.check("offset_tracking");
+    if( offset_tracking )
+    {
+        std::string offset_tracking_support = yarp_options.find("offset_tracking").asString().c_str();
+        offset_tracking_on_double_support = ( offset_tracking_support == "" || offset_tracking_support == "double_support" );
+        offset_tracking_floating_base_link_idyntree_id = -1;
+        if( !offset_tracking_on_double_support )
+        {
+            offset_tracking_floating_base_link_idyntree_id = icub_model->getLinkIndex(offset_tracking_support);
+            if( offset_tracking_floating_base_link_idyntree_id < 0 )
+            {
+                yError() << "wholeBodyDynamicsThread: offset_tracking support link " << offset_tracking_support << " not found in the model";
+                return false;
+            }
+        }
+
+        offset_tracking_params.max_joint_velocity = yarp_options.check("offset_tracking_max_joint_vel",yarp::os::Value(offset_tracking_params.max_joint_velocity)).asDouble();
+        offset_tracking_params.max_force_std = yarp_options.check("offset_tracking_max_force_std",yarp::os::Value(offset_tracking_params.max_force_std)).asDouble();
+        offset_tracking_params.max_torque_std = yarp_options.check("offset_tracking_max_torque_std",yarp::os::Value(offset_tracking_params.max_torque_std)).asDouble();
+        offset_tracking_params.min_quasi_static_time = yarp_options.check("offset_tracking_min_static_time",yarp::os::Value(offset_tracking_params.min_quasi_static_time)).asDouble();
+        offset_tracking_params.force_offset_drift = yarp_options.check("offset_tracking_force_drift",yarp::os::Value(offset_tracking_params.force_offset_drift)).asDouble();
+        offset_tracking_params.torque_offset_drift = yarp_options.check("offset_tracking_torque_drift",yarp::os::Value(offset_tracking_params.torque_offset_drift)).asDouble();
+        offset_tracking_update_period = yarp_options.check("offset_tracking_update_period",yarp::os::Value(5.0)).asDouble();
+        offset_tracking_min_support_force = yarp_options.check("offset_tracking_min_support_force",yarp::os::Value(50.0)).asDouble();
+
+        // The support is checked on the foot F/T sensors, or on the leg ones if the feet have none
+        offset_tracking_left_foot_ft_id = icub_model->getFTSensorIndex("l_foot_ft_sensor");
+        if( offset_tracking_left_foot_ft_id < 0 )
+        {
+            offset_tracking_left_foot_ft_id = icub_model->getFTSensorIndex("l_leg_ft_sensor");
+        }
+        offset_tracking_right_foot_ft_id = icub_model->getFTSensorIndex("r_foot_ft_sensor");
+        if( offset_tracking_right_foot_ft_id < 0 )
+        {
+            offset_tracking_right_foot_ft_id = icub_model->getFTSensorIndex("r_leg_ft_sensor");
+        }
+        if( offset_tracking_left_foot_ft_id < 0 || offset_tracking_right_foot_ft_id < 0 )
+        {
+            yError() << "wholeBodyDynamicsThread: offset_tracking needs the F/T sensors of the legs, to check the support";
+            return false;
+        }
+
+        offset_tracking_support_foot = "";
+        if( offset_tracking_support == "l_foot" || offset_tracking_support == "l_sole" )
+        {
+            offset_tracking_support_foot = "l_foot";
+        }
+        if( offset_tracking_support == "r_foot" || offset_tracking_support == "r_sole" )
+        {
+            offset_tracking_support_foot = "r_foot";
+        }
+        offset_tracking_phase_start = offset_tracking_last_handover = 0.0;
+
+        yInfo() << "Offset tracking option enabled, on support " << (offset_tracking_on_double_support ? "double_support" : offset_tracking_support)
+                << " with offsets updated every " << offset_tracking_update_period << " seconds of quasi-static phase";
+    }
+
 
     //Calibration variables
     int nrOfAvailableFTSensors = sensors->getSensorList(wbi::SENSOR_FORCE_TORQUE).size();
-    if( nrOfAvailableFTSensors != icub_model_calibration->getNrOfFTSensors() ) {
+    if( nrOfAvailableFTSensors != icub_model->getNrOfFTSensors() ) {
         yError() << "wholeBodyDynamicsThread::threadInit() error: number of FT sensors different between model (" <<
-        icub_model_calibration->getNrOfFTSensors() << ") and interface (" << nrOfAvailableFTSensors << " ) ";
+        icub_model->getNrOfFTSensors() << ") and interface (" << nrOfAvailableFTSensors << " ) ";
         return false;
     }
 
     offset_buffer.resize(nrOfAvailableFTSensors,yarp::sig::Vector(6,0.0));
     calibrate_ft_sensor.resize(nrOfAvailableFTSensors,false);
-    joint_status.setNrOfDOFs(icub_model_calibration->getNrOfDOFs());
+    joint_status.setNrOfDOFs(icub_model->getNrOfDOFs());
     sensor_status.setNrOfFTSensors(nrOfAvailableFTSensors);
-    zero_dof_elem_vector.resize(icub_model_calibration->getNrOfDOFs(),0.0);
+    zero_dof_elem_vector.resize(icub_model->getNrOfDOFs(),0.0);
     zero_three_elem_vector.resize(3,0.0);
     calibration_ddp.resize(3,0.0);
 
@@ -468,17 +516,17 @@ bool wholeBodyDynamicsThread::threadInit()
     //Find end effector ids
     int max_id = 100;
 
-    root_link_idyntree_id = icub_model_calibration->getLinkIndex("root_link");
+    root_link_idyntree_id = icub_model->getLinkIndex("root_link");
     //yAssert(root_link_idyntree_id >= 0 && root_link_idyntree_id < max_id );
-    left_foot_link_idyntree_id = icub_model_calibration->getLinkIndex("l_foot");
+    left_foot_link_idyntree_id = icub_model->getLinkIndex("l_foot");
     //yAssert(left_foot_link_idyntree_id >= 0  && left_foot_link_idyntree_id < max_id);
-    right_foot_link_idyntree_id = icub_model_calibration->getLinkIndex("r_foot");
+    right_foot_link_idyntree_id = icub_model->getLinkIndex("r_foot");
     //yAssert(right_foot_link_idyntree_id >= 0 && right_foot_link_idyntree_id < max_id);
     joint_status.zero();
 
     if( assume_fixed_base_calibration )
     {
-        icubgui_support_frame_idyntree_id = icub_model_calibration->getLinkIndex(fixed_link_calibration);
+        icubgui_support_frame_idyntree_id = icub_model->getLinkIndex(fixed_link_calibration);
 
         if( icubgui_support_frame_idyntree_id < 0 )
         {
@@ -491,10 +539,21 @@ bool wholeBodyDynamicsThread::threadInit()
         icubgui_support_frame_idyntree_id = left_foot_link_idyntree_id;
     }
 
-    icub_model_calibration->setAng(joint_status.getJointPosYARP());
+    // Floating base link used by the calibration on double support
+    if( assume_fixed_base_calibration )
+    {
+        calibration_floating_base_link_idyntree_id = icub_model->getLinkIndex(fixed_link_calibration);
+    }
+    else
+    {
+        calibration_floating_base_link_idyntree_id = icub_model->getFloatingBaseLink();
+    }
+    active_calibration_floating_base_link_idyntree_id = calibration_floating_base_link_idyntree_id;
+
+    icub_model->setAng(joint_status.getJointPos());
     //{}^world H_{leftFoot}
     initial_world_H_supportFrame
-            = icub_model_calibration->getPositionKDL(root_link_idyntree_id,icubgui_support_frame_idyntree_id);
+            = icub_model->getPositionKDL(root_link_idyntree_id,icubgui_support_frame_idyntree_id);
 
     //Open and connect all the ports
     for(int output_torque_port_i = 0; output_torque_port_i < (int)output_torque_ports.size(); output_torque_port_i++ )
@@ -622,11 +681,25 @@ bool wholeBodyDynamicsThread::threadInit()
     {
         offset_smoother = new OffsetSmoother(nrOfAvailableFTSensors,smooth_calibration_period_in_ms/1000.0);
     }
+    else if( offset_tracking )
+    {
+        // the tracked offsets are always applied smoothly
+        offset_smoother = new OffsetSmoother(nrOfAvailableFTSensors,1.0);
+    }
     else
     {
         offset_smoother = 0;
     }
 
+    if( offset_tracking )
+    {
+        offset_tracker = new OffsetTracker(nrOfAvailableFTSensors,offset_tracking_params);
+    }
+    else
+    {
+        offset_tracker = 0;
+    }
+
 
     if( this->autoconnect )
     {
@@ -639,7 +712,7 @@ bool wholeBodyDynamicsThread::threadInit()
             std::string port_name = output_torque_ports[output_torque_port_i].port_name;
             std::string local_port = "/" + moduleName + "/" + port_name + "/Torques:o";
             std::string robot_port = "/" + robotName  + "/joint_vsens/" + port_name + ":i";
-            output_torque_ports[output_torque_port_i].output_port = new BufferedPort<Bottle>;
+            output_torque_ports[output_torque_port_i].output_port = new BufferedPort<TorquesPortable>;
             output_torque_ports[output_torque_port_i].output_port->open(local_port);
             if( autoconnect && Network::exists(robot_port) )
             {
@@ -701,13 +774,7 @@ bool wholeBodyDynamicsThread::calibrateOffset(const std::string calib_code, int
     }
 
     //Changing the base of the calibration model to the root link
-    icub_model_calibration->setFloatingBaseLink(icub_model_calibration->getLinkIndex(calibration_support_link));
-
-    if( this->assume_fixed_base_calibration_from_odometry )
-    {
-        icub_model_calibration_on_l_sole->setFloatingBaseLink(icub_model_calibration_on_l_sole->getLinkIndex(calibration_support_link));
-        icub_model_calibration_on_r_sole->setFloatingBaseLink(icub_model_calibration_on_r_sole->getLinkIndex(calibration_support_link));
-    }
+    active_calibration_floating_base_link_idyntree_id = icub_model->getLinkIndex(calibration_support_link);
 
     calibration_mutex.lock();
     std::cout << "wholeBodyDynamicsThread::calibrateOffset " << calib_code  << " called successfully, starting calibration." << std::endl;
@@ -801,6 +868,9 @@ bool wholeBodyDynamicsThread::calibrateOffsetOnDoubleSupport(const std::string c
         }
     }
 
+    //Changing the base of the model to the one used for calibration
+    active_calibration_floating_base_link_idyntree_id = getDoubleSupportCalibrationFloatingBaseLink();
+
     calibration_mutex.lock();
     yInfo() << "wholeBodyDynamicsThread::calibrateOffset " << calib_code  << " called successfully, starting calibration.";
     wbd_mode = CALIBRATING_ON_DOUBLE_SUPPORT;
@@ -836,13 +906,7 @@ bool wholeBodyDynamicsThread::calibrateOffsetOnLeftFootSingleSupport(const std::
     }
 
      //Changing the base of the calibration model to the left foot
-    icub_model_calibration->setFloatingBaseLink(icub_model_calibration->getLinkIndex("l_sole"));
-
-    if( this->assume_fixed_base_calibration_from_odometry )
-    {
-        icub_model_calibration_on_l_sole->setFloatingBaseLink(icub_model_calibration_on_l_sole->getLinkIndex("l_sole"));
-        icub_model_calibration_on_r_sole->setFloatingBaseLink(icub_model_calibration_on_r_sole->getLinkIndex("l_sole"));
-    }
+    active_calibration_floating_base_link_idyntree_id = icub_model->getLinkIndex("l_sole");
 
     calibration_mutex.lock();
     yInfo() << "wholeBodyDynamicsThread::calibrateOffsetOnLeftFootSingleSupport " << calib_code  << " called successfully, starting calibration.";
@@ -880,13 +944,7 @@ bool wholeBodyDynamicsThread::calibrateOffsetOnRightFootSingleSupport(const std:
     }
 
     //Changing the base of the calibration model to the left foot
-    icub_model_calibration->setFloatingBaseLink(icub_model_calibration->getLinkIndex("r_sole"));
-
-    if( this->assume_fixed_base_calibration_from_odometry )
-    {
-        icub_model_calibration_on_l_sole->setFloatingBaseLink(icub_model_calibration_on_l_sole->getLinkIndex("r_sole"));
-        icub_model_calibration_on_r_sole->setFloatingBaseLink(icub_model_calibration_on_r_sole->getLinkIndex("r_sole"));
-    }
+    active_calibration_floating_base_link_idyntree_id = icub_model->getLinkIndex("r_sole");
 
     calibration_mutex.lock();
     yInfo() << "wholeBodyDynamicsThread::calibrateOffsetOnRightFootSingleSupport " << calib_code  << " called successfully, starting calibration.";
@@ -911,6 +969,10 @@ bool wholeBodyDynamicsThread::resetOffset(const std::string calib_code)
     for(int ft_id = 0; ft_id < (int)calibrate_ft_sensor.size(); ft_id++ ) {
         if( calibrate_ft_sensor[ft_id] ) {
             sensor_status.ft_sensors_offset[ft_id] = 0.0;
+            if( offset_tracker )
+            {
+                offset_tracker->setOffset(ft_id,sensor_status.ft_sensors_offset[ft_id]);
+            }
         }
     }
 
@@ -983,9 +1045,8 @@ bool wholeBodyDynamicsThread::initOdometry()
         this->frames_streaming_enabled = false;
     }
 
-    // Allocate model
-    KDL::CoDyCo::UndirectedTree undirected_tree = this->icub_model_calibration->getKDLUndirectedTree();
-    bool ok = this->odometry_helper.init(undirected_tree,
+    // The odometry uses the model shared with the estimation
+    bool ok = this->odometry_helper.init(icub_model,
                                          initial_world_frame,
                                          initial_fixed_link);
     this->current_fixed_link_name = initial_fixed_link;
@@ -1007,9 +1068,6 @@ bool wholeBodyDynamicsThread::initOdometry()
            << initial_world_frame << " and initial fixed link " << initial_fixed_link;
 
     this->odometry_enabled = true;
-    world_H_floatingbase.resize(4,4);
-    floatingbase_twist.resize(6,0.0);
-    floatingbase_acctwist.resize(6,0.0);
 
     // Get id of frames to stream
     if( this->frames_streaming_enabled )
@@ -1037,19 +1095,14 @@ bool wholeBodyDynamicsThread::initOdometry()
             frames_to_stream_indices.push_back(frame_index);
         }
 
-        buffer_bottles.resize(frames_to_stream.size());
-
-        for(size_t i=0; i < buffer_bottles.size(); i++ )
+        for(size_t i=0; i < frames_to_stream.size(); i++ )
         {
             yInfo("wholeBodyDynamicsTree: streaming world position of frame %s",frames_to_stream[i].c_str());
-            buffer_bottles[i].addList();
         }
-
-        buffer_transform_matrix.resize(4,4);
     }
 
     // Open ports
-    port_floatingbasestate = new BufferedPort<Bottle>;
+    port_floatingbasestate = new BufferedPort<FloatingBaseStatePortable>;
     port_floatingbasestate->open(string("/"+moduleName+"/floatingbasestate:o"));
 
     if( this->com_streaming_enabled )
@@ -1060,7 +1113,7 @@ bool wholeBodyDynamicsThread::initOdometry()
 
     if( this->frames_streaming_enabled )
     {
-        port_frames = new BufferedPort<Property>;
+        port_frames = new BufferedPort<FramesPortable>;
         port_frames->open(string("/"+moduleName+"/frames:o"));
     }
 
@@ -1071,24 +1124,17 @@ void wholeBodyDynamicsThread::publishOdometry()
 {
     if( this->odometry_enabled )
     {
-        // Read joint position, velocity and accelerations into the odometry helper model
-        // This could be avoided by using the same geometric model
-        // for odometry, force/torque estimation and sensor force/torque calibration
-        odometry_helper.setJointsState(joint_status.getJointPosKDL(),
-                                       joint_status.getJointVelKDL(),
-                                       joint_status.getJointAccKDL());
+        // The odometry uses the same model of the estimation,
+        // so the joint state of the model has already been set
+        odometry_helper.updateFloatingBase();
 
         // Get floating base position in the world
         KDL::Frame world_H_floatingbase_kdl = odometry_helper.getWorldFrameTransform(this->odometry_floating_base_frame_index);
 
         // Publish the floating base position on the port
-        KDLtoYarp_position(world_H_floatingbase_kdl,this->world_H_floatingbase);
-
-        yarp::os::Bottle & bot = port_floatingbasestate->prepare();
-        bot.clear();
-        bot.addList().read(this->world_H_floatingbase);
-        bot.addList().read(this->floatingbase_twist);
-        bot.addList().read(this->floatingbase_acctwist);
+        // (the twist and the acceleration twist are not estimated, and they are always zero)
+        FloatingBaseStatePortable & floatingbase_state = port_floatingbasestate->prepare();
+        KDLtoYarp_position(world_H_floatingbase_kdl,floatingbase_state.world_H_floatingbase);
 
         port_floatingbasestate->write();
 
@@ -1099,7 +1145,10 @@ void wholeBodyDynamicsThread::publishOdometry()
             KDL::Vector com = odometry_helper.getDynTree().getCOMKDL();
 
             yarp::sig::Vector & com_to_send = port_com->prepare();
-            com_to_send.resize(3);
+            if( com_to_send.size() != 3 )
+            {
+                com_to_send.resize(3);
+            }
 
             KDLtoYarp(com,com_to_send);
 
@@ -1108,17 +1157,15 @@ void wholeBodyDynamicsThread::publishOdometry()
 
         if( this->frames_streaming_enabled )
         {
-            // Stream frames in a property (highly inefficient! clean as soon as possible)
-            Property& output = port_frames->prepare();
+            // Stream frames (serialized as a Property with the frame names as keys)
+            FramesPortable & output = port_frames->prepare();
+            output.setFrameNames(&frames_to_stream);
 
-            for(int i =0; i < frames_to_stream.size(); i++ )
+            for(size_t i =0; i < frames_to_stream.size(); i++ )
             {
                 KDL::Frame frame_to_publish = odometry_helper.getWorldFrameTransform(frames_to_stream_indices[i]);
 
-                KDLtoYarp_position(frame_to_publish,buffer_transform_matrix);
-
-                buffer_bottles[i].get(0).asList()->read(buffer_transform_matrix);
-                output.put(frames_to_stream[i].c_str(),buffer_bottles[i].get(0));
+                KDLtoYarp_position(frame_to_publish,output.world_H_frames[i]);
             }
 
             port_frames->write();
@@ -1235,28 +1282,7 @@ void wholeBodyDynamicsThread::getExternalWrenches()
         int frame_origin_id = output_wrench_ports[i].origin_frame_index;
         int frame_orientation_id = output_wrench_ports[i].orientation_frame_index;
 
-        KDL::Wrench f;
-
-        if( !this->assume_fixed_base_calibration_from_odometry  )
-        {
-            f = externalWrenchTorqueEstimator->robot_estimation_model->getExternalForceTorqueKDL(link_id,frame_origin_id,frame_orientation_id);
-        }
-
-        if( this->assume_fixed_base_calibration_from_odometry )
-        {
-            if( this->current_fixed_link_name == "r_foot" )
-            {
-                f = externalWrenchTorqueEstimator->robot_estimation_model_on_r_sole->getExternalForceTorqueKDL(link_id,frame_origin_id,frame_orientation_id);
-            }
-            else if( this->current_fixed_link_name == "l_foot" )
-            {
-                f = externalWrenchTorqueEstimator->robot_estimation_model_on_l_sole->getExternalForceTorqueKDL(link_id,frame_origin_id,frame_orientation_id);
-            }
-            else
-            {
-                yAssert(false);
-            }
-        }
+        KDL::Wrench f = icub_model->getExternalForceTorqueKDL(link_id,frame_origin_id,frame_orientation_id);
 
         // We can do that just because the translational-angular serialization
         // is the same in KDL and wbi
@@ -1279,13 +1305,13 @@ void wholeBodyDynamicsThread::publishTorques()
             output_vector_index++)
         {
             int torque_wbi_numeric_id = output_torque_ports[output_torque_port_id].wbi_numeric_ids_to_publish[output_vector_index];
-            if( torque_wbi_numeric_id >= joint_status.getJointTorquesYARP().size() || torque_wbi_numeric_id < 0 )
+            if( torque_wbi_numeric_id >= joint_status.getJointTorques().size() || torque_wbi_numeric_id < 0 )
             {
-                //std::cerr << "Warning: tryng to access element " << torque_wbi_numeric_id << " of vector of size " << joint_status.getJointTorquesYARP().size() << std::endl;
+                //std::cerr << "Warning: tryng to access element " << torque_wbi_numeric_id << " of vector of size " << joint_status.getJointTorques().size() << std::endl;
             }
             else
             {
-                output_torque_ports[output_torque_port_id].output_vector[output_vector_index] = joint_status.getJointTorquesYARP()[torque_wbi_numeric_id];
+                output_torque_ports[output_torque_port_id].output_vector[output_vector_index] = joint_status.getJointTorques()[torque_wbi_numeric_id];
             }
         }
 
@@ -1340,11 +1366,10 @@ void wholeBodyDynamicsThread::publishBaseToGui()
         //For the icubGui, the world is the root frame when q == 0
         //So we have to find the transformation between the root now
         //and the root when q == 0
-        icub_model_world_base_position->setAngKDL(joint_status.getJointPosKDL());
-
+        //The joint positions of the model have already been set by the estimation
         // {}^{supportFrame} H_{currentRoot}
         KDL::Frame H_supportFrame_currentRoot
-            = icub_model_world_base_position->getPositionKDL(icubgui_support_frame_idyntree_id,root_link_idyntree_id);
+            = icub_model->getPositionKDL(icubgui_support_frame_idyntree_id,root_link_idyntree_id);
 
         world_H_rootLink
             = initial_world_H_supportFrame*H_supportFrame_currentRoot;
@@ -1415,21 +1440,15 @@ void wholeBodyDynamicsThread::readRobotStatus()
     double * stamps = NULL;
 
     // Get joint encoders position, velocities and accelerations
-    sensors->readSensors(wbi::SENSOR_ENCODER_POS, joint_status.getJointPosKDL().data.data(), stamps, wait);
-    sensors->readSensors(wbi::SENSOR_ENCODER_SPEED, joint_status.getJointVelKDL().data.data(), stamps, wait);
-    sensors->readSensors(wbi::SENSOR_ENCODER_ACCELERATION, joint_status.getJointAccKDL().data.data(), stamps, wait);
-
-    // Update yarp vectors
-    joint_status.updateYarpBuffers();
+    sensors->readSensors(wbi::SENSOR_ENCODER_POS, joint_status.getJointPos().data(), stamps, wait);
+    sensors->readSensors(wbi::SENSOR_ENCODER_SPEED, joint_status.getJointVel().data(), stamps, wait);
+    sensors->readSensors(wbi::SENSOR_ENCODER_ACCELERATION, joint_status.getJointAcc().data(), stamps, wait);
 
     // if the user requested to filter the encoder speed and acceleration, we filter them
     if( filters->enableVelAccFiltering )
     {
-        joint_status.getJointVelYARP() = filters->jointVelFilter->filt(joint_status.getJointVelYARP());
-        joint_status.getJointAccYARP() = filters->jointAccFilter->filt(joint_status.getJointAccYARP());
-
-        // As we modified the yarp buffers, we need to update the KDL ones.
-        joint_status.updateKDLBuffers();
+        joint_status.setJointVel(filters->jointVelFilter->filt(joint_status.getJointVel()));
+        joint_status.setJointAcc(filters->jointAccFilter->filt(joint_status.getJointAcc()));
     }
 
     // Get 6-Axis F/T sensors measure
@@ -1534,7 +1553,7 @@ void wholeBodyDynamicsThread::estimation_run()
     bool ret;
 
     // Update smoothed offset
-    if( this->smooth_calibration )
+    if( this->offset_smoother )
     {
         double now = yarp::os::Time::now();
         for(unsigned int i=0; i < this->sensor_status.ft_sensors_offset.size(); i++ )
@@ -1575,6 +1594,12 @@ void wholeBodyDynamicsThread::estimation_run()
     //Send filtered force torque sensor measurment, if requested
     publishFilteredFTWithoutOffset();
 
+    //Refine the offsets, if the robot is quasi-static (not while calibrating)
+    if( this->offset_tracker && wbd_mode == NORMAL )
+    {
+        trackOffsets();
+    }
+
     //if normal mode, publish the
     printCountdown = (printCountdown>=printPeriod) ? 0 : printCountdown +(int)getRate();   // countdown for next print (see sendMsg method)
 
@@ -1610,18 +1635,134 @@ void wholeBodyDynamicsThread::setNewFTOffset(const int ft_sensor_id, const yarp:
     if( !smooth_calibration )
     {
         sensor_status.ft_sensors_offset[ft_sensor_id] = new_offset;
+
+        //A tracked offset handover still being smoothed would overwrite the calibration
+        if( offset_smoother )
+        {
+            offset_smoother->is_smoothing[ft_sensor_id] = false;
+        }
     }
     else
     {
         offset_smoother->setNewOffset(yarp::os::Time::now(),ft_sensor_id,new_offset,sensor_status.ft_sensors_offset[ft_sensor_id]);
     }
+
+    //The calibrated offset is the new starting point of the tracking
+    if( offset_tracker )
+    {
+        offset_tracker->setOffset(ft_sensor_id,new_offset);
+    }
 }
 
 //*************************************************************************************************************************
-void wholeBodyDynamicsThread::calibration_run()
+void wholeBodyDynamicsThread::trackOffsets()
 {
-    //std::cout << "wholeBodyDynamicsThread::calibration_run(): estimates obtained" << std::endl;
+    double now = yarp::os::Time::now();
+    double dt = getRate()*1e-3;
+
+    bool was_quasi_static = offset_tracker->isQuasiStatic();
+    bool quasi_static = offset_tracker->updateQuasiStaticDetection(dt,
+                                                                   joint_status.getJointVel(),
+                                                                   sensor_status.measured_ft_sensors,
+                                                                   externalWrenchTorqueEstimator->usesOnlyDefaultContacts());
+
+    if( quasi_static )
+    {
+        if( !was_quasi_static )
+        {
+            offset_tracking_phase_start = offset_tracking_last_handover = now;
+        }
+
+        //The model is evaluated only in the quasi-static phases, as in the calibration
+        int floating_base_link = offset_tracking_on_double_support ? getDoubleSupportCalibrationFloatingBaseLink()
+                                                                   : offset_tracking_floating_base_link_idyntree_id;
+        if( offsetTrackingSupportIsLoaded() &&
+            computeStaticModelFTs(floating_base_link,offset_tracking_on_double_support) )
+        {
+            for(unsigned int ft_sensor_id=0; ft_sensor_id < sensor_status.measured_ft_sensors.size(); ft_sensor_id++ )
+            {
+                offset_tracker->updateOffset(ft_sensor_id,dt,
+                                             sensor_status.measured_ft_sensors[ft_sensor_id],
+                                             sensor_status.model_ft_sensors[ft_sensor_id]);
+            }
+        }
 
+        if( now-offset_tracking_last_handover >= offset_tracking_update_period )
+        {
+            handOverTrackedOffsets();
+            offset_tracking_last_handover = now;
+        }
+    }
+    else if( was_quasi_static )
+    {
+        handOverTrackedOffsets();
+        yInfo() << "wholeBodyDynamicsThread: F/T offsets updated at the end of a quasi-static phase of "
+                << now-offset_tracking_phase_start << " seconds";
+    }
+}
+
+//*************************************************************************************************************************
+bool wholeBodyDynamicsThread::offsetTrackingSupportIsLoaded()
+{
+    //The norm of the force does not depend on the frame of the sensor
+    const yarp::sig::Vector & left_ft = sensor_status.estimated_ft_sensors[offset_tracking_left_foot_ft_id];
+    const yarp::sig::Vector & right_ft = sensor_status.estimated_ft_sensors[offset_tracking_right_foot_ft_id];
+    bool left_loaded = sqrt(left_ft[0]*left_ft[0]+left_ft[1]*left_ft[1]+left_ft[2]*left_ft[2]) > offset_tracking_min_support_force;
+    bool right_loaded = sqrt(right_ft[0]*right_ft[0]+right_ft[1]*right_ft[1]+right_ft[2]*right_ft[2]) > offset_tracking_min_support_force;
+
+    if( offset_tracking_on_double_support )
+    {
+        return left_loaded && right_loaded;
+    }
+
+    //On single support only the support foot should be loaded, and it should
+    //be the fixed link of the odometry, if available
+    if( offset_tracking_support_foot == "l_foot" )
+    {
+        return left_loaded && !right_loaded && ( !odometry_enabled || current_fixed_link_name == "l_foot" );
+    }
+    if( offset_tracking_support_foot == "r_foot" )
+    {
+        return right_loaded && !left_loaded && ( !odometry_enabled || current_fixed_link_name == "r_foot" );
+    }
+
+    //The support is not a foot (e.g. the robot is on a pole): both feet should be unloaded
+    return !left_loaded && !right_loaded;
+}
+
+//*************************************************************************************************************************
+void wholeBodyDynamicsThread::handOverTrackedOffsets()
+{
+    double now = yarp::os::Time::now();
+    for(unsigned int ft_sensor_id=0; ft_sensor_id < sensor_status.ft_sensors_offset.size(); ft_sensor_id++ )
+    {
+        offset_smoother->setNewOffset(now,ft_sensor_id,
+                                      offset_tracker->getOffset(ft_sensor_id),
+                                      sensor_status.ft_sensors_offset[ft_sensor_id]);
+    }
+}
+
+//*************************************************************************************************************************
+int wholeBodyDynamicsThread::getDoubleSupportCalibrationFloatingBaseLink()
+{
+    //If the fixed link is given by the odometry, the sole of the fixed foot
+    if( this->assume_fixed_base_calibration_from_odometry )
+    {
+        if( this->current_fixed_link_name == "r_foot" )
+        {
+            return icub_model->getLinkIndex("r_sole");
+        }
+        else if( this->current_fixed_link_name == "l_foot" )
+        {
+            return icub_model->getLinkIndex("l_sole");
+        }
+    }
+    return calibration_floating_base_link_idyntree_id;
+}
+
+//*************************************************************************************************************************
+bool wholeBodyDynamicsThread::computeStaticModelFTs(const int floating_base_link, const bool double_support)
+{
     //Setting imu proper acceleration from measure (assuming omega e domega = 0)
     //acceleration are measures 4:6 (check wbi documentation)
     if( assume_fixed_base_calibration )
@@ -1642,6 +1783,12 @@ void wholeBodyDynamicsThread::calibration_run()
             calibration_ddp[0] = gravity;
         }
     }
+    else if( double_support && this->assume_fixed_base_calibration_from_odometry )
+    {
+        calibration_ddp[0] = 0.0;
+        calibration_ddp[1] = 0.0;
+        calibration_ddp[2] = 9.8;
+    }
     else
     {
         calibration_ddp[0] = sensor_status.wbi_imu[4];
@@ -1654,24 +1801,44 @@ void wholeBodyDynamicsThread::calibration_run()
     yAssert(sensor_status.domega_imu.size() == 3);
     yAssert(sensor_status.proper_ddp_imu.size() == 3);
 
-    icub_model_calibration->setInertialMeasure(zero_three_elem_vector,zero_three_elem_vector,calibration_ddp);
-    icub_model_calibration->setAngKDL(joint_status.getJointPosKDL());
-    icub_model_calibration->setDAng(zero_dof_elem_vector);
-    icub_model_calibration->setD2Ang(zero_dof_elem_vector);
+    //The model is shared with the estimation, that could have changed its base
+    if( icub_model->getFloatingBaseLink() != floating_base_link )
+    {
+        icub_model->setFloatingBaseLink(floating_base_link);
+    }
 
-    icub_model_calibration->kinematicRNEA();
-    icub_model_calibration->dynamicRNEA();
+    icub_model->setInertialMeasure(zero_three_elem_vector,zero_three_elem_vector,calibration_ddp);
+    icub_model->setAng(joint_status.getJointPos());
+    icub_model->setDAng(zero_dof_elem_vector);
+    icub_model->setD2Ang(zero_dof_elem_vector);
 
-    //std::cout << "wholeBodyDynamicsThread::calibration_run(): F/T estimates computed" << std::endl;
-    //std::cout << "wholeBodyDynamicsThread::calibration_run() : imu proper acceleration " << tree_status.proper_ddp_imu.toString() << std::endl;
-    //std::cout << "wholeBodyDynamicsThread::calibration_run() : q " << tree_status.q.toString() << std::endl;
+    bool ok = icub_model->kinematicRNEA();
+    if( double_support )
+    {
+        ok = ok && icub_model->estimateDoubleSupportContactForce(left_foot_link_idyntree_id,right_foot_link_idyntree_id);
+    }
+    ok = ok && icub_model->dynamicRNEA();
+
+    //Get sensors estimated from model
+    for(int ft_sensor_id=0; ft_sensor_id < (int)sensor_status.model_ft_sensors.size(); ft_sensor_id++ )
+    {
+        icub_model->getSensorMeasurement(ft_sensor_id,sensor_status.model_ft_sensors[ft_sensor_id]);
+    }
+
+    return ok;
+}
+
+//*************************************************************************************************************************
+void wholeBodyDynamicsThread::calibration_run()
+{
+    //std::cout << "wholeBodyDynamicsThread::calibration_run(): estimates obtained" << std::endl;
+
+    //Estimating sensors from the model of the robot standing still
+    computeStaticModelFTs(active_calibration_floating_base_link_idyntree_id,false);
 
     for(int ft_sensor_id=0; ft_sensor_id < (int)offset_buffer.size(); ft_sensor_id++ ) {
         if( calibrate_ft_sensor[ft_sensor_id] ) {
 
-            //Get sensor estimated from model
-            icub_model_calibration->getSensorMeasurement(ft_sensor_id,sensor_status.model_ft_sensors[ft_sensor_id]);
-
             //Get sensor measure
             assert((int)offset_buffer[ft_sensor_id].size() == wbi::sensorTypeDescriptions[wbi::SENSOR_FORCE_TORQUE].dataSize);
             offset_buffer[ft_sensor_id] += sensor_status.measured_ft_sensors[ft_sensor_id]-sensor_status.model_ft_sensors[ft_sensor_id];
@@ -1706,7 +1873,6 @@ void wholeBodyDynamicsThread::calibration_run()
         this->disableCalibration();
 
 
-        icub_model_calibration->setFloatingBaseLink(icub_model_calibration->getLinkIndex(calibration_support_link));
         first_calibration = false;
         wbd_mode = NORMAL;
         calibration_mutex.unlock();
@@ -1720,85 +1886,8 @@ void wholeBodyDynamicsThread::calibration_on_double_support_run()
 {
     //std::cout << "wholeBodyDynamicsThread::calibration_on_double_support_run(): estimates obtained" << std::endl;
 
-    bool ok = true;
-
-    //Setting imu proper acceleration from measure (assuming omega e domega = 0)
-    //acceleration are measures 4:6 (check wbi documentation)
-    if( assume_fixed_base_calibration )
-    {
-        double gravity = 9.8;
-        calibration_ddp[0] = 0.0;
-        calibration_ddp[1] = 0.0;
-        calibration_ddp[2] = 0.0;
-        if( fixed_link_calibration == "root_link" )
-        {
-            calibration_ddp[2] = gravity;
-        }
-        else if(    fixed_link_calibration == "l_sole"
-                 || fixed_link_calibration == "r_sole"
-                 || fixed_link_calibration == "r_foot_dh_frame"
-                 || fixed_link_calibration == "l_foot_dh_frame" )
-        {
-            calibration_ddp[0] = gravity;
-        }
-    }
-    else if( this->assume_fixed_base_calibration_from_odometry )
-    {
-        double gravity = 9.8;
-        calibration_ddp[0] = 0.0;
-        calibration_ddp[1] = 0.0;
-        calibration_ddp[2] = 9.8;
-    }
-    else
-    {
-        calibration_ddp[0] = sensor_status.wbi_imu[4];
-        calibration_ddp[1] = sensor_status.wbi_imu[5];
-        calibration_ddp[2] = sensor_status.wbi_imu[6];
-    }
-
-    //Estimating sensors
-    yAssert(sensor_status.omega_imu.size() == 3);
-    yAssert(sensor_status.domega_imu.size() == 3);
-    yAssert(sensor_status.proper_ddp_imu.size() == 3);
-
-    if( !this->assume_fixed_base_calibration_from_odometry )
-    {
-        icub_model_calibration->setInertialMeasure(zero_three_elem_vector,zero_three_elem_vector,calibration_ddp);
-        icub_model_calibration->setAngKDL(joint_status.getJointPosKDL());
-        icub_model_calibration->setDAng(zero_dof_elem_vector);
-        icub_model_calibration->setD2Ang(zero_dof_elem_vector);
-
-        ok = ok && icub_model_calibration->kinematicRNEA();
-        ok = ok && icub_model_calibration->estimateDoubleSupportContactForce(left_foot_link_idyntree_id,right_foot_link_idyntree_id);
-        ok = ok && icub_model_calibration->dynamicRNEA();
-    }
-    else
-    {
-        if( this->current_fixed_link_name == "r_foot" )
-        {
-            icub_model_calibration_on_r_sole->setInertialMeasure(zero_three_elem_vector,zero_three_elem_vector,calibration_ddp);
-            icub_model_calibration_on_r_sole->setAngKDL(joint_status.getJointPosKDL());
-            icub_model_calibration_on_r_sole->setDAng(zero_dof_elem_vector);
-            icub_model_calibration_on_r_sole->setD2Ang(zero_dof_elem_vector);
-
-            ok = ok && icub_model_calibration_on_r_sole->kinematicRNEA();
-            ok = ok && icub_model_calibration_on_r_sole->estimateDoubleSupportContactForce(left_foot_link_idyntree_id,right_foot_link_idyntree_id);
-            ok = ok && icub_model_calibration_on_r_sole->dynamicRNEA();
-        }
-
-        if( this->current_fixed_link_name == "l_foot" )
-        {
-            icub_model_calibration_on_l_sole->setInertialMeasure(zero_three_elem_vector,zero_three_elem_vector,calibration_ddp);
-            icub_model_calibration_on_l_sole->setAngKDL(joint_status.getJointPosKDL());
-            icub_model_calibration_on_l_sole->setDAng(zero_dof_elem_vector);
-            icub_model_calibration_on_l_sole->setD2Ang(zero_dof_elem_vector);
-
-            ok = ok && icub_model_calibration_on_l_sole->kinematicRNEA();
-            ok = ok && icub_model_calibration_on_l_sole->estimateDoubleSupportContactForce(left_foot_link_idyntree_id,right_foot_link_idyntree_id);
-            ok = ok && icub_model_calibration_on_l_sole->dynamicRNEA();
-        }
-    }
-
+    //Estimating sensors from the model of the robot standing on both feet
+    bool ok = computeStaticModelFTs(active_calibration_floating_base_link_idyntree_id,true);
 
     // todo check that the residual forze is zero
 
@@ -1807,30 +1896,10 @@ void wholeBodyDynamicsThread::calibration_on_double_support_run()
         yError() << "wholeBodyDynamicsThread::calibration_on_double_support_run(): offset estimation failed";
     }
 
-    //Get known terms of the Newton-Euler equation
-
     for(int ft_sensor_id=0; ft_sensor_id < (int)offset_buffer.size(); ft_sensor_id++ )
     {
         if( calibrate_ft_sensor[ft_sensor_id] )
         {
-            //Get sensor estimated from model
-            if( !this->assume_fixed_base_calibration_from_odometry )
-            {
-                icub_model_calibration->getSensorMeasurement(ft_sensor_id,sensor_status.model_ft_sensors[ft_sensor_id]);
-            }
-            else
-            {
-                if( this->current_fixed_link_name == "r_foot" )
-                {
-                    icub_model_calibration_on_r_sole->getSensorMeasurement(ft_sensor_id,sensor_status.model_ft_sensors[ft_sensor_id]);
-                }
-
-                if( this->current_fixed_link_name == "l_foot" )
-                {
-                    icub_model_calibration_on_l_sole->getSensorMeasurement(ft_sensor_id,sensor_status.model_ft_sensors[ft_sensor_id]);
-                }
-            }
-
             //Get sensor measure
             assert((int)offset_buffer[ft_sensor_id].size() == wbi::sensorTypeDescriptions[wbi::SENSOR_FORCE_TORQUE].dataSize);
             offset_buffer[ft_sensor_id] += sensor_status.measured_ft_sensors[ft_sensor_id]-sensor_status.model_ft_sensors[ft_sensor_id];
@@ -1866,13 +1935,6 @@ void wholeBodyDynamicsThread::calibration_on_double_support_run()
             calibrate_ft_sensor[ft_sensor_id] = false;
         }
 
-        icub_model_calibration->setFloatingBaseLink(icub_model_calibration->getLinkIndex(calibration_support_link));
-
-        if( this->assume_fixed_base_calibration_from_odometry )
-        {
-            icub_model_calibration_on_l_sole->setFloatingBaseLink(icub_model_calibration->getLinkIndex(calibration_support_link));
-            icub_model_calibration_on_r_sole->setFloatingBaseLink(icub_model_calibration->getLinkIndex(calibration_support_link));
-        }
 
         wbd_mode = NORMAL;
         calibration_mutex.unlock();
@@ -1926,26 +1988,23 @@ void wholeBodyDynamicsThread::threadRelease()
         port_filtered_ft.resize(0);
     }
 
-    yInfo() << "Deleting icub models used for calibration";
-    delete icub_model_calibration;
-
-    if( this->assume_fixed_base_calibration_from_odometry )
-    {
-        delete icub_model_calibration_on_l_sole;
-        delete icub_model_calibration_on_r_sole;
-    }
-
-    if( !this->assume_fixed_base_calibration_from_odometry )
-    {
-        delete icub_model_world_base_position;
-    }
+    yInfo() << "Deleting icub model";
+    delete icub_model;
+    icub_model = 0;
 
     yInfo() << "Deleting filters";
     delete filters;
 
-    if( smooth_calibration )
+    if( offset_smoother )
     {
         delete offset_smoother;
+        offset_smoother = 0;
+    }
+
+    if( offset_tracker )
+    {
+        delete offset_tracker;
+        offset_tracker = 0;
     }
 
     yInfo() << "Closing odometry class";
@@ -1979,14 +2038,13 @@ template <class T> void wholeBodyDynamicsThread::broadcastData(T& _values, Buffe
 }
 
 //*****************************************************************************
-void wholeBodyDynamicsThread::writeTorque(const Vector& _values, int _address, BufferedPort<Bottle> *_port)
+void wholeBodyDynamicsThread::writeTorque(const Vector& _values, int _address, BufferedPort<TorquesPortable> *_port)
 {
-    /** \todo TODO avoid (as much as feasible) dynamic memory allocation */
-    Bottle & a = _port->prepare();
-    a.clear();
-    a.addInt(_address);
-    for(size_t i=0;i<_values.length();i++)
-        a.addDouble(_values(i));
+    // the torques are copied in the buffer of the port: the memory is allocated
+    // only the first time a buffer is used
+    TorquesPortable & a = _port->prepare();
+    a.magic_number = _address;
+    a.torques = _values;
     _port->write();
 }
 
@@ -2210,11 +2268,14 @@ void OffsetSmoother::updateOffset(const double current_time,
             used_offset = new_offset[ft_id];
             this->is_smoothing[ft_id] = false;
         }
-        double progress = time_since_calibration_in_seconds/smooth_calibration_period_in_seconds;
-        used_offset.resize(6);
-        for( int i =0; i < 6; i++ )
+        else
         {
-            used_offset[i] = old_offset[ft_id][i] + progress*(new_offset[ft_id][i]-old_offset[ft_id][i]);
+            double progress = time_since_calibration_in_seconds/smooth_calibration_period_in_seconds;
+            used_offset.resize(6);
+            for( int i =0; i < 6; i++ )
+            {
+                used_offset[i] = old_offset[ft_id][i] + progress*(new_offset[ft_id][i]-old_offset[ft_id][i]);
+            }
         }
     }
 }
@@ -42,8 +42,9 @@ public:
     DirectFiltering();
     ~DirectFiltering();
     bool init(yarp::os::ResourceFinder &rf, wbi::iWholeBodySensors *wbs);
-    void run();
+    void run(const SensorsSnapshot &snapshot);
     void release();
+    bool usesMTB() const { return true; }
     void computeOrientation(yarp::sig::Vector* sensorReading, yarp::sig::Vector& output);
     void computeTilt(yarp::sig::Vector* sensorReading, yarp::sig::Vector& output);
     void setWorldOrientation(MatrixWrapper::Quaternion& worldOrientation);
@@ -51,11 +52,8 @@ public:
 private:
     MatrixWrapper::Matrix                       m_lsole_R_acclsensor;
     MatrixWrapper::Matrix                       m_world_R_lsole;
-    // Measurements port
-    yarp::os::Port                            * sensorMeasPort;
     yarp::os::BufferedPort<yarp::sig::Vector> * outputPort;
     directFilteringParams                       m_params;
-    readerPort                                  sensorDataPort;
     publisherPort                               m_estimatePort;
     publisherPort                               m_tiltPort;
     std::string                                 m_className;
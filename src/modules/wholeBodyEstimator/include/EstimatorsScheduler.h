@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef ESTIMATORSSCHEDULER_H_
+#define ESTIMATORSSCHEDULER_H_
+
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Semaphore.h>
+#include <yarp/os/Thread.h>
+
+#include <string>
+#include <vector>
+
+#include "IEstimator.h"
+
+/**
+ *  Runs the estimators of WholeBodyEstimatorThread at each tick.
+ *  Estimators are grouped in stages from their dependencies: all the estimators of a stage only depend on
+ *  the ones of the previous stages, so the stages are run in order while the estimators due in the same
+ *  stage are dispatched to a small pool of worker threads. Each estimator is run only at the ticks
+ *  matching its own period.
+ */
+class EstimatorsScheduler
+{
+private:
+    /**
+     *  Worker thread running one estimator each time it is dispatched.
+     */
+    class Worker: public yarp::os::Thread
+    {
+    private:
+        yarp::os::Semaphore    m_dispatched;
+        yarp::os::Semaphore   &m_done;
+        IEstimator            *m_estimator;
+        const SensorsSnapshot *m_snapshot;
+    public:
+        Worker(yarp::os::Semaphore &done);
+        void dispatch(IEstimator *estimator, const SensorsSnapshot *snapshot);
+        void run();
+        void onStop();
+    };
+
+    std::vector<IEstimator*>                m_estimators;
+    std::vector<std::string>                m_names;
+    // Number of ticks between two runs of each estimator
+    std::vector<unsigned int>               m_decimation;
+    // Indices of the estimators of each stage
+    std::vector< std::vector<unsigned int> > m_stages;
+    std::vector<Worker*>                    m_workers;
+    yarp::os::Semaphore                     m_done;
+    // Estimators due in the current stage, preallocated
+    std::vector<IEstimator*>                m_due;
+    unsigned long                           m_tick;
+
+    bool computeStages(const std::vector< std::vector<std::string> > &dependencies);
+
+public:
+    EstimatorsScheduler();
+    ~EstimatorsScheduler();
+
+    /**
+     *  Configures the scheduling of the estimators.
+     *
+     *  @param estimators   Estimators, already initialized.
+     *  @param names        Names of the estimators as in estimators_list.
+     *  @param threadPeriod Period of WholeBodyEstimatorThread in ms.
+     *  @param maxWorkers   Maximum number of worker threads, 0 to run all the estimators in the calling thread.
+     *  @param rf           Configuration, whose estimator groups can override the declared period and dependencies.
+     *  @return false if the dependencies are not consistent or the workers could not be started.
+     */
+    bool init(const std::vector<IEstimator*> &estimators,
+              const std::vector<std::string> &names,
+              const double threadPeriod,
+              const unsigned int maxWorkers,
+              yarp::os::ResourceFinder &rf);
+    /**
+     *  Runs the estimators due at this tick with its measurements, returning when all of them are done.
+     */
+    void runTick(const SensorsSnapshot &snapshot);
+    /**
+     *  Stops the worker threads.
+     */
+    void release();
+};
+
+#endif
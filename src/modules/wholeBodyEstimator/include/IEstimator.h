@@ -20,6 +20,9 @@
 
 #include <yarp/os/ResourceFinder.h>
 #include <yarpWholeBodyInterface/yarpWholeBodyInterface.h>
+#include <string>
+#include <vector>
+#include "SensorsAcquisition.h"
 // We need to include the factory here so that the derived classes of IEstimator can use the macros defined there.
 #include "EstimatorsFactory.h"
 
@@ -41,13 +44,38 @@ public:
      */
     virtual bool init(yarp::os::ResourceFinder &rf, wbi::iWholeBodySensors *wbs) = 0;
     /**
-     *  Runs main estimation loop in the implementation.
+     *  Runs main estimation loop in the implementation, for estimators reading their own sensors.
      */
-    virtual void run() = 0;
+    virtual void run() {}
+    /**
+     *  Runs main estimation loop in the implementation with the measurements acquired by WholeBodyEstimatorThread
+     *  at this tick. Estimators should implement this method instead of reading ports themselves. The default
+     *  implementation calls run().
+     *
+     *  @param snapshot Measurements of this tick, shared with the other estimators and only to be read.
+     */
+    virtual void run(const SensorsSnapshot &snapshot) { run(); }
     /**
      *  Releases allocated resources and closes opened ports during initialization.
      */
     virtual void release() = 0;
+    /**
+     *  Desired period of the estimator in ms. The estimator is run every tick of WholeBodyEstimatorThread
+     *  closest to this period. 0 (default) means at every tick. Can be overridden by the 'period' parameter
+     *  of the estimator group in the configuration file.
+     */
+    virtual double getPeriod() const { return 0.0; }
+    /**
+     *  Names (as in estimators_list) of the estimators whose outputs are used by this estimator. In each tick
+     *  the estimator runs after them, while independent estimators can run concurrently. Can be overridden by
+     *  the 'depends_on' list of the estimator group in the configuration file.
+     */
+    virtual std::vector<std::string> getDependencies() const { return std::vector<std::string>(); }
+    /**
+     *  True if the estimator reads the inertial MTB measurements of the snapshot. The MTB port is opened
+     *  only if at least one of the estimators uses it.
+     */
+    virtual bool usesMTB() const { return false; }
 };
 
 #endif
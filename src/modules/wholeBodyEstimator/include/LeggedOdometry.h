@@ -22,6 +22,7 @@
 #include <yarp/os/BufferedPort.h>
 #include <yarp/os/ResourceFinder.h>
 #include <yarp/os/Contactable.h>
+#include <yarp/os/Portable.h>
 
 #include <iCub/iDynTree/DynTree.h>
 #include <iCub/iDynTree/TorqueEstimationTree.h>
@@ -30,24 +31,44 @@
 #include <iDynTree/ModelIO/impl/urdf_import.hpp>
 #include <iDynTree/ModelIO/impl/urdf_sensor_import.hpp>
 #include <iCub/iDynTree/yarp_kdl.h>
+#include <kdl/frames.hpp>
 #include <wbi/wbi.h>
 
 #include <yarp/os/LogStream.h>
 
 using namespace wbi;
 
+/**
+ *  Position of the foot (origin of the world frame) in the floating base frame, serialized
+ *  with the layout of the Bottle historically published by LeggedOdometry, i.e. ((x y z)).
+ *  The position is preallocated, so writing it does not involve any dynamic memory allocation.
+ */
+class FloatingBasePositionPortable : public yarp::os::Portable
+{
+public:
+    FloatingBasePositionPortable();
+
+    yarp::sig::Vector floatingbase_P_foot;
+
+    virtual bool read(yarp::os::ConnectionReader& connection);
+    virtual bool write(yarp::os::ConnectionWriter& connection);
+};
+
 class LeggedOdometry : public IEstimator
 {
     REGISTER(LeggedOdometry)
 private:
     iDynTree::simpleLeggedOdometry odometry_helper;
     int odometry_floating_base_frame_index;
-    yarp::sig::Matrix world_H_floatingbase;
+    KDL::Frame world_H_floatingbase;
     yarp::sig::Vector floatingbase_twist;
     yarp::sig::Vector floatingbase_acctwist;
     bool odometry_enabled;
     bool frames_streaming_enabled;
-    yarp::os::BufferedPort<yarp::os::Bottle> * port_floatingbasestate;
+    /**
+     *  Streams the position of the foot (origin of the world frame) in the floating base frame.
+     */
+    yarp::os::BufferedPort<FloatingBasePositionPortable> * port_floatingbasestate;
     yarp::os::BufferedPort<yarp::os::Property> * port_frames;
     /**
      *  Vector containing the indices of the frames to be streamed, after checking they are actually present. These frame have been specified via configuration file of the wholeBodyEstimator under the group LeggedOdometry.
@@ -87,7 +108,7 @@ public:
     /**
      *  More info in the documentation of the IEstimator class. Called by wholeBodyEstimatorThread each time step and does the job of publishOdometry() in wholeBodyDynamicsTree.
      */
-    void run();
+    void run(const SensorsSnapshot &snapshot);
 
     /**
      *  Same as closeOdometry from wholeBodyDynamicsTree.
@@ -100,9 +121,9 @@ public:
     void closePort(yarp::os::Contactable *_port);
 
     /** 
-     *  Updates joint_status
+     *  Updates joint_status with the encoders of the snapshot
      */
-    void readRobotStatus();
+    void readRobotStatus(const SensorsSnapshot &snapshot);
 };
 
 #endif /* LeggedOdometry */
@@ -18,13 +18,7 @@
 #ifndef QUATERNIONEKF_H_
 #define QUATERNIONEKF_H_
 
-#include <bfl/filter/extendedkalmanfilter.h>
-#include <bfl/model/linearanalyticsystemmodel_gaussianuncertainty.h>
-#include <bfl/model/linearanalyticmeasurementmodel_gaussianuncertainty.h>
-#include <bfl/pdf/analyticconditionalgaussian.h>
-#include <bfl/pdf/linearanalyticconditionalgaussian.h>
-#include "nonLinearAnalyticConditionalGaussian.h"
-#include "nonLinearMeasurementGaussianPdf.h"
+#include <ctrlLibRT/quaternionEKF.h>
 #include "floatingBase.h"
 
 #include <yarp/os/ResourceFinder.h>
@@ -75,6 +69,12 @@
  */
 #define CONVERSION_FACTOR_GYRO 7.6274e-03
 #define PI 3.141592654
+/**
+ *  Norm of the gravity used by the measurement model of the filter.
+ *
+ *  @return 10.0
+ */
+#define GRAVITY_NOMINAL 10.0
 
 /**
  *  Structure containing this class parameters necessary for the Extended Kalman Filter.
@@ -237,8 +237,7 @@ public:
     /**
      Implemented the init() method from IEstimator. More documentation in the corresponding class.
      In particular this method reads the estimator parameters from configuration file, opens publisher 
-     and resder ports, initializes filter variables, creates system and measurement model, sets prios 
-     and instantiates an Extended Kalman Filter.
+     and resder ports and configures the Extended Kalman Filter.
      
      - parameter yarp: rf reference to resource finder.
      - parameter wbi:  wbs pointer to object of type iWholeBodySensors.
@@ -250,14 +249,14 @@ public:
      *  Documentation in IEstimator class. 
      *  In this implementation the following is done:
      *  - Sensor data is read each time step
-     *  - Updates system noise covariance.
-     *  - Calls the prediction and update steps of the Kalman filter (EKF).
+     *  - Calls the prediction and update steps of the Kalman filter (EKF), which also updates the system noise covariance.
      *  - Retrieves posterior mean and covariance of the EKF.
      *  - Publishes estimates results through the ports configured in the init method (quaternion and euler).
      *  - Optionally streams read gyro and accelerometer data.
      */
-    void run();
+    void run(const SensorsSnapshot &snapshot);
     void release();
+    bool usesMTB() const { return true; }
     //TODO: This method should also be enforced through IEstimator
     /**
      *  Reads the filter parameters specified under the group CLASSNAME.
@@ -270,46 +269,34 @@ public:
      */
     bool readEstimatorParams(yarp::os::ResourceFinder &rf, quaternionEKFParams &estimatorParams);
     /**
-     *  Sets initial system noise mean and covariance and instantiates the model of type BFL::AnalyticSystemModelGaussianUncertainty.
-     */
-    void createSystemModel();
-    /**
-     *  Sets initial measurement noise mean and covariance and uses it to create an initial uncertainty PDF which is then used to 
-        create a measurement model of type BFL::AnalyticMeasurementModelGaussianUncertainty.
-     */
-    void createMeasurementModel();
-    /**
-     *  Sets prior means and convariances.
-     */
-    void setPriors();
-    /**
-     *  Instantiates an Extended Kalman Filter of type BFL::ExtendedKalmanFilter.
+     *  Sets sample time, noise variances and priors of the Extended Kalman Filter.
+     *
+     *  @return True if the sizes in the configuration file match the ones of the filter, false otherwise.
      */
-    void createFilter();
+    bool configureFilter();
     //FIXME: This should not exist at all. yarpWholeBodySensors should be able to read this after proper initialization.
     /**
      *  Temporary fix while yarpWholeBodySensors parses acceleromenters and gyros from URDF and provides this measurement directly through the interface.
-     *  Basically calls extractMTBDatafromPort.
+     *  Basically calls extractMTBData on the MTB measurement of the snapshot.
      *
+     *  @param snapshot Measurements acquired by WholeBodyEstimatorThread at this tick.
      *  @param m This object will contain raw angular velocity, linear acceleration and external estimated orientation -if provided- (output).
      *
-     *  @return True if parsing from sensor reading port is successful, false otherwise.
+     *  @return True if the MTB measurement was available and parsed, false otherwise.
      *  @note This method will be soon deprecated. Waiting for newest version of yarpWholeBodySensors.
      */
-    bool readSensorData(measurementsStruct &m);
+    bool readSensorData(const SensorsSnapshot &snapshot, measurementsStruct &m);
     /**
      *  Given that the following variables are somewhere defined: MTB_PORT_DATA_PACKAGE_OFFSET, CONVERSION_FACTOR_ACC, CONVERSION_FACTOR_GYRO.
         This method parses the measurement as streamed by the inertial unit and separates them into linear acceleration, angular velocity and orientation -if provided- (output).
      *
-     *  @param boardNum     Currently specified in the header of this class.
-     *  @param measurements Parsed data (output).
+     *  @param boardNum        Currently specified in the header of this class.
+     *  @param fullMeasurement Full vector as streamed by the inertial MTB port.
+     *  @param measurements    Parsed data (output).
      *
      *  @return True when
      */
-    bool extractMTBDatafromPort(int boardNum, measurementsStruct &measurements);
-    //TODO: Temporary
-    void XiOperator(MatrixWrapper::ColumnVector quat, MatrixWrapper::Matrix* Xi);
-    void SOperator(MatrixWrapper::ColumnVector omg, MatrixWrapper::Matrix* S);
+    bool extractMTBData(int boardNum, const yarp::sig::Vector &fullMeasurement, measurementsStruct &measurements);
 
 private:
     quaternionEKFParams m_quaternionEKFParams;
@@ -317,24 +304,24 @@ private:
     // Publisher ports list
     std::vector<publisherPortStruct> m_outputPortsList;
     std::vector<readerPortStruct> m_inputPortsList;
-    // System model variables
-    BFL::nonLinearAnalyticConditionalGaussian * m_sysPdf;
-    BFL::AnalyticSystemModelGaussianUncertainty * m_sys_model;
-    BFL::Gaussian * m_measurement_uncertainty;
-    BFL::nonLinearMeasurementGaussianPdf * m_measPdf;
-    BFL::AnalyticMeasurementModelGaussianUncertainty * m_meas_model;
-    BFL::Gaussian * m_prior;
-    BFL::ExtendedKalmanFilter * m_filter;
-    MatrixWrapper::ColumnVector m_prior_mu_vec;
-    MatrixWrapper::ColumnVector m_posterior_state;
+    // Extended Kalman Filter
+    iCub::ctrl::realTime::QuaternionEKF m_filter;
+    // Estimates published to the ports
+    yarp::sig::Vector m_estimateQuaternion;
+    yarp::sig::Vector m_estimateEuler;
     //FIXME This should be temporary
-    yarp::os::Port * sensorMeasPort;
     yarp::os::Port * floatingBasePoseExt;
     measurementsStruct measurements;
     wholeBodyEstimator::floatingBase * m_floatingBaseEstimate;
     // Resulting Euler angles
     MatrixWrapper::ColumnVector eulerAngles;
+    // Rotations computed by run(), preallocated in init()
+    MatrixWrapper::Matrix m_rot_from_euler;
+    MatrixWrapper::Matrix m_rot_from_world_to_sensor;
+    MatrixWrapper::Matrix m_rot_from_floatingBase_to_world;
     
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 
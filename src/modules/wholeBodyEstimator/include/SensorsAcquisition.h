@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef SENSORSACQUISITION_H_
+#define SENSORSACQUISITION_H_
+
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/sig/Vector.h>
+#include <wbi/wbi.h>
+
+/**
+ *  Sensor measurements acquired once per tick by WholeBodyEstimatorThread and shared by all the estimators.
+ *  The estimators only read it, so it can be used by concurrent estimators without locking.
+ */
+struct SensorsSnapshot
+{
+    /**
+     *  Time of the acquisition (s).
+     */
+    double timestamp;
+    /**
+     *  True if an MTB measurement has been received, at this tick or before.
+     */
+    bool mtbValid;
+    /**
+     *  True if the MTB measurement was received at this tick.
+     */
+    bool mtbFresh;
+    /**
+     *  Last full vector streamed by the inertial MTB port of the right leg, with the packages of all the boards.
+     */
+    yarp::sig::Vector mtbMeasurement;
+    /**
+     *  True if the encoders were read at this tick.
+     */
+    bool encodersValid;
+    /**
+     *  Joint positions (rad), serialized as the SENSOR_ENCODER list of the whole body sensors.
+     */
+    yarp::sig::Vector jointPositions;
+};
+
+/**
+ *  Reads each sensor used by the estimators exactly once per tick into a SensorsSnapshot.
+ */
+class SensorsAcquisition
+{
+private:
+    wbi::iWholeBodySensors * m_wbs;
+    yarp::os::BufferedPort<yarp::sig::Vector> m_mtbPort;
+    bool                     m_mtbOpened;
+    bool                     m_mtbConnected;
+public:
+    SensorsAcquisition();
+    /**
+     *  Opens the port reading the inertial MTB of the right leg, if needed, and sizes the snapshot buffers.
+     *
+     *  @param rf       Configuration of the module, with the robot and module names in module_parameters.
+     *  @param wbs      Whole body sensors, already initialized.
+     *  @param useMTB   True if at least one estimator uses the MTB measurements.
+     *  @param snapshot Snapshot whose buffers are allocated here (output).
+     *
+     *  @return True if successful, false otherwise.
+     */
+    bool init(yarp::os::ResourceFinder &rf, wbi::iWholeBodySensors *wbs, bool useMTB, SensorsSnapshot &snapshot);
+    /**
+     *  Reads all the sensors into the snapshot without allocating memory. The MTB port is not waited for:
+     *  if no new packet arrived, the last one is kept.
+     */
+    void acquire(SensorsSnapshot &snapshot);
+    /**
+     *  Closes the ports opened in init.
+     */
+    void release();
+};
+
+#endif
@@ -36,6 +36,8 @@
 #include <map>              //std::map
 
 #include "EstimatorsFactory.h"
+#include "EstimatorsScheduler.h"
+#include "SensorsAcquisition.h"
 #include "IEstimator.h"
 #include "LeggedOdometry.h"
 #include "QuaternionEKF.h"
@@ -56,6 +58,11 @@ private:
     
     std::map< std::string, int > m_estimatorsMap;
     std::vector< IEstimator* > m_estimatorsList;
+    std::vector< std::string > m_estimatorsNames;
+    EstimatorsScheduler m_scheduler;
+    // Sensors read once per tick and shared by the estimators
+    SensorsAcquisition m_acquisition;
+    SensorsSnapshot m_snapshot;
 
 public:
     WholeBodyEstimatorThread (yarp::os::ResourceFinder &rf, wbi::iWholeBodySensors* wbs, int period);
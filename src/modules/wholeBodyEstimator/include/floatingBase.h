@@ -23,6 +23,7 @@ namespace wholeBodyEstimator
         wbi::iWholeBodySensors          * m_wbs;
         yarp::os::Property              m_module_params;
         MatrixWrapper::Matrix           m_rot_from_ft_to_acc;
+        MatrixWrapper::Matrix           m_rot_from_sensor_to_world;
         yarp::sig::Vector               m_q;
 
     public:
@@ -45,7 +46,7 @@ namespace wholeBodyEstimator
          *
          *  @return true if successsful, false otherwise.
          */
-        bool compute_Rot_from_floatingBase_to_world( MatrixWrapper::Matrix rot_from_world_to_sensor,
+        bool compute_Rot_from_floatingBase_to_world( const MatrixWrapper::Matrix &rot_from_world_to_sensor,
                                                      MatrixWrapper::Matrix &rot_from_floatingBase_to_world);
         
         
@@ -102,6 +102,18 @@ public:
     bool extractMTBDatafromPort(int boardNum, yarp::os::Port * sensorMeasPort, measurementsStruct &measurements);
     
     
+    /**
+     *  Same parsing of extractMTBDatafromPort, from an already read MTB measurement (e.g. the one of a SensorsSnapshot).
+     *
+     *  @param boardNum        Currently specified in consntants.h
+     *  @param fullMeasurement Full vector as streamed by the inertial MTB port.
+     *  @param measurements    (output) Separated measurements in a single object.
+     *
+     *  @return True when parsing is succesful, false otherwise.
+     */
+    static bool extractMTBData(int boardNum, const yarp::sig::Vector &fullMeasurement, measurementsStruct &measurements);
+    
+    
     /**
      *  Closes the reader port opened by this object.
      *
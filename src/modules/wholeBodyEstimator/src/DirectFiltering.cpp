@@ -19,14 +19,7 @@ bool DirectFiltering::init ( yarp::os::ResourceFinder &rf, wbi::iWholeBodySensor
     // Read directFiltering params
     DirectFiltering::readEstimatorParams(rf, m_params);
     
-    // Open and configure port for reading measurements
-    sensorMeasPort = new yarp::os::Port;
-    std::string srcPort = std::string("/" + this->m_params.robotPrefix + "/right_leg/inertialMTB");
-    if ( !sensorDataPort.configurePort(this->m_className, std::string("rightFootMTBreader"), srcPort, sensorMeasPort) )
-    {
-        yError( "[DirectFiltering::init] Could not connect to %s", srcPort.c_str() );
-        return false;
-    }
+    // Measurements are read by WholeBodyEstimatorThread and passed to run()
     
     // Open and configure port for direct orientation estimate
     if ( !m_estimatePort.configurePort(this->m_className, std::string("orientationEuler")) )
@@ -52,10 +45,10 @@ bool DirectFiltering::init ( yarp::os::ResourceFinder &rf, wbi::iWholeBodySensor
     return true;
 }
 
-void DirectFiltering::run ( )
+void DirectFiltering::run ( const SensorsSnapshot &snapshot )
 {
-    // Read sensor measurements
-    if ( !sensorDataPort.extractMTBDatafromPort(MTB_RIGHT_FOOT_ACC_PLUS_GYRO_2_ID, sensorMeasPort, m_meas) )
+    // Parse sensor measurements
+    if ( !snapshot.mtbValid || !readerPort::extractMTBData(MTB_RIGHT_FOOT_ACC_PLUS_GYRO_2_ID, snapshot.mtbMeasurement, m_meas) )
     {
         yError( "[DirectFiltering::run] Could not read measurement" );
     }
@@ -100,13 +93,6 @@ bool DirectFiltering::readEstimatorParams ( yarp::os::ResourceFinder &rf, direct
 
 void DirectFiltering::release ( )
 {
-    if (sensorMeasPort)
-    {
-        sensorMeasPort->close();
-        delete sensorMeasPort;
-        sensorMeasPort = 0;
-    }
-    
     m_estimatePort.closePort();
     m_tiltPort.closePort();
     
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "EstimatorsScheduler.h"
+
+#include <yarp/os/LogStream.h>
+#include <algorithm>
+#include <cmath>
+
+EstimatorsScheduler::Worker::Worker(yarp::os::Semaphore &done) : m_dispatched(0),
+                                                                 m_done(done),
+                                                                 m_estimator(0),
+                                                                 m_snapshot(0)
+{
+}
+
+void EstimatorsScheduler::Worker::dispatch(IEstimator *estimator, const SensorsSnapshot *snapshot)
+{
+    m_estimator = estimator;
+    m_snapshot = snapshot;
+    m_dispatched.post();
+}
+
+void EstimatorsScheduler::Worker::run()
+{
+    while ( !isStopping() )
+    {
+        m_dispatched.wait();
+        if ( isStopping() )
+            break;
+        m_estimator->run(*m_snapshot);
+        m_done.post();
+    }
+}
+
+void EstimatorsScheduler::Worker::onStop()
+{
+    // Wake up the worker waiting for an estimator
+    m_dispatched.post();
+}
+
+EstimatorsScheduler::EstimatorsScheduler() : m_done(0),
+                                             m_tick(0)
+{
+}
+
+EstimatorsScheduler::~EstimatorsScheduler()
+{
+    release();
+}
+
+bool EstimatorsScheduler::init(const std::vector<IEstimator*> &estimators,
+                               const std::vector<std::string> &names,
+                               const double threadPeriod,
+                               const unsigned int maxWorkers,
+                               yarp::os::ResourceFinder &rf)
+{
+    m_estimators = estimators;
+    m_names = names;
+    m_decimation.assign(m_estimators.size(), 1);
+    m_tick = 0;
+
+    // Period and dependencies declared by each estimator, possibly overridden by its configuration group
+    std::vector< std::vector<std::string> > dependencies(m_estimators.size());
+    for (unsigned int i = 0; i < m_estimators.size(); i++)
+    {
+        double period = m_estimators[i]->getPeriod();
+        dependencies[i] = m_estimators[i]->getDependencies();
+
+        yarp::os::Bottle &group = rf.findGroup(m_names[i]);
+        if ( !group.isNull() && group.check("period") )
+        {
+            period = group.find("period").asDouble();
+        }
+        if ( !group.isNull() && group.check("depends_on") )
+        {
+            dependencies[i].clear();
+            yarp::os::Bottle *list = group.find("depends_on").asList();
+            if ( list )
+            {
+                for (int d = 0; d < list->size(); d++)
+                    dependencies[i].push_back(list->get(d).asString());
+            } else {
+                dependencies[i].push_back(group.find("depends_on").asString());
+            }
+        }
+
+        if ( period > threadPeriod )
+        {
+            m_decimation[i] = (unsigned int) floor(period/threadPeriod + 0.5);
+        }
+        yInfo("[EstimatorsScheduler::init] %s runs every %u ticks of %.1f ms", m_names[i].c_str(), m_decimation[i], threadPeriod);
+    }
+
+    if ( !computeStages(dependencies) )
+    {
+        return false;
+    }
+
+    // The calling thread runs one of the estimators of each stage, the workers the others
+    size_t maxStageSize = 0;
+    for (unsigned int s = 0; s < m_stages.size(); s++)
+        maxStageSize = std::max(maxStageSize, m_stages[s].size());
+    m_due.reserve(maxStageSize);
+    unsigned int nrOfWorkers = std::min((unsigned int) (maxStageSize > 0 ? maxStageSize - 1 : 0), maxWorkers);
+    for (unsigned int w = 0; w < nrOfWorkers; w++)
+    {
+        m_workers.push_back(new Worker(m_done));
+        if ( !m_workers.back()->start() )
+        {
+            yError("[EstimatorsScheduler::init] Worker thread %u could not be started", w);
+            return false;
+        }
+    }
+    yInfo("[EstimatorsScheduler::init] %lu estimators in %lu stages, using %u worker threads",
+          (unsigned long) m_estimators.size(), (unsigned long) m_stages.size(), nrOfWorkers);
+    return true;
+}
+
+bool EstimatorsScheduler::computeStages(const std::vector< std::vector<std::string> > &dependencies)
+{
+    // The stage of an estimator is one more than the largest stage of its dependencies
+    std::vector<int> stage(m_estimators.size(), -1);
+    unsigned int assigned = 0;
+    while ( assigned < m_estimators.size() )
+    {
+        unsigned int assignedBefore = assigned;
+        for (unsigned int i = 0; i < m_estimators.size(); i++)
+        {
+            if ( stage[i] >= 0 )
+                continue;
+            int estimatorStage = 0;
+            bool ready = true;
+            for (unsigned int d = 0; d < dependencies[i].size(); d++)
+            {
+                std::vector<std::string>::const_iterator dep = std::find(m_names.begin(), m_names.end(), dependencies[i][d]);
+                if ( dep == m_names.end() )
+                {
+                    // The dependency is not running in this module, its outputs are read from ports
+                    continue;
+                }
+                int depStage = stage[dep - m_names.begin()];
+                if ( depStage < 0 )
+                {
+                    ready = false;
+                    break;
+                }
+                estimatorStage = std::max(estimatorStage, depStage + 1);
+            }
+            if ( ready )
+            {
+                stage[i] = estimatorStage;
+                assigned++;
+            }
+        }
+        if ( assigned == assignedBefore )
+        {
+            yError("[EstimatorsScheduler::computeStages] The dependencies of the estimators contain a cycle");
+            return false;
+        }
+    }
+
+    m_stages.clear();
+    for (unsigned int i = 0; i < m_estimators.size(); i++)
+    {
+        if ( stage[i] >= (int) m_stages.size() )
+            m_stages.resize(stage[i] + 1);
+        m_stages[stage[i]].push_back(i);
+    }
+    return true;
+}
+
+void EstimatorsScheduler::runTick(const SensorsSnapshot &snapshot)
+{
+    for (unsigned int s = 0; s < m_stages.size(); s++)
+    {
+        m_due.clear();
+        for (unsigned int e = 0; e < m_stages[s].size(); e++)
+        {
+            unsigned int i = m_stages[s][e];
+            if ( m_tick % m_decimation[i] == 0 )
+                m_due.push_back(m_estimators[i]);
+        }
+        if ( m_due.empty() )
+            continue;
+
+        unsigned int dispatched = std::min((unsigned int) m_due.size() - 1, (unsigned int) m_workers.size());
+        for (unsigned int w = 0; w < dispatched; w++)
+        {
+            m_workers[w]->dispatch(m_due[w + 1], &snapshot);
+        }
+        m_due[0]->run(snapshot);
+        for (unsigned int e = dispatched + 1; e < m_due.size(); e++)
+        {
+            m_due[e]->run(snapshot);
+        }
+        for (unsigned int w = 0; w < dispatched; w++)
+        {
+            m_done.wait();
+        }
+    }
+    m_tick++;
+}
+
+void EstimatorsScheduler::release()
+{
+    for (unsigned int w = 0; w < m_workers.size(); w++)
+    {
+        m_workers[w]->stop();
+        delete m_workers[w];
+    }
+    m_workers.clear();
+}
@@ -3,6 +3,9 @@
 
 #include "kdl/frames_io.hpp"
 #include <yarp/math/Math.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
 
 using namespace yarp::os;
 using namespace yarp::sig;
@@ -11,6 +14,37 @@ using namespace iDynTree;
 
 REGISTERIMPL(LeggedOdometry);
 
+FloatingBasePositionPortable::FloatingBasePositionPortable(): floatingbase_P_foot(3,0.0)
+{
+}
+
+bool FloatingBasePositionPortable::read(ConnectionReader& connection)
+{
+    Bottle bot;
+    if( !bot.read(connection) || bot.size() != 1 || !bot.get(0).isList() )
+    {
+        return false;
+    }
+    return Portable::copyPortable(*(bot.get(0).asList()),floatingbase_P_foot);
+}
+
+bool FloatingBasePositionPortable::write(ConnectionWriter& connection)
+{
+    if( connection.isTextMode() )
+    {
+        Bottle bot;
+        bot.addList().read(floatingbase_P_foot);
+        return bot.write(connection);
+    }
+
+    // yarp::sig::Vector::write produces the binary layout of a list element of a Bottle
+    connection.appendInt(BOTTLE_TAG_LIST);
+    connection.appendInt(1);
+    bool ok = floatingbase_P_foot.write(connection);
+    connection.convertTextMode();
+    return ok && !connection.isError();
+}
+
 LeggedOdometry::LeggedOdometry() : m_className("LeggedOdometry")
 {
 }
@@ -251,7 +285,7 @@ bool LeggedOdometry::init(ResourceFinder &rf, wbi::iWholeBodySensors *wbs)
     << initial_world_frame << " and initial fixed link " << initial_fixed_link;
     
     this->odometry_enabled = true;
-    world_H_floatingbase.resize(4,4);
+    world_H_floatingbase = KDL::Frame::Identity();
     floatingbase_twist.resize(6,0.0);
     floatingbase_acctwist.resize(6,0.0);
     
@@ -301,7 +335,7 @@ bool LeggedOdometry::init(ResourceFinder &rf, wbi::iWholeBodySensors *wbs)
     
     
     // Open ports
-    port_floatingbasestate = new BufferedPort<Bottle>;
+    port_floatingbasestate = new BufferedPort<FloatingBasePositionPortable>;
     port_floatingbasestate->open(std::string("/"+ this->m_className +"/floatingbasestate:o"));
     
     if( this->com_streaming_enabled )
@@ -319,12 +353,12 @@ bool LeggedOdometry::init(ResourceFinder &rf, wbi::iWholeBodySensors *wbs)
     yInfo("[LeggedOdometry::init()] LeggedOdometry is running ... \n");
 }
 
-void LeggedOdometry::run()
+void LeggedOdometry::run(const SensorsSnapshot &snapshot)
 {
     
     if( this->odometry_enabled )
     {
-        readRobotStatus();
+        readRobotStatus(snapshot);
 //        std::cerr << "robot status read! " << std::endl;
         
         // Read joint position, velocity and accelerations into the odometry helper model
@@ -335,30 +369,20 @@ void LeggedOdometry::run()
                                        m_joint_status->getJointAccKDL());
         
         // Get floating base position in the world
-        KDL::Frame world_H_floatingbase_kdl = odometry_helper.getWorldFrameTransform(this->odometry_floating_base_frame_index);
-        
-        // Publish the floating base position on the port
-        KDLtoYarp_position(world_H_floatingbase_kdl,this->world_H_floatingbase);
+        // The whole path uses fixed size KDL frames, so that no memory is allocated at each tick
+        this->world_H_floatingbase = odometry_helper.getWorldFrameTransform(this->odometry_floating_base_frame_index);
         
-        yarp::os::Bottle & bot = port_floatingbasestate->prepare();
-        bot.clear();
-        // This matrix is serialized row-wise!!!!
-        yarp::sig::Vector world_P_floatingbase = this->world_H_floatingbase.subcol(0, 3, 3);
-//        std::cerr << "[Legged Odometry] Position from foot to floating base " << std::endl << world_P_floatingbase.toString().c_str() << std::endl;
         //NOTE: Temporal hack for having floatingbase_P_world
-        yarp::sig::Matrix world_R_floatingbase = this->world_H_floatingbase.submatrix(0, 2, 0, 2);
-//        std::cerr << "[Legged Odometry] Rotation from floating base to foot " << std::endl << world_R_floatingbase.toString().c_str() << std::endl;
-        
-        yarp::sig::Matrix floatingbase_H_world(4,4);
-        floatingbase_H_world = yarp::math::SE3inv(world_H_floatingbase);
-        yarp::sig::Vector floatingbase_P_foot(3);
-        floatingbase_P_foot = floatingbase_H_world.subcol(0, 3, 3);
-//        std::cerr << "[Legged Odometry] Position vector from floating base to foot " << floatingbase_P_foot.toString().c_str() << std::endl;
-        bot.addList().read(floatingbase_P_foot);
+        // floatingbase_P_foot is the translation of floatingbase_H_world = world_H_floatingbase^-1, i.e. -world_R_floatingbase^T*world_P_floatingbase
+        KDL::Vector floatingbase_P_foot = -(this->world_H_floatingbase.M.Inverse(this->world_H_floatingbase.p));
+//        std::cerr << "[Legged Odometry] Position vector from floating base to foot " << floatingbase_P_foot << std::endl;
         
-//        bot.addList().read(world_P_floatingbase);
-//        bot.addList().read(this->floatingbase_twist);
-//        bot.addList().read(this->floatingbase_acctwist);
+        // Publish the floating base position on the port, filling the preallocated message in place
+        yarp::sig::Vector & floatingbase_state = port_floatingbasestate->prepare().floatingbase_P_foot;
+        for (int i = 0; i < 3; i++)
+        {
+            floatingbase_state(i) = floatingbase_P_foot(i);
+        }
         
         port_floatingbasestate->write();
         
@@ -399,13 +423,19 @@ void LeggedOdometry::run()
     }
 }
 
-void LeggedOdometry::readRobotStatus()
+void LeggedOdometry::readRobotStatus(const SensorsSnapshot &snapshot)
 {
-    // Last two arguments specify not retrieving timestamps and not to wait to get a sensor measurement
+    // Encoders are read once per tick by WholeBodyEstimatorThread, in the same serialization of m_sensors
 //    std::cerr << "Reading robot status" << std::endl;
-    if ( !m_sensors->readSensors(wbi::SENSOR_ENCODER_POS, m_joint_status->getJointPosKDL().data.data(), NULL, false) )
+    if ( !snapshot.encodersValid ||
+         snapshot.jointPositions.size() != (size_t) m_joint_status->getJointPosKDL().rows() )
     {
         yError("[LeggedOdometry::readRobotStatus()] Encoders could not be read!");
+    } else {
+        for (unsigned int dof = 0; dof < snapshot.jointPositions.size(); dof++)
+        {
+            m_joint_status->getJointPosKDL()(dof) = snapshot.jointPositions(dof);
+        }
     }
 
     // Update yarp vectors.
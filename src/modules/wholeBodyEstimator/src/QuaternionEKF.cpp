@@ -80,18 +80,7 @@ bool QuaternionEKF::init(ResourceFinder &rf, wbi::iWholeBodySensors *wbs)
         m_outputPortsList.push_back(floatingBaseRotPort);
     }
 
-    //FIXME: Temporary, while yarpWholeBodySensors is finished.
-    // Open sensor ports
-    sensorMeasPort = new yarp::os::Port;
-    readerPortStruct sensorDataPort;
-    std::string srcPort = std::string("/" + this->m_quaternionEKFParams.robotPrefix + "/right_leg/inertialMTB");
-    if ( !sensorDataPort.configurePort(this->m_className, std::string("rightFootMTBreader"), srcPort, sensorMeasPort) )
-    {
-        yError("[QuaternionEKF::init] Could not connect to source port");
-        return false;
-    } else {
-        m_inputPortsList.push_back(sensorDataPort);
-    }
+    // The MTB measurements are read by WholeBodyEstimatorThread and passed to run()
     
     std::string srcPortFloatingBasePose = "/LeggedOdometry/floatingbasestate:o";
 //    std::cerr << "[QuaternionEKF] Checking existance of floating base port ... " << std::endl;
@@ -114,25 +103,26 @@ bool QuaternionEKF::init(ResourceFinder &rf, wbi::iWholeBodySensors *wbs)
 
 
     // Initialize rf-dependent private variables
-    m_prior_mu_vec.resize(m_quaternionEKFParams.stateSize);
-    m_posterior_state.resize(m_quaternionEKFParams.stateSize);
-
-    // Create system model
-    createSystemModel();
+    m_estimateQuaternion.resize(m_quaternionEKFParams.stateSize, 0.0);
+    m_estimateEuler.resize(3, 0.0);
 
-    // Create measurement model
-    createMeasurementModel();
-
-    // Setting priors
-    setPriors();
-
-    // Create filter
-    createFilter();
+    // Configure filter
+    if ( !configureFilter() )
+    {
+        yError("[QuaternionEKF::init] The filter could not be configured");
+        return false;
+    }
 
     // Initialize measurement object
     measurements.linAcc.resize(3,0.0);
     measurements.angVel.resize(3,0.0);
 
+    // Initialize the rotations computed by run()
+    m_rot_from_euler.resize(3,3);
+    m_rot_from_world_to_sensor.resize(3,3);
+    m_rot_from_floatingBase_to_world.resize(3,3);
+    m_rot_from_floatingBase_to_world = 0;
+
     // Should this module provide the floating base attitude in the world defined by QuaternionEKF?
     if (m_quaternionEKFParams.floatingBaseAttitude)
     {
@@ -186,89 +176,46 @@ bool QuaternionEKF::init(ResourceFinder &rf, wbi::iWholeBodySensors *wbs)
     return true;
 }
 
-void QuaternionEKF::run()
+void QuaternionEKF::run(const SensorsSnapshot &snapshot)
 {
-    // Read sensor data
+    // Parse sensor data
 //    std::cerr << "[QuaternionEKF] Reading sensor data ... " << std::endl;
-    if ( !readSensorData(measurements) )
+    if ( !readSensorData(snapshot, measurements) )
     {
         yWarning("[QuaternionEKF::run] SENSOR DATA COULD NOT BE READ!");
     } else {
         //yInfo("[QuaternionEKF::run] Parsed sensor data: \n Acc [m/s^2]: \t%s \n Ang Vel [deg/s]: \t%s \n",  (measurements.linAcc).toString().c_str(), (measurements.angVel).toString().c_str());
     }
 
-    // Copy ang velocity data from a yarp vector into a ColumnVector
-    MatrixWrapper::ColumnVector input(measurements.angVel.data(),m_quaternionEKFParams.inputSize);
-    // Copy accelerometer data from a yarp vector into a ColumnVector
-    MatrixWrapper::ColumnVector measurement(measurements.linAcc.data(),m_quaternionEKFParams.measurementSize);
-
-    // Noise gaussian
-    // System Noise Mean
-    //TODO: [NOT SURE] This mean changes!!!
-    MatrixWrapper::ColumnVector sys_noise_mu(m_quaternionEKFParams.stateSize);
-    sys_noise_mu = 0.0;
-
-    /**************** System Noise Covariance *********************************************************/
-    MatrixWrapper::Matrix Xi(m_quaternionEKFParams.stateSize, m_quaternionEKFParams.inputSize);
-    XiOperator(m_posterior_state, &Xi);
-    MatrixWrapper::SymmetricMatrix sys_noise_cov(m_quaternionEKFParams.stateSize);
-    sys_noise_cov = 0.0;
-    // NOTE m_sigma_gyro must be small, ||ek|| = 10e-3 rad/sec
-    MatrixWrapper::Matrix Sigma_gyro(m_quaternionEKFParams.inputSize,m_quaternionEKFParams.inputSize);
-    Sigma_gyro = 0.0;
-    Sigma_gyro(1,1) = Sigma_gyro(2,2) = Sigma_gyro(3,3) = m_quaternionEKFParams.sigmaGyro;
-    MatrixWrapper::Matrix tmp = Xi*Sigma_gyro*Xi.transpose();
-    //NOTE: on 30-07-2015 I commented the following lines because making this matrix symmetric this way does not make much sense from a theoretical point of view. I'd rather add a term such as alpha*I_4x4
-    //         MatrixWrapper::SymmetricMatrix tmpSym(m_state_size);
-    //         tmp.convertToSymmetricMatrix(tmpSym);
-    sys_noise_cov = (MatrixWrapper::SymmetricMatrix) tmp*pow(m_quaternionEKFParams.period/(1000.0*2.0),2);
-    //NOTE: Next line is setting system noise covariance matrix to a constant diagonal matrix
-    //         sys_noise_cov = 0.0; sys_noise_cov(1,1) = sys_noise_cov (2,2) = sys_noise_cov(3,3) = sys_noise_cov(4,4) = 0.000001;
-    /**************** ENDS System Noise Covariance *******************************************************/
-
-    //std::cout << "System covariance matrix will be: " << std::endl << sys_noise_cov << std::endl;
-
-    //FIXME: Remove the line below as the mean pretty much never changes and remains zero
-    //m_sysPdf->AdditiveNoiseMuSet(sys_noise_mu);
-    m_sysPdf->AdditiveNoiseSigmaSet(sys_noise_cov);
-
-    if(!m_filter->Update(m_sys_model, input, m_meas_model, measurement))
-    {
-        yError("[QuaternionEKF::run] Update step of the Kalman Filter could not be performed\n");
-    }
+    // Prediction with the gyroscope (the system noise covariance depends on the last estimate)
+    // and correction with the accelerometer
+    m_filter.step(Eigen::Map<const Eigen::Vector3d>(measurements.angVel.data()),
+                  Eigen::Map<const Eigen::Vector3d>(measurements.linAcc.data()));
 
-    // Get the posterior of the updated filter. Result of all the system model and meaurement information
-    BFL::Pdf<BFL::ColumnVector> * posterior = m_filter->PostGet();
     // Posterior Expectation
-    m_posterior_state = posterior->ExpectedValueGet();
-    MatrixWrapper::Quaternion expectedValueQuat(m_posterior_state);
-    // Posterior Covariance
-    MatrixWrapper::SymmetricMatrix covariance(m_quaternionEKFParams.stateSize);
-    covariance = posterior->CovarianceGet();
-    //std::cout << "[QuaternionEKF::run] Posterior Mean: " << expectedValueQuat << std::endl;
-    //std::cout << "Posterior Covariance: " << posterior->CovarianceGet() << std::endl;
-    MatrixWrapper::Quaternion tmpQuat(expectedValueQuat);
-    //tmpQuat.getEulerAngles(std::string("xyz"), eulerAngles);
-    expectedValueQuat.conjugate(tmpQuat);
-    tmpQuat.getEulerAngles(std::string("xyz"), eulerAngles);
+    const iCub::ctrl::realTime::QuaternionEKF::StateType& posterior_state = m_filter.getState();
+    //std::cout << "[QuaternionEKF::run] Posterior Mean: " << posterior_state.transpose() << std::endl;
+    //std::cout << "Posterior Covariance: " << m_filter.getCovariance() << std::endl;
+    iCub::ctrl::realTime::QuaternionEKF::StateType conjugateQuat(posterior_state(0), -posterior_state(1), -posterior_state(2), -posterior_state(3));
+    Eigen::Vector3d tmpEuler;
+    iCub::ctrl::realTime::QuaternionEKF::eulerAnglesXYZ(conjugateQuat, tmpEuler);
+    for (unsigned int i=1; i<eulerAngles.rows()+1; i++)
+        eulerAngles(i) = tmpEuler(i-1);
     //std::cout << "[QuaternionEKF::run] Posterior Mean in Euler Angles: " << (180/PI)*eulerAngles  << std::endl;
     // Publish results to port
-    yarp::sig::Vector tmpVec(m_quaternionEKFParams.stateSize);
-    for (unsigned int i=1; i<m_posterior_state.size()+1; i++) {
-        tmpVec(i-1) = m_posterior_state(i);
+    for (unsigned int i=0; i<m_estimateQuaternion.size(); i++) {
+        m_estimateQuaternion(i) = posterior_state(i);
     }
     // Publish Euler Angles estimate to port
-    //TODO: Check why I need to do this multiplication in this particular way.
-    yarp::sig::Vector tmpEuler(3);
-    for (unsigned int i=1; i<eulerAngles.rows()+1; i++)
-        tmpEuler(i-1) = eulerAngles(i)*(180/PI);
+    for (unsigned int i=0; i<m_estimateEuler.size(); i++)
+        m_estimateEuler(i) = tmpEuler(i)*(180/PI);
     // Writing to port the full estimated orientation in Euler angles (xyz order)
     yarp::sig::Vector& tmpPortEuler = m_outputPortsList[ORIENTATION_ESTIMATE_PORT_EULER].outputPort->prepare();
-    tmpPortEuler = tmpEuler;
+    tmpPortEuler = m_estimateEuler;
     m_outputPortsList[ORIENTATION_ESTIMATE_PORT_EULER].outputPort->write();
     // Writing to port the full estimated quaternion
     yarp::sig::Vector& tmpPortRef = m_outputPortsList[ORIENTATION_ESTIMATE_PORT_QUATERNION].outputPort->prepare();
-    tmpPortRef = tmpVec;
+    tmpPortRef = m_estimateQuaternion;
     m_outputPortsList[ORIENTATION_ESTIMATE_PORT_QUATERNION].outputPort->write();
 
 
@@ -276,20 +223,22 @@ void QuaternionEKF::run()
     /**
      *  Estimate floating base attitude
      */
-    // rot_from_world_to_sensor which is the result of the estimate a.k.a. tmpQuat in previous lines.
-    MatrixWrapper::Matrix rot_from_world_to_sensor(3,3);
-    rot_from_world_to_sensor = 0;
+    // rot_from_world_to_sensor which is the result of the estimate a.k.a. conjugateQuat in previous lines.
     // Intentionally setting the yaw to zero as this is not yet properly estimated from magnetometer measurements.
-    rot_from_world_to_sensor.eulerToRotation(eulerAngles(1), eulerAngles(2), 0);
+    m_rot_from_euler.eulerToRotation(eulerAngles(1), eulerAngles(2), 0);
     // When using Eigen I need to transpose this matrix 
-    rot_from_world_to_sensor = rot_from_world_to_sensor.transpose();
+    for (unsigned int i=1; i<=3; i++)
+    {
+        for (unsigned int j=1; j<=3; j++)
+        {
+            m_rot_from_world_to_sensor(i,j) = m_rot_from_euler(j,i);
+        }
+    }
     // Output matrix rot_from_floatingBase_to_world
-//    std::cerr << "[QuaternionEKF::run] Rotation from world to sensor: " << std::endl << rot_from_world_to_sensor << std::endl;
-    MatrixWrapper::Matrix rot_from_floatingBase_to_world(3,3);
-    rot_from_floatingBase_to_world = 0;
+//    std::cerr << "[QuaternionEKF::run] Rotation from world to sensor: " << std::endl << m_rot_from_world_to_sensor << std::endl;
     if ( m_quaternionEKFParams.floatingBaseAttitude )
     {
-        m_floatingBaseEstimate->compute_Rot_from_floatingBase_to_world(rot_from_world_to_sensor, rot_from_floatingBase_to_world);
+        m_floatingBaseEstimate->compute_Rot_from_floatingBase_to_world(m_rot_from_world_to_sensor, m_rot_from_floatingBase_to_world);
     }
     
 
@@ -313,9 +262,7 @@ void QuaternionEKF::run()
      *  Currently, this is actually the position of l_sole from the floating base (root) expressed in root.
      */
     
-    yarp::os::Bottle floatingBasePositionBottle;
-    yarp::sig::Vector floatingBasePosition(3);
-    floatingBasePosition = 0;
+    Eigen::Vector3d floatingBasePosition = Eigen::Vector3d::Zero();
 
 //    std::cerr << "[QuaternionEKF] Checking existance of floating base port ... " << std::endl;
 //    if ( yarp::os::Network::exists("/LeggedOdometry/floatingbasestate:o") )
@@ -336,44 +283,29 @@ void QuaternionEKF::run()
     if ( m_quaternionEKFParams.floatingBaseAttitude )
     {
         // Creating roto-translation matrix
-        MatrixWrapper::Matrix rotoTrans_from_floatingBase_to_world(4,4);
-        rotoTrans_from_floatingBase_to_world = 0;
+        Eigen::Matrix4d rotoTrans_from_floatingBase_to_world = Eigen::Matrix4d::Zero();
         // Copying rotational part
-        rotoTrans_from_floatingBase_to_world.setSubMatrix(rot_from_floatingBase_to_world, 1, 3, 1, 3);
-        // Copying translational part
-        MatrixWrapper::ColumnVector pos_from_floatingBase_to_foot_in_floatingBase(floatingBasePosition.data(),3);
-//        std::cerr << "[QuaternionEKF] pos from floating base to foot in floating base: " << std::endl << pos_from_floatingBase_to_foot_in_floatingBase << std::endl;
-        MatrixWrapper::ColumnVector tmpPosition = rot_from_floatingBase_to_world*pos_from_floatingBase_to_foot_in_floatingBase;
-//        std::cerr << "[QuaternionEKF] pos from floating base to foot in world" << std::endl << tmpPosition << std::endl;
-        
-        // Position will contain the homogeneous position vector from floating base to l_sole expressed in floating base.
-        MatrixWrapper::ColumnVector position(4);
-        position = 0; // all rows 1. After setting the first three values, the last one will remain 1.
-        position(1) = tmpPosition(1);
-        position(2) = tmpPosition(2);
-        position(3) = tmpPosition(3);
-        //TODO: Add to this vector the position vector from <world> to <l_sole> expressed in <world> should be roughly [0 0 distance_from_l_sole_to_accelerometer]
-        MatrixWrapper::ColumnVector pos_from_world_to_lsole_in_world(4); pos_from_world_to_lsole_in_world = 0;
-        pos_from_world_to_lsole_in_world(3) = 0.01;
-        pos_from_world_to_lsole_in_world(4) = 1;
-        MatrixWrapper::ColumnVector pos_from_world_to_floatingBase_in_world = pos_from_world_to_lsole_in_world - position;
-//        std::cerr << "[Quaternion] Position from world to floating base in world: " << pos_from_world_to_floatingBase_in_world << std::endl;
-        rotoTrans_from_floatingBase_to_world.setColumn(pos_from_world_to_floatingBase_in_world, 4);
-        
-        
-        yarp::sig::Vector tmpRotMatVec(16);
-        // Streaming columnwise
-        unsigned int k = 0;
-        for (unsigned int j=0; j<4; j++)
+        for (unsigned int i=0; i<3; i++)
         {
-            for (unsigned int i=0; i<4; i++)
+            for (unsigned int j=0; j<3; j++)
             {
-                tmpRotMatVec(k) = rotoTrans_from_floatingBase_to_world(i+1,j+1);
-                k++;
+                rotoTrans_from_floatingBase_to_world(i,j) = m_rot_from_floatingBase_to_world(i+1,j+1);
             }
         }
+        // Copying translational part
+        // Position from floating base to l_sole expressed in world.
+        Eigen::Vector3d position = rotoTrans_from_floatingBase_to_world.topLeftCorner<3,3>()*floatingBasePosition;
+//        std::cerr << "[QuaternionEKF] pos from floating base to foot in world" << std::endl << position << std::endl;
+        //TODO: Add to this vector the position vector from <world> to <l_sole> expressed in <world> should be roughly [0 0 distance_from_l_sole_to_accelerometer]
+        Eigen::Vector3d pos_from_world_to_lsole_in_world(0.0, 0.0, 0.01);
+        rotoTrans_from_floatingBase_to_world.topRightCorner<3,1>() = pos_from_world_to_lsole_in_world - position;
+        rotoTrans_from_floatingBase_to_world(3,3) = 1.0;
+//        std::cerr << "[Quaternion] Position from world to floating base in world: " << rotoTrans_from_floatingBase_to_world.topRightCorner<3,1>() << std::endl;
+        
+        // Streaming columnwise
         yarp::sig::Vector &tmpFloatingBaseRotation = m_outputPortsList[FLOATING_BASE_ROTATION_PORT].outputPort->prepare();
-        tmpFloatingBaseRotation = tmpRotMatVec;
+        tmpFloatingBaseRotation.resize(16);
+        Eigen::Map<Eigen::Matrix4d>(tmpFloatingBaseRotation.data()) = rotoTrans_from_floatingBase_to_world;
         m_outputPortsList[FLOATING_BASE_ROTATION_PORT].outputPort->write();
     }
 }
@@ -394,43 +326,6 @@ void QuaternionEKF::release()
         m_quaternionEKFParams.rot_from_ft_to_acc_bottle = 0;
         yDebug("[QuaternionEKF::~QuaternionEKF] Deallocated m_quaternionEKFParams.rot_from_ft_to_acc_bottle");
     }
-    if (m_filter)
-    {
-        delete m_filter;
-        m_filter = NULL;
-        yDebug("[QuaternionEKF::~QuaternionEKF] m_filter deleted");
-    }
-    if (m_measPdf)
-    {
-        delete m_measPdf;
-        m_measPdf = NULL;
-        yDebug("[QuaternionEKF::~QuaternionEKF] m_measPdf deleted");
-    }
-    if (m_measurement_uncertainty)
-    {
-        delete m_measurement_uncertainty;
-        m_measurement_uncertainty = NULL;
-        yDebug("[QuaternionEKF::~QuaternionEKF] m_measurement_uncertainty deleted");
-    }
-    if (m_meas_model)
-    {
-        delete m_meas_model;
-        m_meas_model = NULL;
-        yDebug("[QuaternionEKF::~QuaternionEKF] m_meas_model deleted");
-    }
-    if (m_prior)
-    {
-        delete m_prior;
-        m_prior = NULL;
-        yDebug("[QuaternionEKF::~QuaternionEKF] m_prior deleted");
-    }
-    if (m_sys_model)
-    {
-        delete m_sys_model;
-        m_sys_model = NULL;
-        yDebug("[QuaternionEKF::~QuaternionEKF] m_sys_model deleted");
-    }
-    
     // Closing ports
 //    for (std::vector<publisherPortStruct>::iterator it = m_outputPortsList.begin() ; it != m_outputPortsList.end() ; it++)
 //    {
@@ -494,76 +389,30 @@ bool QuaternionEKF::readEstimatorParams(yarp::os::ResourceFinder &rf, quaternion
     return true;
 }
 
-void QuaternionEKF::createSystemModel()
-{
-    // System Noise Mean
-    MatrixWrapper::ColumnVector sys_noise_mu(m_quaternionEKFParams.stateSize);
-    sys_noise_mu(1) = sys_noise_mu(2) = sys_noise_mu(3) = sys_noise_mu(4) = 0.0;
-
-    // System Noise Covariance
-    MatrixWrapper::SymmetricMatrix sys_noise_cov(m_quaternionEKFParams.stateSize);
-    sys_noise_cov = 0.0;
-    sys_noise_cov(1,1) = sys_noise_cov(2,2) = sys_noise_cov(3,3) = sys_noise_cov(4,4) = m_quaternionEKFParams.sigmaSystemNoise;
-
-    // Setting System noise uncertainty
-    m_sysPdf = new BFL::nonLinearAnalyticConditionalGaussian(m_quaternionEKFParams.stateSize);
-    m_sysPdf->AdditiveNoiseMuSet(sys_noise_mu);
-    m_sysPdf->AdditiveNoiseSigmaSet(sys_noise_cov);
-    m_sysPdf->setPeriod(m_quaternionEKFParams.period);
-    // Creating the model
-    m_sys_model = new BFL::AnalyticSystemModelGaussianUncertainty(m_sysPdf);
-
-}
-
-void QuaternionEKF::createMeasurementModel()
-{
-    // Creating measurement model for linear measurement model
-    // Measurement noise distribution
-    // Measurement noise mean
-    MatrixWrapper::ColumnVector meas_noise_mu(m_quaternionEKFParams.measurementSize);
-    meas_noise_mu = 0.0;                // Set all to zero
-    meas_noise_mu(3) = 0.0;
-    // Measurement noise covariance
-    MatrixWrapper::SymmetricMatrix meas_noise_cov(m_quaternionEKFParams.measurementSize);
-    meas_noise_cov = 0.0;
-    meas_noise_cov(1,1) = meas_noise_cov(2,2) = meas_noise_cov(3,3) = m_quaternionEKFParams.sigmaMeasurementNoise;
-    // Measurement noise uncertainty
-    //TODO: Remember to delete this object at the end
-    m_measurement_uncertainty = new BFL::Gaussian(meas_noise_mu, meas_noise_cov);
-    // Probability density function (PDF) for the measurement
-    m_measPdf = new BFL::nonLinearMeasurementGaussianPdf(*m_measurement_uncertainty);
-    //  Measurement model from the measurement PDF
-    m_meas_model = new BFL::AnalyticMeasurementModelGaussianUncertainty(m_measPdf);
-
-}
-
-void QuaternionEKF::setPriors()
+bool QuaternionEKF::configureFilter()
 {
+    // The filter has a fixed size: state quaternion, gyroscope input and accelerometer measurement
+    if ( m_quaternionEKFParams.stateSize != 4 || m_quaternionEKFParams.inputSize != 3 || m_quaternionEKFParams.measurementSize != 3 )
+    {
+        yError("[QuaternionEKF::configureFilter] state_size, input_size and measurement_size should be 4, 3 and 3");
+        return false;
+    }
+    m_filter.setTs(m_quaternionEKFParams.period/1000.0);
+    m_filter.setGyroscopeNoise(m_quaternionEKFParams.sigmaGyro);
+    m_filter.setAccelerometerNoise(m_quaternionEKFParams.sigmaMeasurementNoise);
+    m_filter.setGravity(GRAVITY_NOMINAL);
     // Setting prior. This is equivalent to a zero rotation
-    MatrixWrapper::ColumnVector prior_mu(m_quaternionEKFParams.stateSize);
-    prior_mu = 0.0;
-    prior_mu(1) = 1.0;
-    m_prior_mu_vec = prior_mu;
-    m_posterior_state = prior_mu;
-    MatrixWrapper::SymmetricMatrix prior_cov(4);
-    prior_cov = 0.0;
-    prior_cov(1,1) = prior_cov(2,2) = prior_cov(3,3) = prior_cov(4,4) = m_quaternionEKFParams.priorCovariance;
-    yInfo("[QuaternionEKF::setPriors] Priors will be: ");
-    std::cout << "[QuaternionEKF::setPriors] State prior:" << std::endl << prior_mu << std::endl;
-    std::cout << "[QuaternionEKF::setPriors] Covariance prior: " << std::endl << prior_cov << std::endl;
-    m_prior = new BFL::Gaussian(prior_mu, prior_cov);
-
-}
-
-void QuaternionEKF::createFilter()
-{
-    m_filter = new BFL::ExtendedKalmanFilter(m_prior);
+    m_filter.init(Eigen::Vector4d(1.0, 0.0, 0.0, 0.0), m_quaternionEKFParams.priorCovariance);
+    yInfo("[QuaternionEKF::configureFilter] Priors will be: ");
+    std::cout << "[QuaternionEKF::configureFilter] State prior:" << std::endl << m_filter.getState() << std::endl;
+    std::cout << "[QuaternionEKF::configureFilter] Covariance prior: " << std::endl << m_filter.getCovariance() << std::endl;
+    return true;
 }
 
-bool QuaternionEKF::readSensorData(measurementsStruct &meas)
+bool QuaternionEKF::readSensorData(const SensorsSnapshot &snapshot, measurementsStruct &meas)
 {
     //FIXME: TEMPORARY WHILE WHOLEBODYSENSORS IS FINISHED
-    if ( extractMTBDatafromPort(MTB_RIGHT_FOOT_ACC_PLUS_GYRO_2_ID, meas) )
+    if ( snapshot.mtbValid && extractMTBData(MTB_RIGHT_FOOT_ACC_PLUS_GYRO_2_ID, snapshot.mtbMeasurement, meas) )
         return true;
     else {
         yError("[QuaternionEKF::readSensorData] QuaternionEKF was not able to read sensor data.");
@@ -572,85 +421,53 @@ bool QuaternionEKF::readSensorData(measurementsStruct &meas)
 
 }
 
-bool QuaternionEKF::extractMTBDatafromPort(int boardNum, measurementsStruct &measurements)
+bool QuaternionEKF::extractMTBData(int boardNum, const yarp::sig::Vector &fullMeasurement, measurementsStruct &measurements)
 {
-    yarp::sig::Vector fullMeasurement;
-    yarp::os::Bottle measurementBottle;
     int indexSubVector = 0;
-    if ( !sensorMeasPort->read(fullMeasurement) ) {
-        yError("[QuaternionEKF::extractMTBDatafromPort] There was an error trying to read from the MTB port");
-        return false;
-    } else {
-        //yInfo("[QuaternionEKF::extractMTBDatafromPort] Raw meas: %s", fullMeasurement.toString().c_str());
-        /******************* searching for multiple instances of the sensor  **************************/
-        double* tmp;
-        tmp = fullMeasurement.data();
-        double *it = tmp + 2; // First two elements of the vector can be skipped
-        while (it < tmp + fullMeasurement.size()) {
-            it = std::find(it, it + (fullMeasurement.size() - indexSubVector), boardNum);
-            if (it < tmp + fullMeasurement.size()) {
-                indexSubVector = (int)(it - tmp) + 1;
-
-                // Parse sensor data
-                int trueindexSubVector = indexSubVector - 1;
-                if ( tmp[trueindexSubVector]  == boardNum ) {
-                    //  If sensor from board "boardNum" is an accelerometer
-                    if ( tmp[trueindexSubVector + 1] == 1.0) {
-                        measurements.linAcc(0) = tmp[trueindexSubVector + 3];
-                        measurements.linAcc(1) = tmp[trueindexSubVector + 4];
-                        measurements.linAcc(2) = tmp[trueindexSubVector + 5];
-                    } else {
-                        // If sensor from board "boardNum" is a gyroscope
-                        if ( tmp[trueindexSubVector + 1] == 2.0 ) {
-                            measurements.angVel(0) = tmp[trueindexSubVector + 3];
-                            measurements.angVel(1) = tmp[trueindexSubVector + 4];
-                            measurements.angVel(2) = tmp[trueindexSubVector + 5];
-                        }
+    //yInfo("[QuaternionEKF::extractMTBData] Raw meas: %s", fullMeasurement.toString().c_str());
+    /******************* searching for multiple instances of the sensor  **************************/
+    const double* tmp;
+    tmp = fullMeasurement.data();
+    const double *it = tmp + 2; // First two elements of the vector can be skipped
+    while (it < tmp + fullMeasurement.size()) {
+        it = std::find(it, it + (fullMeasurement.size() - indexSubVector), boardNum);
+        if (it < tmp + fullMeasurement.size()) {
+            indexSubVector = (int)(it - tmp) + 1;
+
+            // Parse sensor data
+            int trueindexSubVector = indexSubVector - 1;
+            if ( tmp[trueindexSubVector]  == boardNum ) {
+                //  If sensor from board "boardNum" is an accelerometer
+                if ( tmp[trueindexSubVector + 1] == 1.0) {
+                    measurements.linAcc(0) = tmp[trueindexSubVector + 3];
+                    measurements.linAcc(1) = tmp[trueindexSubVector + 4];
+                    measurements.linAcc(2) = tmp[trueindexSubVector + 5];
+                } else {
+                    // If sensor from board "boardNum" is a gyroscope
+                    if ( tmp[trueindexSubVector + 1] == 2.0 ) {
+                        measurements.angVel(0) = tmp[trueindexSubVector + 3];
+                        measurements.angVel(1) = tmp[trueindexSubVector + 4];
+                        measurements.angVel(2) = tmp[trueindexSubVector + 5];
                     }
                 }
-                it = it + MTB_PORT_DATA_PACKAGE_OFFSET; //Move to the next position in the vector where a package data is expected
             }
+            it = it + MTB_PORT_DATA_PACKAGE_OFFSET; //Move to the next position in the vector where a package data is expected
         }
-        /**********************************************************************************/
-        measurements.linAcc = measurements.linAcc*CONVERSION_FACTOR_ACC;
-        if (yarp::math::norm(measurements.linAcc) > 11.0) {
-            yWarning("[QuaternionEKF::extractMTBDatafromPort]  WARNING!!! Gravity's norm is too big!");
-        }
-        // This change of signs is just to rotate the gyro reference frame to match the accelerometer's ref frame given the way it's been installed on the foot.
-        measurements.angVel(1) = measurements.angVel(1);
-        measurements.angVel(2) = measurements.angVel(2);
-        measurements.angVel = PI/180*CONVERSION_FACTOR_GYRO*measurements.angVel;
-        if (yarp::math::norm(measurements.angVel) > 100.0) {
-            yWarning("[QuaternionEKF::extractMTBDatafromPort]  WARNING!!! [QuaternionEKF::extractMTBDatafromPort] Ang vel's norm is too big!");
-        }
+    }
+    /**********************************************************************************/
+    measurements.linAcc *= CONVERSION_FACTOR_ACC;
+    if (yarp::math::norm(measurements.linAcc) > 11.0) {
+        yWarning("[QuaternionEKF::extractMTBData]  WARNING!!! Gravity's norm is too big!");
+    }
+    // This change of signs is just to rotate the gyro reference frame to match the accelerometer's ref frame given the way it's been installed on the foot.
+    measurements.angVel(1) = measurements.angVel(1);
+    measurements.angVel(2) = measurements.angVel(2);
+    measurements.angVel *= PI/180*CONVERSION_FACTOR_GYRO;
+    if (yarp::math::norm(measurements.angVel) > 100.0) {
+        yWarning("[QuaternionEKF::extractMTBData]  WARNING!!! [QuaternionEKF::extractMTBData] Ang vel's norm is too big!");
     }
     return true;
 }
 
-void QuaternionEKF::XiOperator ( MatrixWrapper::ColumnVector quat, MatrixWrapper::Matrix* Xi )
-{
-    //     In  Matlab language this would be:
-    //     Xi = [       -qk(2:4,:)'           ;
-    //           qk(1)*eye(3) + S(qk(2:4,:)) ];
-    // NOTE When testing Eigen I changed the following line from 1.0 to 0.0. Couldn't understand why I would have put 1.0 for instance
-    (*Xi) = 0.0;
-    MatrixWrapper::ColumnVector omg(3);
-    omg(1) = quat(2);    omg(2) = quat(3);    omg(3) = quat(4);
-    (*Xi)(1,1) = -quat(2);    (*Xi)(1,2) = -quat(3);    (*Xi)(1,3) = -quat(4);
-    MatrixWrapper::Matrix eye(3,3);
-    eye.toIdentity();
-    MatrixWrapper::Matrix S(3,3);
-    SOperator(omg, &S);
-    MatrixWrapper::Matrix tmpAdd = eye*quat(1) + S;
-    Xi->setSubMatrix(tmpAdd,2,4,1,3);
-}
-
-void QuaternionEKF::SOperator ( MatrixWrapper::ColumnVector omg, MatrixWrapper::Matrix* S )
-{
-    (*S)(1,1) = 0.0;    (*S)(1,2) = -omg(3); (*S)(1,3) = omg(2);
-    (*S)(2,1) = omg(3); (*S)(2,2) = 0.0    ; (*S)(2,3) = -omg(1);
-    (*S)(3,1) = -omg(2);(*S)(3,2) = omg(1) ; (*S)(3,3) = 0.0;
-}
-
 QuaternionEKF::~QuaternionEKF()
 {}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 Fondazione Istituto Italiano di Tecnologia - Italian Institute of Technology
+ * Author: Jorhabib Eljaik
+ * email:  jorhabib.eljaik@iit.it
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "SensorsAcquisition.h"
+
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Time.h>
+
+SensorsAcquisition::SensorsAcquisition() : m_wbs(0),
+                                           m_mtbOpened(false),
+                                           m_mtbConnected(false)
+{
+}
+
+bool SensorsAcquisition::init(yarp::os::ResourceFinder &rf, wbi::iWholeBodySensors *wbs, bool useMTB, SensorsSnapshot &snapshot)
+{
+    m_wbs = wbs;
+
+    yarp::os::Bottle moduleParams = rf.findGroup("module_parameters");
+    if ( moduleParams.isNull() )
+    {
+        yError("[SensorsAcquisition::init] No module_parameters group was found.");
+        return false;
+    }
+    std::string robotName = moduleParams.find("robot").asString();
+    std::string moduleName = moduleParams.check("name", yarp::os::Value("wholeBodyEstimator")).asString();
+
+    // A single reader of the inertial MTB for all the estimators, only if one of them uses it
+    if ( useMTB )
+    {
+        std::string srcPort = std::string("/" + robotName + "/right_leg/inertialMTB");
+        std::string mtbPortName = std::string("/" + moduleName + "/rightFootMTB:i");
+        if ( !m_mtbPort.open(mtbPortName) )
+        {
+            yError("[SensorsAcquisition::init] Could not open input port %s", mtbPortName.c_str());
+            return false;
+        }
+        m_mtbOpened = true;
+        m_mtbConnected = yarp::os::Network::connect(srcPort, mtbPortName);
+        if ( !m_mtbConnected )
+        {
+            yWarning("[SensorsAcquisition::init] Could not connect to %s, the MTB measurements will not be available", srcPort.c_str());
+        }
+    }
+
+    snapshot.timestamp = 0.0;
+    snapshot.mtbValid = false;
+    snapshot.mtbFresh = false;
+    snapshot.encodersValid = false;
+    snapshot.jointPositions.resize(m_wbs ? m_wbs->getSensorList(wbi::SENSOR_ENCODER).size() : 0, 0.0);
+    return true;
+}
+
+void SensorsAcquisition::acquire(SensorsSnapshot &snapshot)
+{
+    snapshot.timestamp = yarp::os::Time::now();
+
+    // The MTB is not waited for, so that a stalled stream does not stop the estimators: the last
+    // packet is kept. The vector keeps its capacity between ticks, as the size of the MTB packages does not change
+    snapshot.mtbFresh = false;
+    if ( m_mtbConnected )
+    {
+        yarp::sig::Vector *mtbMeasurement = m_mtbPort.read(false);
+        if ( mtbMeasurement )
+        {
+            snapshot.mtbMeasurement = *mtbMeasurement;
+            snapshot.mtbValid = true;
+            snapshot.mtbFresh = true;
+        }
+    }
+
+    // Last two arguments specify not retrieving timestamps and not to wait to get a sensor measurement
+    snapshot.encodersValid = m_wbs && snapshot.jointPositions.size() > 0 &&
+                             m_wbs->readSensors(wbi::SENSOR_ENCODER_POS, snapshot.jointPositions.data(), NULL, false);
+    if ( m_wbs && snapshot.jointPositions.size() > 0 && !snapshot.encodersValid )
+    {
+        yError("[SensorsAcquisition::acquire] Encoders could not be read!");
+    }
+}
+
+void SensorsAcquisition::release()
+{
+    if ( m_mtbOpened )
+    {
+        m_mtbPort.interrupt();
+        m_mtbPort.close();
+    }
+    m_mtbOpened = false;
+    m_mtbConnected = false;
+}
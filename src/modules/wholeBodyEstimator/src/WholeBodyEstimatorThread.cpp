@@ -33,6 +33,18 @@ bool WholeBodyEstimatorThread::threadInit()
         }
     }
     
+    // Open the sensors shared by the estimators (the MTB only if an estimator uses it)
+    bool useMTB = false;
+    for (std::vector<IEstimator*>::iterator it = this->m_estimatorsList.begin(); it < this->m_estimatorsList.end(); ++it)
+    {
+        useMTB = useMTB || (*it)->usesMTB();
+    }
+    if ( !m_acquisition.init(m_rfCopy, m_wbs, useMTB, m_snapshot) )
+    {
+        yError("[WholeBodyEstimatorThread::threadInit()] Sensors acquisition could not be initialized");
+        return false;
+    }
+    
     // Initialize each estimator
     std::vector<IEstimator*>::iterator it;
     unsigned int k = 1;
@@ -49,6 +61,15 @@ bool WholeBodyEstimatorThread::threadInit()
         k++;
     }
     
+    // Schedule the estimators according to their dependencies and periods
+    yarp::os::Bottle moduleParams = m_rfCopy.findGroup("module_parameters");
+    int maxWorkers = moduleParams.check("estimator_threads", Value(2)).asInt();
+    if ( !m_scheduler.init(m_estimatorsList, m_estimatorsNames, getRate(), maxWorkers > 0 ? maxWorkers : 0, m_rfCopy) )
+    {
+        yError("[WholeBodyEstimatorThread::threadInit()] Estimators could not be scheduled");
+        return false;
+    }
+    
     return true;
 }
 
@@ -64,12 +85,9 @@ void WholeBodyEstimatorThread::run()
     
     this->m_run_mutex_acquired = true;
     
-    // run each estimator
-    std::vector<IEstimator*>::iterator it;
-    for (it = this->m_estimatorsList.begin(); it < this->m_estimatorsList.end(); ++it)
-    {
-        (*it)->run();
-    }
+    // read each sensor once, then run the estimators due at this tick, independent ones concurrently
+    m_acquisition.acquire(m_snapshot);
+    m_scheduler.runTick(m_snapshot);
 
     this->m_run_mutex_acquired = false;
     run_mutex.unlock();
@@ -79,6 +97,9 @@ void WholeBodyEstimatorThread::run()
 void WholeBodyEstimatorThread::threadRelease()
 {
     std::cerr << "[wholeBodyEstimatorThread::threadRelease] Starting thread closure... " << std::endl;
+    // Stop the workers before releasing the estimators they run
+    m_scheduler.release();
+    m_acquisition.release();
     // Delete each estimator
     unsigned int k = 1;
     std::vector<IEstimator*>::iterator it;
@@ -127,6 +148,7 @@ bool WholeBodyEstimatorThread::fillEstimatorsList()
         // This line is pretty much doing:
         // m_estimatorList[i] = new <class-name-from-map>
         m_estimatorsList.push_back( EstimatorsFactory::create(it->first) );
+        m_estimatorsNames.push_back( it->first );
     }
     
     return true;
@@ -30,6 +30,7 @@ namespace wholeBodyEstimator
          *  Updating rotation matrix from FT sensor to accelerometer
          */
         m_rot_from_ft_to_acc = rot_from_ft_to_acc;
+        m_rot_from_sensor_to_world.resize(3,3);
 
         /**
          *  Get module parameters of interest
@@ -95,7 +96,7 @@ namespace wholeBodyEstimator
     }
 
 
-    bool floatingBase::compute_Rot_from_floatingBase_to_world( MatrixWrapper::Matrix rot_from_world_to_sensor,
+    bool floatingBase::compute_Rot_from_floatingBase_to_world( const MatrixWrapper::Matrix &rot_from_world_to_sensor,
                                                                MatrixWrapper::Matrix &rot_from_floatingBase_to_world)
     {
         /**
@@ -129,7 +130,14 @@ namespace wholeBodyEstimator
         // Compute rot_from_floating_base_to_world
         wbi::Rotation wbi_rot_from_world_to_sensor;
         // Passing the transpose just because of the different storing order of the matrices
-        wbi_rot_from_world_to_sensor.setDcm(rot_from_world_to_sensor.transpose().data());
+        for (unsigned int i = 1; i <= 3; i++)
+        {
+            for (unsigned int j = 1; j <= 3; j++)
+            {
+                m_rot_from_sensor_to_world(i,j) = rot_from_world_to_sensor(j,i);
+            }
+        }
+        wbi_rot_from_world_to_sensor.setDcm(m_rot_from_sensor_to_world.data());
 //        std::cerr << "[floatinBase::compute_Rot_from_floatingBase_to_world] rot_from_world_to_sensor " << std::endl << rot_from_world_to_sensor << std::endl;
 //        std::cerr << "[floatinBase::compute_Rot_from_floatingBase_to_world] rot_from_acc_to_floating_base " << std::endl
 //        << rot_from_acc_to_floating_base.toString().c_str() << std::endl;
@@ -76,51 +76,54 @@ bool readerPort::configurePort(std::string className, std::string pName, std::st
 bool readerPort::extractMTBDatafromPort(int boardNum, yarp::os::Port * sensorMeasPort, measurementsStruct &measurements)
 {
     yarp::sig::Vector fullMeasurement;
-    yarp::os::Bottle measurementBottle;
-    int indexSubVector = 0;
     if ( !sensorMeasPort->read(fullMeasurement) ) {
         yError("[extractMTBDatafromPort] There was an error trying to read from the MTB port");
         return false;
-    } else {
-            //yInfo("[QuaternionEKF::extractMTBDatafromPort] Raw meas: %s", fullMeasurement.toString().c_str());
-        /******************* searching for multiple instances of the sensor  **************************/
-        double* tmp;
-        tmp = fullMeasurement.data();
-        double *it = tmp + 2; // First two elements of the vector can be skipped
-        while (it < tmp + fullMeasurement.size()) {
-            it = std::find(it, it + (fullMeasurement.size() - indexSubVector), boardNum);
-            if (it < tmp + fullMeasurement.size()) {
-                indexSubVector = static_cast<int>(it - tmp) + 1;
+    }
+    return extractMTBData(boardNum, fullMeasurement, measurements);
+}
 
-                // Parse sensor data
-                int trueindexSubVector = indexSubVector - 1;
-                if ( static_cast<int>(tmp[trueindexSubVector])  == boardNum ) {
-                    //  If sensor from board "boardNum" is an accelerometer
-                    if ( tmp[trueindexSubVector + 1] == 1.0) {
-                        measurements.linAcc(0) = tmp[trueindexSubVector + 3];
-                        measurements.linAcc(1) = tmp[trueindexSubVector + 4];
-                        measurements.linAcc(2) = tmp[trueindexSubVector + 5];
-                    } else {
-                        // If sensor from board "boardNum" is a gyroscope
-                        if ( tmp[trueindexSubVector + 1] == 2.0 ) {
-                            measurements.angVel(0) = tmp[trueindexSubVector + 3];
-                            measurements.angVel(1) = tmp[trueindexSubVector + 4];
-                            measurements.angVel(2) = tmp[trueindexSubVector + 5];
-                        }
+bool readerPort::extractMTBData(int boardNum, const yarp::sig::Vector &fullMeasurement, measurementsStruct &measurements)
+{
+    int indexSubVector = 0;
+    //yInfo("[QuaternionEKF::extractMTBDatafromPort] Raw meas: %s", fullMeasurement.toString().c_str());
+    /******************* searching for multiple instances of the sensor  **************************/
+    const double* tmp;
+    tmp = fullMeasurement.data();
+    const double *it = tmp + 2; // First two elements of the vector can be skipped
+    while (it < tmp + fullMeasurement.size()) {
+        it = std::find(it, it + (fullMeasurement.size() - indexSubVector), boardNum);
+        if (it < tmp + fullMeasurement.size()) {
+            indexSubVector = static_cast<int>(it - tmp) + 1;
+
+            // Parse sensor data
+            int trueindexSubVector = indexSubVector - 1;
+            if ( static_cast<int>(tmp[trueindexSubVector])  == boardNum ) {
+                //  If sensor from board "boardNum" is an accelerometer
+                if ( tmp[trueindexSubVector + 1] == 1.0) {
+                    measurements.linAcc(0) = tmp[trueindexSubVector + 3];
+                    measurements.linAcc(1) = tmp[trueindexSubVector + 4];
+                    measurements.linAcc(2) = tmp[trueindexSubVector + 5];
+                } else {
+                    // If sensor from board "boardNum" is a gyroscope
+                    if ( tmp[trueindexSubVector + 1] == 2.0 ) {
+                        measurements.angVel(0) = tmp[trueindexSubVector + 3];
+                        measurements.angVel(1) = tmp[trueindexSubVector + 4];
+                        measurements.angVel(2) = tmp[trueindexSubVector + 5];
                     }
                 }
-                it = it + MTB_PORT_DATA_PACKAGE_OFFSET; //Move to the next position in the vector where a package data is expected
             }
+            it = it + MTB_PORT_DATA_PACKAGE_OFFSET; //Move to the next position in the vector where a package data is expected
         }
-        /**********************************************************************************/
-        measurements.linAcc = measurements.linAcc*CONVERSION_FACTOR_ACC;
-        if (yarp::math::norm(measurements.linAcc) > 11.0) {
-            yWarning("[QuaternionEKF::extractMTBDatafromPort]  WARNING!!! Gravity's norm is too big!");
-        }
-        measurements.angVel = PI/180*CONVERSION_FACTOR_GYRO*measurements.angVel;
-        if (yarp::math::norm(measurements.angVel) > 100.0) {
-            yWarning("[QuaternionEKF::extractMTBDatafromPort]  WARNING!!! [QuaternionEKF::extractMTBDatafromPort] Ang vel's norm is too big!");
-        }
+    }
+    /**********************************************************************************/
+    measurements.linAcc *= CONVERSION_FACTOR_ACC;
+    if (yarp::math::norm(measurements.linAcc) > 11.0) {
+        yWarning("[QuaternionEKF::extractMTBDatafromPort]  WARNING!!! Gravity's norm is too big!");
+    }
+    measurements.angVel *= PI/180*CONVERSION_FACTOR_GYRO;
+    if (yarp::math::norm(measurements.angVel) > 100.0) {
+        yWarning("[QuaternionEKF::extractMTBDatafromPort]  WARNING!!! [QuaternionEKF::extractMTBDatafromPort] Ang vel's norm is too big!");
     }
     return true;
 }